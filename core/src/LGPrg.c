@@ -40,6 +40,9 @@
 #include <stdarg.h>
 
 #include "Ludogram.h"
+#include "PGDeleteQueue.h"
+#include "PGDataTypes.h"
+#include "PGProfiler.h"
 
 
 #pragma mark - GL Logging
@@ -102,7 +105,7 @@ LGPrgVar * LGPrgVarNew(GLint location, GLint size, GLenum type, const char * nam
 	// hashing is simpler.
 	size_t recordSize = offsetof(LGPrgVar, name) + nameLength + 1/* NUL */;
 
-	LGPrgVar * o = malloc(recordSize);
+	LGPrgVar * o = pgMemAlloc(recordSize, PGM_Program);
 	if (o)
 	{
 		memset(o, 0, recordSize);
@@ -134,7 +137,7 @@ void LGPrgVarDelete(LGPrgVar ** o_)
 			size_t nameLength = strlen(o->name);
 			size_t recordSize = offsetof(LGPrgVar, name) + nameLength + 1/* NUL */;
 			memset(o, 0, recordSize);
-			free(o);
+			pgMemFree(o);
 		}
 		*o_ = NULL;
 	}
@@ -264,7 +267,7 @@ GLuint LGPrgVarLocation(const LGPrgVar *hash, const char *name)
 // ## LGPrgObjectInit
 //
 // Initialises a new LGPrgObject. Takes ownership of log, which
-// will be freed when deleted.
+// will be freed when deleted, so it must come from `pgMemAlloc`.
 void LGPrgObjectInit(LGPrgObject * o, GLuint reference, GLboolean valid, GLchar * log)
 {
 	if (o)
@@ -278,12 +281,12 @@ void LGPrgObjectInit(LGPrgObject * o, GLuint reference, GLboolean valid, GLchar
 
 // ## LGPrgObjectDestroy
 //
-// Destroys the contents of the LGPrgObject, also `free`ing any `log` string.
+// Destroys the contents of the LGPrgObject, also freeing any `log` string.
 void LGPrgObjectDestroy(LGPrgObject * o)
 {
 	if (o)
 	{
-		free(o->log);
+		pgMemFree(o->log);
 		memset(o, 0, sizeof(LGPrgObject));
 	}
 }
@@ -300,7 +303,7 @@ void LGPrgObjectCopy(LGPrgObject *dst, const LGPrgObject *src)
 	if (src->log)
 	{
 		size_t len = strlen(src->log) + 1;
-		dst->log = (GLchar *)malloc(len * sizeof(GLchar));
+		dst->log = (GLchar *)pgMemAlloc(len * sizeof(GLchar), PGM_Log);
 		if (dst->log)
 		{
 			strncpy(dst->log, src->log, len);
@@ -322,6 +325,7 @@ void LGPrgObjectCopy(LGPrgObject *dst, const LGPrgObject *src)
 // If any errors occur during creation, NULL is returned.
 LGPrgObject * LGPrgShaderNew(const GLchar *source, GLenum type)
 {
+	pgProfileZone(__func__);
 	LGLogGLErrors("Preparing to create and compile shader.");
 	
 	GLuint shader = glCreateShader(type);
@@ -353,7 +357,13 @@ LGPrgObject * LGPrgShaderNew(const GLchar *source, GLenum type)
 	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
 	if (logLength > 0)
 	{
-		log = (GLchar *)malloc(logLength * sizeof(GLchar));
+		log = (GLchar *)pgMemAlloc(logLength * sizeof(GLchar), PGM_Log);
+		if (NULL == log)
+		{
+			glDeleteShader(shader);
+			LGLogOOM("Out of memory for the compile log in LGPrgShaderNew");
+			return NULL;
+		}
 		glGetShaderInfoLog(shader, logLength, NULL, log);
 	}
 	
@@ -368,7 +378,7 @@ LGPrgObject * LGPrgShaderNew(const GLchar *source, GLenum type)
 	}
 	
 	// Finally, create the new LGPrgObject to return
-	LGPrgObject * o = (LGPrgObject *)malloc(sizeof(LGPrgObject));
+	LGPrgObject * o = (LGPrgObject *)pgMemAlloc(sizeof(LGPrgObject), PGM_Program);
 	if (o)
 	{
 		LGPrgObjectInit(o, shader, status, log);
@@ -376,7 +386,7 @@ LGPrgObject * LGPrgShaderNew(const GLchar *source, GLenum type)
 	else
 	{
 		glDeleteShader(shader);
-		free(log);
+		pgMemFree(log);
 		LGLogOOM("Out of memory when returning new shader object from LGPrgCompileShader");
 	}
 	return o;
@@ -409,7 +419,7 @@ void LGPrgShaderDelete(LGPrgObject ** shader_)
 		if (shader)
 		{
 			LGPrgShaderDestroy(shader);
-			free(shader);
+			pgMemFree(shader);
 		}
 		*shader_ = NULL;
 	}
@@ -443,6 +453,7 @@ void LGPrgStoreActiveVariables(LGPrg * prg)
 // and `uniforms` respectively.
 LGPrg * LGPrgNew(const LGPrgObject * vertexShader, const LGPrgObject * fragmentShader)
 {
+	pgProfileZone(__func__);
 	if (!vertexShader || vertexShader->valid == GL_FALSE)
 	{
 		LGLogError("Cannot create new LGPrg: vertexShader is NULL or not valid.");
@@ -476,7 +487,13 @@ LGPrg * LGPrgNew(const LGPrgObject * vertexShader, const LGPrgObject * fragmentS
 	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
 	if (logLength > 0)
 	{
-		log = (GLchar *)malloc(logLength * sizeof(GLchar));
+		log = (GLchar *)pgMemAlloc(logLength * sizeof(GLchar), PGM_Log);
+		if (NULL == log)
+		{
+			glDeleteProgram(program);
+			LGLogOOM("Out of memory for the link log in LGPrgNew");
+			return NULL;
+		}
 		glGetProgramInfoLog(program, logLength, NULL, log);
 	}
     
@@ -488,7 +505,7 @@ LGPrg * LGPrgNew(const LGPrgObject * vertexShader, const LGPrgObject * fragmentS
     }
 	
 	// Finally, create the new LGPrg to return
-	LGPrg * prg = (LGPrg *)malloc(sizeof(LGPrg));
+	LGPrg * prg = (LGPrg *)pgMemAlloc(sizeof(LGPrg), PGM_Program);
 	if (prg)
 	{
 		memset(prg, 0, sizeof(LGPrg));
@@ -502,7 +519,7 @@ LGPrg * LGPrgNew(const LGPrgObject * vertexShader, const LGPrgObject * fragmentS
 	else
 	{
 		glDeleteProgram(program);
-		free(log);
+		pgMemFree(log);
 		LGLogOOM("Out of memory when returning new LGPrg from LGPrgNew");
 	}
 	return prg;
@@ -578,7 +595,8 @@ GLuint LGPrgUniformLocation(const LGPrg *prg, const char *name)
 // ## LGPrgDelete
 //
 // Deletes the program, releasing all resources and `free`ing
-// the LGPrg object
+// the LGPrg object. The GL program itself goes through the
+// delete queue, so frames already queued can still draw with it.
 void LGPrgDelete(LGPrg ** prg_)
 {
 	if (prg_)
@@ -586,20 +604,23 @@ void LGPrgDelete(LGPrg ** prg_)
 		LGPrg *prg = *prg_;
 		if (prg)
 		{
+			// The shaders belong to whoever passed them to LGPrgNew, so
+			// only detach them. Deleting them here as well would delete
+			// them twice.
 			glDetachShader(prg->program.reference, prg->vertexShader.reference);
-			LGPrgShaderDestroy(&prg->vertexShader);
+			LGPrgObjectDestroy(&prg->vertexShader);
 
 			glDetachShader(prg->program.reference, prg->fragmentShader.reference);
-			LGPrgShaderDestroy(&prg->fragmentShader);
+			LGPrgObjectDestroy(&prg->fragmentShader);
 			
-			glDeleteProgram(prg->program.reference);
+			pgDeleteQueuePush(PGD_Program, prg->program.reference);
 			LGPrgObjectDestroy(&prg->program);
 			
 			LGPrgVarHashClear(&prg->attributes);
 			LGPrgVarHashClear(&prg->uniforms);
 			
 			memset(prg, 0, sizeof(LGPrg));
-			free(prg);
+			pgMemFree(prg);
 		}
 		*prg_ = NULL;
 	}
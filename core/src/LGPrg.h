@@ -52,6 +52,11 @@ GLenum _LGvLogGLErrors(const char *fmt, ...);
  *
  * When you are finished with the program, delete it with LGPrgDelete.
  *
+ * Shaders and programs only touch GL and their own memory, so they can be
+ * made on a loader thread (see pgContextLoad) and handed over whole in the
+ * load's completion. Unlike PGProgram there is no second half to run on
+ * the render thread.
+ *
  * @param vertexShader vertex shader to use in the program
  * @param vertexShader fragment shader to use in the program
  *
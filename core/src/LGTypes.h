@@ -26,9 +26,9 @@
 #ifndef LGTypes_h
 #define LGTypes_h
 
-#include <OpenGLES/ES2/gl.h>
-#include <OpenGLES/ES2/glext.h>
+#include "PGGL.h"
 
+#include "PGAllocator.h"
 #include "../../external/uthash/uthash-1.9.6/src/uthash.h"
 
 #ifdef __cplusplus
@@ -0,0 +1,180 @@
+//
+//  PGAllocator.c
+//
+//  Created by David Wagner on 12/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+/**
+ * Sits immediately before every pointer handed out. It remembers who to
+ * give the block back to, so frees still work after the allocator changes.
+ */
+struct PGMemHeader {
+	size_t size;		// As requested by the caller
+	void (*deallocate)(void *, void *, size_t, PGMemoryTag);
+	void *userData;
+	uint16_t tag;
+	uint16_t alignmentShift;
+	uint32_t offset;	// From the start of the block to the user pointer
+} __attribute__((aligned(16)));
+
+// What every allocator has to provide, and so the alignment we get for free
+#define BASE_ALIGNMENT 16
+
+struct PGMemTagCounters {
+	size_t liveBytes;
+	size_t peakBytes;
+	unsigned long liveAllocations;
+	unsigned long allocations;
+	unsigned long frees;
+} __attribute__((aligned(64)));
+
+static void *defaultAllocate(void *userData, size_t size, PGMemoryTag tag)
+{
+	return malloc(size);
+}
+
+static void defaultDeallocate(void *userData, void *pointer, size_t size, PGMemoryTag tag)
+{
+	free(pointer);
+}
+
+static PGAllocator Allocator = { defaultAllocate, defaultDeallocate, NULL };
+
+static struct PGMemTagCounters Counters[PGM_TagCount];
+
+static const char * const TagNames[PGM_TagCount] = {
+	"general",
+	"context",
+	"jobs",
+	"arena",
+	"program",
+	"log",
+	"hash",
+	"renderer",
+	"mesh",
+	"profiler",
+	"texture",
+};
+
+void pgMemorySetAllocator(const PGAllocator *allocator)
+{
+	if (NULL == allocator || NULL == allocator->allocate || NULL == allocator->deallocate)
+	{
+		Allocator.allocate = defaultAllocate;
+		Allocator.deallocate = defaultDeallocate;
+		Allocator.userData = NULL;
+	}
+	else
+	{
+		Allocator = *allocator;
+	}
+}
+
+static void countAllocation(PGMemoryTag tag, size_t size)
+{
+	struct PGMemTagCounters *c = &Counters[tag];
+	size_t live = __atomic_add_fetch(&c->liveBytes, size, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->liveAllocations, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->allocations, 1, __ATOMIC_RELAXED);
+
+	size_t peak = __atomic_load_n(&c->peakBytes, __ATOMIC_RELAXED);
+	while (live > peak && !__atomic_compare_exchange_n(&c->peakBytes, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		// peak was reloaded by the failed exchange
+	}
+}
+
+static void countFree(PGMemoryTag tag, size_t size)
+{
+	struct PGMemTagCounters *c = &Counters[tag];
+	__atomic_sub_fetch(&c->liveBytes, size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&c->liveAllocations, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->frees, 1, __ATOMIC_RELAXED);
+}
+
+static size_t blockSizeFor(size_t size, size_t alignment)
+{
+	// Blocks and the header are both multiples of the base alignment, so
+	// only bigger alignments need any slack
+	return sizeof(struct PGMemHeader) + (alignment - BASE_ALIGNMENT) + size;
+}
+
+void *pgMemAllocAligned(size_t size, size_t alignment, PGMemoryTag tag)
+{
+	if (tag >= PGM_TagCount) tag = PGM_General;
+	if (alignment < BASE_ALIGNMENT) alignment = BASE_ALIGNMENT;
+	if (0 != (alignment & (alignment - 1))) return NULL;
+
+	uint16_t alignmentShift = 0;
+	while (((size_t)1 << alignmentShift) < alignment) alignmentShift++;
+
+	size_t blockSize = blockSizeFor(size, alignment);
+	unsigned char *block = Allocator.allocate(Allocator.userData, blockSize, tag);
+	if (NULL == block) return NULL;
+
+	uintptr_t user = ((uintptr_t)block + sizeof(struct PGMemHeader) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	struct PGMemHeader *header = (struct PGMemHeader *)user - 1;
+	header->size = size;
+	header->deallocate = Allocator.deallocate;
+	header->userData = Allocator.userData;
+	header->tag = tag;
+	header->alignmentShift = alignmentShift;
+	header->offset = (uint32_t)(user - (uintptr_t)block);
+
+	countAllocation(tag, size);
+	return (void *)user;
+}
+
+void *pgMemAlloc(size_t size, PGMemoryTag tag)
+{
+	return pgMemAllocAligned(size, BASE_ALIGNMENT, tag);
+}
+
+void pgMemFree(void *pointer)
+{
+	if (NULL == pointer) return;
+
+	struct PGMemHeader *header = (struct PGMemHeader *)pointer - 1;
+	unsigned char *block = (unsigned char *)pointer - header->offset;
+	PGMemoryTag tag = header->tag;
+
+	countFree(tag, header->size);
+	header->deallocate(header->userData, block, blockSizeFor(header->size, (size_t)1 << header->alignmentShift), tag);
+}
+
+void pgMemoryStats(PGMemoryTag tag, PGMemoryStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGMemoryStats));
+
+	PGMemoryTag first = tag;
+	PGMemoryTag last = tag;
+	if (tag >= PGM_TagCount)
+	{
+		first = 0;
+		last = PGM_TagCount - 1;
+	}
+
+	for (int t = first; t <= (int)last; t++)
+	{
+		struct PGMemTagCounters *c = &Counters[t];
+		stats->liveBytes += __atomic_load_n(&c->liveBytes, __ATOMIC_RELAXED);
+		stats->peakBytes += __atomic_load_n(&c->peakBytes, __ATOMIC_RELAXED);
+		stats->liveAllocations += __atomic_load_n(&c->liveAllocations, __ATOMIC_RELAXED);
+		stats->allocations += __atomic_load_n(&c->allocations, __ATOMIC_RELAXED);
+		stats->frees += __atomic_load_n(&c->frees, __ATOMIC_RELAXED);
+	}
+}
+
+const char *pgMemoryTagName(PGMemoryTag tag)
+{
+	if (tag >= PGM_TagCount) return "all";
+
+	return TagNames[tag];
+}
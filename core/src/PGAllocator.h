@@ -0,0 +1,91 @@
+//
+//  PGAllocator.h
+//
+//  Created by David Wagner on 12/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGAllocator_h
+#define PGAllocator_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Which part of the library an allocation belongs to, for accounting.
+	 */
+	typedef enum
+	{
+		PGM_General = 0
+	,	PGM_Context
+	,	PGM_Jobs
+	,	PGM_Arena
+	,	PGM_Program
+	,	PGM_Log
+	,	PGM_Hash
+	,	PGM_Renderer
+	,	PGM_Mesh
+	,	PGM_Profiler
+	,	PGM_Texture
+	,	PGM_TagCount
+	}
+	PGMemoryTag;
+
+	/**
+	 * A pluggable allocator. `allocate` must return memory aligned to at
+	 * least 16 bytes. `deallocate` is passed the size and tag the block was
+	 * allocated with.
+	 */
+	typedef struct
+	{
+		void *(*allocate)(void *userData, size_t size, PGMemoryTag tag);
+		void (*deallocate)(void *userData, void *pointer, size_t size, PGMemoryTag tag);
+		void *userData;
+	}
+	PGAllocator;
+
+	typedef struct
+	{
+		size_t liveBytes;
+		size_t peakBytes;
+		unsigned long liveAllocations;
+		unsigned long allocations;	// Over the lifetime of the process
+		unsigned long frees;
+	}
+	PGMemoryStats;
+
+	/**
+	 * Installs the allocator all library allocations go through, including
+	 * uthash tables. Pass NULL to go back to malloc and free. Blocks are
+	 * always returned to the allocator they came from, so it is safe to
+	 * switch with allocations outstanding, but the call itself isn't thread
+	 * safe. Install the allocator before creating anything.
+	 */
+	void pgMemorySetAllocator(const PGAllocator *allocator);
+
+	void *pgMemAlloc(size_t size, PGMemoryTag tag);
+	void *pgMemAllocAligned(size_t size, size_t alignment, PGMemoryTag tag);
+	void pgMemFree(void *pointer);
+
+	/**
+	 * Stats for one tag, or for all tags combined if `tag` is PGM_TagCount.
+	 * The combined peak is the sum of the tag peaks, which is an upper bound.
+	 */
+	void pgMemoryStats(PGMemoryTag tag, PGMemoryStats *stats);
+	const char *pgMemoryTagName(PGMemoryTag tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Route uthash's bookkeeping through the library allocator. This must be
+// seen before uthash.h is included.
+#ifndef uthash_malloc
+#	define uthash_malloc(sz) pgMemAlloc((sz), PGM_Hash)
+#	define uthash_free(ptr, sz) pgMemFree(ptr)
+#endif
+
+#endif
@@ -0,0 +1,193 @@
+//
+//  PGArena.c
+//
+//  Created by David Wagner on 10/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#define ALIGN_UP(n) (((n) + (PG_ARENA_ALIGNMENT - 1)) & ~(size_t)(PG_ARENA_ALIGNMENT - 1))
+
+struct PGArenaChunk {
+	struct PGArenaChunk *next;
+	size_t capacity;
+	size_t used;
+	unsigned char *data;
+};
+
+struct PGArenaPrivate {
+	unsigned char *base;
+	size_t capacity;
+	size_t used;
+
+	// Overflow chunks, newest first
+	struct PGArenaChunk *spill;
+	size_t spilled;
+
+	size_t highWaterMark;
+	unsigned long spills;
+	unsigned long resets;
+};
+
+static void *alignedAlloc(size_t size)
+{
+	return pgMemAllocAligned(size, PG_ARENA_ALIGNMENT, PGM_Arena);
+}
+
+static void freeSpill(PGArena arena)
+{
+	struct PGArenaChunk *chunk = arena->spill;
+	while (NULL != chunk)
+	{
+		struct PGArenaChunk *next = chunk->next;
+		pgMemFree(chunk);
+		chunk = next;
+	}
+	arena->spill = NULL;
+	arena->spilled = 0;
+}
+
+PGResult pgArenaCreate(PGArena *arena, size_t capacity)
+{
+	if (NULL == arena) return PGR_NullPointerBarf;
+	*arena = NULL;
+
+	PGArena a = pgMemAlloc(sizeof(struct PGArenaPrivate), PGM_Arena);
+	if (NULL == a) return PGR_OutOfMemory;
+	memset(a, 0, sizeof(struct PGArenaPrivate));
+
+	a->capacity = ALIGN_UP(capacity);
+	if (a->capacity > 0)
+	{
+		a->base = alignedAlloc(a->capacity);
+		if (NULL == a->base)
+		{
+			pgMemFree(a);
+			return PGR_OutOfMemory;
+		}
+	}
+
+	*arena = a;
+	return PGR_OK;
+}
+
+void pgArenaDestroy(PGArena *arena)
+{
+	if (NULL != arena && NULL != *arena)
+	{
+		PGArena a = *arena;
+
+		freeSpill(a);
+		pgMemFree(a->base);
+
+		memset(a, 0, sizeof(struct PGArenaPrivate));
+		pgMemFree(a);
+
+		*arena = NULL;
+	}
+}
+
+static void *spillAlloc(PGArena arena, size_t size)
+{
+	struct PGArenaChunk *chunk = arena->spill;
+	if (NULL == chunk || chunk->capacity - chunk->used < size)
+	{
+		// Each chunk is at least as big as the primary block, so a frame
+		// which overflows badly doesn't end up with a chunk per allocation
+		size_t capacity = size > arena->capacity ? size : arena->capacity;
+		size_t header = ALIGN_UP(sizeof(struct PGArenaChunk));
+		chunk = alignedAlloc(header + capacity);
+		if (NULL == chunk) return NULL;
+
+		chunk->next = arena->spill;
+		chunk->capacity = capacity;
+		chunk->used = 0;
+		chunk->data = (unsigned char *)chunk + header;
+		arena->spill = chunk;
+		arena->spills++;
+	}
+
+	void *p = chunk->data + chunk->used;
+	chunk->used += size;
+	arena->spilled += size;
+	return p;
+}
+
+void *pgArenaAlloc(PGArena arena, size_t size)
+{
+	if (NULL == arena) return NULL;
+
+	size = ALIGN_UP(size > 0 ? size : 1);
+
+	void *p;
+	if (arena->capacity - arena->used >= size)
+	{
+		p = arena->base + arena->used;
+		arena->used += size;
+	}
+	else
+	{
+		p = spillAlloc(arena, size);
+		if (NULL == p)
+		{
+			pgLog(PGL_Error, "Arena out of memory allocating %zu bytes.", size);
+			return NULL;
+		}
+	}
+
+	size_t total = arena->used + arena->spilled;
+	if (total > arena->highWaterMark)
+	{
+		arena->highWaterMark = total;
+	}
+	return p;
+}
+
+void pgArenaReset(PGArena arena)
+{
+	if (NULL == arena) return;
+
+	if (NULL != arena->spill)
+	{
+		// Grow the primary block so the next frame fits without spilling.
+		// If that fails just keep the old block; we'll spill again.
+		size_t capacity = ALIGN_UP(arena->highWaterMark);
+		unsigned char *base = alignedAlloc(capacity);
+		if (NULL != base)
+		{
+			pgMemFree(arena->base);
+			arena->base = base;
+			arena->capacity = capacity;
+		}
+		freeSpill(arena);
+	}
+
+	arena->used = 0;
+	arena->resets++;
+}
+
+void pgArenaStats(PGArena arena, PGArenaStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGArenaStats));
+	pgArenaAccumulateStats(arena, stats);
+}
+
+void pgArenaAccumulateStats(PGArena arena, PGArenaStats *total)
+{
+	if (NULL == arena || NULL == total) return;
+
+	total->capacity += arena->capacity;
+	total->used += arena->used + arena->spilled;
+	total->highWaterMark += arena->highWaterMark;
+	total->spilled += arena->spilled;
+	total->spills += arena->spills;
+	if (arena->resets > total->resets)
+	{
+		total->resets = arena->resets;
+	}
+}
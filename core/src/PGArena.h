@@ -0,0 +1,59 @@
+//
+//  PGArena.h
+//
+//  Created by David Wagner on 10/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGArena_h
+#define PGArena_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Every allocation is aligned to this
+	#define PG_ARENA_ALIGNMENT 16
+
+	typedef struct
+	{
+		size_t capacity;		// Size of the primary block(s)
+		size_t used;			// Bytes handed out since the last reset
+		size_t highWaterMark;	// Most bytes ever handed out between resets
+		size_t spilled;			// Bytes which didn't fit the primary block since the last reset
+		unsigned long spills;	// Overflow chunks allocated over the arena's lifetime
+		unsigned long resets;
+	}
+	PGArenaStats;
+
+	/**
+	 * A linear (bump) allocator. Allocations are freed all at once with
+	 * pgArenaReset.
+	 *
+	 * Allocations come out of a primary block. When it is full they spill
+	 * into overflow chunks from the heap, which are released on reset, when
+	 * the primary block is also grown to the high water mark so later
+	 * frames fit. An arena is not thread safe.
+	 */
+	PGResult pgArenaCreate(PGArena *arena, size_t capacity);
+	void pgArenaDestroy(PGArena *arena);
+
+	void *pgArenaAlloc(PGArena arena, size_t size);
+	void pgArenaReset(PGArena arena);
+
+	void pgArenaStats(PGArena arena, PGArenaStats *stats);
+
+	/**
+	 * Adds the arena's stats to `total`. Capacity, usage and spills are
+	 * summed. The high water mark becomes the sum of high water marks,
+	 * which is the most the arenas could ever need together.
+	 */
+	void pgArenaAccumulateStats(PGArena arena, PGArenaStats *total);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,767 @@
+//
+//  PGAtlas.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Pictogram.h"
+
+enum {
+	ENTRY_Queued = 0
+,	ENTRY_Packing
+,	ENTRY_Ready
+,	ENTRY_Failed
+};
+
+enum {
+	WORK_Idle = 0
+,	WORK_Pack
+,	WORK_Defragment
+};
+
+struct PGAtlasNode {
+	int x;
+	int y;			// Top of the space used below this span
+	int width;
+};
+
+/**
+ * The outline of the used part of a page, left to right. Everything
+ * below it is taken.
+ */
+struct PGAtlasSkyline {
+	int count;
+	struct PGAtlasNode *nodes;
+};
+
+/**
+ * An image and where it is. Kept apart from the handle pool, which moves
+ * its items, so packing jobs can work on it. A job writes the pixels and
+ * the placement of the entries it is given; everything else belongs to
+ * the GL thread.
+ */
+struct PGAtlasEntry {
+	PGAtlasImage image;
+	GLsizei width;
+	GLsizei height;
+	GLubyte *pixels;		// As given until packed, then padded
+	GLboolean padded;
+
+	int page;				// Top left of the padded block
+	int x;
+	int y;
+	int newPage;			// Where defragmenting moves it
+	int newX;
+	int newY;
+
+	int state;
+	int index;				// In `entries`
+	GLboolean busy;			// Given to a job
+	GLboolean removed;		// Removed while busy, so freed when the job is done
+	GLboolean retried;		// Queued again after not fitting
+};
+
+struct PGAtlasList {
+	struct PGAtlasEntry **items;
+	int count;
+	int capacity;
+};
+
+struct PGAtlasPrivate {
+	PGAtlasOptions options;
+	PGJobScheduler jobs;
+	PGHandlePool images;		// Items are entry pointers
+
+	struct PGAtlasList entries;	// Every live image
+	struct PGAtlasList queue;	// Waiting to be packed
+
+	int pageCount;
+	GLuint textures[PG_ATLAS_MAX_PAGES];
+	PGGpuResource memory[PG_ATLAS_MAX_PAGES];
+	struct PGAtlasSkyline skylines[PG_ATLAS_MAX_PAGES];
+	struct PGAtlasSkyline spare[PG_ATLAS_MAX_PAGES];	// Defragmenting packs into these
+
+	size_t liveArea;			// Padded area of every packed image
+	size_t packedArea;			// Area under the skylines
+	GLboolean holes;			// Images have been removed since the last repack
+	GLboolean wantDefragment;
+	unsigned long defragmentations;
+
+	// The job owns the batch, the skylines and these results until `done`
+	int work;
+	struct PGAtlasList batch;
+	int workPageCount;
+	size_t workPackedArea;
+	int done;
+	PGJob job;
+};
+
+static size_t paddedArea(PGAtlas atlas, const struct PGAtlasEntry *entry)
+{
+	GLsizei padding = 2 * atlas->options.padding;
+	return (size_t)(entry->width + padding) * (entry->height + padding);
+}
+
+static int listPush(struct PGAtlasList *list, struct PGAtlasEntry *entry)
+{
+	if (list->count == list->capacity)
+	{
+		int capacity = list->capacity > 0 ? list->capacity * 2 : 32;
+		struct PGAtlasEntry **items = pgMemAlloc(sizeof(struct PGAtlasEntry *) * capacity, PGM_Texture);
+		if (NULL == items) return 0;
+		if (list->count > 0) memcpy(items, list->items, sizeof(struct PGAtlasEntry *) * list->count);
+		pgMemFree(list->items);
+		list->items = items;
+		list->capacity = capacity;
+	}
+	list->items[list->count++] = entry;
+	return 1;
+}
+
+static void listRemove(struct PGAtlasList *list, const struct PGAtlasEntry *entry)
+{
+	for (int i = 0; i < list->count; i++)
+	{
+		if (list->items[i] == entry)
+		{
+			list->items[i] = list->items[--list->count];
+			return;
+		}
+	}
+}
+
+static void freeEntry(struct PGAtlasEntry *entry)
+{
+	pgMemFree(entry->pixels);
+	pgMemFree(entry);
+}
+
+// Packing ///////////////////////////////////////////////////////////////////
+
+static int resetSkyline(struct PGAtlasSkyline *skyline, int size)
+{
+	// Every node is at least a pixel wide, and adding one can briefly
+	// leave an extra
+	if (NULL == skyline->nodes)
+	{
+		skyline->nodes = pgMemAlloc(sizeof(struct PGAtlasNode) * (size_t)(size + 2), PGM_Texture);
+		if (NULL == skyline->nodes) return 0;
+	}
+	skyline->nodes[0] = (struct PGAtlasNode){ 0, 0, size };
+	skyline->count = 1;
+	return 1;
+}
+
+/**
+ * The lowest a block can sit with its left edge at node `i`, or -1 if it
+ * would go off the page.
+ */
+static int fit(const struct PGAtlasSkyline *skyline, int i, int width, int height, int size)
+{
+	if (skyline->nodes[i].x + width > size) return -1;
+
+	int y = 0;
+	for (int left = width; left > 0; i++)
+	{
+		if (skyline->nodes[i].y > y) y = skyline->nodes[i].y;
+		if (y + height > size) return -1;
+		left -= skyline->nodes[i].width;
+	}
+	return y;
+}
+
+/**
+ * Raises the skyline over a block placed at node `index`, then merges
+ * spans left at the same height.
+ */
+static void raiseSkyline(struct PGAtlasSkyline *skyline, int index, int width, int y)
+{
+	struct PGAtlasNode *nodes = skyline->nodes;
+	memmove(&nodes[index + 1], &nodes[index], sizeof(struct PGAtlasNode) * (size_t)(skyline->count - index));
+	nodes[index].y = y;
+	nodes[index].width = width;
+	skyline->count++;
+
+	// Cut back the spans the block covers
+	int i = index + 1;
+	while (i < skyline->count)
+	{
+		int covered = nodes[i - 1].x + nodes[i - 1].width - nodes[i].x;
+		if (covered <= 0) break;
+
+		if (covered < nodes[i].width)
+		{
+			nodes[i].x += covered;
+			nodes[i].width -= covered;
+			break;
+		}
+		memmove(&nodes[i], &nodes[i + 1], sizeof(struct PGAtlasNode) * (size_t)(skyline->count - i - 1));
+		skyline->count--;
+	}
+
+	for (i = 0; i + 1 < skyline->count; )
+	{
+		if (nodes[i].y == nodes[i + 1].y)
+		{
+			nodes[i].width += nodes[i + 1].width;
+			memmove(&nodes[i + 1], &nodes[i + 2], sizeof(struct PGAtlasNode) * (size_t)(skyline->count - i - 2));
+			skyline->count--;
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/**
+ * Places a block where its bottom edge ends up lowest, preferring
+ * narrower spans to keep wide ones for wide blocks.
+ */
+static int insert(struct PGAtlasSkyline *skyline, int width, int height, int size, int *x, int *y)
+{
+	int best = -1, bestBottom = INT_MAX, bestWidth = INT_MAX, bestY = 0;
+	for (int i = 0; i < skyline->count; i++)
+	{
+		int top = fit(skyline, i, width, height, size);
+		if (top < 0) continue;
+
+		if (top + height < bestBottom || (top + height == bestBottom && skyline->nodes[i].width < bestWidth))
+		{
+			best = i;
+			bestBottom = top + height;
+			bestWidth = skyline->nodes[i].width;
+			bestY = top;
+		}
+	}
+	if (best < 0) return 0;
+
+	*x = skyline->nodes[best].x;
+	*y = bestY;
+	raiseSkyline(skyline, best, width, bestY + height);
+	return 1;
+}
+
+static size_t areaUnder(const struct PGAtlasSkyline *skyline)
+{
+	size_t area = 0;
+	for (int i = 0; i < skyline->count; i++) area += (size_t)skyline->nodes[i].width * skyline->nodes[i].y;
+	return area;
+}
+
+/**
+ * Copies the image into the middle of a padded block. Extruding repeats
+ * the edge pixels out to the block's edge, so filtering at the image's
+ * edge never picks up a neighbour.
+ */
+static int pad(PGAtlas atlas, struct PGAtlasEntry *entry)
+{
+	GLsizei padding = atlas->options.padding;
+	GLsizei width = entry->width + 2 * padding, height = entry->height + 2 * padding;
+	size_t rowBytes = (size_t)width * 4;
+	GLubyte *block = pgMemAlloc(rowBytes * height, PGM_Texture);
+	if (NULL == block) return 0;
+	memset(block, 0, rowBytes * height);
+
+	for (GLsizei y = 0; y < entry->height; y++)
+	{
+		GLubyte *row = block + (size_t)(y + padding) * rowBytes;
+		const GLubyte *from = entry->pixels + (size_t)y * entry->width * 4;
+		memcpy(row + (size_t)padding * 4, from, (size_t)entry->width * 4);
+		if (atlas->options.extrude)
+		{
+			for (GLsizei x = 0; x < padding; x++)
+			{
+				memcpy(row + (size_t)x * 4, from, 4);
+				memcpy(row + (size_t)(padding + entry->width + x) * 4, from + (size_t)(entry->width - 1) * 4, 4);
+			}
+		}
+	}
+	if (atlas->options.extrude)
+	{
+		for (GLsizei y = 0; y < padding; y++)
+		{
+			memcpy(block + (size_t)y * rowBytes, block + (size_t)padding * rowBytes, rowBytes);
+			memcpy(block + (size_t)(padding + entry->height + y) * rowBytes, block + (size_t)(padding + entry->height - 1) * rowBytes, rowBytes);
+		}
+	}
+
+	pgMemFree(entry->pixels);
+	entry->pixels = block;
+	entry->padded = GL_TRUE;
+	return 1;
+}
+
+static int compareEntries(const void *a, const void *b)
+{
+	const struct PGAtlasEntry *x = *(struct PGAtlasEntry * const *)a, *y = *(struct PGAtlasEntry * const *)b;
+	if (x->height != y->height) return y->height - x->height;
+	return y->width - x->width;
+}
+
+/**
+ * Packs the batch into `skylines`, opening pages as needed, and returns
+ * how many pages are in use. Entries which don't fit get page -1.
+ */
+static int packInto(PGAtlas atlas, struct PGAtlasSkyline *skylines, int pageCount, GLboolean moving)
+{
+	int size = atlas->options.pageSize, padding = 2 * atlas->options.padding;
+	qsort(atlas->batch.items, (size_t)atlas->batch.count, sizeof(struct PGAtlasEntry *), compareEntries);
+
+	for (int i = 0; i < atlas->batch.count; i++)
+	{
+		struct PGAtlasEntry *entry = atlas->batch.items[i];
+		int page = -1, x = 0, y = 0;
+		if (entry->padded || pad(atlas, entry))
+		{
+			for (int p = 0; p < PG_ATLAS_MAX_PAGES; p++)
+			{
+				if (p == pageCount)
+				{
+					if (!resetSkyline(&skylines[p], size)) break;
+					pageCount++;
+				}
+				if (insert(&skylines[p], entry->width + padding, entry->height + padding, size, &x, &y))
+				{
+					page = p;
+					break;
+				}
+			}
+		}
+
+		if (moving)
+		{
+			entry->newPage = page;
+			entry->newX = x;
+			entry->newY = y;
+		}
+		else
+		{
+			entry->page = page;
+			entry->x = x;
+			entry->y = y;
+		}
+	}
+	return pageCount;
+}
+
+static void work(PGAtlas atlas)
+{
+	pgProfileZone("pgAtlas pack");
+	struct PGAtlasSkyline *skylines = WORK_Defragment == atlas->work ? atlas->spare : atlas->skylines;
+	int pageCount = packInto(atlas, skylines, WORK_Defragment == atlas->work ? 0 : atlas->pageCount, WORK_Defragment == atlas->work);
+
+	atlas->workPageCount = pageCount;
+	atlas->workPackedArea = 0;
+	for (int p = 0; p < pageCount; p++) atlas->workPackedArea += areaUnder(&skylines[p]);
+	__atomic_store_n(&atlas->done, 1, __ATOMIC_RELEASE);
+}
+
+static void workJob(PGJob job, void *data)
+{
+	work(*(PGAtlas *)data);
+}
+
+// Uploading /////////////////////////////////////////////////////////////////
+
+static GLuint createPage(PGAtlas atlas, PGGpuResource *memory)
+{
+	size_t bytes = pgGpuTextureBytes(GL_RGBA, GL_UNSIGNED_BYTE, atlas->options.pageSize, atlas->options.pageSize, 1);
+	if (PGR_OK == pgGpuMemoryAdd(memory, PGG_Texture, bytes, NULL)) pgGpuMemorySetLabel(*memory, "atlas page");
+
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->options.pageSize, atlas->options.pageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	pgLogAnyGlErrors("Created atlas page.");
+	return texture;
+}
+
+static void upload(PGAtlas atlas, GLuint texture, const struct PGAtlasEntry *entry, int x, int y)
+{
+	GLsizei padding = 2 * atlas->options.padding;
+	GLsizei width = entry->width + padding, height = entry->height + padding;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, entry->pixels);
+	pgStatsTextureUpload((size_t)width * height * 4);
+}
+
+static void finishPack(PGAtlas atlas)
+{
+	for (int p = atlas->pageCount; p < atlas->workPageCount; p++) atlas->textures[p] = createPage(atlas, &atlas->memory[p]);
+	atlas->pageCount = atlas->workPageCount;
+	atlas->packedArea = atlas->workPackedArea;
+
+	for (int i = 0; i < atlas->batch.count; i++)
+	{
+		struct PGAtlasEntry *entry = atlas->batch.items[i];
+		entry->busy = GL_FALSE;
+		if (entry->removed)
+		{
+			freeEntry(entry);
+		}
+		else if (entry->page >= 0)
+		{
+			upload(atlas, atlas->textures[entry->page], entry, entry->x, entry->y);
+			atlas->liveArea += paddedArea(atlas, entry);
+			entry->state = ENTRY_Ready;
+		}
+		else if (atlas->holes && !entry->retried && listPush(&atlas->queue, entry))
+		{
+			// Try again once the holes are packed away
+			entry->retried = GL_TRUE;
+			entry->state = ENTRY_Queued;
+			atlas->wantDefragment = GL_TRUE;
+		}
+		else
+		{
+			pgLog(PGL_Error, "No room in the atlas for a %dx%d image.", entry->width, entry->height);
+			entry->state = ENTRY_Failed;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void finishDefragment(PGAtlas atlas)
+{
+	GLboolean fits = GL_TRUE;
+	for (int i = 0; i < atlas->batch.count; i++)
+	{
+		const struct PGAtlasEntry *entry = atlas->batch.items[i];
+		if (!entry->removed && entry->newPage < 0) fits = GL_FALSE;
+	}
+
+	GLuint textures[PG_ATLAS_MAX_PAGES];
+	PGGpuResource memory[PG_ATLAS_MAX_PAGES];
+	if (fits)
+	{
+		for (int p = 0; p < atlas->workPageCount; p++) textures[p] = createPage(atlas, &memory[p]);
+	}
+	else
+	{
+		pgLog(PGL_Warn, "Defragmenting the atlas made it no smaller. Keeping the old pages.");
+	}
+
+	for (int i = 0; i < atlas->batch.count; i++)
+	{
+		struct PGAtlasEntry *entry = atlas->batch.items[i];
+		entry->busy = GL_FALSE;
+		if (entry->removed)
+		{
+			freeEntry(entry);
+		}
+		else if (fits)
+		{
+			entry->page = entry->newPage;
+			entry->x = entry->newX;
+			entry->y = entry->newY;
+			upload(atlas, textures[entry->page], entry, entry->x, entry->y);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (fits)
+	{
+		for (int p = 0; p < atlas->pageCount; p++)
+		{
+			pgDeleteQueuePush(PGD_Texture, atlas->textures[p]);
+			pgGpuMemoryRemove(&atlas->memory[p]);
+		}
+		for (int p = 0; p < PG_ATLAS_MAX_PAGES; p++)
+		{
+			struct PGAtlasSkyline swap = atlas->skylines[p];
+			atlas->skylines[p] = atlas->spare[p];
+			atlas->spare[p] = swap;
+			atlas->textures[p] = p < atlas->workPageCount ? textures[p] : 0;
+			atlas->memory[p] = p < atlas->workPageCount ? memory[p] : PG_NULL_HANDLE;
+		}
+		atlas->pageCount = atlas->workPageCount;
+		atlas->packedArea = atlas->workPackedArea;
+		atlas->defragmentations++;
+	}
+}
+
+static GLboolean needsDefragment(PGAtlas atlas)
+{
+	if (!atlas->holes) return GL_FALSE;
+	if (atlas->wantDefragment) return GL_TRUE;
+	return atlas->packedArea > 0 && (float)atlas->liveArea < atlas->options.defragmentBelow * (float)atlas->packedArea;
+}
+
+static void startWork(PGAtlas atlas, int kind)
+{
+	atlas->batch.count = 0;
+	if (WORK_Defragment == kind)
+	{
+		for (int i = 0; i < atlas->entries.count; i++)
+		{
+			struct PGAtlasEntry *entry = atlas->entries.items[i];
+			if (ENTRY_Ready == entry->state && !listPush(&atlas->batch, entry))
+			{
+				// Stop before half the images have been left out
+				atlas->batch.count = 0;
+				return;
+			}
+		}
+		atlas->holes = GL_FALSE;
+		atlas->wantDefragment = GL_FALSE;
+	}
+	else
+	{
+		// Swapping lists hands over the queue in one go
+		struct PGAtlasList swap = atlas->batch;
+		atlas->batch = atlas->queue;
+		atlas->queue = swap;
+		atlas->queue.count = 0;
+		for (int i = 0; i < atlas->batch.count; i++) atlas->batch.items[i]->state = ENTRY_Packing;
+	}
+	for (int i = 0; i < atlas->batch.count; i++) atlas->batch.items[i]->busy = GL_TRUE;
+
+	atlas->work = kind;
+	atlas->done = 0;
+	atlas->job = NULL;
+	if (NULL != atlas->jobs)
+	{
+		atlas->job = pgJobCreate(atlas->jobs, workJob, &atlas, sizeof(atlas));
+		if (NULL != atlas->job)
+		{
+			pgJobRun(atlas->jobs, atlas->job);
+			return;
+		}
+		pgLog(PGL_Warn, "Could not make an atlas packing job. Packing on the calling thread.");
+	}
+	work(atlas);
+}
+
+void pgAtlasUpdate(PGAtlas atlas)
+{
+	if (NULL == atlas) return;
+
+	if (WORK_Idle != atlas->work)
+	{
+		if (!__atomic_load_n(&atlas->done, __ATOMIC_ACQUIRE)) return;
+
+		pgProfileZone("pgAtlasUpdate");
+		if (WORK_Defragment == atlas->work) finishDefragment(atlas);
+		else finishPack(atlas);
+		atlas->batch.count = 0;
+		atlas->work = WORK_Idle;
+	}
+
+	if (needsDefragment(atlas))
+	{
+		startWork(atlas, WORK_Defragment);
+	}
+	else if (atlas->queue.count > 0)
+	{
+		startWork(atlas, WORK_Pack);
+	}
+}
+
+void pgAtlasFlush(PGAtlas atlas)
+{
+	if (NULL == atlas) return;
+
+	do
+	{
+		// The job can't have been recycled before it is done
+		while (WORK_Idle != atlas->work && !__atomic_load_n(&atlas->done, __ATOMIC_ACQUIRE))
+		{
+			pgJobWait(atlas->jobs, atlas->job);
+		}
+		pgAtlasUpdate(atlas);
+	}
+	while (WORK_Idle != atlas->work);
+}
+
+// Images ////////////////////////////////////////////////////////////////////
+
+PGResult pgAtlasCreate(PGAtlas *atlas, const PGAtlasOptions *options, PGJobScheduler jobs)
+{
+	if (NULL == atlas) return PGR_NullPointerBarf;
+	*atlas = NULL;
+
+	PGAtlasOptions o = { PG_ATLAS_DEFAULT_PAGE_SIZE, 1, GL_TRUE, 0.5f };
+	if (NULL != options) o = *options;
+	if (o.pageSize <= 0 || o.pageSize > PG_IMAGE_MAX_SIZE || o.padding < 0 || 2 * o.padding >= o.pageSize)
+	{
+		pgLog(PGL_Error, "Invalid atlas of %dx%d pages with %d pixels of padding.", o.pageSize, o.pageSize, o.padding);
+		return PGR_LazyGenericError;
+	}
+
+	PGAtlas a = pgMemAlloc(sizeof(struct PGAtlasPrivate), PGM_Texture);
+	if (NULL == a) return PGR_OutOfMemory;
+	memset(a, 0, sizeof(struct PGAtlasPrivate));
+	a->options = o;
+	a->jobs = jobs;
+	*atlas = a;
+
+	PGResult result = pgHandlePoolCreate(&a->images, sizeof(struct PGAtlasEntry *), PGM_Texture);
+	if (PGR_OK != result)
+	{
+		pgAtlasDestroy(atlas);
+		return result;
+	}
+	return PGR_OK;
+}
+
+void pgAtlasDestroy(PGAtlas *atlas)
+{
+	if (NULL != atlas && NULL != *atlas)
+	{
+		PGAtlas a = *atlas;
+
+		while (WORK_Idle != a->work && !__atomic_load_n(&a->done, __ATOMIC_ACQUIRE))
+		{
+			pgJobWait(a->jobs, a->job);
+		}
+
+		// Entries removed while busy are only in the batch
+		for (int i = 0; i < a->batch.count; i++)
+		{
+			if (a->batch.items[i]->removed) freeEntry(a->batch.items[i]);
+		}
+		for (int i = 0; i < a->entries.count; i++) freeEntry(a->entries.items[i]);
+		pgMemFree(a->entries.items);
+		pgMemFree(a->queue.items);
+		pgMemFree(a->batch.items);
+
+		for (int p = 0; p < PG_ATLAS_MAX_PAGES; p++)
+		{
+			pgDeleteQueuePush(PGD_Texture, a->textures[p]);
+			pgGpuMemoryRemove(&a->memory[p]);
+			pgMemFree(a->skylines[p].nodes);
+			pgMemFree(a->spare[p].nodes);
+		}
+		pgHandlePoolDestroy(&a->images);
+
+		memset(a, 0, sizeof(struct PGAtlasPrivate));
+		pgMemFree(a);
+
+		*atlas = NULL;
+	}
+}
+
+static struct PGAtlasEntry *lookupEntry(PGAtlas atlas, PGAtlasImage image)
+{
+	struct PGAtlasEntry **item = pgHandlePoolGet(atlas->images, image);
+	if (NULL == item)
+	{
+		if (PG_NULL_HANDLE != image) pgLog(PGL_Warn, "Stale atlas image handle 0x%08x.", image);
+		return NULL;
+	}
+	return *item;
+}
+
+PGResult pgAtlasAdd(PGAtlas atlas, PGAtlasImage *image, const GLubyte *pixels, GLsizei width, GLsizei height)
+{
+	if (NULL == image) return PGR_NullPointerBarf;
+	*image = PG_NULL_HANDLE;
+	if (NULL == atlas || NULL == pixels) return PGR_NullPointerBarf;
+
+	if (width <= 0 || height <= 0 || width + 2 * atlas->options.padding > atlas->options.pageSize || height + 2 * atlas->options.padding > atlas->options.pageSize)
+	{
+		pgLog(PGL_Error, "A %dx%d image won't fit on a %dx%d atlas page.", width, height, atlas->options.pageSize, atlas->options.pageSize);
+		return PGR_Unsupported;
+	}
+
+	struct PGAtlasEntry *entry = pgMemAlloc(sizeof(struct PGAtlasEntry), PGM_Texture);
+	if (NULL == entry) return PGR_OutOfMemory;
+	memset(entry, 0, sizeof(struct PGAtlasEntry));
+	entry->width = width;
+	entry->height = height;
+	entry->page = -1;
+
+	size_t bytes = (size_t)width * height * 4;
+	entry->pixels = pgMemAlloc(bytes, PGM_Texture);
+	struct PGAtlasEntry **item = NULL;
+	if (NULL != entry->pixels) entry->image = pgHandlePoolAdd(atlas->images, (void **)&item);
+	if (NULL == item)
+	{
+		freeEntry(entry);
+		return PGR_OutOfMemory;
+	}
+	memcpy(entry->pixels, pixels, bytes);
+	*item = entry;
+
+	entry->index = atlas->entries.count;
+	if (!listPush(&atlas->entries, entry) || !listPush(&atlas->queue, entry))
+	{
+		if (atlas->entries.count > entry->index) atlas->entries.count--;
+		pgHandlePoolRemove(atlas->images, entry->image);
+		freeEntry(entry);
+		return PGR_OutOfMemory;
+	}
+
+	*image = entry->image;
+	return PGR_OK;
+}
+
+void pgAtlasRemove(PGAtlas atlas, PGAtlasImage *image)
+{
+	if (NULL == atlas || NULL == image || PG_NULL_HANDLE == *image) return;
+
+	struct PGAtlasEntry *entry = lookupEntry(atlas, *image);
+	*image = PG_NULL_HANDLE;
+	if (NULL == entry) return;
+
+	pgHandlePoolRemove(atlas->images, entry->image);
+
+	struct PGAtlasEntry *last = atlas->entries.items[--atlas->entries.count];
+	atlas->entries.items[entry->index] = last;
+	last->index = entry->index;
+
+	if (ENTRY_Ready == entry->state)
+	{
+		atlas->liveArea -= paddedArea(atlas, entry);
+		atlas->holes = GL_TRUE;
+	}
+	if (ENTRY_Queued == entry->state) listRemove(&atlas->queue, entry);
+
+	if (entry->busy) entry->removed = GL_TRUE;
+	else freeEntry(entry);
+}
+
+PGResult pgAtlasLookup(PGAtlas atlas, PGAtlasImage image, PGAtlasRegion *region)
+{
+	if (NULL == region) return PGR_NullPointerBarf;
+	memset(region, 0, sizeof(PGAtlasRegion));
+	if (NULL == atlas) return PGR_NullPointerBarf;
+
+	const struct PGAtlasEntry *entry = lookupEntry(atlas, image);
+	if (NULL == entry) return PGR_StaleHandle;
+	if (ENTRY_Failed == entry->state) return PGR_OutOfMemory;
+	if (ENTRY_Ready != entry->state) return PGR_NotReady;
+
+	GLfloat scale = 1.0f / (GLfloat)atlas->options.pageSize;
+	GLsizei x = entry->x + atlas->options.padding, y = entry->y + atlas->options.padding;
+	region->texture = atlas->textures[entry->page];
+	region->page = entry->page;
+	region->u0 = (GLfloat)x * scale;
+	region->v0 = (GLfloat)y * scale;
+	region->u1 = (GLfloat)(x + entry->width) * scale;
+	region->v1 = (GLfloat)(y + entry->height) * scale;
+	return PGR_OK;
+}
+
+void pgAtlasStats(PGAtlas atlas, PGAtlasStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGAtlasStats));
+	if (NULL == atlas) return;
+
+	stats->pages = atlas->pageCount;
+	stats->images = pgHandlePoolCount(atlas->images);
+	stats->pending = (unsigned long)atlas->queue.count;
+	if (WORK_Pack == atlas->work) stats->pending += (unsigned long)atlas->batch.count;
+	stats->occupancy = atlas->packedArea > 0 ? (float)atlas->liveArea / (float)atlas->packedArea : 1.0f;
+	stats->defragmentations = atlas->defragmentations;
+}
@@ -0,0 +1,101 @@
+//
+//  PGAtlas.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGAtlas_h
+#define PGAtlas_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_ATLAS_MAX_PAGES 8
+	#define PG_ATLAS_DEFAULT_PAGE_SIZE 1024
+
+	typedef struct
+	{
+		GLsizei pageSize;			// Width and height of every page
+		GLsizei padding;			// Pixels kept clear around each image
+		GLboolean extrude;			// Fill the padding with the image's edge pixels instead of clearing it
+		float defragmentBelow;		// Repack once images cover less than this fraction of the packed area
+	}
+	PGAtlasOptions;
+
+	/**
+	 * Where an image is. Images sharing a texture can be drawn together.
+	 */
+	typedef struct
+	{
+		GLuint texture;
+		int page;
+		GLfloat u0, v0;				// Top left, on the first row of the image
+		GLfloat u1, v1;
+	}
+	PGAtlasRegion;
+
+	typedef struct
+	{
+		int pages;
+		unsigned long images;
+		unsigned long pending;		// Not yet packed and uploaded
+		float occupancy;			// Fraction of the packed area covered by images, padding included
+		unsigned long defragmentations;
+	}
+	PGAtlasStats;
+
+	/**
+	 * Packs small images into shared textures, so things drawn with
+	 * different images can still be batched.
+	 *
+	 * Each page is a square RGBA8 texture, filled bottom-left first by a
+	 * skyline packer. Added images are queued, and each pgAtlasUpdate
+	 * hands the queue to a job which pads and packs them, tallest first,
+	 * then uploads what it packed the next time it is called. Without a
+	 * job scheduler the packing happens inside pgAtlasUpdate.
+	 *
+	 * Removing an image leaves a hole. When images cover less than
+	 * `defragmentBelow` of the packed area, or an image doesn't fit while
+	 * there are holes, every image is repacked by a job into new pages,
+	 * which replace the old ones once uploaded. Regions move when this
+	 * happens, so look them up as they are drawn rather than keeping them.
+	 * Images keep a copy of their pixels for this.
+	 *
+	 * Atlases belong to the GL thread. With a job scheduler, that thread
+	 * must belong to it.
+	 */
+	PGResult pgAtlasCreate(PGAtlas *atlas, const PGAtlasOptions *options, PGJobScheduler jobs);
+	void pgAtlasDestroy(PGAtlas *atlas);
+
+	/**
+	 * Queues RGBA8 pixels, top row first, which are copied before
+	 * returning. Fails straight away if the image can never fit on a page.
+	 */
+	PGResult pgAtlasAdd(PGAtlas atlas, PGAtlasImage *image, const GLubyte *pixels, GLsizei width, GLsizei height);
+	void pgAtlasRemove(PGAtlas atlas, PGAtlasImage *image);
+
+	/**
+	 * PGR_NotReady until the image is packed and uploaded, and
+	 * PGR_OutOfMemory if it didn't fit in the atlas.
+	 */
+	PGResult pgAtlasLookup(PGAtlas atlas, PGAtlasImage image, PGAtlasRegion *region);
+
+	/**
+	 * Uploads finished packing and starts the next. Call once a frame.
+	 */
+	void pgAtlasUpdate(PGAtlas atlas);
+
+	/**
+	 * Packs and uploads everything queued, waiting for jobs to finish.
+	 */
+	void pgAtlasFlush(PGAtlas atlas);
+
+	void pgAtlasStats(PGAtlas atlas, PGAtlasStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,13 +8,67 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 #include "Pictogram.h"
 
+// Traced builds number fences in a table only the render thread touches,
+// so their loader waits with glFinish instead
+#if defined(GL_ES_VERSION_3_0) && !defined(PG_GL_TRACE)
+#	define PG_CONTEXT_HAS_FENCES 1
+#endif
+
+// Frame arenas for each scheduler thread, followed by one shared by
+// threads from outside the scheduler
+#define SHARED_ARENA PG_MAX_JOB_THREADS
+#define ARENAS_PER_FRAME (PG_MAX_JOB_THREADS + 1)
+
+struct PGLoad {
+	struct PGLoad *next;
+	PGLoadFunction load;
+	PGLoadCompletion complete;
+	void *userData;
+#ifdef PG_CONTEXT_HAS_FENCES
+	GLsync fence;		// Signalled when the load's GL work is done
+#endif
+};
+
 struct PGContextPrivate {
-	int nothing;
+	PGJobScheduler jobs;
+	
+	unsigned long frame;
+	size_t frameArenaSize;
+	PGArena frameArenas[PG_FRAMES_IN_FLIGHT][ARENAS_PER_FRAME];
+	pthread_mutex_t sharedArenaLock;
+	
+	// Loader thread. The lists and flags are shared with it under loadLock
+	PGSharedContext shared;
+	pthread_t loader;
+	GLboolean loaderRunning;
+	GLboolean fences;
+	pthread_mutex_t loadLock;
+	pthread_cond_t loadWake;
+	int loaderState;				// LOADER_* below
+	struct PGLoad *queued;			// Waiting for the loader, oldest first
+	struct PGLoad *queuedTail;
+	struct PGLoad *loaded;			// Run, waiting to complete, oldest first
+	struct PGLoad *loadedTail;
+	unsigned long pending;
+};
+
+enum
+{
+	LOADER_Starting = 0
+,	LOADER_Running
+,	LOADER_Failed
+,	LOADER_Stopping
 };
 
 PGResult pgContextCreate(PGContext *context)
+{
+	return pgContextCreateWithWorkers(context, -1);
+}
+
+PGResult pgContextCreateWithWorkers(PGContext *context, int workerCount)
 {
 	if (NULL == context)
 	{
@@ -22,23 +76,354 @@ PGResult pgContextCreate(PGContext *context)
 	}
 	*context = NULL;
 	
-	PGContext c = malloc(sizeof(struct PGContextPrivate));
+	PGContext c = pgMemAlloc(sizeof(struct PGContextPrivate), PGM_Context);
 	if (NULL == c) return PGR_OutOfMemory;
 	*context = c;
 	memset(c, 0, sizeof(struct PGContextPrivate));
+	c->frameArenaSize = PG_DEFAULT_FRAME_ARENA_SIZE;
+	pthread_mutex_init(&c->sharedArenaLock, NULL);
+	pthread_mutex_init(&c->loadLock, NULL);
+	pthread_cond_init(&c->loadWake, NULL);
+	
+	PGResult result = pgJobSchedulerCreate(&c->jobs, workerCount);
+	if (PGR_OK != result) return result;
 	
 	return PGR_OK;
 }
 
+PGResult pgContextCreateWithAllocator(PGContext *context, int workerCount, const PGAllocator *allocator)
+{
+	pgMemorySetAllocator(allocator);
+	return pgContextCreateWithWorkers(context, workerCount);
+}
+
 void pgContextDestroy(PGContext *context)
 {
 	if (NULL != context && NULL != *context)
 	{
 		PGContext c = *context;
 		
+		pgContextStopLoader(c);
+		pgJobSchedulerDestroy(&c->jobs);
+		
+		for (int frame = 0; frame < PG_FRAMES_IN_FLIGHT; frame++)
+		{
+			for (int i = 0; i < ARENAS_PER_FRAME; i++)
+			{
+				pgArenaDestroy(&c->frameArenas[frame][i]);
+			}
+		}
+		pthread_mutex_destroy(&c->sharedArenaLock);
+		pthread_mutex_destroy(&c->loadLock);
+		pthread_cond_destroy(&c->loadWake);
+		
 		memset(c, 0, sizeof(struct PGContextPrivate));
-		free(c);
+		pgMemFree(c);
 		
 		*context = NULL;
 	}
 }
+
+PGJobScheduler pgContextJobScheduler(PGContext context)
+{
+	if (NULL == context) return NULL;
+	
+	return context->jobs;
+}
+
+void pgContextBeginFrame(PGContext context)
+{
+	if (NULL == context) return;
+	
+	context->frame++;
+	
+	PGArena *arenas = context->frameArenas[context->frame % PG_FRAMES_IN_FLIGHT];
+	for (int i = 0; i < ARENAS_PER_FRAME; i++)
+	{
+		pgArenaReset(arenas[i]);
+	}
+}
+
+unsigned long pgContextFrameIndex(PGContext context)
+{
+	if (NULL == context) return 0;
+	
+	return context->frame;
+}
+
+static PGArena frameArena(PGContext context, int index)
+{
+	PGArena *arena = &context->frameArenas[context->frame % PG_FRAMES_IN_FLIGHT][index];
+	if (NULL == *arena)
+	{
+		// Only ever created by the thread which owns the slot, or under
+		// the shared arena lock
+		if (PGR_OK != pgArenaCreate(arena, context->frameArenaSize))
+		{
+			pgLog(PGL_Error, "Could not create frame arena.");
+			return NULL;
+		}
+	}
+	return *arena;
+}
+
+void *pgContextFrameAlloc(PGContext context, size_t size)
+{
+	if (NULL == context) return NULL;
+	
+	int thread = pgJobSchedulerCurrentThread(context->jobs);
+	if (thread >= 0)
+	{
+		return pgArenaAlloc(frameArena(context, thread), size);
+	}
+	
+	pthread_mutex_lock(&context->sharedArenaLock);
+	void *p = pgArenaAlloc(frameArena(context, SHARED_ARENA), size);
+	pthread_mutex_unlock(&context->sharedArenaLock);
+	return p;
+}
+
+void pgContextSetFrameArenaSize(PGContext context, size_t bytesPerThread)
+{
+	if (NULL == context) return;
+	
+	context->frameArenaSize = bytesPerThread;
+}
+
+void pgContextFrameArenaStats(PGContext context, PGArenaStats *stats)
+{
+	if (NULL == context || NULL == stats) return;
+	
+	memset(stats, 0, sizeof(PGArenaStats));
+	for (int i = 0; i < ARENAS_PER_FRAME; i++)
+	{
+		pgArenaAccumulateStats(context->frameArenas[context->frame % PG_FRAMES_IN_FLIGHT][i], stats);
+	}
+	
+	// The per frame sum above only sees this frame's arenas, so take the
+	// worst frame for the high water mark
+	for (int frame = 0; frame < PG_FRAMES_IN_FLIGHT; frame++)
+	{
+		size_t highWaterMark = 0;
+		for (int i = 0; i < ARENAS_PER_FRAME; i++)
+		{
+			PGArenaStats arenaStats;
+			pgArenaStats(context->frameArenas[frame][i], &arenaStats);
+			highWaterMark += arenaStats.highWaterMark;
+		}
+		if (highWaterMark > stats->highWaterMark)
+		{
+			stats->highWaterMark = highWaterMark;
+		}
+	}
+}
+
+// Loader ////////////////////////////////////////////////////////////////////
+
+static void *loaderThreadMain(void *arg)
+{
+	PGContext c = arg;
+	pgProfilerSetThreadName("loader");
+	
+	PGResult result = c->shared.makeCurrent(c->shared.userData);
+	
+	pthread_mutex_lock(&c->loadLock);
+	c->loaderState = PGR_OK == result ? LOADER_Running : LOADER_Failed;
+	pthread_cond_broadcast(&c->loadWake);
+	if (PGR_OK != result)
+	{
+		pthread_mutex_unlock(&c->loadLock);
+		return NULL;
+	}
+	
+	for (;;)
+	{
+		// Stopping still drains the queue
+		while (NULL == c->queued && LOADER_Stopping != c->loaderState)
+		{
+			pthread_cond_wait(&c->loadWake, &c->loadLock);
+		}
+		struct PGLoad *load = c->queued;
+		if (NULL == load) break;
+		
+		c->queued = load->next;
+		if (NULL == c->queued) c->queuedTail = NULL;
+		pthread_mutex_unlock(&c->loadLock);
+		
+		load->load(load->userData);
+		load->next = NULL;
+#ifdef PG_CONTEXT_HAS_FENCES
+		if (c->fences)
+		{
+			// The flush makes sure the fence reaches the GPU, so the render
+			// thread's poll can see it signal
+			load->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+		}
+		else
+#endif
+		{
+			glFinish();
+		}
+		
+		pthread_mutex_lock(&c->loadLock);
+		if (NULL != c->loadedTail) c->loadedTail->next = load;
+		else c->loaded = load;
+		c->loadedTail = load;
+	}
+	pthread_mutex_unlock(&c->loadLock);
+	
+	if (NULL != c->shared.releaseCurrent) c->shared.releaseCurrent(c->shared.userData);
+	return NULL;
+}
+
+PGResult pgContextStartLoader(PGContext context, const PGSharedContext *shared)
+{
+	if (NULL == context || NULL == shared || NULL == shared->makeCurrent) return PGR_NullPointerBarf;
+	if (context->loaderRunning) return PGR_OK;
+	
+	context->shared = *shared;
+	context->fences = GL_FALSE;
+#ifdef PG_CONTEXT_HAS_FENCES
+	const char *version = (const char *)glGetString(GL_VERSION);
+	context->fences = (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11));
+#endif
+	
+	context->loaderState = LOADER_Starting;
+	int error = pthread_create(&context->loader, NULL, loaderThreadMain, context);
+	if (0 != error)
+	{
+		pgLog(PGL_Error, "Could not start loader thread: %s", strerror(error));
+		return PGR_LazyGenericError;
+	}
+	
+	pthread_mutex_lock(&context->loadLock);
+	while (LOADER_Starting == context->loaderState)
+	{
+		pthread_cond_wait(&context->loadWake, &context->loadLock);
+	}
+	int state = context->loaderState;
+	pthread_mutex_unlock(&context->loadLock);
+	
+	if (LOADER_Failed == state)
+	{
+		pthread_join(context->loader, NULL);
+		pgLog(PGL_Error, "Could not make the loader's shared context current.");
+		return PGR_Unsupported;
+	}
+	
+	context->loaderRunning = GL_TRUE;
+	return PGR_OK;
+}
+
+/**
+ * Completes loads in order until one whose fence hasn't signalled, or
+ * until all are done if `wait`.
+ */
+static unsigned long publishLoads(PGContext context, GLboolean wait)
+{
+	unsigned long published = 0;
+	for (;;)
+	{
+		pthread_mutex_lock(&context->loadLock);
+		struct PGLoad *load = context->loaded;
+		pthread_mutex_unlock(&context->loadLock);
+		if (NULL == load) break;
+		
+#ifdef PG_CONTEXT_HAS_FENCES
+		if (NULL != load->fence)
+		{
+			// The loader flushed after the fence, so there's nothing for
+			// this context to flush
+			GLuint64 timeout = wait ? 1000000000ull : 0;
+			GLenum status;
+			do
+			{
+				status = glClientWaitSync(load->fence, 0, timeout);
+			}
+			while (wait && GL_TIMEOUT_EXPIRED == status);
+			
+			if (GL_TIMEOUT_EXPIRED == status) break;
+			if (GL_WAIT_FAILED == status)
+			{
+				pgLogAnyGlErrors("Waiting for load fence.");
+			}
+			glDeleteSync(load->fence);
+			load->fence = NULL;
+		}
+#endif
+		
+		pthread_mutex_lock(&context->loadLock);
+		context->loaded = load->next;
+		if (NULL == context->loaded) context->loadedTail = NULL;
+		context->pending--;
+		pthread_mutex_unlock(&context->loadLock);
+		
+		if (NULL != load->complete) load->complete(load->userData);
+		pgMemFree(load);
+		published++;
+	}
+	return published;
+}
+
+void pgContextStopLoader(PGContext context)
+{
+	if (NULL == context || !context->loaderRunning) return;
+	
+	pthread_mutex_lock(&context->loadLock);
+	context->loaderState = LOADER_Stopping;
+	pthread_cond_broadcast(&context->loadWake);
+	pthread_mutex_unlock(&context->loadLock);
+	
+	pthread_join(context->loader, NULL);
+	context->loaderRunning = GL_FALSE;
+	
+	publishLoads(context, GL_TRUE);
+}
+
+PGResult pgContextLoad(PGContext context, PGLoadFunction load, PGLoadCompletion complete, void *userData)
+{
+	if (NULL == context || NULL == load) return PGR_NullPointerBarf;
+	
+	// Traces are recorded from one thread, in the order calls are made
+	if (!context->loaderRunning || pgTraceIsRecording())
+	{
+		load(userData);
+		if (NULL != complete) complete(userData);
+		return PGR_OK;
+	}
+	
+	struct PGLoad *l = pgMemAlloc(sizeof(struct PGLoad), PGM_Context);
+	if (NULL == l) return PGR_OutOfMemory;
+	memset(l, 0, sizeof(struct PGLoad));
+	l->load = load;
+	l->complete = complete;
+	l->userData = userData;
+	
+	pthread_mutex_lock(&context->loadLock);
+	if (NULL != context->queuedTail) context->queuedTail->next = l;
+	else context->queued = l;
+	context->queuedTail = l;
+	context->pending++;
+	pthread_cond_broadcast(&context->loadWake);
+	pthread_mutex_unlock(&context->loadLock);
+	
+	return PGR_OK;
+}
+
+unsigned long pgContextPublishLoads(PGContext context)
+{
+	if (NULL == context) return 0;
+	
+	return publishLoads(context, GL_FALSE);
+}
+
+unsigned long pgContextPendingLoads(PGContext context)
+{
+	if (NULL == context) return 0;
+	
+	pthread_mutex_lock(&context->loadLock);
+	unsigned long pending = context->pending;
+	pthread_mutex_unlock(&context->loadLock);
+	return pending;
+}
@@ -12,9 +12,127 @@
 extern "C" {
 #endif
 
+// Frame allocations stay valid until this many further frames have begun
+#define PG_FRAMES_IN_FLIGHT 3
+
+// Default size of each thread's frame arena
+#define PG_DEFAULT_FRAME_ARENA_SIZE (64 * 1024)
+
+/**
+ * Creates a context. The calling thread joins the context's job scheduler,
+ * along with one worker thread per remaining core.
+ */
 PGResult pgContextCreate(PGContext *context);
+
+/**
+ * As pgContextCreate, but with a fixed number of job worker threads.
+ */
+PGResult pgContextCreateWithWorkers(PGContext *context, int workerCount);
+
+/**
+ * Installs `allocator` (see pgMemorySetAllocator) and then creates the
+ * context with it. The allocator is process wide, so every context shares
+ * it, and it must outlive everything allocated through it.
+ */
+PGResult pgContextCreateWithAllocator(PGContext *context, int workerCount, const PGAllocator *allocator);
 void pgContextDestroy(PGContext *context);
 
+PGJobScheduler pgContextJobScheduler(PGContext context);
+
+/**
+ * Starts a new frame, recycling the frame arenas used PG_FRAMES_IN_FLIGHT
+ * frames ago. Call it between frames, when no jobs are allocating.
+ */
+void pgContextBeginFrame(PGContext context);
+unsigned long pgContextFrameIndex(PGContext context);
+
+/**
+ * Allocates temporary memory which lives until PG_FRAMES_IN_FLIGHT more
+ * frames have begun, so it is still valid while queued frames which use
+ * it are in flight. Never free it.
+ *
+ * Each thread in the job scheduler allocates from its own arena without
+ * locking. Other threads share one arena behind a lock.
+ */
+void *pgContextFrameAlloc(PGContext context, size_t size);
+
+/**
+ * Sets the starting size of each thread's frame arena. Arenas which
+ * overflow grow to fit on their own, so this only affects how many frames
+ * spill before they settle. Applies to arenas created after the call.
+ */
+void pgContextSetFrameArenaSize(PGContext context, size_t bytesPerThread);
+
+/**
+ * Stats for the arenas of the current frame. The high water mark covers
+ * every frame so far.
+ */
+void pgContextFrameArenaStats(PGContext context, PGArenaStats *stats);
+
+/**
+ * A second GL context in the render context's share group, for the
+ * loader thread. makeCurrent and releaseCurrent are called on the loader
+ * thread. Platforms provide one, such as pgHeadlessSharedContext.
+ */
+typedef struct
+{
+	PGResult (*makeCurrent)(void *userData);
+	void (*releaseCurrent)(void *userData);
+	void *userData;
+}
+PGSharedContext;
+
+/**
+ * Runs on the loader thread with the shared context current. Only GL and
+ * thread safe work belongs here, such as pgProgramBuild, LGPrgNew or
+ * filling buffers and textures made with plain GL calls; handles such as
+ * PGProgram are made in the completion.
+ */
+typedef void (*PGLoadFunction)(void *userData);
+
+/**
+ * Runs on the render thread, from pgContextPublishLoads, once the GL
+ * objects the load made can be used there.
+ */
+typedef void (*PGLoadCompletion)(void *userData);
+
+/**
+ * Starts a thread which makes `shared` current and runs loads on it, so
+ * compiling, linking and uploading new content doesn't stall rendering.
+ * Call from the render thread with the render context current.
+ *
+ * Loads run in the order they were queued, and complete in the same
+ * order. On OpenGL ES 3 each load is followed by a fence which the render
+ * thread polls; elsewhere the loader waits for the GPU with glFinish.
+ */
+PGResult pgContextStartLoader(PGContext context, const PGSharedContext *shared);
+
+/**
+ * Finishes the loads already queued, stops the thread and completes
+ * them. Call from the render thread. pgContextDestroy calls this too.
+ */
+void pgContextStopLoader(PGContext context);
+
+/**
+ * Queues a load. With no loader thread, or while a GL trace is being
+ * recorded, the load and its completion both run straight away on the
+ * calling thread instead, which must then be the render thread.
+ * `complete` may be NULL.
+ */
+PGResult pgContextLoad(PGContext context, PGLoadFunction load, PGLoadCompletion complete, void *userData);
+
+/**
+ * Runs the completions of loads whose GL work has finished, without
+ * waiting for the rest, and returns how many ran. Call once a frame on
+ * the render thread.
+ */
+unsigned long pgContextPublishLoads(PGContext context);
+
+/**
+ * Loads queued or running which haven't completed.
+ */
+unsigned long pgContextPendingLoads(PGContext context);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,264 @@
+//
+//  PGDamage.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <string.h>
+#include "Pictogram.h"
+
+// Repaints whose bounds cover more than this share of the framebuffer go full
+#define FULL_NUMERATOR 3
+#define FULL_DENOMINATOR 4
+
+struct PGDamageList {
+	PGDamageRect rects[PG_DAMAGE_MAX_RECTS];
+	GLsizei count;
+};
+
+struct PGDamagePrivate {
+	GLsizei width;
+	GLsizei height;
+
+	struct PGDamageList pending;
+	struct PGDamageList history[PG_DAMAGE_HISTORY];	// This frame's first
+	int historyCount;								// Frames since the last resize
+
+	struct PGDamageList repaint;
+	PGDamageStats stats;
+};
+
+static unsigned long area(const PGDamageRect *r)
+{
+	return (unsigned long)r->width * (unsigned long)r->height;
+}
+
+static PGDamageRect unite(const PGDamageRect *a, const PGDamageRect *b)
+{
+	GLint left = a->x < b->x ? a->x : b->x;
+	GLint bottom = a->y < b->y ? a->y : b->y;
+	GLint right = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+	GLint top = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+	PGDamageRect r = { left, bottom, right - left, top - bottom };
+	return r;
+}
+
+/**
+ * Touching counts, as drawing two abutting rects costs more than one.
+ */
+static GLboolean touches(const PGDamageRect *a, const PGDamageRect *b)
+{
+	return a->x <= b->x + b->width && b->x <= a->x + a->width
+		&& a->y <= b->y + b->height && b->y <= a->y + a->height;
+}
+
+static void removeRect(struct PGDamageList *list, GLsizei index)
+{
+	list->rects[index] = list->rects[--list->count];
+}
+
+/**
+ * Adds a rect already clipped to the framebuffer, first absorbing every
+ * rect it touches. If the list overflows, the two rects whose union adds
+ * the least area are merged.
+ */
+static void addRect(struct PGDamageList *list, PGDamageRect rect)
+{
+	for (GLsizei i = 0; i < list->count; )
+	{
+		if (touches(&rect, &list->rects[i]))
+		{
+			rect = unite(&rect, &list->rects[i]);
+			removeRect(list, i);
+			i = 0;	// The bigger rect may touch ones already passed
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	if (list->count < PG_DAMAGE_MAX_RECTS)
+	{
+		list->rects[list->count++] = rect;
+		return;
+	}
+
+	// Merge the cheapest pair among the full list and the new rect
+	PGDamageRect all[PG_DAMAGE_MAX_RECTS + 1];
+	memcpy(all, list->rects, sizeof(list->rects));
+	all[PG_DAMAGE_MAX_RECTS] = rect;
+
+	GLsizei bestA = 0, bestB = 1;
+	unsigned long bestCost = (unsigned long)-1;
+	for (GLsizei a = 0; a < PG_DAMAGE_MAX_RECTS + 1; ++a)
+	{
+		for (GLsizei b = a + 1; b < PG_DAMAGE_MAX_RECTS + 1; ++b)
+		{
+			PGDamageRect u = unite(&all[a], &all[b]);
+			unsigned long cost = area(&u) - area(&all[a]) - area(&all[b]);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestA = a;
+				bestB = b;
+			}
+		}
+	}
+
+	PGDamageRect merged = unite(&all[bestA], &all[bestB]);
+	all[bestB] = all[PG_DAMAGE_MAX_RECTS];
+	list->count = 0;
+	for (GLsizei i = 0; i < PG_DAMAGE_MAX_RECTS; ++i)
+	{
+		if (i != bestA) list->rects[list->count++] = all[i];
+	}
+	addRect(list, merged);
+}
+
+static void setFull(struct PGDamageList *list, GLsizei width, GLsizei height)
+{
+	PGDamageRect full = { 0, 0, width, height };
+	list->rects[0] = full;
+	list->count = width > 0 && height > 0 ? 1 : 0;
+}
+
+PGResult pgDamageCreate(PGDamage *damage)
+{
+	if (NULL == damage) return PGR_NullPointerBarf;
+	*damage = NULL;
+
+	PGDamage d = pgMemAlloc(sizeof(struct PGDamagePrivate), PGM_Renderer);
+	if (NULL == d) return PGR_OutOfMemory;
+	memset(d, 0, sizeof(struct PGDamagePrivate));
+	*damage = d;
+
+	return PGR_OK;
+}
+
+void pgDamageDestroy(PGDamage *damage)
+{
+	if (NULL != damage && NULL != *damage)
+	{
+		PGDamage d = *damage;
+
+		memset(d, 0, sizeof(struct PGDamagePrivate));
+		pgMemFree(d);
+
+		*damage = NULL;
+	}
+}
+
+void pgDamageResize(PGDamage damage, GLsizei width, GLsizei height)
+{
+	if (NULL == damage) return;
+
+	damage->width = width;
+	damage->height = height;
+	damage->historyCount = 0;
+	setFull(&damage->pending, width, height);
+}
+
+void pgDamageAdd(PGDamage damage, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (NULL == damage) return;
+
+	GLint left = x > 0 ? x : 0;
+	GLint bottom = y > 0 ? y : 0;
+	GLint right = x + width < damage->width ? x + width : damage->width;
+	GLint top = y + height < damage->height ? y + height : damage->height;
+	if (right <= left || top <= bottom) return;
+
+	PGDamageRect rect = { left, bottom, right - left, top - bottom };
+	addRect(&damage->pending, rect);
+}
+
+void pgDamageAddAll(PGDamage damage)
+{
+	if (NULL == damage) return;
+
+	setFull(&damage->pending, damage->width, damage->height);
+}
+
+GLboolean pgDamageHasPending(PGDamage damage)
+{
+	if (NULL == damage) return GL_FALSE;
+
+	return damage->pending.count > 0;
+}
+
+void pgDamageBeginFrame(PGDamage damage, int bufferAge)
+{
+	if (NULL == damage) return;
+
+	memmove(&damage->history[1], &damage->history[0], sizeof(struct PGDamageList) * (PG_DAMAGE_HISTORY - 1));
+	damage->history[0] = damage->pending;
+	damage->pending.count = 0;
+	if (damage->historyCount < PG_DAMAGE_HISTORY) damage->historyCount++;
+
+	struct PGDamageList *repaint = &damage->repaint;
+	GLboolean full = bufferAge <= 0 || bufferAge > damage->historyCount;
+	if (!full)
+	{
+		*repaint = damage->history[0];
+		for (int frame = 1; frame < bufferAge; ++frame)
+		{
+			const struct PGDamageList *older = &damage->history[frame];
+			for (GLsizei i = 0; i < older->count; ++i) addRect(repaint, older->rects[i]);
+		}
+
+		if (repaint->count > 0)
+		{
+			PGDamageRect bounds = repaint->rects[0];
+			for (GLsizei i = 1; i < repaint->count; ++i) bounds = unite(&bounds, &repaint->rects[i]);
+			unsigned long screen = (unsigned long)damage->width * (unsigned long)damage->height;
+			full = area(&bounds) * FULL_DENOMINATOR > screen * FULL_NUMERATOR;
+		}
+	}
+	if (full) setFull(repaint, damage->width, damage->height);
+
+	damage->stats.rects = repaint->count;
+	damage->stats.pixels = 0;
+	for (GLsizei i = 0; i < repaint->count; ++i) damage->stats.pixels += area(&repaint->rects[i]);
+	if (0 == repaint->count) damage->stats.skippedFrames++;
+	else if (full) damage->stats.fullRepaints++;
+	else damage->stats.partialRepaints++;
+}
+
+GLsizei pgDamageRepaintRects(PGDamage damage, const PGDamageRect **rects)
+{
+	if (NULL != rects) *rects = NULL;
+	if (NULL == damage) return 0;
+
+	if (NULL != rects) *rects = damage->repaint.rects;
+	return damage->repaint.count;
+}
+
+GLboolean pgDamageRepaintBounds(PGDamage damage, PGDamageRect *bounds)
+{
+	if (NULL == bounds) return GL_FALSE;
+	memset(bounds, 0, sizeof(PGDamageRect));
+	if (NULL == damage || 0 == damage->repaint.count) return GL_FALSE;
+
+	*bounds = damage->repaint.rects[0];
+	for (GLsizei i = 1; i < damage->repaint.count; ++i) *bounds = unite(bounds, &damage->repaint.rects[i]);
+	return GL_TRUE;
+}
+
+GLboolean pgDamageIsFull(PGDamage damage)
+{
+	if (NULL == damage || 1 != damage->repaint.count) return GL_FALSE;
+
+	const PGDamageRect *r = &damage->repaint.rects[0];
+	return 0 == r->x && 0 == r->y && r->width == damage->width && r->height == damage->height;
+}
+
+void pgDamageStats(PGDamage damage, PGDamageStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGDamageStats));
+	if (NULL == damage) return;
+
+	*stats = damage->stats;
+}
@@ -0,0 +1,107 @@
+//
+//  PGDamage.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGDamage_h
+#define PGDamage_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Rects kept per frame. More are merged, cheapest merge first.
+	#define PG_DAMAGE_MAX_RECTS 4
+
+	// Frames of damage kept. Older buffers are repainted in full.
+	#define PG_DAMAGE_HISTORY 4
+
+	/**
+	 * In framebuffer pixels with the origin at the bottom left, as for
+	 * glScissor.
+	 */
+	typedef struct
+	{
+		GLint x;
+		GLint y;
+		GLsizei width;
+		GLsizei height;
+	}
+	PGDamageRect;
+
+	typedef struct
+	{
+		GLsizei rects;					// Repainted this frame
+		unsigned long pixels;			// Repainted this frame
+		unsigned long fullRepaints;		// Over the lifetime of the tracker
+		unsigned long partialRepaints;
+		unsigned long skippedFrames;	// Frames with nothing to repaint
+	}
+	PGDamageStats;
+
+	/**
+	 * Works out which parts of the framebuffer need drawing again, from
+	 * the rects reported as changed and how old the back buffer's contents
+	 * are.
+	 *
+	 * A back buffer `bufferAge` frames old is missing the damage of this
+	 * frame and of the frames in between, so that much is repainted. Age 0
+	 * means the contents are undefined, as after a swap which doesn't
+	 * preserve them, and everything is repainted. When the repaint would
+	 * cover most of the framebuffer anyway it becomes one full rect.
+	 *
+	 * The renderer owns one, which it sizes in pgRendererSetup and moves
+	 * on in pgRendererBeginFrame, so damage reported before
+	 * pgRendererBeginFrame is repainted that frame.
+	 */
+	PGResult pgDamageCreate(PGDamage *damage);
+	void pgDamageDestroy(PGDamage *damage);
+
+	/**
+	 * Forgets the history and damages everything.
+	 */
+	void pgDamageResize(PGDamage damage, GLsizei width, GLsizei height);
+
+	/**
+	 * Clipped to the framebuffer and merged with overlapping rects.
+	 */
+	void pgDamageAdd(PGDamage damage, GLint x, GLint y, GLsizei width, GLsizei height);
+	void pgDamageAddAll(PGDamage damage);
+
+	/**
+	 * True if anything was added since the last pgDamageBeginFrame.
+	 */
+	GLboolean pgDamageHasPending(PGDamage damage);
+
+	/**
+	 * Closes the damage reported since the last call as this frame's, and
+	 * works out the frame's repaint.
+	 */
+	void pgDamageBeginFrame(PGDamage damage, int bufferAge);
+
+	/**
+	 * The rects to draw this frame, and how many. None means the frame
+	 * looks the same as the back buffer and need not be drawn or presented.
+	 */
+	GLsizei pgDamageRepaintRects(PGDamage damage, const PGDamageRect **rects);
+
+	/**
+	 * One rect around the frame's repaint, for drawing it in a single
+	 * pass. False, with an empty rect, if nothing needs repainting.
+	 */
+	GLboolean pgDamageRepaintBounds(PGDamage damage, PGDamageRect *bounds);
+
+	/**
+	 * True if this frame repaints everything.
+	 */
+	GLboolean pgDamageIsFull(PGDamage damage);
+
+	void pgDamageStats(PGDamage damage, PGDamageStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
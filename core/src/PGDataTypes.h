@@ -8,6 +8,8 @@
 #ifndef PGDataTypes_h
 #define PGDataTypes_h
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +26,18 @@ extern "C" {
 	,	PGR_InvalidProgram
 	,	PGR_CouldNotLinkProgram
 	,   PGR_OutOfMemory
+	,	PGR_CouldNotCreateBuffer
+	,	PGR_NoActiveProgram
+	,	PGR_MissingAttribute
+	,	PGR_StaleHandle
+	,	PGR_Unsupported
+	,	PGR_MissingUniform
+	,	PGR_ReadbackFull
+	,	PGR_CouldNotCreateSocket
+	,	PGR_CouldNotDecode
+	,	PGR_NotReady
+	,	PGR_InvalidPipeline
+	,	PGR_Cancelled
 	}
 	PGResult;
 
@@ -37,9 +51,34 @@ extern "C" {
 	}
 	PGLogLevel;
 
+	// Generational handle, see PGHandle.h
+	typedef uint32_t PGHandle;
+
 	typedef struct PGContextPrivate* PGContext;
-	typedef struct PGProgramPrivate* PGProgram;
+	typedef PGHandle PGProgram;
 	typedef struct PGRendererPrivate* PGRenderer;
+	typedef PGHandle PGMesh;
+	typedef PGHandle PGTexture;
+	typedef struct PGHandlePoolPrivate* PGHandlePool;
+	typedef struct PGJobSchedulerPrivate* PGJobScheduler;
+	typedef struct PGJobPrivate* PGJob;
+	typedef struct PGRenderLoopPrivate* PGRenderLoop;
+	typedef struct PGArenaPrivate* PGArena;
+	typedef struct PGSoftRasterPrivate* PGSoftRaster;
+	typedef struct PGReadbackPrivate* PGReadback;
+	typedef struct PGMetricsServerPrivate* PGMetricsServer;
+	typedef struct PGAtlasPrivate* PGAtlas;
+	typedef PGHandle PGAtlasImage;
+	typedef PGHandle PGGpuResource;
+	typedef struct PGRenderTargetPoolPrivate* PGRenderTargetPool;
+	typedef PGHandle PGRenderTarget;
+	typedef struct PGFrameGraphPrivate* PGFrameGraph;
+	typedef PGHandle PGPipeline;
+	typedef struct PGUniformBufferPrivate* PGUniformBuffer;
+	typedef struct PGUploadQueuePrivate* PGUploadQueue;
+	typedef PGHandle PGUploadJob;
+	typedef struct PGDamagePrivate* PGDamage;
+	typedef struct PGFrameSchedulerPrivate* PGFrameScheduler;
 	
 #ifdef __cplusplus
 }
@@ -0,0 +1,117 @@
+//
+//  PGDeleteQueue.c
+//
+//  Created by David Wagner on 14/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "Pictogram.h"
+
+// One bucket per frame in flight, plus the one being filled
+#define NUM_BUCKETS (PG_FRAMES_IN_FLIGHT + 1)
+
+struct PGDeletion {
+	PGGLObjectType type;
+	GLuint name;
+};
+
+struct PGDeleteBucket {
+	struct PGDeletion *deletions;
+	unsigned long count;
+	unsigned long capacity;
+};
+
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static struct PGDeleteBucket Buckets[NUM_BUCKETS];
+static unsigned int Current;
+
+static void deleteObject(const struct PGDeletion *d)
+{
+	switch (d->type)
+	{
+		case PGD_Buffer: glDeleteBuffers(1, &d->name); break;
+		case PGD_Program: glDeleteProgram(d->name); break;
+		case PGD_Shader: glDeleteShader(d->name); break;
+		case PGD_Texture: glDeleteTextures(1, &d->name); break;
+		case PGD_Framebuffer: glDeleteFramebuffers(1, &d->name); break;
+		case PGD_Renderbuffer: glDeleteRenderbuffers(1, &d->name); break;
+	}
+}
+
+static void retireBucket(struct PGDeleteBucket *bucket)
+{
+	for (unsigned long i = 0; i < bucket->count; i++)
+	{
+		deleteObject(&bucket->deletions[i]);
+	}
+	bucket->count = 0;
+}
+
+void pgDeleteQueuePush(PGGLObjectType type, GLuint name)
+{
+	if (0 == name) return;
+
+	pthread_mutex_lock(&Lock);
+	struct PGDeleteBucket *bucket = &Buckets[Current];
+	if (bucket->count == bucket->capacity)
+	{
+		unsigned long capacity = bucket->capacity > 0 ? bucket->capacity * 2 : 32;
+		struct PGDeletion *deletions = pgMemAlloc(sizeof(struct PGDeletion) * capacity, PGM_Renderer);
+		if (NULL == deletions)
+		{
+			// Better to leak the object than delete it under a queued frame
+			pthread_mutex_unlock(&Lock);
+			pgLog(PGL_Error, "Out of memory queueing GL object %u for deletion.", name);
+			return;
+		}
+		if (bucket->count > 0)
+		{
+			memcpy(deletions, bucket->deletions, sizeof(struct PGDeletion) * bucket->count);
+		}
+		pgMemFree(bucket->deletions);
+		bucket->deletions = deletions;
+		bucket->capacity = capacity;
+	}
+
+	struct PGDeletion *d = &bucket->deletions[bucket->count++];
+	d->type = type;
+	d->name = name;
+	pthread_mutex_unlock(&Lock);
+}
+
+void pgDeleteQueueAdvanceFrame(void)
+{
+	pthread_mutex_lock(&Lock);
+	// The oldest bucket was filled PG_FRAMES_IN_FLIGHT frames ago. It
+	// becomes the bucket for this frame once it is empty.
+	Current = (Current + 1) % NUM_BUCKETS;
+	retireBucket(&Buckets[Current]);
+	pthread_mutex_unlock(&Lock);
+}
+
+void pgDeleteQueueFlush(void)
+{
+	pthread_mutex_lock(&Lock);
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++)
+	{
+		retireBucket(&Buckets[i]);
+	}
+	pthread_mutex_unlock(&Lock);
+}
+
+unsigned long pgDeleteQueuePending(void)
+{
+	unsigned long pending = 0;
+
+	pthread_mutex_lock(&Lock);
+	for (unsigned int i = 0; i < NUM_BUCKETS; i++)
+	{
+		pending += Buckets[i].count;
+	}
+	pthread_mutex_unlock(&Lock);
+
+	return pending;
+}
@@ -0,0 +1,52 @@
+//
+//  PGDeleteQueue.h
+//
+//  Created by David Wagner on 14/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGDeleteQueue_h
+#define PGDeleteQueue_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	typedef enum
+	{
+		PGD_Buffer = 0
+	,	PGD_Program
+	,	PGD_Shader
+	,	PGD_Texture
+	,	PGD_Framebuffer
+	,	PGD_Renderbuffer
+	}
+	PGGLObjectType;
+
+	/**
+	 * Queues a GL object for deletion once every frame that might still be
+	 * using it has finished, PG_FRAMES_IN_FLIGHT frames from now. Safe to
+	 * call from any thread. Zero names are ignored.
+	 */
+	void pgDeleteQueuePush(PGGLObjectType type, GLuint name);
+
+	/**
+	 * Deletes the objects whose frames have retired. Call once per frame on
+	 * the thread which owns the GL context. pgRendererBeginFrame does this
+	 * for you.
+	 */
+	void pgDeleteQueueAdvanceFrame(void);
+
+	/**
+	 * Deletes everything queued, immediately. For tearing down a context,
+	 * when no frames are in flight any more.
+	 */
+	void pgDeleteQueueFlush(void);
+
+	unsigned long pgDeleteQueuePending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
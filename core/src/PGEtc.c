@@ -0,0 +1,313 @@
+//
+//  PGEtc.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+// Blocks are 4x4 pixels. Colour blocks are 64 bits, read big endian, with
+// the pixel indices in the low 32 bits: bit (16 + i) is the high bit of
+// pixel i and bit i the low, where i counts down the columns (x * 4 + y).
+
+static const int Modifiers[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int Distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int AlphaModifiers[16][8] = {
+	{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+	{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+	{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+	{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+	{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+	{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+	{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static inline uint64_t readU64BE(const GLubyte *p)
+{
+	uint64_t x = 0;
+	for (int i = 0; i < 8; i++) x = x << 8 | p[i];
+	return x;
+}
+
+static inline int bits(uint64_t block, int low, int count)
+{
+	return (int)(block >> low) & ((1 << count) - 1);
+}
+
+static inline GLubyte clamp255(int x)
+{
+	return (GLubyte)(x < 0 ? 0 : x > 255 ? 255 : x);
+}
+
+static inline int extend4(int x) { return x << 4 | x; }
+static inline int extend5(int x) { return x << 3 | x >> 2; }
+static inline int extend6(int x) { return x << 2 | x >> 4; }
+static inline int extend7(int x) { return x << 1 | x >> 6; }
+
+static inline void setColor(GLubyte *c, int r, int g, int b)
+{
+	c[0] = clamp255(r);
+	c[1] = clamp255(g);
+	c[2] = clamp255(b);
+	c[3] = 255;
+}
+
+static inline int pixelIndex(uint64_t block, int i)
+{
+	return (int)((block >> (i + 15)) & 2) | (int)((block >> i) & 1);
+}
+
+/**
+ * T and H modes pick each pixel from four paint colours. Without the
+ * opaque bit, index 2 is transparent black.
+ */
+static void paint(uint64_t block, GLubyte palette[4][4], int opaque, GLubyte tile[16][4])
+{
+	if (!opaque) memset(palette[2], 0, 4);
+	for (int i = 0; i < 16; i++)
+	{
+		memcpy(tile[(i & 3) * 4 + (i >> 2)], palette[pixelIndex(block, i)], 4);
+	}
+}
+
+static void decodeT(uint64_t block, int opaque, GLubyte tile[16][4])
+{
+	int r1 = extend4(bits(block, 59, 2) << 2 | bits(block, 56, 2));
+	int g1 = extend4(bits(block, 52, 4)), b1 = extend4(bits(block, 48, 4));
+	int r2 = extend4(bits(block, 44, 4)), g2 = extend4(bits(block, 40, 4)), b2 = extend4(bits(block, 36, 4));
+	int d = Distances[bits(block, 34, 2) << 1 | bits(block, 32, 1)];
+
+	GLubyte palette[4][4];
+	setColor(palette[0], r1, g1, b1);
+	setColor(palette[1], r2 + d, g2 + d, b2 + d);
+	setColor(palette[2], r2, g2, b2);
+	setColor(palette[3], r2 - d, g2 - d, b2 - d);
+	paint(block, palette, opaque, tile);
+}
+
+static void decodeH(uint64_t block, int opaque, GLubyte tile[16][4])
+{
+	int r1 = bits(block, 59, 4);
+	int g1 = bits(block, 56, 3) << 1 | bits(block, 52, 1);
+	int b1 = bits(block, 51, 1) << 3 | bits(block, 47, 3);
+	int r2 = bits(block, 43, 4);
+	int g2 = bits(block, 39, 4);
+	int b2 = bits(block, 35, 4);
+
+	// The order of the base colours is the distance's lowest bit
+	int first = r1 << 8 | g1 << 4 | b1, second = r2 << 8 | g2 << 4 | b2;
+	int d = Distances[bits(block, 34, 1) << 2 | bits(block, 32, 1) << 1 | (first >= second)];
+
+	r1 = extend4(r1), g1 = extend4(g1), b1 = extend4(b1);
+	r2 = extend4(r2), g2 = extend4(g2), b2 = extend4(b2);
+
+	GLubyte palette[4][4];
+	setColor(palette[0], r1 + d, g1 + d, b1 + d);
+	setColor(palette[1], r1 - d, g1 - d, b1 - d);
+	setColor(palette[2], r2 + d, g2 + d, b2 + d);
+	setColor(palette[3], r2 - d, g2 - d, b2 - d);
+	paint(block, palette, opaque, tile);
+}
+
+/**
+ * Planar mode interpolates across the block from three colours, at the
+ * origin (O), the right hand side (H) and the bottom (V). Always opaque.
+ */
+static void decodePlanar(uint64_t block, GLubyte tile[16][4])
+{
+	int ro = extend6(bits(block, 57, 6));
+	int go = extend7(bits(block, 56, 1) << 6 | bits(block, 49, 6));
+	int bo = extend6(bits(block, 48, 1) << 5 | bits(block, 43, 2) << 3 | bits(block, 39, 3));
+	int rh = extend6(bits(block, 34, 5) << 1 | bits(block, 32, 1));
+	int gh = extend7(bits(block, 25, 7));
+	int bh = extend6(bits(block, 19, 6));
+	int rv = extend6(bits(block, 13, 6));
+	int gv = extend7(bits(block, 6, 7));
+	int bv = extend6(bits(block, 0, 6));
+
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			setColor(tile[y * 4 + x],
+				(x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+				(x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+				(x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+		}
+	}
+}
+
+/**
+ * An ETC2 RGB block, which ETC1 is a subset of. With punchthrough alpha,
+ * the differential bit says whether the block is opaque instead.
+ *
+ * ETC1 has no modes to overflow into. The reference decoders extend the
+ * out of range sum in 8 bits, so ETC1 blocks do that instead.
+ */
+static void decodeColorBlock(const GLubyte *src, int etc1, int punchthrough, GLubyte tile[16][4])
+{
+	uint64_t block = readU64BE(src);
+	int differential = bits(block, 33, 1);
+	int opaque = !punchthrough || differential;
+	if (punchthrough) differential = 1;
+
+	int base[2][3];
+	if (differential)
+	{
+		int r = bits(block, 59, 5), g = bits(block, 51, 5), b = bits(block, 43, 5);
+		int dr = bits(block, 56, 3), dg = bits(block, 48, 3), db = bits(block, 40, 3);
+		int r2 = r + (dr ^ 4) - 4, g2 = g + (dg ^ 4) - 4, b2 = b + (db ^ 4) - 4;
+
+		// Overflowing a channel selects one of the ETC2 modes
+		if (etc1)
+		{
+			r2 = (GLubyte)extend5((GLubyte)r2), g2 = (GLubyte)extend5((GLubyte)g2), b2 = (GLubyte)extend5((GLubyte)b2);
+		}
+		else if (r2 < 0 || r2 > 31)
+		{
+			decodeT(block, opaque, tile);
+			return;
+		}
+		else if (g2 < 0 || g2 > 31)
+		{
+			decodeH(block, opaque, tile);
+			return;
+		}
+		else if (b2 < 0 || b2 > 31)
+		{
+			decodePlanar(block, tile);
+			return;
+		}
+
+		else
+		{
+			r2 = extend5(r2), g2 = extend5(g2), b2 = extend5(b2);
+		}
+
+		base[0][0] = extend5(r), base[0][1] = extend5(g), base[0][2] = extend5(b);
+		base[1][0] = r2, base[1][1] = g2, base[1][2] = b2;
+	}
+	else
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			base[0][c] = extend4(bits(block, 60 - 8 * c, 4));
+			base[1][c] = extend4(bits(block, 56 - 8 * c, 4));
+		}
+	}
+
+	// Indices 0 to 3 add +small, +large, -small and -large
+	GLubyte palette[2][4][4];
+	for (int s = 0; s < 2; s++)
+	{
+		const int *m = Modifiers[bits(block, 37 - 3 * s, 3)];
+		int offsets[4] = { opaque ? m[0] : 0, m[1], -m[0], -m[1] };
+		for (int i = 0; i < 4; i++)
+		{
+			setColor(palette[s][i], base[s][0] + offsets[i], base[s][1] + offsets[i], base[s][2] + offsets[i]);
+		}
+		if (!opaque) memset(palette[s][2], 0, 4);
+	}
+
+	// The two sub blocks are side by side, or one above the other if flipped
+	int flip = bits(block, 32, 1);
+	for (int i = 0; i < 16; i++)
+	{
+		int x = i >> 2, y = i & 3;
+		int s = flip ? y >> 1 : x >> 1;
+		memcpy(tile[y * 4 + x], palette[s][pixelIndex(block, i)], 4);
+	}
+}
+
+/**
+ * An EAC alpha block: a base value, a multiplier and a modifier table,
+ * then a 3 bit index per pixel.
+ */
+static void decodeAlphaBlock(const GLubyte *src, GLubyte tile[16][4])
+{
+	uint64_t block = readU64BE(src);
+	int base = bits(block, 56, 8), multiplier = bits(block, 52, 4);
+	const int *modifiers = AlphaModifiers[bits(block, 48, 4)];
+
+	GLubyte alphas[8];
+	for (int i = 0; i < 8; i++) alphas[i] = clamp255(base + modifiers[i] * multiplier);
+	for (int i = 0; i < 16; i++)
+	{
+		tile[(i & 3) * 4 + (i >> 2)][3] = alphas[bits(block, 45 - 3 * i, 3)];
+	}
+}
+
+static size_t blockBytes(GLenum format)
+{
+	switch (format)
+	{
+		case GL_ETC1_RGB8_OES:
+		case GL_COMPRESSED_RGB8_ETC2:
+		case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+			return 8;
+		case GL_COMPRESSED_RGBA8_ETC2_EAC:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+int pgEtcCanDecode(GLenum format)
+{
+	return 0 != blockBytes(format);
+}
+
+size_t pgEtcImageSize(GLenum format, GLsizei width, GLsizei height)
+{
+	if (width <= 0 || height <= 0) return 0;
+	return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * blockBytes(format);
+}
+
+PGResult pgEtcDecode(GLenum format, const void *blocks, size_t size, GLsizei width, GLsizei height, GLubyte *pixels)
+{
+	if (NULL == blocks || NULL == pixels) return PGR_NullPointerBarf;
+
+	size_t bytes = blockBytes(format);
+	if (0 == bytes)
+	{
+		pgLog(PGL_Error, "Can't decode texture format 0x%04x.", format);
+		return PGR_Unsupported;
+	}
+	if (size < pgEtcImageSize(format, width, height))
+	{
+		pgLog(PGL_Error, "Only %zu bytes of blocks for a %dx%d image.", size, width, height);
+		return PGR_CouldNotDecode;
+	}
+
+	int etc1 = GL_ETC1_RGB8_OES == format;
+	int punchthrough = GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 == format;
+	int alpha = GL_COMPRESSED_RGBA8_ETC2_EAC == format;
+	const GLubyte *src = blocks;
+	GLubyte tile[16][4];
+	for (GLsizei by = 0; by < height; by += 4)
+	{
+		for (GLsizei bx = 0; bx < width; bx += 4, src += bytes)
+		{
+			// EAC alpha comes before the colour
+			decodeColorBlock(alpha ? src + 8 : src, etc1, punchthrough, tile);
+			if (alpha) decodeAlphaBlock(src, tile);
+
+			// Blocks hanging off the edge are cropped
+			int w = width - bx < 4 ? width - bx : 4;
+			int h = height - by < 4 ? height - by : 4;
+			for (int y = 0; y < h; y++)
+			{
+				memcpy(pixels + ((size_t)(by + y) * width + bx) * 4, tile[y * 4], (size_t)w * 4);
+			}
+		}
+	}
+	return PGR_OK;
+}
@@ -0,0 +1,53 @@
+//
+//  PGEtc.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGEtc_h
+#define PGEtc_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Not every platform's headers have these
+#ifndef GL_ETC1_RGB8_OES
+#	define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#	define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+#	define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#	define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+	/**
+	 * Whether pgEtcDecode handles `format`: ETC1, and ETC2 RGB8, RGB8 with
+	 * punchthrough alpha, and RGBA8 with EAC alpha.
+	 */
+	int pgEtcCanDecode(GLenum format);
+
+	/**
+	 * Bytes of blocks covering a `width` by `height` image, 0 for formats
+	 * which can't be decoded.
+	 */
+	size_t pgEtcImageSize(GLenum format, GLsizei width, GLsizei height);
+
+	/**
+	 * Decodes an image to RGBA8, rows in the same order as the blocks.
+	 * `size` must be at least pgEtcImageSize. Safe on any thread.
+	 */
+	PGResult pgEtcDecode(GLenum format, const void *blocks, size_t size, GLsizei width, GLsizei height, GLubyte *pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,528 @@
+//
+//  PGFrameGraph.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <string.h>
+#include "Pictogram.h"
+
+enum {
+	Invalidate_Unknown = 0
+,	Invalidate_None
+,	Invalidate_Core			// glInvalidateFramebuffer
+,	Invalidate_Extension	// glDiscardFramebufferEXT
+};
+
+typedef enum {
+	FR_Transient = 0
+,	FR_Imported
+,	FR_Backbuffer
+} PGFrameResourceKind;
+
+struct PGFrameResourceInfo {
+	const char *name;
+	PGFrameResourceKind kind;
+	PGRenderTargetDesc desc;
+	PGRenderTarget target;		// Imported, or acquired while executing
+	PGFramePass first;			// Of the passes which aren't culled
+	PGFramePass last;
+};
+
+struct PGFramePassInfo {
+	const char *name;
+	PGFramePassFunction function;
+	void *userData;
+	PGFrameResource reads[PG_FRAME_PASS_MAX_READS];
+	int readCount;
+	PGFrameResource write;
+	PGFrameLoad load;
+	GLboolean keep;
+
+	// Worked out by compiling
+	GLboolean culled;
+	GLboolean keepContents;		// A later pass loads what this one writes
+	GLboolean resolve;			// A later pass reads what this one writes
+};
+
+struct PGFrameGraphPrivate {
+	PGRenderer renderer;
+	int invalidate;
+
+	struct PGFramePassInfo passes[PG_FRAME_GRAPH_MAX_PASSES];
+	int passCount;
+	struct PGFrameResourceInfo resources[PG_FRAME_GRAPH_MAX_RESOURCES];
+	int resourceCount;
+	GLboolean compiled;
+
+	PGFrameGraphStats stats;
+};
+
+static void detectInvalidation(PGFrameGraph graph)
+{
+	if (Invalidate_Unknown != graph->invalidate) return;
+
+	graph->invalidate = Invalidate_None;
+#ifdef GL_ES_VERSION_3_0
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+	{
+		graph->invalidate = Invalidate_Core;
+		return;
+	}
+#endif
+#ifdef GL_EXT_discard_framebuffer
+	if (pgRendererHasExtension(graph->renderer, "GL_EXT_discard_framebuffer"))
+	{
+#ifdef PG_GL_LOADS_EXTENSIONS
+		if (NULL == pgglDiscardFramebufferEXT) return;
+#endif
+		graph->invalidate = Invalidate_Extension;
+	}
+#endif
+}
+
+static struct PGFramePassInfo *lookupPass(PGFrameGraph graph, PGFramePass pass)
+{
+	if (NULL == graph || pass < 0 || pass >= graph->passCount) return NULL;
+	return &graph->passes[pass];
+}
+
+static struct PGFrameResourceInfo *lookupResource(PGFrameGraph graph, PGFrameResource resource)
+{
+	if (NULL == graph || resource < 0 || resource >= graph->resourceCount) return NULL;
+	return &graph->resources[resource];
+}
+
+static PGFrameResource addResource(PGFrameGraph graph, const char *name, PGFrameResourceKind kind)
+{
+	if (NULL == graph) return PG_FRAME_NONE;
+	if (graph->resourceCount >= PG_FRAME_GRAPH_MAX_RESOURCES)
+	{
+		pgLog(PGL_Error, "Frame graph has no room for resource %s.", NULL != name ? name : "?");
+		return PG_FRAME_NONE;
+	}
+
+	PGFrameResource resource = graph->resourceCount++;
+	struct PGFrameResourceInfo *r = &graph->resources[resource];
+	memset(r, 0, sizeof(struct PGFrameResourceInfo));
+	r->name = name;
+	r->kind = kind;
+	r->target = PG_NULL_HANDLE;
+	r->first = r->last = PG_FRAME_NONE;
+	graph->compiled = GL_FALSE;
+	return resource;
+}
+
+// Invalidation //////////////////////////////////////////////////////////////
+
+/**
+ * Invalidates attachments of the bound framebuffer.
+ */
+static void invalidate(PGFrameGraph graph, GLboolean colour, GLboolean depth, GLboolean stencil)
+{
+	GLenum attachments[3];
+	GLsizei count = 0;
+	if (colour) attachments[count++] = GL_COLOR_ATTACHMENT0;
+	if (depth) attachments[count++] = GL_DEPTH_ATTACHMENT;
+	if (stencil) attachments[count++] = GL_STENCIL_ATTACHMENT;
+	if (0 == count) return;
+
+	switch (graph->invalidate)
+	{
+#ifdef GL_ES_VERSION_3_0
+		case Invalidate_Core:
+			glInvalidateFramebuffer(GL_FRAMEBUFFER, count, attachments);
+			break;
+#endif
+#ifdef GL_EXT_discard_framebuffer
+		case Invalidate_Extension:
+			glDiscardFramebufferEXT(GL_FRAMEBUFFER, count, attachments);
+			break;
+#endif
+		default:
+			return;
+	}
+	graph->stats.invalidations++;
+}
+
+static GLboolean hasStencil(GLenum depthFormat)
+{
+#ifdef GL_DEPTH24_STENCIL8_OES
+	if (GL_DEPTH24_STENCIL8_OES == depthFormat) return GL_TRUE;
+#endif
+	return GL_STENCIL_INDEX8 == depthFormat;
+}
+
+static void invalidateResource(PGFrameGraph graph, const struct PGFrameResourceInfo *r, GLboolean colour, GLboolean depth)
+{
+	if (FR_Backbuffer == r->kind)
+	{
+		invalidate(graph, colour, GL_FALSE, GL_FALSE);
+		return;
+	}
+	GLenum depthFormat = r->desc.depthFormat;
+	invalidate(graph, colour && 0 != r->desc.colourFormat,
+		depth && 0 != depthFormat && GL_STENCIL_INDEX8 != depthFormat,
+		depth && hasStencil(depthFormat));
+}
+
+// Graphs ////////////////////////////////////////////////////////////////////
+
+PGResult pgFrameGraphCreate(PGFrameGraph *graph, PGRenderer renderer)
+{
+	if (NULL == graph) return PGR_NullPointerBarf;
+	*graph = NULL;
+	if (NULL == renderer) return PGR_NullPointerBarf;
+	if (NULL == pgRendererRenderTargets(renderer)) return PGR_Unsupported;
+
+	PGFrameGraph g = pgMemAlloc(sizeof(struct PGFrameGraphPrivate), PGM_Renderer);
+	if (NULL == g) return PGR_OutOfMemory;
+	memset(g, 0, sizeof(struct PGFrameGraphPrivate));
+	*graph = g;
+
+	g->renderer = renderer;
+	return PGR_OK;
+}
+
+void pgFrameGraphDestroy(PGFrameGraph *graph)
+{
+	if (NULL != graph && NULL != *graph)
+	{
+		PGFrameGraph g = *graph;
+
+		memset(g, 0, sizeof(struct PGFrameGraphPrivate));
+		pgMemFree(g);
+
+		*graph = NULL;
+	}
+}
+
+void pgFrameGraphReset(PGFrameGraph graph)
+{
+	if (NULL == graph) return;
+
+	graph->passCount = 0;
+	graph->resourceCount = 0;
+	graph->compiled = GL_FALSE;
+}
+
+PGFrameResource pgFrameGraphCreateTarget(PGFrameGraph graph, const char *name, const PGRenderTargetDesc *desc)
+{
+	if (NULL == desc) return PG_FRAME_NONE;
+
+	PGFrameResource resource = addResource(graph, name, FR_Transient);
+	if (PG_FRAME_NONE != resource) graph->resources[resource].desc = *desc;
+	return resource;
+}
+
+PGFrameResource pgFrameGraphImport(PGFrameGraph graph, const char *name, PGRenderTarget target)
+{
+	if (NULL == graph) return PG_FRAME_NONE;
+
+	PGRenderTargetDesc desc;
+	if (PGR_OK != pgRenderTargetDescription(pgRendererRenderTargets(graph->renderer), target, &desc)) return PG_FRAME_NONE;
+
+	PGFrameResource resource = addResource(graph, name, FR_Imported);
+	if (PG_FRAME_NONE != resource)
+	{
+		graph->resources[resource].desc = desc;
+		graph->resources[resource].target = target;
+	}
+	return resource;
+}
+
+PGFrameResource pgFrameGraphBackbuffer(PGFrameGraph graph)
+{
+	return addResource(graph, "backbuffer", FR_Backbuffer);
+}
+
+PGFramePass pgFrameGraphAddPass(PGFrameGraph graph, const char *name, PGFramePassFunction function, void *userData)
+{
+	if (NULL == graph) return PG_FRAME_NONE;
+	if (graph->passCount >= PG_FRAME_GRAPH_MAX_PASSES)
+	{
+		pgLog(PGL_Error, "Frame graph has no room for pass %s.", NULL != name ? name : "?");
+		return PG_FRAME_NONE;
+	}
+
+	PGFramePass pass = graph->passCount++;
+	struct PGFramePassInfo *p = &graph->passes[pass];
+	memset(p, 0, sizeof(struct PGFramePassInfo));
+	p->name = name;
+	p->function = function;
+	p->userData = userData;
+	p->write = PG_FRAME_NONE;
+	graph->compiled = GL_FALSE;
+	return pass;
+}
+
+PGResult pgFrameGraphRead(PGFrameGraph graph, PGFramePass pass, PGFrameResource resource)
+{
+	struct PGFramePassInfo *p = lookupPass(graph, pass);
+	struct PGFrameResourceInfo *r = lookupResource(graph, resource);
+	if (NULL == p || NULL == r) return PGR_LazyGenericError;
+	if (FR_Backbuffer == r->kind || !r->desc.sampled)
+	{
+		pgLog(PGL_Error, "Pass %s can't read %s, which isn't a sampled target.", p->name, r->name);
+		return PGR_Unsupported;
+	}
+	if (p->readCount >= PG_FRAME_PASS_MAX_READS) return PGR_OutOfMemory;
+
+	p->reads[p->readCount++] = resource;
+	graph->compiled = GL_FALSE;
+	return PGR_OK;
+}
+
+PGResult pgFrameGraphWrite(PGFrameGraph graph, PGFramePass pass, PGFrameResource resource, PGFrameLoad load)
+{
+	struct PGFramePassInfo *p = lookupPass(graph, pass);
+	if (NULL == p || NULL == lookupResource(graph, resource)) return PGR_LazyGenericError;
+	if (PG_FRAME_NONE != p->write)
+	{
+		pgLog(PGL_Error, "Pass %s already writes %s.", p->name, graph->resources[p->write].name);
+		return PGR_Unsupported;
+	}
+
+	p->write = resource;
+	p->load = load;
+	graph->compiled = GL_FALSE;
+	return PGR_OK;
+}
+
+void pgFrameGraphKeepPass(PGFrameGraph graph, PGFramePass pass)
+{
+	struct PGFramePassInfo *p = lookupPass(graph, pass);
+	if (NULL == p) return;
+
+	p->keep = GL_TRUE;
+	graph->compiled = GL_FALSE;
+}
+
+PGResult pgFrameGraphCompile(PGFrameGraph graph)
+{
+	if (NULL == graph) return PGR_NullPointerBarf;
+	if (graph->compiled) return PGR_OK;
+
+	// Walk back from the last pass, tracking which resources a later pass
+	// still needs the contents of. Writing without loading ends the need,
+	// as earlier contents are overwritten.
+	GLboolean needed[PG_FRAME_GRAPH_MAX_RESOURCES] = { GL_FALSE };
+	GLboolean loaded[PG_FRAME_GRAPH_MAX_RESOURCES] = { GL_FALSE };
+	GLboolean read[PG_FRAME_GRAPH_MAX_RESOURCES] = { GL_FALSE };
+	unsigned long culled = 0;
+	for (PGFramePass i = graph->passCount - 1; i >= 0; i--)
+	{
+		struct PGFramePassInfo *p = &graph->passes[i];
+		PGFrameResource w = p->write;
+		GLboolean sideEffect = p->keep || (PG_FRAME_NONE != w && FR_Transient != graph->resources[w].kind);
+
+		p->culled = !sideEffect && (PG_FRAME_NONE == w || !needed[w]);
+		if (p->culled)
+		{
+			culled++;
+			continue;
+		}
+
+		if (PG_FRAME_NONE != w)
+		{
+			p->keepContents = loaded[w];
+			p->resolve = read[w];
+			loaded[w] = PGFL_Load == p->load;
+			read[w] = GL_FALSE;
+			needed[w] = PGFL_Load == p->load;
+		}
+		for (int j = 0; j < p->readCount; j++)
+		{
+			needed[p->reads[j]] = GL_TRUE;
+			read[p->reads[j]] = GL_TRUE;
+		}
+	}
+
+	for (PGFrameResource r = 0; r < graph->resourceCount; r++)
+	{
+		graph->resources[r].first = graph->resources[r].last = PG_FRAME_NONE;
+	}
+	for (PGFramePass i = 0; i < graph->passCount; i++)
+	{
+		struct PGFramePassInfo *p = &graph->passes[i];
+		if (p->culled) continue;
+
+		for (int j = 0; j <= p->readCount; j++)
+		{
+			PGFrameResource resource = j < p->readCount ? p->reads[j] : p->write;
+			if (PG_FRAME_NONE == resource) continue;
+
+			struct PGFrameResourceInfo *r = &graph->resources[resource];
+			if (PG_FRAME_NONE == r->first && FR_Transient == r->kind && (j < p->readCount || PGFL_Load == p->load))
+			{
+				pgLog(PGL_Error, "Pass %s uses %s before anything writes it.", p->name, r->name);
+				return PGR_LazyGenericError;
+			}
+			if (PG_FRAME_NONE == r->first) r->first = i;
+			r->last = i;
+		}
+	}
+
+	unsigned long transients = 0;
+	for (PGFrameResource r = 0; r < graph->resourceCount; r++)
+	{
+		if (FR_Transient == graph->resources[r].kind && PG_FRAME_NONE != graph->resources[r].first) transients++;
+	}
+
+	graph->stats.passes = graph->passCount;
+	graph->stats.culled = culled;
+	graph->stats.transients = transients;
+	graph->compiled = GL_TRUE;
+	return PGR_OK;
+}
+
+static PGResult bindTarget(PGFrameGraph graph, struct PGFramePassInfo *p)
+{
+	struct PGFrameResourceInfo *r = &graph->resources[p->write];
+
+	// A partial repaint keeps the backbuffer outside the damage
+	PGDamageRect repaint;
+	GLboolean partial = GL_FALSE;
+	if (FR_Backbuffer == r->kind)
+	{
+		pgRendererBindFramebuffer(graph->renderer);
+		partial = pgRendererRepaintScissor(graph->renderer, &repaint);
+	}
+	else
+	{
+		PGResult result = pgRenderTargetBind(pgRendererRenderTargets(graph->renderer), r->target);
+		if (PGR_OK != result) return result;
+	}
+
+	switch (p->load)
+	{
+		case PGFL_DontCare:
+			if (!partial) invalidateResource(graph, r, GL_TRUE, GL_TRUE);
+			break;
+		case PGFL_Clear:
+			if (!partial) invalidateResource(graph, r, GL_TRUE, GL_TRUE);
+			// Clears obey the write masks and scissor a pipeline left set
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthMask(GL_TRUE);
+			glStencilMask(~0u);
+			if (partial)
+			{
+				glEnable(GL_SCISSOR_TEST);
+				glScissor(repaint.x, repaint.y, repaint.width, repaint.height);
+			}
+			else
+			{
+				glDisable(GL_SCISSOR_TEST);
+			}
+			pgRendererInvalidateState(graph->renderer);
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClearDepthf(1.0f);
+			glClearStencil(0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			break;
+		case PGFL_Load:
+			break;
+	}
+	return PGR_OK;
+}
+
+/**
+ * Resolves the target if a later pass reads it and drops whatever no
+ * later pass needs, so a tiler doesn't write it back.
+ */
+static void finishTarget(PGFrameGraph graph, struct PGFramePassInfo *p, PGRenderTargetPool pool)
+{
+	struct PGFrameResourceInfo *r = &graph->resources[p->write];
+	if (FR_Transient != r->kind) return;
+
+	GLboolean multisampled = r->desc.samples > 1;
+	if (multisampled && p->resolve)
+	{
+		pgRenderTargetResolve(pool, r->target);
+		graph->stats.resolves++;
+	}
+	if (p->keepContents) return;
+
+	// The colour is still needed if it is read from a single sampled target
+	invalidateResource(graph, r, multisampled || !p->resolve, GL_TRUE);
+}
+
+PGResult pgFrameGraphExecute(PGFrameGraph graph)
+{
+	if (NULL == graph) return PGR_NullPointerBarf;
+	PGResult result = pgFrameGraphCompile(graph);
+	if (PGR_OK != result) return result;
+	pgProfileZone(__func__);
+
+	detectInvalidation(graph);
+	PGRenderTargetPool pool = pgRendererRenderTargets(graph->renderer);
+	PGRenderTarget used[PG_FRAME_GRAPH_MAX_RESOURCES];
+	unsigned long targets = 0;
+	graph->stats.resolves = 0;
+	graph->stats.invalidations = 0;
+
+	for (PGFramePass i = 0; i < graph->passCount && PGR_OK == result; i++)
+	{
+		struct PGFramePassInfo *p = &graph->passes[i];
+		if (p->culled) continue;
+
+		// Transients starting here
+		for (PGFrameResource resource = 0; resource < graph->resourceCount && PGR_OK == result; resource++)
+		{
+			struct PGFrameResourceInfo *r = &graph->resources[resource];
+			if (FR_Transient != r->kind || r->first != i) continue;
+
+			result = pgRenderTargetAcquire(pool, &r->target, &r->desc);
+			if (PGR_OK != result) break;
+
+			unsigned long t = 0;
+			while (t < targets && used[t] != r->target) t++;
+			if (t == targets) used[targets++] = r->target;
+		}
+
+		if (PGR_OK == result && PG_FRAME_NONE != p->write) result = bindTarget(graph, p);
+		if (PGR_OK == result && NULL != p->function)
+		{
+			pgProfileZone(NULL != p->name ? p->name : "pass");
+			p->function(graph, i, p->userData);
+		}
+		if (PGR_OK == result && PG_FRAME_NONE != p->write) finishTarget(graph, p, pool);
+
+		// Transients ending here go back for later passes to reuse
+		for (PGFrameResource resource = 0; resource < graph->resourceCount; resource++)
+		{
+			struct PGFrameResourceInfo *r = &graph->resources[resource];
+			if (FR_Transient == r->kind && (r->last == i || PGR_OK != result)) pgRenderTargetRelease(pool, &r->target);
+		}
+	}
+
+	pgRendererBindFramebuffer(graph->renderer);
+	pgLogAnyGlErrors("Executed frame graph.");
+	graph->stats.targets = targets;
+	return result;
+}
+
+GLuint pgFrameGraphTexture(PGFrameGraph graph, PGFrameResource resource)
+{
+	struct PGFrameResourceInfo *r = lookupResource(graph, resource);
+	if (NULL == r || PG_NULL_HANDLE == r->target) return 0;
+
+	return pgRenderTargetTexture(pgRendererRenderTargets(graph->renderer), r->target);
+}
+
+GLboolean pgFrameGraphPassCulled(PGFrameGraph graph, PGFramePass pass)
+{
+	struct PGFramePassInfo *p = lookupPass(graph, pass);
+	return NULL != p && graph->compiled && p->culled;
+}
+
+void pgFrameGraphStats(PGFrameGraph graph, PGFrameGraphStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGFrameGraphStats));
+	if (NULL == graph) return;
+
+	*stats = graph->stats;
+}
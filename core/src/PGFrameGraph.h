@@ -0,0 +1,141 @@
+//
+//  PGFrameGraph.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGFrameGraph_h
+#define PGFrameGraph_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_FRAME_GRAPH_MAX_PASSES 32
+	#define PG_FRAME_GRAPH_MAX_RESOURCES 32
+	#define PG_FRAME_PASS_MAX_READS 8
+
+	// Passes and resources are indices into the frame being declared, and
+	// mean nothing after pgFrameGraphReset
+	typedef int PGFramePass;
+	typedef int PGFrameResource;
+	#define PG_FRAME_NONE (-1)
+
+	/**
+	 * What a pass needs of the target it writes when it starts.
+	 */
+	typedef enum
+	{
+		PGFL_DontCare = 0	// The pass covers every pixel itself
+	,	PGFL_Clear			// Cleared to transparent black and the far plane
+	,	PGFL_Load			// Drawn over what an earlier pass left
+	}
+	PGFrameLoad;
+
+	typedef void (*PGFramePassFunction)(PGFrameGraph graph, PGFramePass pass, void *userData);
+
+	typedef struct
+	{
+		unsigned long passes;			// Declared in the last compiled frame
+		unsigned long culled;
+		unsigned long transients;		// Used by passes which weren't culled
+		unsigned long targets;			// Render targets those shared
+		unsigned long resolves;
+		unsigned long invalidations;	// Framebuffers invalidated or discarded
+	}
+	PGFrameGraphStats;
+
+	/**
+	 * Schedules a frame's passes from what they read and write.
+	 *
+	 * Each frame, declare the resources and passes, then execute. Passes
+	 * run in the order they were declared, so a pass can only read what an
+	 * earlier pass wrote. Passes whose output is never read, directly or
+	 * through later passes, are culled. Passes which write the backbuffer
+	 * or an imported target, or which are kept with pgFrameGraphKeepPass,
+	 * always run.
+	 *
+	 * Transient targets are acquired from the renderer's PGRenderTargetPool
+	 * just before the first pass using them and released after the last,
+	 * so transients with the same description whose lifetimes don't
+	 * overlap share a target. GL can't alias memory between formats, so
+	 * only matching descriptions share.
+	 *
+	 * Attachments whose contents won't be needed again are invalidated,
+	 * with glInvalidateFramebuffer on ES 3 or glDiscardFramebufferEXT, so
+	 * tiled GPUs neither load them at the start of a pass nor store them
+	 * at the end. Multisampled transients which are read later are
+	 * resolved at the end of the pass writing them.
+	 *
+	 * Graphs belong to the GL thread.
+	 */
+	PGResult pgFrameGraphCreate(PGFrameGraph *graph, PGRenderer renderer);
+	void pgFrameGraphDestroy(PGFrameGraph *graph);
+
+	/**
+	 * Forgets the last frame's passes and resources.
+	 */
+	void pgFrameGraphReset(PGFrameGraph graph);
+
+	/**
+	 * A render target which only lives for this frame. `name` is kept, not
+	 * copied, and is only for logs.
+	 */
+	PGFrameResource pgFrameGraphCreateTarget(PGFrameGraph graph, const char *name, const PGRenderTargetDesc *desc);
+
+	/**
+	 * A target from the renderer's pool which outlives the frame, such as
+	 * last frame's image for feedback effects.
+	 */
+	PGFrameResource pgFrameGraphImport(PGFrameGraph graph, const char *name, PGRenderTarget target);
+
+	/**
+	 * The renderer's own framebuffer. During a partial repaint, passes
+	 * writing it clear only the rect pgRendererScissorRepaint was given,
+	 * and PGFL_DontCare doesn't discard it.
+	 */
+	PGFrameResource pgFrameGraphBackbuffer(PGFrameGraph graph);
+
+	/**
+	 * Adds a pass which calls `function` when the graph executes, with its
+	 * target bound if it writes one. `name` is kept, not copied.
+	 */
+	PGFramePass pgFrameGraphAddPass(PGFrameGraph graph, const char *name, PGFramePassFunction function, void *userData);
+
+	/**
+	 * The pass samples the resource's colour texture.
+	 */
+	PGResult pgFrameGraphRead(PGFrameGraph graph, PGFramePass pass, PGFrameResource resource);
+
+	/**
+	 * The pass draws into the resource. A pass writes one resource at most.
+	 */
+	PGResult pgFrameGraphWrite(PGFrameGraph graph, PGFramePass pass, PGFrameResource resource, PGFrameLoad load);
+
+	/**
+	 * Runs the pass even if nothing reads what it writes, for passes with
+	 * effects the graph can't see.
+	 */
+	void pgFrameGraphKeepPass(PGFrameGraph graph, PGFramePass pass);
+
+	/**
+	 * Orders and culls the passes and works out resource lifetimes.
+	 * pgFrameGraphExecute compiles first if the frame hasn't been.
+	 */
+	PGResult pgFrameGraphCompile(PGFrameGraph graph);
+	PGResult pgFrameGraphExecute(PGFrameGraph graph);
+
+	/**
+	 * While executing, the texture of a resource the pass reads.
+	 */
+	GLuint pgFrameGraphTexture(PGFrameGraph graph, PGFrameResource resource);
+
+	GLboolean pgFrameGraphPassCulled(PGFrameGraph graph, PGFramePass pass);
+	void pgFrameGraphStats(PGFrameGraph graph, PGFrameGraphStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+//
+//  PGFrameScheduler.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+struct PGFrameSchedulerPrivate {
+	PGFrameSchedulerCallbacks callbacks;
+	PGFrameSchedulerMode mode;
+
+	// Set from any thread
+	int dirty;
+	int animations;
+	unsigned long wakes;
+	uint64_t deadline;		// PG_FRAME_SCHEDULER_IDLE if none
+
+	PGFrameSchedulerStats stats;
+};
+
+static uint64_t now(PGFrameScheduler scheduler)
+{
+	if (NULL != scheduler->callbacks.now) return scheduler->callbacks.now(scheduler->callbacks.userData);
+	return pgStatsNowMicroseconds();
+}
+
+static GLboolean workPending(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler->callbacks.workPending) return GL_FALSE;
+	return scheduler->callbacks.workPending(scheduler->callbacks.userData);
+}
+
+static void wake(PGFrameScheduler scheduler)
+{
+	__atomic_add_fetch(&scheduler->wakes, 1, __ATOMIC_RELAXED);
+	if (NULL != scheduler->callbacks.wake) scheduler->callbacks.wake(scheduler->callbacks.userData);
+}
+
+PGResult pgFrameSchedulerCreate(PGFrameScheduler *scheduler, const PGFrameSchedulerCallbacks *callbacks)
+{
+	if (NULL == scheduler) return PGR_NullPointerBarf;
+	*scheduler = NULL;
+
+	PGFrameScheduler s = pgMemAlloc(sizeof(struct PGFrameSchedulerPrivate), PGM_Renderer);
+	if (NULL == s) return PGR_OutOfMemory;
+	memset(s, 0, sizeof(struct PGFrameSchedulerPrivate));
+	*scheduler = s;
+
+	if (NULL != callbacks) s->callbacks = *callbacks;
+	s->mode = PGFS_OnDemand;
+	s->deadline = PG_FRAME_SCHEDULER_IDLE;
+
+	// The first frame is always drawn
+	s->dirty = 1;
+	return PGR_OK;
+}
+
+void pgFrameSchedulerDestroy(PGFrameScheduler *scheduler)
+{
+	if (NULL != scheduler && NULL != *scheduler)
+	{
+		PGFrameScheduler s = *scheduler;
+
+		memset(s, 0, sizeof(struct PGFrameSchedulerPrivate));
+		pgMemFree(s);
+
+		*scheduler = NULL;
+	}
+}
+
+void pgFrameSchedulerSetMode(PGFrameScheduler scheduler, PGFrameSchedulerMode mode)
+{
+	if (NULL == scheduler || mode == scheduler->mode) return;
+
+	scheduler->mode = mode;
+	if (PGFS_Continuous == mode) wake(scheduler);
+}
+
+PGFrameSchedulerMode pgFrameSchedulerMode(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return PGFS_OnDemand;
+
+	return scheduler->mode;
+}
+
+void pgFrameSchedulerInvalidate(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return;
+
+	if (0 == __atomic_exchange_n(&scheduler->dirty, 1, __ATOMIC_ACQ_REL)) wake(scheduler);
+}
+
+void pgFrameSchedulerInvalidateAt(PGFrameScheduler scheduler, uint64_t time)
+{
+	if (NULL == scheduler) return;
+
+	// Only ever moved earlier, until a tick takes it
+	uint64_t deadline = __atomic_load_n(&scheduler->deadline, __ATOMIC_ACQUIRE);
+	do
+	{
+		if (time >= deadline) return;
+	}
+	while (!__atomic_compare_exchange_n(&scheduler->deadline, &deadline, time, GL_TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	// The display link keeps ticking while a deadline is waiting, but may
+	// have been paused if there wasn't one
+	if (PG_FRAME_SCHEDULER_IDLE == deadline) wake(scheduler);
+}
+
+void pgFrameSchedulerBeginAnimation(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return;
+
+	if (0 == __atomic_fetch_add(&scheduler->animations, 1, __ATOMIC_ACQ_REL)) wake(scheduler);
+}
+
+void pgFrameSchedulerEndAnimation(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return;
+
+	int animations = __atomic_sub_fetch(&scheduler->animations, 1, __ATOMIC_ACQ_REL);
+	if (animations < 0)
+	{
+		pgLog(PGL_Warn, "More frame scheduler animations ended than began.");
+		__atomic_store_n(&scheduler->animations, 0, __ATOMIC_RELEASE);
+	}
+	else if (0 == animations)
+	{
+		// Draw where the animation stopped
+		pgFrameSchedulerInvalidate(scheduler);
+	}
+}
+
+GLboolean pgFrameSchedulerShouldRender(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return GL_TRUE;
+
+	scheduler->stats.ticks++;
+
+	// Cleared first, so invalidations made while drawing ask for another frame
+	GLboolean render = 0 != __atomic_exchange_n(&scheduler->dirty, 0, __ATOMIC_ACQ_REL);
+	uint64_t deadline = __atomic_load_n(&scheduler->deadline, __ATOMIC_ACQUIRE);
+	uint64_t time = PG_FRAME_SCHEDULER_IDLE != deadline ? now(scheduler) : 0;
+	while (PG_FRAME_SCHEDULER_IDLE != deadline && time >= deadline)
+	{
+		// Fails if another thread moved the deadline earlier, which is due too
+		if (__atomic_compare_exchange_n(&scheduler->deadline, &deadline, PG_FRAME_SCHEDULER_IDLE, GL_TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			render = GL_TRUE;
+			break;
+		}
+	}
+	render = render
+		|| PGFS_Continuous == scheduler->mode
+		|| __atomic_load_n(&scheduler->animations, __ATOMIC_ACQUIRE) > 0
+		|| workPending(scheduler);
+
+	if (render) scheduler->stats.framesRendered++;
+	else scheduler->stats.framesSkipped++;
+	return render;
+}
+
+uint64_t pgFrameSchedulerNextFrameTime(PGFrameScheduler scheduler)
+{
+	if (NULL == scheduler) return 0;
+
+	if (PGFS_Continuous == scheduler->mode
+		|| 0 != __atomic_load_n(&scheduler->dirty, __ATOMIC_ACQUIRE)
+		|| __atomic_load_n(&scheduler->animations, __ATOMIC_ACQUIRE) > 0
+		|| workPending(scheduler))
+	{
+		return 0;
+	}
+	return __atomic_load_n(&scheduler->deadline, __ATOMIC_ACQUIRE);
+}
+
+void pgFrameSchedulerStats(PGFrameScheduler scheduler, PGFrameSchedulerStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGFrameSchedulerStats));
+	if (NULL == scheduler) return;
+
+	*stats = scheduler->stats;
+	stats->wakes = __atomic_load_n(&scheduler->wakes, __ATOMIC_RELAXED);
+}
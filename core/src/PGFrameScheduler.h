@@ -0,0 +1,108 @@
+//
+//  PGFrameScheduler.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGFrameScheduler_h
+#define PGFrameScheduler_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// From pgFrameSchedulerNextFrameTime when nothing will need a frame
+	#define PG_FRAME_SCHEDULER_IDLE UINT64_MAX
+
+	typedef enum
+	{
+		PGFS_OnDemand = 0	// Frames only when something changed
+	,	PGFS_Continuous		// A frame every tick
+	}
+	PGFrameSchedulerMode;
+
+	/**
+	 * Every member may be NULL.
+	 */
+	typedef struct
+	{
+		uint64_t (*now)(void *userData);			// Microseconds, pgStatsNowMicroseconds if NULL
+		GLboolean (*workPending)(void *userData);	// Work only frames finish, such as pgRendererHasPendingWork
+		void (*wake)(void *userData);				// A frame is needed, so restart a paused display link
+		void *userData;
+	}
+	PGFrameSchedulerCallbacks;
+
+	typedef struct
+	{
+		unsigned long ticks;
+		unsigned long framesRendered;
+		unsigned long framesSkipped;
+		unsigned long wakes;
+	}
+	PGFrameSchedulerStats;
+
+	/**
+	 * Decides on each display tick whether to draw a frame, so a screen
+	 * which isn't changing costs no GL work.
+	 *
+	 * In on demand mode a tick renders if the scheduler was invalidated
+	 * since the last frame, an animation is running, a time asked for with
+	 * pgFrameSchedulerInvalidateAt has come, or the workPending callback
+	 * says uploads are still waiting for frames. Input, animations and
+	 * resource completions should invalidate it, as should queuing
+	 * uploads, since workPending is only asked while ticking. Continuous
+	 * mode renders every tick.
+	 *
+	 * Time only comes from the `now` callback, so the scheduler can be
+	 * driven by a simulated clock.
+	 *
+	 * pgFrameSchedulerInvalidate, pgFrameSchedulerInvalidateAt and the
+	 * animation calls may be made from any thread. Everything else belongs
+	 * to the thread which ticks.
+	 */
+	PGResult pgFrameSchedulerCreate(PGFrameScheduler *scheduler, const PGFrameSchedulerCallbacks *callbacks);
+	void pgFrameSchedulerDestroy(PGFrameScheduler *scheduler);
+
+	void pgFrameSchedulerSetMode(PGFrameScheduler scheduler, PGFrameSchedulerMode mode);
+	PGFrameSchedulerMode pgFrameSchedulerMode(PGFrameScheduler scheduler);
+
+	/**
+	 * Asks for a frame on the next tick, calling `wake` if none was asked
+	 * for already.
+	 */
+	void pgFrameSchedulerInvalidate(PGFrameScheduler scheduler);
+
+	/**
+	 * Asks for a frame once the clock reaches `time`, such as to blink a
+	 * cursor. The earliest time asked for wins.
+	 */
+	void pgFrameSchedulerInvalidateAt(PGFrameScheduler scheduler, uint64_t time);
+
+	/**
+	 * Every tick renders between these. They nest.
+	 */
+	void pgFrameSchedulerBeginAnimation(PGFrameScheduler scheduler);
+	void pgFrameSchedulerEndAnimation(PGFrameScheduler scheduler);
+
+	/**
+	 * Call on each display tick, and draw a frame if it returns true.
+	 * Invalidations made while drawing ask for the next frame.
+	 */
+	GLboolean pgFrameSchedulerShouldRender(PGFrameScheduler scheduler);
+
+	/**
+	 * When the next frame is needed: 0 for the next tick, a clock time, or
+	 * PG_FRAME_SCHEDULER_IDLE if nothing is waiting, when the display link
+	 * can be paused until `wake` is called.
+	 */
+	uint64_t pgFrameSchedulerNextFrameTime(PGFrameScheduler scheduler);
+
+	void pgFrameSchedulerStats(PGFrameScheduler scheduler, PGFrameSchedulerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
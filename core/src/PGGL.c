@@ -0,0 +1,53 @@
+//
+//  PGGL.c
+//
+//  Created by David Wagner on 15/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include "Pictogram.h"
+
+#ifdef PG_GL_LOADS_EXTENSIONS
+
+#ifdef GL_EXT_instanced_arrays
+PFNGLVERTEXATTRIBDIVISOREXTPROC pgglVertexAttribDivisorEXT;
+PFNGLDRAWARRAYSINSTANCEDEXTPROC pgglDrawArraysInstancedEXT;
+#endif
+
+#ifdef GL_EXT_disjoint_timer_query
+PFNGLGENQUERIESEXTPROC pgglGenQueriesEXT;
+PFNGLDELETEQUERIESEXTPROC pgglDeleteQueriesEXT;
+PFNGLBEGINQUERYEXTPROC pgglBeginQueryEXT;
+PFNGLENDQUERYEXTPROC pgglEndQueryEXT;
+PFNGLGETQUERYOBJECTUIVEXTPROC pgglGetQueryObjectuivEXT;
+PFNGLGETQUERYOBJECTUI64VEXTPROC pgglGetQueryObjectui64vEXT;
+#endif
+
+#ifdef GL_EXT_discard_framebuffer
+PFNGLDISCARDFRAMEBUFFEREXTPROC pgglDiscardFramebufferEXT;
+#endif
+
+void pgGLLoadExtensions(PGGLProcLoader loader)
+{
+	if (NULL == loader) return;
+
+#ifdef GL_EXT_instanced_arrays
+	pgglVertexAttribDivisorEXT = (PFNGLVERTEXATTRIBDIVISOREXTPROC)loader("glVertexAttribDivisorEXT");
+	pgglDrawArraysInstancedEXT = (PFNGLDRAWARRAYSINSTANCEDEXTPROC)loader("glDrawArraysInstancedEXT");
+#endif
+
+#ifdef GL_EXT_disjoint_timer_query
+	pgglGenQueriesEXT = (PFNGLGENQUERIESEXTPROC)loader("glGenQueriesEXT");
+	pgglDeleteQueriesEXT = (PFNGLDELETEQUERIESEXTPROC)loader("glDeleteQueriesEXT");
+	pgglBeginQueryEXT = (PFNGLBEGINQUERYEXTPROC)loader("glBeginQueryEXT");
+	pgglEndQueryEXT = (PFNGLENDQUERYEXTPROC)loader("glEndQueryEXT");
+	pgglGetQueryObjectuivEXT = (PFNGLGETQUERYOBJECTUIVEXTPROC)loader("glGetQueryObjectuivEXT");
+	pgglGetQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)loader("glGetQueryObjectui64vEXT");
+#endif
+
+#ifdef GL_EXT_discard_framebuffer
+	pgglDiscardFramebufferEXT = (PFNGLDISCARDFRAMEBUFFEREXTPROC)loader("glDiscardFramebufferEXT");
+#endif
+}
+
+#endif
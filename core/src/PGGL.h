@@ -0,0 +1,70 @@
+//
+//  PGGL.h
+//
+//  Created by David Wagner on 15/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGGL_h
+#define PGGL_h
+
+#if defined(__APPLE__)
+#	include <OpenGLES/ES2/gl.h>
+#	include <OpenGLES/ES2/glext.h>
+#else
+	// Mesa and most Linux drivers ship ES 3 headers and libraries. The ES 3
+	// paths still check the context version at runtime.
+#	include <GLES3/gl3.h>
+#	include <GLES2/gl2ext.h>
+#	define PG_GL_LOADS_EXTENSIONS 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef PG_GL_LOADS_EXTENSIONS
+	// Extension entry points aren't exported by every driver's library, so
+	// they are looked up at runtime instead. They stay NULL until
+	// pgGLLoadExtensions is called with a current context.
+#	ifdef GL_EXT_instanced_arrays
+	extern PFNGLVERTEXATTRIBDIVISOREXTPROC pgglVertexAttribDivisorEXT;
+	extern PFNGLDRAWARRAYSINSTANCEDEXTPROC pgglDrawArraysInstancedEXT;
+#		define glVertexAttribDivisorEXT pgglVertexAttribDivisorEXT
+#		define glDrawArraysInstancedEXT pgglDrawArraysInstancedEXT
+#	endif
+
+#	ifdef GL_EXT_disjoint_timer_query
+	extern PFNGLGENQUERIESEXTPROC pgglGenQueriesEXT;
+	extern PFNGLDELETEQUERIESEXTPROC pgglDeleteQueriesEXT;
+	extern PFNGLBEGINQUERYEXTPROC pgglBeginQueryEXT;
+	extern PFNGLENDQUERYEXTPROC pgglEndQueryEXT;
+	extern PFNGLGETQUERYOBJECTUIVEXTPROC pgglGetQueryObjectuivEXT;
+	extern PFNGLGETQUERYOBJECTUI64VEXTPROC pgglGetQueryObjectui64vEXT;
+#		define glGenQueriesEXT pgglGenQueriesEXT
+#		define glDeleteQueriesEXT pgglDeleteQueriesEXT
+#		define glBeginQueryEXT pgglBeginQueryEXT
+#		define glEndQueryEXT pgglEndQueryEXT
+#		define glGetQueryObjectuivEXT pgglGetQueryObjectuivEXT
+#		define glGetQueryObjectui64vEXT pgglGetQueryObjectui64vEXT
+#	endif
+
+#	ifdef GL_EXT_discard_framebuffer
+	extern PFNGLDISCARDFRAMEBUFFEREXTPROC pgglDiscardFramebufferEXT;
+#		define glDiscardFramebufferEXT pgglDiscardFramebufferEXT
+#	endif
+
+	typedef void *(*PGGLProcLoader)(const char *name);
+	void pgGLLoadExtensions(PGGLProcLoader loader);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+// PGTrace.c calls the real entry points
+#if defined(PG_GL_TRACE) && !defined(PG_TRACE_IMPLEMENTATION)
+#	include "PGTraceGL.h"
+#endif
+
+#endif
@@ -0,0 +1,405 @@
+//
+//  PGGpuMemory.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Pictogram.h"
+
+struct PGGpuResourcePrivate {
+	PGGpuCategory category;
+	size_t bytes;
+	PGGpuEviction eviction;		// No `evict` means it has to stay
+	GLboolean evicted;
+	uint64_t lastUsed;			// From Uses, so the oldest is least recently used
+	unsigned long usedFrame;
+	char label[PG_GPU_MEMORY_LABEL_SIZE];
+};
+
+struct PGGpuCounters {
+	size_t liveBytes;
+	size_t peakBytes;
+	size_t evictableBytes;
+	size_t evictedBytes;
+	unsigned long resources;
+	unsigned long evictions;
+	unsigned long reloads;
+};
+
+struct PGGpuCandidate {
+	uint64_t lastUsed;
+	PGGpuResource resource;
+};
+
+// Everything here is only touched from the GL thread
+static PGHandlePool Resources;
+static struct PGGpuCounters Counters[PGG_CategoryCount];
+static size_t Budget;
+static size_t LiveBytes;
+static uint64_t Uses;
+static unsigned long Frame;
+static GLboolean OverBudget;
+
+static const char * const CategoryNames[PGG_CategoryCount] = {
+	"texture",
+	"buffer",
+	"render_target",
+};
+
+static struct PGGpuResourcePrivate *lookupResource(PGGpuResource resource)
+{
+	struct PGGpuResourcePrivate *r = pgHandlePoolGet(Resources, resource);
+	if (NULL == r && PG_NULL_HANDLE != resource)
+	{
+		pgLog(PGL_Warn, "Stale GPU memory handle 0x%08x.", resource);
+	}
+	return r;
+}
+
+static void adjust(size_t *counter, size_t bytes, GLboolean add)
+{
+	if (add) *counter += bytes;
+	else *counter -= bytes;
+}
+
+/**
+ * Adds or takes away a resource's bytes, wherever they are counted.
+ */
+static void tally(const struct PGGpuResourcePrivate *r, GLboolean add)
+{
+	struct PGGpuCounters *c = &Counters[r->category];
+	if (r->evicted)
+	{
+		adjust(&c->evictedBytes, r->bytes, add);
+		return;
+	}
+
+	adjust(&c->liveBytes, r->bytes, add);
+	adjust(&LiveBytes, r->bytes, add);
+	if (NULL != r->eviction.evict) adjust(&c->evictableBytes, r->bytes, add);
+	if (c->liveBytes > c->peakBytes) c->peakBytes = c->liveBytes;
+}
+
+PGResult pgGpuMemoryAdd(PGGpuResource *resource, PGGpuCategory category, size_t bytes, const PGGpuEviction *eviction)
+{
+	if (NULL == resource) return PGR_NullPointerBarf;
+	*resource = PG_NULL_HANDLE;
+	if (category >= PGG_CategoryCount) return PGR_LazyGenericError;
+
+	if (NULL == Resources)
+	{
+		PGResult result = pgHandlePoolCreate(&Resources, sizeof(struct PGGpuResourcePrivate), PGM_Renderer);
+		if (PGR_OK != result) return result;
+	}
+
+	struct PGGpuResourcePrivate *r = NULL;
+	PGGpuResource handle = pgHandlePoolAdd(Resources, (void **)&r);
+	if (NULL == r) return PGR_OutOfMemory;
+	r->category = category;
+	r->bytes = bytes;
+	if (NULL != eviction) r->eviction = *eviction;
+	r->lastUsed = ++Uses;
+	r->usedFrame = Frame;
+
+	tally(r, GL_TRUE);
+	Counters[category].resources++;
+
+	*resource = handle;
+	return PGR_OK;
+}
+
+void pgGpuMemoryRemove(PGGpuResource *resource)
+{
+	if (NULL != resource && PG_NULL_HANDLE != *resource)
+	{
+		struct PGGpuResourcePrivate *r = lookupResource(*resource);
+		if (NULL != r)
+		{
+			tally(r, GL_FALSE);
+			Counters[r->category].resources--;
+			pgHandlePoolRemove(Resources, *resource);
+		}
+
+		*resource = PG_NULL_HANDLE;
+	}
+}
+
+void pgGpuMemoryResize(PGGpuResource resource, size_t bytes)
+{
+	struct PGGpuResourcePrivate *r = lookupResource(resource);
+	if (NULL == r) return;
+
+	tally(r, GL_FALSE);
+	r->bytes = bytes;
+	tally(r, GL_TRUE);
+}
+
+PGResult pgGpuMemoryUse(PGGpuResource resource)
+{
+	struct PGGpuResourcePrivate *r = lookupResource(resource);
+	if (NULL == r) return PGR_StaleHandle;
+
+	if (r->evicted)
+	{
+		if (NULL != r->eviction.reload)
+		{
+			PGResult result = r->eviction.reload(r->eviction.userData);
+			if (PGR_OK != result) return result;
+
+			// Reloading may have made other resources
+			r = pgHandlePoolGet(Resources, resource);
+			if (NULL == r) return PGR_StaleHandle;
+		}
+
+		tally(r, GL_FALSE);
+		r->evicted = GL_FALSE;
+		tally(r, GL_TRUE);
+		Counters[r->category].reloads++;
+	}
+
+	r->lastUsed = ++Uses;
+	r->usedFrame = Frame;
+	return PGR_OK;
+}
+
+GLboolean pgGpuMemoryIsEvicted(PGGpuResource resource)
+{
+	struct PGGpuResourcePrivate *r = lookupResource(resource);
+	return NULL != r && r->evicted;
+}
+
+void pgGpuMemorySetBudget(size_t bytes)
+{
+	Budget = bytes;
+	OverBudget = GL_FALSE;
+}
+
+size_t pgGpuMemoryBudget(void)
+{
+	return Budget;
+}
+
+void pgGpuMemorySetLabel(PGGpuResource resource, const char *label)
+{
+	struct PGGpuResourcePrivate *r = lookupResource(resource);
+	if (NULL == r) return;
+
+	if (NULL == label) label = "";
+	size_t length = strlen(label);
+	if (length >= PG_GPU_MEMORY_LABEL_SIZE) label += length - (PG_GPU_MEMORY_LABEL_SIZE - 1);
+	strncpy(r->label, label, PG_GPU_MEMORY_LABEL_SIZE - 1);
+	r->label[PG_GPU_MEMORY_LABEL_SIZE - 1] = '\0';
+}
+
+// Eviction //////////////////////////////////////////////////////////////////
+
+static int compareCandidates(const void *a, const void *b)
+{
+	const struct PGGpuCandidate *x = a, *y = b;
+	return x->lastUsed < y->lastUsed ? -1 : x->lastUsed > y->lastUsed;
+}
+
+/**
+ * Evicts resources not used this frame, least recently used first, until
+ * the estimate is under the budget.
+ */
+static void evict(void)
+{
+	uint32_t count = pgHandlePoolCount(Resources);
+	struct PGGpuCandidate *candidates = pgMemAlloc(sizeof(struct PGGpuCandidate) * (count > 0 ? count : 1), PGM_Renderer);
+	if (NULL == candidates) return;
+
+	uint32_t candidateCount = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const struct PGGpuResourcePrivate *r = pgHandlePoolItemAt(Resources, i);
+		if (NULL == r->eviction.evict || r->evicted || r->usedFrame == Frame) continue;
+
+		candidates[candidateCount].lastUsed = r->lastUsed;
+		candidates[candidateCount].resource = pgHandlePoolHandleAt(Resources, i);
+		candidateCount++;
+	}
+	qsort(candidates, candidateCount, sizeof(struct PGGpuCandidate), compareCandidates);
+
+	for (uint32_t i = 0; i < candidateCount && LiveBytes > Budget; i++)
+	{
+		struct PGGpuResourcePrivate *r = pgHandlePoolGet(Resources, candidates[i].resource);
+		if (NULL == r || !r->eviction.evict(r->eviction.userData)) continue;
+
+		r = pgHandlePoolGet(Resources, candidates[i].resource);
+		if (NULL == r) continue;
+		tally(r, GL_FALSE);
+		r->evicted = GL_TRUE;
+		tally(r, GL_TRUE);
+		Counters[r->category].evictions++;
+	}
+	pgMemFree(candidates);
+}
+
+void pgGpuMemoryUpdate(void)
+{
+	Frame++;
+	if (0 == Budget || LiveBytes <= Budget)
+	{
+		OverBudget = GL_FALSE;
+		return;
+	}
+
+	pgProfileZone("pgGpuMemoryUpdate");
+	evict();
+	if (LiveBytes > Budget && !OverBudget)
+	{
+		pgLog(PGL_Warn, "GPU memory estimate of %zu bytes is over the budget of %zu, and nothing else can be evicted.", LiveBytes, Budget);
+		pgGpuMemoryReport(PGL_Warn);
+	}
+	OverBudget = LiveBytes > Budget;
+}
+
+// Reporting /////////////////////////////////////////////////////////////////
+
+void pgGpuMemoryStats(PGGpuCategory category, PGGpuMemoryStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGGpuMemoryStats));
+
+	int first = category, last = category;
+	if (category >= PGG_CategoryCount)
+	{
+		first = 0;
+		last = PGG_CategoryCount - 1;
+	}
+
+	for (int i = first; i <= last; i++)
+	{
+		const struct PGGpuCounters *c = &Counters[i];
+		stats->liveBytes += c->liveBytes;
+		stats->peakBytes += c->peakBytes;
+		stats->evictableBytes += c->evictableBytes;
+		stats->evictedBytes += c->evictedBytes;
+		stats->resources += c->resources;
+		stats->evictions += c->evictions;
+		stats->reloads += c->reloads;
+	}
+}
+
+const char *pgGpuMemoryCategoryName(PGGpuCategory category)
+{
+	if (category >= PGG_CategoryCount) return "all";
+
+	return CategoryNames[category];
+}
+
+void pgGpuMemoryReport(PGLogLevel level)
+{
+	PGGpuMemoryStats total;
+	pgGpuMemoryStats(PGG_CategoryCount, &total);
+	pgLog(level, "GPU memory: %zu bytes in %lu resources, budget %zu.", total.liveBytes, total.resources, Budget);
+
+	for (int category = 0; category < PGG_CategoryCount; category++)
+	{
+		PGGpuMemoryStats s;
+		pgGpuMemoryStats((PGGpuCategory)category, &s);
+		pgLog(level, "  %s: %zu bytes (peak %zu, evictable %zu, evicted %zu) in %lu resources, %lu evictions, %lu reloads.",
+			CategoryNames[category], s.liveBytes, s.peakBytes, s.evictableBytes, s.evictedBytes, s.resources, s.evictions, s.reloads);
+
+		// A pass per place is fine for a handful of places
+		const struct PGGpuResourcePrivate *largest[PG_GPU_MEMORY_REPORT_LARGEST] = { NULL };
+		uint32_t count = pgHandlePoolCount(Resources);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const struct PGGpuResourcePrivate *r = pgHandlePoolItemAt(Resources, i);
+			if (category != (int)r->category || r->evicted) continue;
+
+			for (int place = 0; place < PG_GPU_MEMORY_REPORT_LARGEST; place++)
+			{
+				if (NULL != largest[place] && largest[place]->bytes >= r->bytes) continue;
+
+				memmove(&largest[place + 1], &largest[place], sizeof(largest[0]) * (PG_GPU_MEMORY_REPORT_LARGEST - place - 1));
+				largest[place] = r;
+				break;
+			}
+		}
+		for (int place = 0; place < PG_GPU_MEMORY_REPORT_LARGEST && NULL != largest[place]; place++)
+		{
+			pgLog(level, "    %zu bytes: %s", largest[place]->bytes, '\0' != largest[place]->label[0] ? largest[place]->label : "(unlabelled)");
+		}
+	}
+}
+
+// Estimates /////////////////////////////////////////////////////////////////
+
+static size_t bytesPerPixel(GLenum format, GLenum type)
+{
+	int components;
+	switch (format)
+	{
+		case GL_ALPHA:
+		case GL_LUMINANCE:
+			components = 1;
+			break;
+		case GL_LUMINANCE_ALPHA:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_RGBA:
+		default:
+			// Drivers keep RGB with a padding byte
+			components = 4;
+			break;
+	}
+
+	switch (type)
+	{
+		case GL_UNSIGNED_SHORT_5_6_5:
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+			return 2;
+		case GL_FLOAT:
+			return (size_t)components * 4;
+#ifdef GL_HALF_FLOAT_OES
+		case GL_HALF_FLOAT_OES:
+			return (size_t)components * 2;
+#endif
+		default:
+			return (size_t)components;
+	}
+}
+
+size_t pgGpuTextureBytes(GLenum format, GLenum type, GLsizei width, GLsizei height, int levels)
+{
+	size_t bytes = 0;
+	for (int level = 0; level < levels; level++)
+	{
+		GLsizei w = width >> level > 0 ? width >> level : 1;
+		GLsizei h = height >> level > 0 ? height >> level : 1;
+		if (0 == type) bytes += pgKtxLevelSize(format, w, h);
+		else bytes += (size_t)w * h * bytesPerPixel(format, type);
+	}
+	return bytes;
+}
+
+size_t pgGpuRenderbufferBytes(GLenum internalFormat, GLsizei width, GLsizei height)
+{
+	size_t pixelBytes;
+	switch (internalFormat)
+	{
+		case GL_STENCIL_INDEX8:
+			pixelBytes = 1;
+			break;
+		case GL_RGBA4:
+		case GL_RGB5_A1:
+		case GL_RGB565:
+		case GL_DEPTH_COMPONENT16:
+			pixelBytes = 2;
+			break;
+		default:
+			// RGBA8 and the packed depth formats
+			pixelBytes = 4;
+			break;
+	}
+	return (size_t)width * height * pixelBytes;
+}
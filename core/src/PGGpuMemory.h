@@ -0,0 +1,147 @@
+//
+//  PGGpuMemory.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGGpuMemory_h
+#define PGGpuMemory_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_GPU_MEMORY_LABEL_SIZE 48
+	#define PG_GPU_MEMORY_REPORT_LARGEST 5
+
+	/**
+	 * What a GL allocation is for, for accounting.
+	 */
+	typedef enum
+	{
+		PGG_Texture = 0
+	,	PGG_Buffer
+	,	PGG_RenderTarget
+	,	PGG_CategoryCount
+	}
+	PGGpuCategory;
+
+	/**
+	 * How to give a resource's memory back and get it again. `evict`
+	 * deletes the GL object, leaving whatever is needed to make it again,
+	 * or returns GL_FALSE if it can't be evicted right now. `reload` is
+	 * called when an evicted resource is next used, and may be NULL if the
+	 * owner remakes the object itself when it sees it has gone. `userData`
+	 * should identify the resource by handle, not by pointer, as pool
+	 * items move.
+	 */
+	typedef struct
+	{
+		GLboolean (*evict)(void *userData);
+		PGResult (*reload)(void *userData);
+		void *userData;
+	}
+	PGGpuEviction;
+
+	typedef struct
+	{
+		size_t liveBytes;			// Of resources currently in GL
+		size_t peakBytes;
+		size_t evictableBytes;		// Of those, how much could be evicted
+		size_t evictedBytes;		// Of resources waiting to be reloaded
+		unsigned long resources;
+		unsigned long evictions;	// Over the lifetime of the process
+		unsigned long reloads;
+	}
+	PGGpuMemoryStats;
+
+	/**
+	 * GL doesn't say how much memory its objects use, so the library
+	 * estimates it from their formats and sizes as they are made, and
+	 * keeps a tally per category.
+	 *
+	 * Resources that can be made again, such as textures loaded from
+	 * files and meshes, which keep their vertices, are evictable. With a
+	 * budget set, pgGpuMemoryUpdate evicts the least recently used of them
+	 * until the estimate is back under it. Resources used during the
+	 * current frame are never evicted, so the estimate can go over the
+	 * budget if a frame needs more than it allows.
+	 *
+	 * Everything here belongs to the GL thread.
+	 */
+
+	/**
+	 * Starts accounting for `bytes` of GL memory. `eviction` is copied, and
+	 * may be NULL for resources which have to stay. The resource counts as
+	 * used this frame.
+	 */
+	PGResult pgGpuMemoryAdd(PGGpuResource *resource, PGGpuCategory category, size_t bytes, const PGGpuEviction *eviction);
+	void pgGpuMemoryRemove(PGGpuResource *resource);
+
+	/**
+	 * For a resource whose GL object has been reallocated at a different
+	 * size.
+	 */
+	void pgGpuMemoryResize(PGGpuResource resource, size_t bytes);
+
+	/**
+	 * Marks a resource as used this frame, reloading it first if it has
+	 * been evicted. Fails if reloading does, and the resource stays
+	 * evicted.
+	 */
+	PGResult pgGpuMemoryUse(PGGpuResource resource);
+	GLboolean pgGpuMemoryIsEvicted(PGGpuResource resource);
+
+	/**
+	 * Bytes of estimated GL memory to stay under, or 0, the default, for no
+	 * limit.
+	 */
+	void pgGpuMemorySetBudget(size_t bytes);
+	size_t pgGpuMemoryBudget(void);
+
+	/**
+	 * Starts a new frame and evicts down to the budget.
+	 * pgRendererBeginFrame calls this.
+	 */
+	void pgGpuMemoryUpdate(void);
+
+	/**
+	 * Stats for one category, or for all of them combined if `category` is
+	 * PGG_CategoryCount. The combined peak is the sum of the category
+	 * peaks, which is an upper bound.
+	 */
+	void pgGpuMemoryStats(PGGpuCategory category, PGGpuMemoryStats *stats);
+	const char *pgGpuMemoryCategoryName(PGGpuCategory category);
+
+	/**
+	 * Names a resource in reports. Copied, keeping the end if it is too
+	 * long, as that is the interesting part of a path.
+	 */
+	void pgGpuMemorySetLabel(PGGpuResource resource, const char *label);
+
+	/**
+	 * Logs a line per category, and the largest resources in each. Logged
+	 * as a warning when the budget can't be met.
+	 */
+	void pgGpuMemoryReport(PGLogLevel level);
+
+	/**
+	 * Estimated bytes of a texture with `levels` levels, each half the
+	 * size of the one before. `format` and `type` are as given to
+	 * glTexImage2D, or a compressed internal format with a zero `type`.
+	 */
+	size_t pgGpuTextureBytes(GLenum format, GLenum type, GLsizei width, GLsizei height, int levels);
+
+	/**
+	 * Estimated bytes of renderbuffer storage.
+	 */
+	size_t pgGpuRenderbufferBytes(GLenum internalFormat, GLsizei width, GLsizei height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+//
+//  PGHandle.c
+//
+//  Created by David Wagner on 14/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#define INDEX_MASK (PG_HANDLE_MAX_ITEMS - 1)
+#define GENERATION_MASK ((1u << (32 - PG_HANDLE_INDEX_BITS)) - 1)
+#define NO_FREE_SLOT UINT32_MAX
+
+#define HANDLE_INDEX(h) ((h) & INDEX_MASK)
+#define HANDLE_GENERATION(h) ((h) >> PG_HANDLE_INDEX_BITS)
+#define MAKE_HANDLE(index, generation) (((generation) << PG_HANDLE_INDEX_BITS) | (index))
+
+struct PGHandleSlot {
+	uint32_t dense;			// Where the item lives, or the next free slot
+	uint32_t generation;
+};
+
+struct PGHandlePoolPrivate {
+	size_t itemSize;
+	PGMemoryTag tag;
+
+	// Live items, packed, with the handle of each alongside
+	unsigned char *items;
+	PGHandle *handles;
+	uint32_t count;
+	uint32_t capacity;
+
+	// Indexed by handle. There are never more slots than capacity.
+	struct PGHandleSlot *slots;
+	uint32_t slotCount;
+	uint32_t freeSlot;
+};
+
+PGResult pgHandlePoolCreate(PGHandlePool *pool, size_t itemSize, PGMemoryTag tag)
+{
+	if (NULL == pool) return PGR_NullPointerBarf;
+	*pool = NULL;
+
+	if (0 == itemSize) return PGR_LazyGenericError;
+
+	PGHandlePool p = pgMemAlloc(sizeof(struct PGHandlePoolPrivate), tag);
+	if (NULL == p) return PGR_OutOfMemory;
+	memset(p, 0, sizeof(struct PGHandlePoolPrivate));
+
+	p->itemSize = itemSize;
+	p->tag = tag;
+	p->freeSlot = NO_FREE_SLOT;
+
+	*pool = p;
+	return PGR_OK;
+}
+
+void pgHandlePoolDestroy(PGHandlePool *pool)
+{
+	if (NULL != pool && NULL != *pool)
+	{
+		PGHandlePool p = *pool;
+
+		pgMemFree(p->items);
+		pgMemFree(p->handles);
+		pgMemFree(p->slots);
+
+		memset(p, 0, sizeof(struct PGHandlePoolPrivate));
+		pgMemFree(p);
+
+		*pool = NULL;
+	}
+}
+
+static int grow(PGHandlePool pool)
+{
+	uint32_t capacity = pool->capacity > 0 ? pool->capacity * 2 : 16;
+	if (capacity > PG_HANDLE_MAX_ITEMS) capacity = PG_HANDLE_MAX_ITEMS;
+	if (capacity <= pool->capacity) return 0;
+
+	unsigned char *items = pgMemAlloc(pool->itemSize * capacity, pool->tag);
+	PGHandle *handles = pgMemAlloc(sizeof(PGHandle) * capacity, pool->tag);
+	struct PGHandleSlot *slots = pgMemAlloc(sizeof(struct PGHandleSlot) * capacity, pool->tag);
+	if (NULL == items || NULL == handles || NULL == slots)
+	{
+		pgMemFree(items);
+		pgMemFree(handles);
+		pgMemFree(slots);
+		return 0;
+	}
+
+	if (pool->count > 0)
+	{
+		memcpy(items, pool->items, pool->itemSize * pool->count);
+		memcpy(handles, pool->handles, sizeof(PGHandle) * pool->count);
+	}
+	if (pool->slotCount > 0)
+	{
+		memcpy(slots, pool->slots, sizeof(struct PGHandleSlot) * pool->slotCount);
+	}
+
+	pgMemFree(pool->items);
+	pgMemFree(pool->handles);
+	pgMemFree(pool->slots);
+	pool->items = items;
+	pool->handles = handles;
+	pool->slots = slots;
+	pool->capacity = capacity;
+
+	return 1;
+}
+
+PGHandle pgHandlePoolAdd(PGHandlePool pool, void **item)
+{
+	if (NULL != item) *item = NULL;
+	if (NULL == pool) return PG_NULL_HANDLE;
+
+	if (pool->count == pool->capacity && !grow(pool))
+	{
+		pgLog(PGL_Error, "Handle pool full at %u items.", pool->count);
+		return PG_NULL_HANDLE;
+	}
+
+	uint32_t index;
+	if (NO_FREE_SLOT != pool->freeSlot)
+	{
+		index = pool->freeSlot;
+		pool->freeSlot = pool->slots[index].dense;
+	}
+	else
+	{
+		index = pool->slotCount++;
+		pool->slots[index].generation = 1;
+	}
+
+	struct PGHandleSlot *slot = &pool->slots[index];
+	PGHandle handle = MAKE_HANDLE(index, slot->generation);
+	slot->dense = pool->count;
+
+	void *p = pool->items + pool->itemSize * pool->count;
+	memset(p, 0, pool->itemSize);
+	pool->handles[pool->count] = handle;
+	pool->count++;
+
+	if (NULL != item) *item = p;
+	return handle;
+}
+
+static struct PGHandleSlot *liveSlot(PGHandlePool pool, PGHandle handle)
+{
+	if (NULL == pool || PG_NULL_HANDLE == handle) return NULL;
+
+	uint32_t index = HANDLE_INDEX(handle);
+	if (index >= pool->slotCount) return NULL;
+
+	// Free slots point into the free list rather than at an item with
+	// this handle, so checking the handle back covers them as well
+	struct PGHandleSlot *slot = &pool->slots[index];
+	if (slot->dense >= pool->count || pool->handles[slot->dense] != handle) return NULL;
+
+	return slot;
+}
+
+void pgHandlePoolRemove(PGHandlePool pool, PGHandle handle)
+{
+	struct PGHandleSlot *slot = liveSlot(pool, handle);
+	if (NULL == slot) return;
+
+	// Keep the items packed by moving the last one into the hole
+	uint32_t hole = slot->dense;
+	uint32_t last = pool->count - 1;
+	if (hole != last)
+	{
+		memcpy(pool->items + pool->itemSize * hole, pool->items + pool->itemSize * last, pool->itemSize);
+		pool->handles[hole] = pool->handles[last];
+		pool->slots[HANDLE_INDEX(pool->handles[hole])].dense = hole;
+	}
+	pool->count--;
+
+	slot->generation = (slot->generation + 1) & GENERATION_MASK;
+	if (0 == slot->generation) slot->generation = 1;
+
+	slot->dense = pool->freeSlot;
+	pool->freeSlot = HANDLE_INDEX(handle);
+}
+
+void *pgHandlePoolGet(PGHandlePool pool, PGHandle handle)
+{
+	struct PGHandleSlot *slot = liveSlot(pool, handle);
+	if (NULL == slot) return NULL;
+
+	return pool->items + pool->itemSize * slot->dense;
+}
+
+int pgHandlePoolIsValid(PGHandlePool pool, PGHandle handle)
+{
+	return NULL != liveSlot(pool, handle);
+}
+
+uint32_t pgHandlePoolCount(PGHandlePool pool)
+{
+	if (NULL == pool) return 0;
+
+	return pool->count;
+}
+
+void *pgHandlePoolItemAt(PGHandlePool pool, uint32_t index)
+{
+	if (NULL == pool || index >= pool->count) return NULL;
+
+	return pool->items + pool->itemSize * index;
+}
+
+PGHandle pgHandlePoolHandleAt(PGHandlePool pool, uint32_t index)
+{
+	if (NULL == pool || index >= pool->count) return PG_NULL_HANDLE;
+
+	return pool->handles[index];
+}
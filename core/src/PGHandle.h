@@ -0,0 +1,64 @@
+//
+//  PGHandle.h
+//
+//  Created by David Wagner on 14/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGHandle_h
+#define PGHandle_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Handles are a slot index in the low bits and the slot's generation in
+	 * the high bits. The generation changes every time the slot is freed, so
+	 * a handle to a destroyed object never matches whatever reuses its slot.
+	 * Generations start at 1, so a valid handle is never PG_NULL_HANDLE.
+	 */
+	#define PG_NULL_HANDLE 0
+	#define PG_HANDLE_INDEX_BITS 20
+	#define PG_HANDLE_MAX_ITEMS (1u << PG_HANDLE_INDEX_BITS)
+
+	/**
+	 * A pool of fixed size items addressed by handle. Live items are kept
+	 * packed at the front of one array, so iterating them is a linear walk.
+	 * Removing an item moves the last one into its place, and adding may
+	 * reallocate the array, so pointers from pgHandlePoolGet are only good
+	 * until the next add or remove. Pools are not thread safe.
+	 */
+	PGResult pgHandlePoolCreate(PGHandlePool *pool, size_t itemSize, PGMemoryTag tag);
+	void pgHandlePoolDestroy(PGHandlePool *pool);
+
+	/**
+	 * Adds a zeroed item and returns its handle, or PG_NULL_HANDLE if the
+	 * pool is full or out of memory. If `item` is not NULL it is set to
+	 * point at the new item.
+	 */
+	PGHandle pgHandlePoolAdd(PGHandlePool pool, void **item);
+	void pgHandlePoolRemove(PGHandlePool pool, PGHandle handle);
+
+	/**
+	 * The item for `handle`, or NULL if the handle is stale or null.
+	 */
+	void *pgHandlePoolGet(PGHandlePool pool, PGHandle handle);
+	int pgHandlePoolIsValid(PGHandlePool pool, PGHandle handle);
+
+	/**
+	 * Live items are numbered 0 to count - 1 in storage order. The order
+	 * changes when items are removed.
+	 */
+	uint32_t pgHandlePoolCount(PGHandlePool pool);
+	void *pgHandlePoolItemAt(PGHandlePool pool, uint32_t index);
+	PGHandle pgHandlePoolHandleAt(PGHandlePool pool, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
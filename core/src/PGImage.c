@@ -0,0 +1,595 @@
+//
+//  PGImage.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "Pictogram.h"
+
+// Eight pixels at a time, using the compiler's vector extensions so the same
+// code becomes NEON on device and SSE or AVX on the desktop
+typedef uint32_t v8u __attribute__((vector_size(8 * sizeof(uint32_t))));
+
+#define PNG_SIGNATURE_SIZE 8
+#define TGA_HEADER_SIZE 18
+
+static const uint8_t PNGSignature[PNG_SIGNATURE_SIZE] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+
+static PGResult corrupt(const char *why)
+{
+	pgLog(PGL_Error, "Could not decode image: %s.", why);
+	return PGR_CouldNotDecode;
+}
+
+static PGResult allocatePixels(PGImage *image, uint32_t width, uint32_t height)
+{
+	if (0 == width || 0 == height || width > PG_IMAGE_MAX_SIZE || height > PG_IMAGE_MAX_SIZE)
+	{
+		pgLog(PGL_Error, "Image size %ux%u is out of range.", width, height);
+		return PGR_Unsupported;
+	}
+
+	image->pixels = pgMemAlloc((size_t)width * height * 4, PGM_Texture);
+	if (NULL == image->pixels) return PGR_OutOfMemory;
+	image->width = (GLsizei)width;
+	image->height = (GLsizei)height;
+	return PGR_OK;
+}
+
+// Premultiplying ////////////////////////////////////////////////////////////
+
+/**
+ * c * a / 255, rounded to nearest, exactly, for c and a up to 255. Vectors
+ * are passed by pointer, as their by value ABI depends on the target.
+ */
+static inline void multiply255(v8u *c, const v8u *a)
+{
+	v8u x = *c * *a + 128;
+	*c = (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t multiply255Scalar(uint32_t c, uint32_t a)
+{
+	uint32_t x = c * a + 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+void pgImagePremultiply(GLubyte *pixels, size_t count)
+{
+	if (NULL == pixels) return;
+
+	// Pixels are read as little endian words, red in the low byte, which
+	// every target we build for is
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		v8u p;
+		memcpy(&p, pixels + i * 4, sizeof(p));
+		v8u r = p & 0xff, g = (p >> 8) & 0xff, b = (p >> 16) & 0xff, a = p >> 24;
+		multiply255(&r, &a);
+		multiply255(&g, &a);
+		multiply255(&b, &a);
+		p = r | g << 8 | b << 16 | a << 24;
+		memcpy(pixels + i * 4, &p, sizeof(p));
+	}
+	for (; i < count; i++)
+	{
+		GLubyte *p = pixels + i * 4;
+		for (int c = 0; c < 3; c++) p[c] = (GLubyte)multiply255Scalar(p[c], p[3]);
+	}
+}
+
+// PNG ///////////////////////////////////////////////////////////////////////
+
+struct PNGHeader {
+	uint32_t width;
+	uint32_t height;
+	int depth;
+	int colorType;
+	int channels;
+
+	uint8_t palette[256 * 4];
+	int paletteSize;
+	int hasKey;				// tRNS for grey and true colour images
+	uint16_t key[3];
+};
+
+static uint32_t readU32BE(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint16_t readU16BE(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static int pngChannels(int colorType, int depth)
+{
+	switch (colorType)
+	{
+		case 0: return (1 == depth || 2 == depth || 4 == depth || 8 == depth || 16 == depth) ? 1 : 0;
+		case 3: return (1 == depth || 2 == depth || 4 == depth || 8 == depth) ? 1 : 0;
+		case 2: return (8 == depth || 16 == depth) ? 3 : 0;
+		case 4: return (8 == depth || 16 == depth) ? 2 : 0;
+		case 6: return (8 == depth || 16 == depth) ? 4 : 0;
+		default: return 0;
+	}
+}
+
+static inline int paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+/**
+ * Reverses one row's filter in place. `prior` is the previous row, already
+ * unfiltered, or zeros for the first.
+ */
+static int unfilterRow(uint8_t *row, const uint8_t *prior, size_t length, size_t bpp, int filter)
+{
+	size_t i;
+	switch (filter)
+	{
+		case 0:
+			break;
+		case 1:
+			for (i = bpp; i < length; i++) row[i] += row[i - bpp];
+			break;
+		case 2:
+			for (i = 0; i < length; i++) row[i] += prior[i];
+			break;
+		case 3:
+			for (i = 0; i < bpp; i++) row[i] += prior[i] >> 1;
+			for (; i < length; i++) row[i] += (row[i - bpp] + prior[i]) >> 1;
+			break;
+		case 4:
+			for (i = 0; i < bpp; i++) row[i] += prior[i];
+			for (; i < length; i++) row[i] += (uint8_t)paeth(row[i - bpp], prior[i], prior[i - bpp]);
+			break;
+		default:
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * The `index`th sample of a row, at full precision.
+ */
+static inline uint32_t pngSample(const uint8_t *row, size_t index, int depth)
+{
+	if (8 == depth) return row[index];
+	if (16 == depth) return readU16BE(row + index * 2);
+
+	size_t bit = index * depth;
+	return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+}
+
+static inline uint8_t pngScale(uint32_t sample, int depth)
+{
+	if (8 == depth) return (uint8_t)sample;
+	if (16 == depth) return (uint8_t)(sample >> 8);
+	return (uint8_t)(sample * 255 / ((1u << depth) - 1));
+}
+
+static PGResult expandPNGRow(const struct PNGHeader *h, const uint8_t *row, uint8_t *out)
+{
+	uint32_t width = h->width;
+
+	// The common cases, straight copies
+	if (8 == h->depth && 6 == h->colorType)
+	{
+		memcpy(out, row, (size_t)width * 4);
+		return PGR_OK;
+	}
+	if (8 == h->depth && 2 == h->colorType && !h->hasKey)
+	{
+		for (uint32_t x = 0; x < width; x++, row += 3, out += 4)
+		{
+			out[0] = row[0];
+			out[1] = row[1];
+			out[2] = row[2];
+			out[3] = 255;
+		}
+		return PGR_OK;
+	}
+
+	for (uint32_t x = 0; x < width; x++, out += 4)
+	{
+		size_t s = (size_t)x * h->channels;
+		switch (h->colorType)
+		{
+			case 0:
+			{
+				uint32_t grey = pngSample(row, s, h->depth);
+				out[0] = out[1] = out[2] = pngScale(grey, h->depth);
+				out[3] = h->hasKey && grey == h->key[0] ? 0 : 255;
+				break;
+			}
+			case 2:
+			{
+				uint32_t r = pngSample(row, s, h->depth);
+				uint32_t g = pngSample(row, s + 1, h->depth);
+				uint32_t b = pngSample(row, s + 2, h->depth);
+				out[0] = pngScale(r, h->depth);
+				out[1] = pngScale(g, h->depth);
+				out[2] = pngScale(b, h->depth);
+				out[3] = h->hasKey && r == h->key[0] && g == h->key[1] && b == h->key[2] ? 0 : 255;
+				break;
+			}
+			case 3:
+			{
+				uint32_t index = pngSample(row, s, h->depth);
+				if ((int)index >= h->paletteSize) return corrupt("PNG palette index is out of range");
+				memcpy(out, h->palette + index * 4, 4);
+				break;
+			}
+			case 4:
+				out[0] = out[1] = out[2] = pngScale(pngSample(row, s, h->depth), h->depth);
+				out[3] = pngScale(pngSample(row, s + 1, h->depth), h->depth);
+				break;
+			case 6:
+				for (int c = 0; c < 4; c++) out[c] = pngScale(pngSample(row, s + c, h->depth), h->depth);
+				break;
+		}
+	}
+	return PGR_OK;
+}
+
+/**
+ * Walks the chunks after the signature, reading the header, palette and
+ * transparency and totalling the compressed data. With `idat` set the
+ * compressed data is also gathered into it. Chunk CRCs aren't checked,
+ * as the zlib stream carries its own checksum.
+ */
+static PGResult readPNGChunks(const uint8_t *data, size_t size, struct PNGHeader *h, uint8_t *idat, size_t *idatSize)
+{
+	const uint8_t *p = data + PNG_SIGNATURE_SIZE;
+	const uint8_t *end = data + size;
+	int seenHeader = 0;
+	*idatSize = 0;
+
+	while (end - p >= 12)
+	{
+		uint32_t length = readU32BE(p);
+		const uint8_t *type = p + 4;
+		const uint8_t *body = p + 8;
+		if (length > (size_t)(end - body) - 4) return corrupt("PNG chunk is truncated");
+
+		if (0 == memcmp(type, "IHDR", 4))
+		{
+			if (length < 13) return corrupt("PNG header is too short");
+			h->width = readU32BE(body);
+			h->height = readU32BE(body + 4);
+			h->depth = body[8];
+			h->colorType = body[9];
+			h->channels = pngChannels(h->colorType, h->depth);
+			if (0 == h->channels) return corrupt("PNG colour type and bit depth don't go together");
+			if (0 != body[12])
+			{
+				pgLog(PGL_Error, "Interlaced PNGs are unsupported.");
+				return PGR_Unsupported;
+			}
+			seenHeader = 1;
+		}
+		else if (0 == memcmp(type, "PLTE", 4))
+		{
+			h->paletteSize = length / 3 > 256 ? 256 : (int)(length / 3);
+			for (int i = 0; i < h->paletteSize; i++)
+			{
+				memcpy(h->palette + i * 4, body + i * 3, 3);
+				h->palette[i * 4 + 3] = 255;
+			}
+		}
+		else if (0 == memcmp(type, "tRNS", 4))
+		{
+			if (3 == h->colorType)
+			{
+				for (uint32_t i = 0; i < length && i < 256; i++) h->palette[i * 4 + 3] = body[i];
+			}
+			else if (0 == h->colorType && length >= 2)
+			{
+				h->key[0] = readU16BE(body);
+				h->hasKey = 1;
+			}
+			else if (2 == h->colorType && length >= 6)
+			{
+				for (int c = 0; c < 3; c++) h->key[c] = readU16BE(body + c * 2);
+				h->hasKey = 1;
+			}
+		}
+		else if (0 == memcmp(type, "IDAT", 4))
+		{
+			if (NULL != idat) memcpy(idat + *idatSize, body, length);
+			*idatSize += length;
+		}
+		else if (0 == memcmp(type, "IEND", 4))
+		{
+			break;
+		}
+
+		p = body + length + 4;
+	}
+
+	if (!seenHeader) return corrupt("PNG has no header");
+	if (3 == h->colorType && 0 == h->paletteSize) return corrupt("PNG has no palette");
+	if (0 == *idatSize) return corrupt("PNG has no image data");
+	return PGR_OK;
+}
+
+static PGResult decodePNG(PGImage *image, const uint8_t *data, size_t size)
+{
+	struct PNGHeader h;
+	memset(&h, 0, sizeof(h));
+
+	size_t idatSize;
+	PGResult result = readPNGChunks(data, size, &h, NULL, &idatSize);
+	if (PGR_OK != result) return result;
+
+	result = allocatePixels(image, h.width, h.height);
+	if (PGR_OK != result) return result;
+
+	size_t rowBytes = ((size_t)h.width * h.channels * h.depth + 7) / 8;
+	size_t bpp = (size_t)(h.channels * h.depth + 7) / 8;
+	size_t stride = rowBytes + 1;
+	size_t rawSize = stride * h.height;
+
+	uint8_t *idat = pgMemAlloc(idatSize, PGM_Texture);
+	uint8_t *raw = pgMemAlloc(rawSize, PGM_Texture);
+	uint8_t *zeros = pgMemAlloc(rowBytes, PGM_Texture);
+	if (NULL == idat || NULL == raw || NULL == zeros)
+	{
+		result = PGR_OutOfMemory;
+		goto done;
+	}
+	memset(zeros, 0, rowBytes);
+
+	readPNGChunks(data, size, &h, idat, &idatSize);
+
+	size_t written;
+	result = pgInflate(idat, idatSize, raw, rawSize, &written);
+	if (PGR_OK != result) goto done;
+	if (written != rawSize)
+	{
+		result = corrupt("PNG image data is the wrong size");
+		goto done;
+	}
+
+	for (uint32_t y = 0; y < h.height; y++)
+	{
+		uint8_t *row = raw + y * stride;
+		const uint8_t *prior = y > 0 ? row - stride + 1 : zeros;
+		if (!unfilterRow(row + 1, prior, rowBytes, bpp, row[0]))
+		{
+			result = corrupt("PNG row filter is unknown");
+			goto done;
+		}
+
+		result = expandPNGRow(&h, row + 1, image->pixels + (size_t)y * h.width * 4);
+		if (PGR_OK != result) goto done;
+	}
+
+done:
+	pgMemFree(zeros);
+	pgMemFree(raw);
+	pgMemFree(idat);
+	return result;
+}
+
+// TGA ///////////////////////////////////////////////////////////////////////
+
+static PGResult decodeTGA(PGImage *image, const uint8_t *data, size_t size)
+{
+	if (size < TGA_HEADER_SIZE) return corrupt("too short to be a TGA");
+
+	int idLength = data[0];
+	int colorMapType = data[1];
+	int imageType = data[2];
+	uint32_t colorMapLength = data[5] | data[6] << 8;
+	uint32_t colorMapEntryBits = data[7];
+	uint32_t width = data[12] | data[13] << 8;
+	uint32_t height = data[14] | data[15] << 8;
+	int pixelBits = data[16];
+	int descriptor = data[17];
+
+	int rle = imageType >= 8;
+	int grey = 3 == (imageType & 7);
+	if ((2 != (imageType & 7) && !grey) || colorMapType > 1)
+	{
+		pgLog(PGL_Error, "TGA image type %d is unsupported.", imageType);
+		return PGR_Unsupported;
+	}
+	if ((grey && 8 != pixelBits) || (!grey && 24 != pixelBits && 32 != pixelBits))
+	{
+		pgLog(PGL_Error, "TGA pixel depth %d is unsupported.", pixelBits);
+		return PGR_Unsupported;
+	}
+
+	// A colour map can come with a true colour image, and is ignored
+	size_t offset = TGA_HEADER_SIZE + idLength;
+	if (1 == colorMapType) offset += colorMapLength * ((colorMapEntryBits + 7) / 8);
+	if (offset > size) return corrupt("TGA is truncated");
+
+	PGResult result = allocatePixels(image, width, height);
+	if (PGR_OK != result) return result;
+
+	const uint8_t *p = data + offset;
+	const uint8_t *end = data + size;
+	size_t pixelBytes = pixelBits / 8;
+	size_t total = (size_t)width * height;
+	int topFirst = descriptor & 0x20;
+	int rightFirst = descriptor & 0x10;
+
+	size_t run = 0;		// Pixels left in the current packet
+	int repeat = 0;
+	for (size_t n = 0; n < total; n++)
+	{
+		if (rle && 0 == run)
+		{
+			if (p >= end) return corrupt("TGA is truncated");
+			run = (*p & 0x7f) + 1;
+			repeat = *p & 0x80;
+			p++;
+		}
+		if ((size_t)(end - p) < pixelBytes) return corrupt("TGA is truncated");
+
+		size_t row = n / width;
+		size_t column = n % width;
+		size_t y = topFirst ? row : height - 1 - row;
+		size_t x = rightFirst ? width - 1 - column : column;
+		GLubyte *out = image->pixels + (y * width + x) * 4;
+
+		if (grey)
+		{
+			out[0] = out[1] = out[2] = p[0];
+			out[3] = 255;
+		}
+		else
+		{
+			out[0] = p[2];
+			out[1] = p[1];
+			out[2] = p[0];
+			out[3] = 4 == pixelBytes ? p[3] : 255;
+		}
+
+		if (rle)
+		{
+			// Repeated packets hold one pixel, used until the run ends
+			run--;
+			if (!repeat || 0 == run) p += pixelBytes;
+		}
+		else
+		{
+			p += pixelBytes;
+		}
+	}
+
+	return PGR_OK;
+}
+
+// Images ////////////////////////////////////////////////////////////////////
+
+/**
+ * The top level of a KTX, decoded on the CPU for when GL can't take it.
+ */
+static PGResult decodeKTX(PGImage *image, const uint8_t *data, size_t size)
+{
+	PGKtx ktx;
+	PGResult result = pgKtxParse(&ktx, data, size);
+	if (PGR_OK != result) return result;
+
+	if (!pgEtcCanDecode(ktx.internalFormat))
+	{
+		pgLog(PGL_Error, "Can't decode texture format 0x%04x.", ktx.internalFormat);
+		return PGR_Unsupported;
+	}
+
+	result = allocatePixels(image, (uint32_t)ktx.width, (uint32_t)ktx.height);
+	if (PGR_OK != result) return result;
+	return pgEtcDecode(ktx.internalFormat, ktx.levels[0], ktx.levelSizes[0], ktx.width, ktx.height, image->pixels);
+}
+
+PGResult pgImageDecode(PGImage *image, const void *data, size_t size)
+{
+	if (NULL == image) return PGR_NullPointerBarf;
+	memset(image, 0, sizeof(PGImage));
+	if (NULL == data) return PGR_NullPointerBarf;
+
+	PGResult result;
+	if (size >= PNG_SIGNATURE_SIZE && 0 == memcmp(data, PNGSignature, PNG_SIGNATURE_SIZE))
+	{
+		result = decodePNG(image, data, size);
+	}
+	else if (pgKtxIsKtx(data, size))
+	{
+		result = decodeKTX(image, data, size);
+	}
+	else
+	{
+		// TGA has no signature, so anything else is tried as one
+		result = decodeTGA(image, data, size);
+	}
+
+	if (PGR_OK != result) pgImageFree(image);
+	return result;
+}
+
+PGResult pgImageReadFile(const char *path, void **data, size_t *size)
+{
+	if (NULL == data || NULL == size) return PGR_NullPointerBarf;
+	*data = NULL;
+	*size = 0;
+	if (NULL == path) return PGR_NullPointerBarf;
+
+	FILE *file = fopen(path, "rb");
+	if (NULL == file)
+	{
+		pgLog(PGL_Error, "Could not open %s: %s", path, strerror(errno));
+		return PGR_CouldNotReadFile;
+	}
+
+	long length = -1;
+	if (0 == fseek(file, 0, SEEK_END)) length = ftell(file);
+	rewind(file);
+	if (length < 0)
+	{
+		fclose(file);
+		pgLog(PGL_Error, "Could not get the size of %s.", path);
+		return PGR_CouldNotReadFile;
+	}
+
+	void *buffer = pgMemAlloc(length > 0 ? (size_t)length : 1, PGM_Texture);
+	if (NULL == buffer)
+	{
+		fclose(file);
+		return PGR_OutOfMemory;
+	}
+
+	size_t read = fread(buffer, 1, (size_t)length, file);
+	fclose(file);
+	if (read != (size_t)length)
+	{
+		pgMemFree(buffer);
+		pgLog(PGL_Error, "Could not read %s.", path);
+		return PGR_CouldNotReadFile;
+	}
+
+	*data = buffer;
+	*size = read;
+	return PGR_OK;
+}
+
+PGResult pgImageLoad(PGImage *image, const char *path)
+{
+	if (NULL == image) return PGR_NullPointerBarf;
+	memset(image, 0, sizeof(PGImage));
+
+	void *data;
+	size_t size;
+	PGResult result = pgImageReadFile(path, &data, &size);
+	if (PGR_OK != result) return result;
+
+	result = pgImageDecode(image, data, size);
+	if (PGR_OK != result) pgLog(PGL_Error, "Could not decode %s.", path);
+
+	pgMemFree(data);
+	return result;
+}
+
+void pgImageFree(PGImage *image)
+{
+	if (NULL == image) return;
+
+	pgMemFree(image->pixels);
+	memset(image, 0, sizeof(PGImage));
+}
@@ -0,0 +1,67 @@
+//
+//  PGImage.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGImage_h
+#define PGImage_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_IMAGE_MAX_SIZE 16384
+
+	/**
+	 * Decoded pixels, always 8 bit RGBA with the top row first.
+	 */
+	typedef struct
+	{
+		GLsizei width;
+		GLsizei height;
+		GLubyte *pixels;
+	}
+	PGImage;
+
+	/**
+	 * Decodes a PNG, KTX or TGA file held in memory. None needs a GL
+	 * context, so all are safe on any thread.
+	 *
+	 * PNG supports every colour type and bit depth, with tRNS transparency,
+	 * but not interlacing. Sixteen bit channels are cut down to eight.
+	 * KTX gives the top level of an ETC1, ETC2 or EAC texture; see PGEtc.h.
+	 * TGA supports uncompressed and run length encoded true colour (24 and
+	 * 32 bit) and grey (8 bit) images, in any corner's orientation.
+	 *
+	 * On failure the image is left empty, and freeing it is harmless.
+	 */
+	PGResult pgImageDecode(PGImage *image, const void *data, size_t size);
+
+	/**
+	 * Reads and decodes the file at `path`.
+	 */
+	PGResult pgImageLoad(PGImage *image, const char *path);
+
+	/**
+	 * Reads the whole file at `path` into memory, to be freed with
+	 * pgMemFree.
+	 */
+	PGResult pgImageReadFile(const char *path, void **data, size_t *size);
+
+	void pgImageFree(PGImage *image);
+
+	/**
+	 * Multiplies the colour of `count` RGBA pixels by their alpha, in
+	 * place, rounding to nearest.
+	 */
+	void pgImagePremultiply(GLubyte *pixels, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,379 @@
+//
+//  PGInflate.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#define MAX_BITS 15
+#define FAST_BITS 9
+#define MAX_LITERAL_CODES 288
+#define MAX_DISTANCE_CODES 30
+#define MAX_LENGTH_CODES 29
+#define ADLER_BASE 65521
+#define ADLER_BLOCK 5552
+
+/**
+ * A canonical Huffman code. Codes of up to FAST_BITS bits are decoded with
+ * one look up in `fast`, indexed by the next FAST_BITS bits of input.
+ * Longer codes are walked a bit at a time using the counts.
+ */
+struct PGHuffman {
+	uint16_t counts[MAX_BITS + 1];
+	uint16_t symbols[MAX_LITERAL_CODES];
+	uint16_t fast[1 << FAST_BITS];		// Code length << 9 | symbol, 0 for longer codes
+};
+
+struct PGBits {
+	const uint8_t *in;
+	const uint8_t *end;
+	uint64_t buffer;
+	int count;
+	size_t padding;		// Zero bytes fed in past the end of the input
+};
+
+// Running out of input fills the output with whatever the padding decodes
+// to, so a full output is reported as truncation when that has happened
+#define OUTPUT_FULL(b) (overrun(b) ? "data is truncated" : "output is too small")
+
+struct PGOutput {
+	uint8_t *data;
+	size_t size;
+	size_t position;
+};
+
+static const uint16_t LengthBase[MAX_LENGTH_CODES] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LengthExtra[MAX_LENGTH_CODES] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DistanceBase[MAX_DISTANCE_CODES] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DistanceExtra[MAX_DISTANCE_CODES] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Bits //////////////////////////////////////////////////////////////////////
+
+/**
+ * Tops the buffer up to at least 57 bits. Past the end of the input it is
+ * filled with zeros, which is noticed by overrun at the end of each block,
+ * so decoding never has to check for running out mid symbol.
+ */
+static inline void refill(struct PGBits *b)
+{
+	while (b->count <= 56)
+	{
+		if (b->in < b->end) b->buffer |= (uint64_t)*b->in++ << b->count;
+		else b->padding++;
+		b->count += 8;
+	}
+}
+
+static inline uint32_t getBits(struct PGBits *b, int n)
+{
+	if (b->count < n) refill(b);
+	uint32_t value = (uint32_t)(b->buffer & ((1ull << n) - 1));
+	b->buffer >>= n;
+	b->count -= n;
+	return value;
+}
+
+static inline int overrun(const struct PGBits *b)
+{
+	return b->padding * 8 > (size_t)b->count;
+}
+
+// Huffman codes /////////////////////////////////////////////////////////////
+
+static unsigned reverseBits(unsigned code, int length)
+{
+	unsigned reversed = 0;
+	for (int i = 0; i < length; i++)
+	{
+		reversed = (reversed << 1) | (code & 1);
+		code >>= 1;
+	}
+	return reversed;
+}
+
+/**
+ * Returns 0 for a complete code, more than 0 for an incomplete one, and
+ * less than 0 if the lengths describe more codes than there are bits for.
+ */
+static int buildHuffman(struct PGHuffman *h, const uint8_t *lengths, int n)
+{
+	memset(h->counts, 0, sizeof(h->counts));
+	for (int symbol = 0; symbol < n; symbol++) h->counts[lengths[symbol]]++;
+	h->counts[0] = 0;
+
+	int left = 1;
+	for (int length = 1; length <= MAX_BITS; length++)
+	{
+		left <<= 1;
+		left -= h->counts[length];
+		if (left < 0) return left;
+	}
+
+	uint16_t offsets[MAX_BITS + 1];
+	offsets[1] = 0;
+	for (int length = 1; length < MAX_BITS; length++) offsets[length + 1] = offsets[length] + h->counts[length];
+	for (int symbol = 0; symbol < n; symbol++)
+	{
+		if (0 != lengths[symbol]) h->symbols[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+	}
+
+	memset(h->fast, 0, sizeof(h->fast));
+	unsigned code = 0;
+	int index = 0;
+	for (int length = 1; length <= FAST_BITS; length++)
+	{
+		for (int i = 0; i < h->counts[length]; i++, code++, index++)
+		{
+			uint16_t entry = (uint16_t)(length << 9 | h->symbols[index]);
+			for (unsigned fill = reverseBits(code, length); fill < (1u << FAST_BITS); fill += 1u << length)
+			{
+				h->fast[fill] = entry;
+			}
+		}
+		code <<= 1;
+	}
+
+	return left;
+}
+
+static inline int decodeSymbol(struct PGBits *b, const struct PGHuffman *h)
+{
+	if (b->count < MAX_BITS) refill(b);
+
+	unsigned entry = h->fast[b->buffer & ((1u << FAST_BITS) - 1)];
+	if (0 != entry)
+	{
+		int length = entry >> 9;
+		b->buffer >>= length;
+		b->count -= length;
+		return entry & 511;
+	}
+
+	// Codes are packed most significant bit first, so are read a bit at a
+	// time. first is the first code of each length, index its symbol.
+	int code = 0, first = 0, index = 0;
+	for (int length = 1; length <= MAX_BITS; length++)
+	{
+		code |= (int)(b->buffer >> (length - 1)) & 1;
+		int count = h->counts[length];
+		if (code - count < first)
+		{
+			b->buffer >>= length;
+			b->count -= length;
+			return h->symbols[index + (code - first)];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+// Blocks ////////////////////////////////////////////////////////////////////
+
+static const char *inflateStored(struct PGBits *b, struct PGOutput *o)
+{
+	getBits(b, b->count & 7);
+	uint32_t length = getBits(b, 16);
+	uint32_t check = getBits(b, 16);
+	if (length != (~check & 0xffff)) return "stored block length is corrupt";
+	if (length > o->size - o->position) return "output is too small";
+
+	// Whatever is left in the bit buffer is whole bytes
+	while (length > 0 && b->count >= 8)
+	{
+		o->data[o->position++] = (uint8_t)getBits(b, 8);
+		length--;
+	}
+	if (length > (size_t)(b->end - b->in)) return "stored block is truncated";
+	memcpy(o->data + o->position, b->in, length);
+	b->in += length;
+	o->position += length;
+	return NULL;
+}
+
+static const char *inflateCodes(struct PGBits *b, struct PGOutput *o, const struct PGHuffman *literals, const struct PGHuffman *distances)
+{
+	for (;;)
+	{
+		int symbol = decodeSymbol(b, literals);
+		if (symbol < 256)
+		{
+			if (symbol < 0) return "bad literal or length code";
+			if (o->position >= o->size) return OUTPUT_FULL(b);
+			o->data[o->position++] = (uint8_t)symbol;
+			continue;
+		}
+		if (256 == symbol) return NULL;
+
+		symbol -= 257;
+		if (symbol >= MAX_LENGTH_CODES) return "bad length code";
+		size_t length = LengthBase[symbol] + getBits(b, LengthExtra[symbol]);
+
+		symbol = decodeSymbol(b, distances);
+		if (symbol < 0 || symbol >= MAX_DISTANCE_CODES) return "bad distance code";
+		size_t distance = DistanceBase[symbol] + getBits(b, DistanceExtra[symbol]);
+
+		if (distance > o->position) return "distance is too far back";
+		if (length > o->size - o->position) return OUTPUT_FULL(b);
+
+		uint8_t *to = o->data + o->position;
+		const uint8_t *from = to - distance;
+		if (distance >= length) memcpy(to, from, length);
+		else for (size_t i = 0; i < length; i++) to[i] = from[i];
+		o->position += length;
+	}
+}
+
+static const char *inflateFixed(struct PGBits *b, struct PGOutput *o)
+{
+	uint8_t lengths[MAX_LITERAL_CODES + MAX_DISTANCE_CODES];
+	int symbol = 0;
+	for (; symbol < 144; symbol++) lengths[symbol] = 8;
+	for (; symbol < 256; symbol++) lengths[symbol] = 9;
+	for (; symbol < 280; symbol++) lengths[symbol] = 7;
+	for (; symbol < MAX_LITERAL_CODES; symbol++) lengths[symbol] = 8;
+	for (; symbol < MAX_LITERAL_CODES + MAX_DISTANCE_CODES; symbol++) lengths[symbol] = 5;
+
+	struct PGHuffman literals, distances;
+	buildHuffman(&literals, lengths, MAX_LITERAL_CODES);
+	buildHuffman(&distances, lengths + MAX_LITERAL_CODES, MAX_DISTANCE_CODES);
+	return inflateCodes(b, o, &literals, &distances);
+}
+
+static const char *inflateDynamic(struct PGBits *b, struct PGOutput *o)
+{
+	static const uint8_t Order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	int literalCount = getBits(b, 5) + 257;
+	int distanceCount = getBits(b, 5) + 1;
+	int codeCount = getBits(b, 4) + 4;
+	if (literalCount > 286 || distanceCount > MAX_DISTANCE_CODES) return "too many codes";
+
+	uint8_t lengths[MAX_LITERAL_CODES + MAX_DISTANCE_CODES];
+	memset(lengths, 0, sizeof(lengths));
+	for (int i = 0; i < codeCount; i++) lengths[Order[i]] = (uint8_t)getBits(b, 3);
+
+	struct PGHuffman literals, distances;
+	if (0 != buildHuffman(&literals, lengths, 19)) return "bad code length code";
+
+	int total = literalCount + distanceCount;
+	for (int index = 0; index < total;)
+	{
+		int symbol = decodeSymbol(b, &literals);
+		if (symbol < 0) return "bad code length";
+		if (symbol < 16)
+		{
+			lengths[index++] = (uint8_t)symbol;
+			continue;
+		}
+
+		uint8_t length = 0;
+		int repeat;
+		if (16 == symbol)
+		{
+			if (0 == index) return "repeat with no previous length";
+			length = lengths[index - 1];
+			repeat = 3 + getBits(b, 2);
+		}
+		else if (17 == symbol) repeat = 3 + getBits(b, 3);
+		else repeat = 11 + getBits(b, 7);
+
+		if (index + repeat > total) return "too many code lengths";
+		while (repeat-- > 0) lengths[index++] = length;
+	}
+	if (0 == lengths[256]) return "no end of block code";
+
+	// Incomplete codes are allowed, as long as they are never used
+	if (buildHuffman(&literals, lengths, literalCount) < 0) return "over-subscribed literal code";
+	if (buildHuffman(&distances, lengths + literalCount, distanceCount) < 0) return "over-subscribed distance code";
+	return inflateCodes(b, o, &literals, &distances);
+}
+
+// Stream ////////////////////////////////////////////////////////////////////
+
+static uint32_t adler32(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size > 0)
+	{
+		size_t n = size < ADLER_BLOCK ? size : ADLER_BLOCK;
+		size -= n;
+		while (n-- > 0)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+	}
+	return b << 16 | a;
+}
+
+static const char *inflateStream(struct PGBits *b, struct PGOutput *o)
+{
+	uint32_t method = getBits(b, 8);
+	uint32_t flags = getBits(b, 8);
+	if (8 != (method & 15) || 0 != (method << 8 | flags) % 31) return "not a zlib stream";
+	if (flags & 32) return "preset dictionaries are unsupported";
+
+	uint32_t last;
+	do
+	{
+		last = getBits(b, 1);
+		const char *error;
+		switch (getBits(b, 2))
+		{
+			case 0: error = inflateStored(b, o); break;
+			case 1: error = inflateFixed(b, o); break;
+			case 2: error = inflateDynamic(b, o); break;
+			default: error = "bad block type"; break;
+		}
+		if (NULL != error) return error;
+		if (overrun(b)) return "data is truncated";
+	}
+	while (!last);
+
+	getBits(b, b->count & 7);
+	uint32_t check = getBits(b, 8) << 24;
+	check |= getBits(b, 8) << 16;
+	check |= getBits(b, 8) << 8;
+	check |= getBits(b, 8);
+	if (overrun(b)) return "checksum is missing";
+	if (check != adler32(o->data, o->position)) return "checksum doesn't match";
+	return NULL;
+}
+
+PGResult pgInflate(const void *in, size_t inSize, void *out, size_t outSize, size_t *written)
+{
+	if (NULL != written) *written = 0;
+	if (NULL == in || (NULL == out && outSize > 0)) return PGR_NullPointerBarf;
+
+	struct PGBits bits = { in, (const uint8_t *)in + inSize, 0, 0, 0 };
+	struct PGOutput output = { out, outSize, 0 };
+	const char *error = inflateStream(&bits, &output);
+	if (NULL != error)
+	{
+		pgLog(PGL_Error, "Could not inflate: %s.", error);
+		return PGR_CouldNotDecode;
+	}
+
+	if (NULL != written) *written = output.position;
+	return PGR_OK;
+}
@@ -0,0 +1,29 @@
+//
+//  PGInflate.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGInflate_h
+#define PGInflate_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Decompresses a zlib stream (RFC 1950 around RFC 1951 deflate data)
+	 * into `out`, which must be big enough for all of it. Enough for PNG,
+	 * which always knows how big its data will be, without depending on
+	 * zlib. `written` may be NULL. Thread safe.
+	 */
+	PGResult pgInflate(const void *in, size_t inSize, void *out, size_t outSize, size_t *written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
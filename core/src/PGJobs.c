@@ -0,0 +1,594 @@
+//
+//  PGJobs.c
+//
+//  Created by David Wagner on 05/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "Pictogram.h"
+
+#define DEQUE_CAPACITY PG_MAX_JOBS_PER_THREAD
+#define DEQUE_MASK (DEQUE_CAPACITY - 1)
+
+// Failed steal attempts before an idle worker goes to sleep
+#define IDLE_SPINS 64
+// Sleeping workers also wake on their own this often, in case a
+// wake up was missed
+#define IDLE_SLEEP_NSEC (2 * 1000 * 1000)
+
+struct PGJobPrivate {
+	PGJobFunction function;
+	PGJob parent;
+	int32_t unfinished;
+	int32_t continuationCount;
+	PGJob continuations[PG_MAX_JOB_CONTINUATIONS];
+	unsigned char data[PG_JOB_DATA_SIZE];
+} __attribute__((aligned(64)));
+
+/**
+ * Chase-Lev work stealing deque. The owning thread pushes and pops at the
+ * bottom, other threads steal from the top.
+ */
+struct PGJobDeque {
+	int64_t top __attribute__((aligned(64)));
+	int64_t bottom __attribute__((aligned(64)));
+	PGJob jobs[DEQUE_CAPACITY];
+};
+
+struct PGJobThread {
+	PGJobScheduler scheduler;
+	int index;
+	pthread_t thread;
+	int started;
+	uint32_t random;
+
+	struct PGJobDeque deque;
+
+	struct PGJobPrivate *pool;
+	uint32_t nextJob;
+};
+
+struct PGJobSchedulerPrivate {
+	struct PGJobThread *threads[PG_MAX_JOB_THREADS];
+	int32_t threadCount;
+	int workerCount;
+
+	int32_t quit;
+	int32_t sleepers;
+	pthread_mutex_t sleepLock;
+	pthread_cond_t wake;
+};
+
+struct PGParallelForData {
+	PGJobRangeFunction function;
+	void *userData;
+	size_t first;
+	size_t count;
+	size_t grain;
+};
+
+static __thread struct PGJobThread *CurrentThread = NULL;
+
+#pragma mark - Deque
+
+static void dequePush(struct PGJobDeque *deque, PGJob job)
+{
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->jobs[b & DEQUE_MASK], job, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+static PGJob dequePop(struct PGJobDeque *deque)
+{
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if (t > b)
+	{
+		// Empty
+		__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	PGJob job = __atomic_load_n(&deque->jobs[b & DEQUE_MASK], __ATOMIC_RELAXED);
+	if (t == b)
+	{
+		// Last job, so race any thieves for it
+		if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		{
+			job = NULL;
+		}
+		__atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return job;
+}
+
+static PGJob dequeSteal(struct PGJobDeque *deque)
+{
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b) return NULL;
+
+	PGJob job = __atomic_load_n(&deque->jobs[t & DEQUE_MASK], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+	{
+		// Lost the race to another thief or the owner
+		return NULL;
+	}
+	return job;
+}
+
+static int64_t dequeSize(struct PGJobDeque *deque)
+{
+	int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	int64_t t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+	return b - t;
+}
+
+#pragma mark - Scheduling
+
+static struct PGJobThread *schedulerThread(PGJobScheduler scheduler)
+{
+	struct PGJobThread *thread = CurrentThread;
+	if (NULL == thread || thread->scheduler != scheduler) return NULL;
+	return thread;
+}
+
+static void wakeSleepers(PGJobScheduler scheduler, int all)
+{
+	if (__atomic_load_n(&scheduler->sleepers, __ATOMIC_ACQUIRE) > 0)
+	{
+		pthread_mutex_lock(&scheduler->sleepLock);
+		if (all)
+		{
+			pthread_cond_broadcast(&scheduler->wake);
+		}
+		else
+		{
+			pthread_cond_signal(&scheduler->wake);
+		}
+		pthread_mutex_unlock(&scheduler->sleepLock);
+	}
+}
+
+static PGJob findJob(struct PGJobThread *thread)
+{
+	PGJob job = dequePop(&thread->deque);
+	if (NULL != job) return job;
+
+	PGJobScheduler scheduler = thread->scheduler;
+	int32_t count = __atomic_load_n(&scheduler->threadCount, __ATOMIC_ACQUIRE);
+	if (count > PG_MAX_JOB_THREADS) count = PG_MAX_JOB_THREADS;
+	if (count <= 1) return NULL;
+
+	// xorshift, so each thread starts stealing from a different victim
+	uint32_t x = thread->random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	thread->random = x;
+
+	for (int32_t i = 0; i < count; i++)
+	{
+		struct PGJobThread *victim = __atomic_load_n(&scheduler->threads[(x + i) % count], __ATOMIC_ACQUIRE);
+		if (NULL == victim || victim == thread) continue;
+
+		job = dequeSteal(&victim->deque);
+		if (NULL != job) return job;
+	}
+	return NULL;
+}
+
+static void finishJob(PGJobScheduler scheduler, PGJob job)
+{
+	// Read everything we need before the job can be seen as finished, as
+	// after that it may be recycled.
+	PGJob parent = job->parent;
+	int32_t continuationCount = job->continuationCount;
+	PGJob continuations[PG_MAX_JOB_CONTINUATIONS];
+	memcpy(continuations, job->continuations, sizeof(PGJob) * continuationCount);
+
+	int32_t unfinished = __atomic_sub_fetch(&job->unfinished, 1, __ATOMIC_ACQ_REL);
+	if (0 != unfinished) return;
+
+	for (int32_t i = 0; i < continuationCount; i++)
+	{
+		pgJobRun(scheduler, continuations[i]);
+	}
+
+	if (NULL != parent)
+	{
+		finishJob(scheduler, parent);
+	}
+}
+
+static void executeJob(PGJobScheduler scheduler, PGJob job)
+{
+	job->function(job, job->data);
+	finishJob(scheduler, job);
+}
+
+static void *workerMain(void *arg)
+{
+	struct PGJobThread *thread = arg;
+	PGJobScheduler scheduler = thread->scheduler;
+	CurrentThread = thread;
+
+	int idle = 0;
+	while (!__atomic_load_n(&scheduler->quit, __ATOMIC_ACQUIRE))
+	{
+		PGJob job = findJob(thread);
+		if (NULL != job)
+		{
+			executeJob(scheduler, job);
+			idle = 0;
+			continue;
+		}
+
+		if (++idle < IDLE_SPINS)
+		{
+			sched_yield();
+			continue;
+		}
+
+		pthread_mutex_lock(&scheduler->sleepLock);
+		__atomic_add_fetch(&scheduler->sleepers, 1, __ATOMIC_ACQ_REL);
+		if (!__atomic_load_n(&scheduler->quit, __ATOMIC_ACQUIRE))
+		{
+			struct timeval now;
+			gettimeofday(&now, NULL);
+			struct timespec until;
+			long nsec = now.tv_usec * 1000L + IDLE_SLEEP_NSEC;
+			until.tv_sec = now.tv_sec + nsec / 1000000000L;
+			until.tv_nsec = nsec % 1000000000L;
+			pthread_cond_timedwait(&scheduler->wake, &scheduler->sleepLock, &until);
+		}
+		__atomic_sub_fetch(&scheduler->sleepers, 1, __ATOMIC_ACQ_REL);
+		pthread_mutex_unlock(&scheduler->sleepLock);
+		idle = 0;
+	}
+
+	CurrentThread = NULL;
+	return NULL;
+}
+
+static void destroyThread(struct PGJobThread *thread)
+{
+	if (NULL != thread)
+	{
+		pgMemFree(thread->pool);
+		memset(thread, 0, sizeof(struct PGJobThread));
+		pgMemFree(thread);
+	}
+}
+
+static struct PGJobThread *createThread(PGJobScheduler scheduler)
+{
+	// Allocate before claiming a slot, as a claimed slot can't be given
+	// back once another thread has claimed the next one
+	struct PGJobThread *thread = pgMemAllocAligned(sizeof(struct PGJobThread), 64, PGM_Jobs);
+	if (NULL == thread) return NULL;
+	memset(thread, 0, sizeof(struct PGJobThread));
+
+	thread->pool = pgMemAllocAligned(sizeof(struct PGJobPrivate) * PG_MAX_JOBS_PER_THREAD, 64, PGM_Jobs);
+	if (NULL == thread->pool)
+	{
+		pgMemFree(thread);
+		return NULL;
+	}
+	memset(thread->pool, 0, sizeof(struct PGJobPrivate) * PG_MAX_JOBS_PER_THREAD);
+
+	// Thieves skip slots which haven't been filled yet
+	int32_t index = __atomic_fetch_add(&scheduler->threadCount, 1, __ATOMIC_ACQ_REL);
+	if (index >= PG_MAX_JOB_THREADS)
+	{
+		__atomic_sub_fetch(&scheduler->threadCount, 1, __ATOMIC_ACQ_REL);
+		destroyThread(thread);
+		return NULL;
+	}
+
+	thread->scheduler = scheduler;
+	thread->index = index;
+	thread->random = 2463534242u + 7919u * (uint32_t)index;
+
+	__atomic_store_n(&scheduler->threads[index], thread, __ATOMIC_RELEASE);
+
+	return thread;
+}
+
+PGResult pgJobSchedulerCreate(PGJobScheduler *scheduler, int workerCount)
+{
+	if (NULL == scheduler) return PGR_NullPointerBarf;
+	*scheduler = NULL;
+
+	if (workerCount < 0)
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		workerCount = cores > 1 ? (int)cores - 1 : 0;
+	}
+	if (workerCount > PG_MAX_JOB_THREADS - 1)
+	{
+		workerCount = PG_MAX_JOB_THREADS - 1;
+	}
+
+	PGJobScheduler s = pgMemAlloc(sizeof(struct PGJobSchedulerPrivate), PGM_Jobs);
+	if (NULL == s) return PGR_OutOfMemory;
+	memset(s, 0, sizeof(struct PGJobSchedulerPrivate));
+	pthread_mutex_init(&s->sleepLock, NULL);
+	pthread_cond_init(&s->wake, NULL);
+	*scheduler = s;
+
+	// The creating thread always takes part
+	PGResult result = pgJobSchedulerAttachThread(s);
+	if (PGR_OK != result) return result;
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		struct PGJobThread *thread = createThread(s);
+		if (NULL == thread) return PGR_OutOfMemory;
+
+		int error = pthread_create(&thread->thread, NULL, workerMain, thread);
+		if (0 != error)
+		{
+			pgLog(PGL_Error, "Could not start job worker %d: %s", i, strerror(error));
+			return PGR_LazyGenericError;
+		}
+		thread->started = 1;
+		s->workerCount++;
+	}
+
+	return PGR_OK;
+}
+
+void pgJobSchedulerDestroy(PGJobScheduler *scheduler)
+{
+	if (NULL != scheduler && NULL != *scheduler)
+	{
+		PGJobScheduler s = *scheduler;
+
+		__atomic_store_n(&s->quit, 1, __ATOMIC_RELEASE);
+		pthread_mutex_lock(&s->sleepLock);
+		pthread_cond_broadcast(&s->wake);
+		pthread_mutex_unlock(&s->sleepLock);
+
+		int32_t count = __atomic_load_n(&s->threadCount, __ATOMIC_ACQUIRE);
+		for (int32_t i = 0; i < count; i++)
+		{
+			struct PGJobThread *thread = s->threads[i];
+			if (NULL == thread) continue;
+
+			if (CurrentThread == thread)
+			{
+				CurrentThread = NULL;
+			}
+			else if (thread->started)
+			{
+				pthread_join(thread->thread, NULL);
+			}
+		}
+		for (int32_t i = 0; i < count; i++)
+		{
+			destroyThread(s->threads[i]);
+		}
+
+		pthread_cond_destroy(&s->wake);
+		pthread_mutex_destroy(&s->sleepLock);
+		memset(s, 0, sizeof(struct PGJobSchedulerPrivate));
+		pgMemFree(s);
+
+		*scheduler = NULL;
+	}
+}
+
+PGResult pgJobSchedulerAttachThread(PGJobScheduler scheduler)
+{
+	if (NULL == scheduler) return PGR_NullPointerBarf;
+	if (NULL != schedulerThread(scheduler)) return PGR_OK;
+
+	struct PGJobThread *thread = createThread(scheduler);
+	if (NULL == thread)
+	{
+		pgLog(PGL_Error, "Could not attach thread to job scheduler. At most %d threads may take part.", PG_MAX_JOB_THREADS);
+		return PGR_OutOfMemory;
+	}
+	CurrentThread = thread;
+
+	return PGR_OK;
+}
+
+int pgJobSchedulerThreadCount(PGJobScheduler scheduler)
+{
+	if (NULL == scheduler) return 0;
+
+	return __atomic_load_n(&scheduler->threadCount, __ATOMIC_ACQUIRE);
+}
+
+int pgJobSchedulerCurrentThread(PGJobScheduler scheduler)
+{
+	struct PGJobThread *thread = schedulerThread(scheduler);
+	return NULL == thread ? -1 : thread->index;
+}
+
+#pragma mark - Jobs
+
+static PGJob allocateJob(struct PGJobThread *thread)
+{
+	// Skip over any job in the ring which is still in flight
+	for (uint32_t attempt = 0; attempt < PG_MAX_JOBS_PER_THREAD; attempt++)
+	{
+		PGJob job = &thread->pool[thread->nextJob++ & (PG_MAX_JOBS_PER_THREAD - 1)];
+		if (0 == __atomic_load_n(&job->unfinished, __ATOMIC_ACQUIRE))
+		{
+			return job;
+		}
+	}
+	return NULL;
+}
+
+PGJob pgJobCreateChild(PGJobScheduler scheduler, PGJob parent, PGJobFunction function, const void *data, size_t size)
+{
+	struct PGJobThread *thread = schedulerThread(scheduler);
+	if (NULL == thread)
+	{
+		pgLog(PGL_Error, "Jobs can only be created by threads attached to the scheduler.");
+		return NULL;
+	}
+	if (NULL == function || size > PG_JOB_DATA_SIZE || (size > 0 && NULL == data))
+	{
+		pgLog(PGL_Error, "Invalid job: function %p, %zu bytes of data.", function, size);
+		return NULL;
+	}
+
+	PGJob job = allocateJob(thread);
+	if (NULL == job)
+	{
+		pgLog(PGL_Error, "Out of jobs. More than %d jobs are in flight on thread %d.", PG_MAX_JOBS_PER_THREAD, thread->index);
+		return NULL;
+	}
+
+	if (NULL != parent)
+	{
+		__atomic_add_fetch(&parent->unfinished, 1, __ATOMIC_ACQ_REL);
+	}
+
+	job->function = function;
+	job->parent = parent;
+	job->continuationCount = 0;
+	if (size > 0)
+	{
+		memcpy(job->data, data, size);
+	}
+	__atomic_store_n(&job->unfinished, 1, __ATOMIC_RELEASE);
+
+	return job;
+}
+
+PGJob pgJobCreate(PGJobScheduler scheduler, PGJobFunction function, const void *data, size_t size)
+{
+	return pgJobCreateChild(scheduler, NULL, function, data, size);
+}
+
+PGResult pgJobAddContinuation(PGJob job, PGJob continuation)
+{
+	if (NULL == job || NULL == continuation) return PGR_NullPointerBarf;
+	if (job->continuationCount >= PG_MAX_JOB_CONTINUATIONS) return PGR_LazyGenericError;
+
+	job->continuations[job->continuationCount++] = continuation;
+	return PGR_OK;
+}
+
+void pgJobRun(PGJobScheduler scheduler, PGJob job)
+{
+	if (NULL == job) return;
+
+	struct PGJobThread *thread = schedulerThread(scheduler);
+	if (NULL == thread)
+	{
+		pgLog(PGL_Error, "Jobs can only be run by threads attached to the scheduler.");
+		return;
+	}
+
+	if (dequeSize(&thread->deque) >= DEQUE_CAPACITY)
+	{
+		// No room to queue it, so run it here and now
+		executeJob(scheduler, job);
+		return;
+	}
+
+	dequePush(&thread->deque, job);
+	wakeSleepers(scheduler, 0);
+}
+
+int pgJobIsFinished(PGJob job)
+{
+	if (NULL == job) return 1;
+
+	return 0 == __atomic_load_n(&job->unfinished, __ATOMIC_ACQUIRE);
+}
+
+void pgJobWait(PGJobScheduler scheduler, PGJob job)
+{
+	struct PGJobThread *thread = schedulerThread(scheduler);
+	if (NULL == thread)
+	{
+		pgLog(PGL_Error, "Jobs can only be waited for by threads attached to the scheduler.");
+		return;
+	}
+
+	// Help out until the job is done
+	while (!pgJobIsFinished(job))
+	{
+		PGJob next = findJob(thread);
+		if (NULL != next)
+		{
+			executeJob(scheduler, next);
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+}
+
+#pragma mark - Parallel for
+
+static void parallelForJob(PGJob job, void *data)
+{
+	struct PGParallelForData *range = data;
+
+	if (range->count <= range->grain)
+	{
+		range->function(range->userData, range->first, range->count);
+		return;
+	}
+
+	PGJobScheduler scheduler = CurrentThread->scheduler;
+	size_t half = range->count / 2;
+
+	struct PGParallelForData left = *range;
+	left.count = half;
+
+	struct PGParallelForData right = *range;
+	right.first += half;
+	right.count -= half;
+
+	PGJob leftJob = pgJobCreateChild(scheduler, job, parallelForJob, &left, sizeof(left));
+	PGJob rightJob = pgJobCreateChild(scheduler, job, parallelForJob, &right, sizeof(right));
+	if (NULL == leftJob || NULL == rightJob)
+	{
+		// Out of jobs, so do the remaining work here
+		if (NULL == leftJob) left.function(left.userData, left.first, left.count);
+		else pgJobRun(scheduler, leftJob);
+		if (NULL == rightJob) right.function(right.userData, right.first, right.count);
+		else pgJobRun(scheduler, rightJob);
+		return;
+	}
+	pgJobRun(scheduler, leftJob);
+	pgJobRun(scheduler, rightJob);
+}
+
+PGJob pgJobParallelFor(PGJobScheduler scheduler, PGJob parent, size_t count, size_t grain, PGJobRangeFunction function, void *userData)
+{
+	if (NULL == function) return NULL;
+
+	struct PGParallelForData range;
+	range.function = function;
+	range.userData = userData;
+	range.first = 0;
+	range.count = count;
+	range.grain = grain > 0 ? grain : 1;
+
+	return pgJobCreateChild(scheduler, parent, parallelForJob, &range, sizeof(range));
+}
@@ -0,0 +1,107 @@
+//
+//  PGJobs.h
+//
+//  Created by David Wagner on 05/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGJobs_h
+#define PGJobs_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Threads which can take part in a scheduler, including the thread which
+	// created it and any attached with pgJobSchedulerAttachThread.
+	#define PG_MAX_JOB_THREADS 16
+
+	// Jobs are recycled from a ring per thread. A job may be reused once this
+	// many newer jobs have been created on the same thread, so don't hold on
+	// to a PGJob after it has finished.
+	#define PG_MAX_JOBS_PER_THREAD 4096
+
+	#define PG_JOB_DATA_SIZE 64
+	#define PG_MAX_JOB_CONTINUATIONS 4
+
+	/**
+	 * Job entry point. `data` points to the copy of the data the job was
+	 * created with.
+	 */
+	typedef void (*PGJobFunction)(PGJob job, void *data);
+
+	/**
+	 * Entry point for pgJobParallelFor. Called with sub ranges of at most
+	 * `grain` items.
+	 */
+	typedef void (*PGJobRangeFunction)(void *userData, size_t first, size_t count);
+
+	/**
+	 * Creates a work stealing scheduler. The calling thread becomes a member
+	 * of the scheduler, and `workerCount` extra threads are started. Pass a
+	 * negative workerCount to start one worker per remaining core.
+	 */
+	PGResult pgJobSchedulerCreate(PGJobScheduler *scheduler, int workerCount);
+	void pgJobSchedulerDestroy(PGJobScheduler *scheduler);
+
+	/**
+	 * Lets the calling thread create, run and wait for jobs. Threads which
+	 * don't belong to the scheduler can't create jobs.
+	 */
+	PGResult pgJobSchedulerAttachThread(PGJobScheduler scheduler);
+
+	int pgJobSchedulerThreadCount(PGJobScheduler scheduler);
+
+	/**
+	 * Index of the calling thread within the scheduler, in the range
+	 * [0, PG_MAX_JOB_THREADS), or -1 if the thread doesn't belong to it.
+	 * Useful for indexing per thread data from inside jobs.
+	 */
+	int pgJobSchedulerCurrentThread(PGJobScheduler scheduler);
+
+	/**
+	 * Creates a job which will call `function` with a copy of `data`. At
+	 * most PG_JOB_DATA_SIZE bytes may be passed. The job doesn't start
+	 * until it is passed to pgJobRun.
+	 */
+	PGJob pgJobCreate(PGJobScheduler scheduler, PGJobFunction function, const void *data, size_t size);
+
+	/**
+	 * As pgJobCreate, but the parent won't be finished until this job is.
+	 * The child must be created before the parent finishes, which normally
+	 * means from inside the parent, or before the parent is run.
+	 */
+	PGJob pgJobCreateChild(PGJobScheduler scheduler, PGJob parent, PGJobFunction function, const void *data, size_t size);
+
+	/**
+	 * Runs `continuation` once `job` has finished. Must be called before
+	 * `job` is run. Returns PGR_LazyGenericError if the job already has
+	 * PG_MAX_JOB_CONTINUATIONS continuations.
+	 */
+	PGResult pgJobAddContinuation(PGJob job, PGJob continuation);
+
+	void pgJobRun(PGJobScheduler scheduler, PGJob job);
+
+	/**
+	 * Waits for `job` to finish. The calling thread runs other jobs while
+	 * it waits rather than blocking.
+	 */
+	void pgJobWait(PGJobScheduler scheduler, PGJob job);
+
+	int pgJobIsFinished(PGJob job);
+
+	/**
+	 * Creates a job which calls `function` over [0, count) in ranges of at
+	 * most `grain` items, splitting the range in half across child jobs until
+	 * it is small enough. Run it and wait for it like any other job. `parent`
+	 * may be NULL.
+	 */
+	PGJob pgJobParallelFor(PGJobScheduler scheduler, PGJob parent, size_t count, size_t grain, PGJobRangeFunction function, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
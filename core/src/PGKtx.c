@@ -0,0 +1,119 @@
+//
+//  PGKtx.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#define KTX_IDENTIFIER_SIZE 12
+#define KTX_HEADER_SIZE 64
+
+static const GLubyte Identifier[KTX_IDENTIFIER_SIZE] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Block sizes of GL_COMPRESSED_RGBA_ASTC_4x4_KHR onwards
+static const GLubyte AstcBlocks[][2] = {
+	{ 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+	{ 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+};
+
+static PGResult corrupt(const char *why)
+{
+	pgLog(PGL_Error, "Could not read KTX: %s.", why);
+	return PGR_CouldNotDecode;
+}
+
+static uint32_t readU32(const GLubyte *p, int swap)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof(x));
+	return swap ? __builtin_bswap32(x) : x;
+}
+
+size_t pgKtxLevelSize(GLenum format, GLsizei width, GLsizei height)
+{
+	if (pgEtcCanDecode(format)) return pgEtcImageSize(format, width, height);
+
+	if (format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR && format <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR)
+	{
+		const GLubyte *block = AstcBlocks[format - GL_COMPRESSED_RGBA_ASTC_4x4_KHR];
+		return (size_t)((width + block[0] - 1) / block[0]) * (size_t)((height + block[1] - 1) / block[1]) * 16;
+	}
+	return 0;
+}
+
+int pgKtxIsKtx(const void *data, size_t size)
+{
+	return NULL != data && size >= KTX_IDENTIFIER_SIZE && 0 == memcmp(data, Identifier, KTX_IDENTIFIER_SIZE);
+}
+
+PGResult pgKtxParse(PGKtx *ktx, const void *data, size_t size)
+{
+	if (NULL == ktx) return PGR_NullPointerBarf;
+	memset(ktx, 0, sizeof(PGKtx));
+	if (NULL == data) return PGR_NullPointerBarf;
+
+	if (!pgKtxIsKtx(data, size)) return corrupt("not a KTX file");
+	if (size < KTX_HEADER_SIZE) return corrupt("header is truncated");
+
+	// Written in the writer's byte order, which this says
+	const GLubyte *p = data;
+	uint32_t endianness = readU32(p + 12, 0);
+	int swap = 0x01020304 == endianness;
+	if (!swap && 0x04030201 != endianness) return corrupt("bad endianness");
+
+	uint32_t type = readU32(p + 16, swap);
+	uint32_t internalFormat = readU32(p + 28, swap);
+	uint32_t width = readU32(p + 36, swap);
+	uint32_t height = readU32(p + 40, swap);
+	uint32_t depth = readU32(p + 44, swap);
+	uint32_t arrayElements = readU32(p + 48, swap);
+	uint32_t faces = readU32(p + 52, swap);
+	uint32_t levels = readU32(p + 56, swap);
+	uint32_t keyValueBytes = readU32(p + 60, swap);
+
+	if (0 != type || 0 == pgKtxLevelSize(internalFormat, 1, 1))
+	{
+		pgLog(PGL_Error, "KTX texture format 0x%04x isn't supported.", internalFormat);
+		return PGR_Unsupported;
+	}
+	if (depth > 1 || 0 != arrayElements || 1 != faces)
+	{
+		pgLog(PGL_Error, "Only 2D KTX textures are supported.");
+		return PGR_Unsupported;
+	}
+	if (0 == width || 0 == height || width > PG_IMAGE_MAX_SIZE || height > PG_IMAGE_MAX_SIZE) return corrupt("bad size");
+
+	// None means they should be generated, which compressed textures can't be
+	if (0 == levels) levels = 1;
+	if (levels > PG_KTX_MAX_LEVELS || (0 == width >> (levels - 1) && 0 == height >> (levels - 1))) return corrupt("too many levels");
+
+	size_t offset = KTX_HEADER_SIZE + (size_t)keyValueBytes;
+	if (offset > size) return corrupt("data is truncated");
+
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		if (size - offset < 4) return corrupt("data is truncated");
+		uint32_t imageSize = readU32(p + offset, swap);
+		offset += 4;
+
+		uint32_t levelWidth = width >> level ? width >> level : 1;
+		uint32_t levelHeight = height >> level ? height >> level : 1;
+		if (imageSize != pgKtxLevelSize(internalFormat, (GLsizei)levelWidth, (GLsizei)levelHeight)) return corrupt("level size doesn't match");
+		if (size - offset < imageSize) return corrupt("data is truncated");
+
+		ktx->levels[level] = p + offset;
+		ktx->levelSizes[level] = imageSize;
+		offset += imageSize + (4 - imageSize % 4) % 4;
+		if (offset > size) offset = size;
+	}
+
+	ktx->internalFormat = internalFormat;
+	ktx->width = (GLsizei)width;
+	ktx->height = (GLsizei)height;
+	ktx->levelCount = (int)levels;
+	return PGR_OK;
+}
@@ -0,0 +1,60 @@
+//
+//  PGKtx.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGKtx_h
+#define PGKtx_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_KTX_MAX_LEVELS 16
+
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#	define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_12x12_KHR
+#	define GL_COMPRESSED_RGBA_ASTC_12x12_KHR 0x93BD
+#endif
+
+	/**
+	 * A 2D texture in a KTX 1.1 container. The levels point into the data
+	 * it was parsed from, largest first.
+	 */
+	typedef struct
+	{
+		GLenum internalFormat;
+		GLsizei width;
+		GLsizei height;
+		int levelCount;
+		const GLubyte *levels[PG_KTX_MAX_LEVELS];
+		size_t levelSizes[PG_KTX_MAX_LEVELS];
+	}
+	PGKtx;
+
+	int pgKtxIsKtx(const void *data, size_t size);
+
+	/**
+	 * Finds the levels of a compressed texture: ETC1, ETC2 and EAC, or
+	 * ASTC from 4x4 to 12x12 blocks. Arrays, cube maps, 3D and
+	 * uncompressed textures aren't supported.
+	 */
+	PGResult pgKtxParse(PGKtx *ktx, const void *data, size_t size);
+
+	/**
+	 * Bytes of blocks covering a level of a format pgKtxParse takes, or 0
+	 * for any other format.
+	 */
+	size_t pgKtxLevelSize(GLenum format, GLsizei width, GLsizei height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 #include "Pictogram.h"
 
 static PGLogLevel MinimumLogLevel = PGL_Error;
+static PGLogCounts Counts;
 
 void _pgLogv(PGLogLevel level, const char *fmt, ...)
 {
@@ -20,6 +21,11 @@ void _pgLogv(PGLogLevel level, const char *fmt, ...)
 		va_start(ap, fmt);
 		vprintf(fmt, ap);
 		va_end(ap);
+		__atomic_add_fetch(&Counts.written, 1, __ATOMIC_RELAXED);
+	}
+	else
+	{
+		__atomic_add_fetch(&Counts.dropped, 1, __ATOMIC_RELAXED);
 	}
 }
 
@@ -33,6 +39,7 @@ void _pgLogAnyGlErrorsv(const char *fmt, ...)
 	GLenum error = glGetError();
 	if (GL_NO_ERROR != error)
 	{
+		__atomic_add_fetch(&Counts.glErrors, 1, __ATOMIC_RELAXED);
 		va_list ap;
 		va_start(ap, fmt);
 		vprintf(fmt, ap);
@@ -59,3 +66,12 @@ void _pgLogAnyGlErrorsv(const char *fmt, ...)
 		}
 	}
 }
+
+void pgLogGetCounts(PGLogCounts *counts)
+{
+	if (NULL == counts) return;
+	
+	counts->written = __atomic_load_n(&Counts.written, __ATOMIC_RELAXED);
+	counts->dropped = __atomic_load_n(&Counts.dropped, __ATOMIC_RELAXED);
+	counts->glErrors = __atomic_load_n(&Counts.glErrors, __ATOMIC_RELAXED);
+}
@@ -30,6 +30,19 @@ extern "C" {
 #	define pgLogAnyGlErrors(message, ...) _pgLogAnyGlErrorsv(("[%s:%d] --GL ERROR-- " message), __FILE__, __LINE__, ## __VA_ARGS__)
 	void _pgLogAnyGlErrorsv(const char *fmt, ...);
 #endif
+
+	typedef struct
+	{
+		unsigned long written;
+		unsigned long dropped;	// Below the log level
+		unsigned long glErrors;
+	}
+	PGLogCounts;
+
+	/**
+	 * Counts of messages since launch. Safe to call from any thread.
+	 */
+	void pgLogGetCounts(PGLogCounts *counts);
 	
 #ifdef __cplusplus
 }
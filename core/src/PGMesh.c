@@ -0,0 +1,419 @@
+//
+//  PGMesh.c
+//
+//  Created by David Wagner on 02/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "Pictogram.h"
+
+struct PGMeshAttrib {
+	char name[PG_MAX_ATTRIB_NAME];
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei offset;
+};
+
+struct PGMeshPrivate {
+	GLuint vertexBuffer;
+	GLsizei stride;
+	GLsizei vertexCount;
+
+	struct PGMeshAttrib attribs[PG_MAX_MESH_ATTRIBS];
+	GLsizei attribCount;
+	uint32_t layoutHash;
+
+	// Client side copy of the vertices, used to build the batch buffer
+	GLubyte *vertices;
+
+	// Replicated copies of the mesh for the uniform array batch path
+	GLuint batchBuffer;
+	GLsizei batchCopies;
+
+	// Both buffers can be evicted, as they are remade from `vertices`
+	PGMesh mesh;
+	PGGpuResource memory;
+};
+
+// Every live mesh. Only touched from the GL thread.
+static PGHandlePool Meshes;
+
+static struct PGMeshPrivate *lookupMesh(PGMesh mesh)
+{
+	struct PGMeshPrivate *m = pgHandlePoolGet(Meshes, mesh);
+	if (NULL == m && PG_NULL_HANDLE != mesh)
+	{
+		pgLog(PGL_Warn, "Stale mesh handle 0x%08x.", mesh);
+	}
+	return m;
+}
+
+/**
+ * Each batch vertex is the original vertex followed by a float copy index,
+ * padded so the next vertex starts on a 4 byte boundary.
+ */
+static GLsizei pgMeshBatchStride(const struct PGMeshPrivate *mesh)
+{
+	return ((mesh->stride + 3) & ~3) + sizeof(GLfloat);
+}
+
+PGResult pgMeshCreate(PGMesh *mesh, const GLvoid *vertices, GLsizei stride, GLsizei vertexCount, const PGVertexAttrib *attribs, GLsizei attribCount)
+{
+	if (NULL == mesh) return PGR_NullPointerBarf;
+	*mesh = PG_NULL_HANDLE;
+
+	if (NULL == vertices || NULL == attribs) return PGR_NullPointerBarf;
+	if (stride <= 0 || vertexCount <= 0 || attribCount <= 0 || attribCount > PG_MAX_MESH_ATTRIBS)
+	{
+		pgLog(PGL_Error, "Invalid mesh layout: stride %d, %d vertices, %d attributes.", stride, vertexCount, attribCount);
+		return PGR_LazyGenericError;
+	}
+
+	if (NULL == Meshes)
+	{
+		PGResult result = pgHandlePoolCreate(&Meshes, sizeof(struct PGMeshPrivate), PGM_Mesh);
+		if (PGR_OK != result) return result;
+	}
+
+	size_t bytes = (size_t)stride * vertexCount;
+	GLubyte *copy = pgMemAlloc(bytes, PGM_Mesh);
+	if (NULL == copy) return PGR_OutOfMemory;
+
+	struct PGMeshPrivate *m = NULL;
+	PGMesh handle = pgHandlePoolAdd(Meshes, (void **)&m);
+	if (NULL == m)
+	{
+		pgMemFree(copy);
+		return PGR_OutOfMemory;
+	}
+	m->mesh = handle;
+	m->vertices = copy;
+	memcpy(m->vertices, vertices, bytes);
+	m->stride = stride;
+	m->vertexCount = vertexCount;
+
+	for (GLsizei i = 0; i < attribCount; i++)
+	{
+		struct PGMeshAttrib *a = &m->attribs[i];
+		strncpy(a->name, attribs[i].name, PG_MAX_ATTRIB_NAME - 1);
+		a->size = attribs[i].size;
+		a->type = attribs[i].type;
+		a->normalized = attribs[i].normalized;
+		a->offset = attribs[i].offset;
+	}
+	m->attribCount = attribCount;
+	m->layoutHash = pgVertexLayoutHash(stride, attribs, attribCount);
+
+	*mesh = handle;
+
+	return PGR_OK;
+}
+
+static GLboolean pgMeshEvict(void *userData)
+{
+	struct PGMeshPrivate *m = pgHandlePoolGet(Meshes, (PGMesh)(uintptr_t)userData);
+	if (NULL == m) return GL_FALSE;
+
+	pgDeleteQueuePush(PGD_Buffer, m->vertexBuffer);
+	pgDeleteQueuePush(PGD_Buffer, m->batchBuffer);
+	m->vertexBuffer = 0;
+	m->batchBuffer = 0;
+	m->batchCopies = 0;
+	return GL_TRUE;
+}
+
+/**
+ * Accounts for whichever buffers the mesh has, after one has been made.
+ */
+static void pgMeshTrackMemory(struct PGMeshPrivate *mesh)
+{
+	size_t bytes = 0;
+	if (0 != mesh->vertexBuffer) bytes += (size_t)mesh->stride * mesh->vertexCount;
+	if (0 != mesh->batchBuffer) bytes += (size_t)pgMeshBatchStride(mesh) * mesh->vertexCount * mesh->batchCopies;
+
+	if (PG_NULL_HANDLE == mesh->memory)
+	{
+		PGGpuEviction eviction = { pgMeshEvict, NULL, (void *)(uintptr_t)mesh->mesh };
+		if (PGR_OK == pgGpuMemoryAdd(&mesh->memory, PGG_Buffer, bytes, &eviction))
+		{
+			pgGpuMemorySetLabel(mesh->memory, "mesh");
+		}
+		return;
+	}
+	pgGpuMemoryResize(mesh->memory, bytes);
+	pgGpuMemoryUse(mesh->memory);
+}
+
+/**
+ * The vertex buffer is made the first time the mesh is drawn with GL, so
+ * meshes can be created without a context for the software renderer. It
+ * is made again the same way if it has been evicted.
+ */
+static PGResult pgMeshBindVertexBuffer(struct PGMeshPrivate *mesh)
+{
+	if (0 != mesh->vertexBuffer)
+	{
+		pgGpuMemoryUse(mesh->memory);
+		glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+		return PGR_OK;
+	}
+
+	pgLogAnyGlErrors("About to create mesh buffer.");
+	glGenBuffers(1, &mesh->vertexBuffer);
+	if (0 == mesh->vertexBuffer)
+	{
+		pgLogAnyGlErrors("Could not create mesh buffer.");
+		return PGR_CouldNotCreateBuffer;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)mesh->stride * mesh->vertexCount, mesh->vertices, GL_STATIC_DRAW);
+	pgStatsBufferUpload((unsigned long)mesh->stride * mesh->vertexCount);
+	pgLogAnyGlErrors("Created mesh buffer.");
+	pgMeshTrackMemory(mesh);
+
+	return PGR_OK;
+}
+
+void pgMeshDestroy(PGMesh *mesh)
+{
+	if (NULL != mesh && PG_NULL_HANDLE != *mesh)
+	{
+		struct PGMeshPrivate *m = lookupMesh(*mesh);
+		if (NULL != m)
+		{
+			pgDeleteQueuePush(PGD_Buffer, m->vertexBuffer);
+			pgDeleteQueuePush(PGD_Buffer, m->batchBuffer);
+			pgGpuMemoryRemove(&m->memory);
+			pgMemFree(m->vertices);
+
+			pgHandlePoolRemove(Meshes, *mesh);
+		}
+
+		*mesh = PG_NULL_HANDLE;
+	}
+}
+
+int pgMeshIsValid(PGMesh mesh)
+{
+	return pgHandlePoolIsValid(Meshes, mesh);
+}
+
+GLsizei pgMeshVertexCount(PGMesh mesh)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m) return 0;
+
+	return m->vertexCount;
+}
+
+GLsizei pgMeshStride(PGMesh mesh)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m) return 0;
+
+	return m->stride;
+}
+
+const GLvoid *pgMeshVertices(PGMesh mesh)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m) return NULL;
+
+	return m->vertices;
+}
+
+GLboolean pgMeshFindAttribute(PGMesh mesh, const char *name, PGVertexAttrib *attrib)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m || NULL == name) return GL_FALSE;
+
+	for (GLsizei i = 0; i < m->attribCount; i++)
+	{
+		const struct PGMeshAttrib *a = &m->attribs[i];
+		if (0 != strcmp(a->name, name)) continue;
+
+		if (NULL != attrib)
+		{
+			attrib->name = name;
+			attrib->size = a->size;
+			attrib->type = a->type;
+			attrib->normalized = a->normalized;
+			attrib->offset = a->offset;
+		}
+		return GL_TRUE;
+	}
+	return GL_FALSE;
+}
+
+PGHandlePool pgMeshPool(void)
+{
+	return Meshes;
+}
+
+static GLuint pgMeshEnableAttributesWithStride(const struct PGMeshPrivate *mesh, PGProgram program, GLsizei stride)
+{
+	GLuint enabled = 0;
+	for (GLsizei i = 0; i < mesh->attribCount; i++)
+	{
+		const struct PGMeshAttrib *a = &mesh->attribs[i];
+		GLint location = pgProgramAttribLocation(program, a->name);
+		if (location < 0 || location >= 32) continue;
+
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, a->size, a->type, a->normalized, stride, (const GLvoid *)(intptr_t)a->offset);
+		enabled |= 1u << location;
+	}
+	return enabled;
+}
+
+GLuint pgMeshEnableAttributes(PGMesh mesh, PGProgram program)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m || PG_NULL_HANDLE == program) return 0;
+
+	if (PGR_OK != pgMeshBindVertexBuffer(m)) return 0;
+	return pgMeshEnableAttributesWithStride(m, program, m->stride);
+}
+
+GLuint pgMeshEnableLocations(PGMesh mesh, const GLint *locations)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m || NULL == locations) return 0;
+
+	if (PGR_OK != pgMeshBindVertexBuffer(m)) return 0;
+
+	GLuint enabled = 0;
+	for (GLsizei i = 0; i < m->attribCount; i++)
+	{
+		const struct PGMeshAttrib *a = &m->attribs[i];
+		GLint location = locations[i];
+		if (location < 0 || location >= 32) continue;
+
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, a->size, a->type, a->normalized, m->stride, (const GLvoid *)(intptr_t)a->offset);
+		enabled |= 1u << location;
+	}
+	return enabled;
+}
+
+static uint32_t hashBytes(uint32_t hash, const void *data, size_t bytes)
+{
+	// FNV-1a
+	const unsigned char *p = data;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		hash = (hash ^ p[i]) * 16777619u;
+	}
+	return hash;
+}
+
+uint32_t pgVertexLayoutHash(GLsizei stride, const PGVertexAttrib *attribs, GLsizei attribCount)
+{
+	uint32_t hash = 2166136261u;
+	hash = hashBytes(hash, &stride, sizeof(stride));
+	hash = hashBytes(hash, &attribCount, sizeof(attribCount));
+	for (GLsizei i = 0; NULL != attribs && i < attribCount; i++)
+	{
+		const PGVertexAttrib *a = &attribs[i];
+		size_t length = NULL != a->name ? strlen(a->name) : 0;
+		if (length > PG_MAX_ATTRIB_NAME - 1) length = PG_MAX_ATTRIB_NAME - 1;
+		GLubyte normalized = a->normalized ? 1 : 0;
+
+		hash = hashBytes(hash, a->name, length);
+		hash = hashBytes(hash, "", 1);
+		hash = hashBytes(hash, &a->size, sizeof(a->size));
+		hash = hashBytes(hash, &a->type, sizeof(a->type));
+		hash = hashBytes(hash, &normalized, sizeof(normalized));
+		hash = hashBytes(hash, &a->offset, sizeof(a->offset));
+	}
+	return hash;
+}
+
+uint32_t pgMeshLayoutHash(PGMesh mesh)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	return NULL != m ? m->layoutHash : 0;
+}
+
+static PGResult pgMeshBuildBatchBuffer(struct PGMeshPrivate *mesh, GLsizei copies)
+{
+	GLsizei batchStride = pgMeshBatchStride(mesh);
+	size_t bytes = (size_t)batchStride * mesh->vertexCount * copies;
+	GLubyte *data = pgMemAlloc(bytes, PGM_Mesh);
+	if (NULL == data) return PGR_OutOfMemory;
+	memset(data, 0, bytes);
+
+	GLubyte *out = data;
+	for (GLsizei copy = 0; copy < copies; copy++)
+	{
+		GLfloat index = (GLfloat)copy;
+		const GLubyte *in = mesh->vertices;
+		for (GLsizei v = 0; v < mesh->vertexCount; v++)
+		{
+			memcpy(out, in, mesh->stride);
+			memcpy(out + batchStride - sizeof(GLfloat), &index, sizeof(GLfloat));
+			in += mesh->stride;
+			out += batchStride;
+		}
+	}
+
+	if (0 == mesh->batchBuffer)
+	{
+		glGenBuffers(1, &mesh->batchBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->batchBuffer);
+	glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+	pgStatsBufferUpload(bytes);
+	pgLogAnyGlErrors("Created mesh batch buffer.");
+	pgMemFree(data);
+
+	mesh->batchCopies = copies;
+	pgMeshTrackMemory(mesh);
+	return PGR_OK;
+}
+
+GLuint pgMeshEnableBatchAttributes(PGMesh mesh, PGProgram program, GLsizei copies, GLint indexLocation)
+{
+	struct PGMeshPrivate *m = lookupMesh(mesh);
+	if (NULL == m || PG_NULL_HANDLE == program || copies <= 0) return 0;
+
+	if (copies > m->batchCopies)
+	{
+		if (PGR_OK != pgMeshBuildBatchBuffer(m, copies))
+		{
+			pgLog(PGL_Error, "Could not build batch buffer of %d copies.", copies);
+			return 0;
+		}
+	}
+	else
+	{
+		pgGpuMemoryUse(m->memory);
+		glBindBuffer(GL_ARRAY_BUFFER, m->batchBuffer);
+	}
+
+	GLsizei batchStride = pgMeshBatchStride(m);
+	GLuint enabled = pgMeshEnableAttributesWithStride(m, program, batchStride);
+	if (indexLocation >= 0 && indexLocation < 32)
+	{
+		glEnableVertexAttribArray(indexLocation);
+		glVertexAttribPointer(indexLocation, 1, GL_FLOAT, GL_FALSE, batchStride, (const GLvoid *)(intptr_t)(batchStride - sizeof(GLfloat)));
+		enabled |= 1u << indexLocation;
+	}
+	return enabled;
+}
+
+void pgMeshDisableAttributes(GLuint enabledMask)
+{
+	for (GLuint location = 0; enabledMask != 0; location++, enabledMask >>= 1)
+	{
+		if (enabledMask & 1u)
+		{
+			glDisableVertexAttribArray(location);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
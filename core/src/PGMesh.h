@@ -0,0 +1,103 @@
+//
+//  PGMesh.h
+//
+//  Created by David Wagner on 02/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGMesh_h
+#define PGMesh_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_MAX_MESH_ATTRIBS 8
+	#define PG_MAX_ATTRIB_NAME 32
+
+	/**
+	 * Describes one attribute in an interleaved vertex. The name is matched
+	 * against the active attributes of whichever program is in use when the
+	 * mesh is drawn, so a mesh can be drawn with any program which declares
+	 * some or all of its attributes.
+	 */
+	typedef struct
+	{
+		const char *name;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei offset;
+	}
+	PGVertexAttrib;
+
+	/**
+	 * Creates a mesh from interleaved vertex data. The vertices are copied,
+	 * and uploaded to a vertex buffer the first time the mesh is drawn with
+	 * GL. The client side copy is kept for batched and software drawing,
+	 * and to remake the buffers if they are evicted to stay within the GPU
+	 * memory budget.
+	 */
+	PGResult pgMeshCreate(PGMesh *mesh, const GLvoid *vertices, GLsizei stride, GLsizei vertexCount, const PGVertexAttrib *attribs, GLsizei attribCount);
+
+	/**
+	 * Invalidates the handle straight away. The buffers are deleted through
+	 * the delete queue, once frames already queued are done with them.
+	 */
+	void pgMeshDestroy(PGMesh *mesh);
+	int pgMeshIsValid(PGMesh mesh);
+
+	GLsizei pgMeshVertexCount(PGMesh mesh);
+	GLsizei pgMeshStride(PGMesh mesh);
+
+	/**
+	 * The client side copy of the vertices, and the layout of the named
+	 * attribute within them.
+	 */
+	const GLvoid *pgMeshVertices(PGMesh mesh);
+	GLboolean pgMeshFindAttribute(PGMesh mesh, const char *name, PGVertexAttrib *attrib);
+
+	/**
+	 * The pool holding every live mesh, NULL until the first is created.
+	 */
+	PGHandlePool pgMeshPool(void);
+
+	/**
+	 * Binds the mesh vertex buffer and enables every mesh attribute the
+	 * program declares. Returns a mask of the enabled attribute locations
+	 * which should be passed to pgMeshDisableAttributes after drawing.
+	 */
+	GLuint pgMeshEnableAttributes(PGMesh mesh, PGProgram program);
+
+	/**
+	 * As pgMeshEnableAttributes, but binds a buffer holding `copies` back to
+	 * back copies of the mesh. Each copy carries an extra float attribute,
+	 * bound to indexLocation, containing the index of the copy. The buffer
+	 * is built the first time it is asked for and rebuilt only if more
+	 * copies are needed.
+	 */
+	GLuint pgMeshEnableBatchAttributes(PGMesh mesh, PGProgram program, GLsizei copies, GLint indexLocation);
+
+	void pgMeshDisableAttributes(GLuint enabledMask);
+
+	/**
+	 * A hash of a vertex layout, names and order included, so meshes and
+	 * pipelines with the same layout can be matched without comparing
+	 * names. Names are hashed as meshes store them, cut to
+	 * PG_MAX_ATTRIB_NAME - 1 characters.
+	 */
+	uint32_t pgVertexLayoutHash(GLsizei stride, const PGVertexAttrib *attribs, GLsizei attribCount);
+	uint32_t pgMeshLayoutHash(PGMesh mesh);
+
+	/**
+	 * As pgMeshEnableAttributes, but with the location of each of the
+	 * mesh's attributes, in order, already looked up. Negative locations
+	 * are skipped.
+	 */
+	GLuint pgMeshEnableLocations(PGMesh mesh, const GLint *locations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,310 @@
+//
+//  PGMetrics.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Pictogram.h"
+
+#define REPLY_SIZE 8192
+
+struct PGMetricsServerPrivate {
+	// Published under a sequence lock. The render thread makes the count
+	// odd while it writes, and readers retry until they see the same even
+	// count either side of their copy, so publishing never waits.
+	unsigned long sequence;
+	PGMetrics metrics;
+
+	char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	int listener;
+	int wake[2];
+	pthread_t thread;
+	int started;
+};
+
+void pgMetricsServerPublish(PGMetricsServer server, PGRenderer renderer)
+{
+	if (NULL == server) return;
+
+	// Gathered outside the write, so readers retry for as short a time as
+	// possible
+	PGMetrics m;
+	memset(&m, 0, sizeof(PGMetrics));
+	m.published = server->metrics.published + 1;
+	if (NULL != renderer)
+	{
+		pgRendererStatsHistory(renderer, &m.lastFrame, 1);
+		pgRendererStatsSnapshot(renderer, PG_METRICS_WINDOW, &m.recent);
+	}
+	for (int tag = 0; tag < PGM_TagCount; tag++)
+	{
+		pgMemoryStats((PGMemoryTag)tag, &m.memory[tag]);
+	}
+	for (int category = 0; category < PGG_CategoryCount; category++)
+	{
+		pgGpuMemoryStats((PGGpuCategory)category, &m.gpuMemory[category]);
+	}
+	m.gpuBudget = pgGpuMemoryBudget();
+	pgProgramGetLookupCounts(&m.lookups);
+	pgLogGetCounts(&m.log);
+	m.profilerDropped = pgProfilerDropped();
+	m.deletesPending = pgDeleteQueuePending();
+	m.programs = pgHandlePoolCount(pgProgramPool());
+	m.meshes = pgHandlePoolCount(pgMeshPool());
+	m.textures = pgHandlePoolCount(pgTexturePool());
+	m.texturesPending = pgTextureUploadsPending();
+
+	unsigned long sequence = server->sequence;
+	__atomic_store_n(&server->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&server->metrics, &m, sizeof(PGMetrics));
+	__atomic_store_n(&server->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void pgMetricsServerRead(PGMetricsServer server, PGMetrics *metrics)
+{
+	if (NULL == metrics) return;
+	memset(metrics, 0, sizeof(PGMetrics));
+	if (NULL == server) return;
+
+	for (;;)
+	{
+		unsigned long before = __atomic_load_n(&server->sequence, __ATOMIC_ACQUIRE);
+		if (0 == (before & 1))
+		{
+			memcpy(metrics, &server->metrics, sizeof(PGMetrics));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (before == __atomic_load_n(&server->sequence, __ATOMIC_RELAXED)) return;
+		}
+		sched_yield();
+	}
+}
+
+// Serving ///////////////////////////////////////////////////////////////////
+
+static size_t formatMetrics(const PGMetrics *m, char *reply, size_t size)
+{
+	size_t length = 0;
+#define PUT(fmt, ...) \
+	do { \
+		int n = snprintf(reply + length, size - length, fmt "\n", __VA_ARGS__); \
+		if (n > 0) length = length + n < size ? length + n : size - 1; \
+	} while (0)
+
+	PUT("published %lu", m->published);
+
+	const PGFrameStats *f = &m->lastFrame;
+	PUT("frame.number %lu", f->frame);
+	PUT("frame.draw_calls %lu", f->drawCalls);
+	PUT("frame.instances %lu", f->instances);
+	PUT("frame.vertices %lu", f->vertices);
+	PUT("frame.program_binds %lu", f->programBinds);
+	PUT("frame.redundant_program_binds %lu", f->redundantProgramBinds);
+	PUT("frame.pipeline_binds %lu", f->pipelineBinds);
+	PUT("frame.redundant_pipeline_binds %lu", f->redundantPipelineBinds);
+	PUT("frame.state_changes %lu", f->stateChanges);
+	PUT("frame.uniform_uploads %lu", f->uniformUploads);
+	PUT("frame.buffer_uploads %lu", f->bufferUploads);
+	PUT("frame.buffer_bytes %lu", f->bufferBytes);
+	PUT("frame.texture_uploads %lu", f->textureUploads);
+	PUT("frame.texture_bytes %lu", f->textureBytes);
+	PUT("frame.cpu_us %llu", (unsigned long long)f->cpuMicroseconds);
+
+	const PGStatsSnapshot *r = &m->recent;
+	PUT("recent.frames %lu", r->frames);
+	PUT("recent.draw_calls %lu", r->total.drawCalls);
+	PUT("recent.buffer_bytes %lu", r->total.bufferBytes);
+	PUT("recent.texture_bytes %lu", r->total.textureBytes);
+	PUT("recent.cpu_us.min %llu", (unsigned long long)r->cpuMin);
+	PUT("recent.cpu_us.p50 %llu", (unsigned long long)r->cpuP50);
+	PUT("recent.cpu_us.p95 %llu", (unsigned long long)r->cpuP95);
+	PUT("recent.cpu_us.p99 %llu", (unsigned long long)r->cpuP99);
+	PUT("recent.cpu_us.max %llu", (unsigned long long)r->cpuMax);
+	PUT("recent.cpu_us.mean %.1f", r->cpuMean);
+
+	for (int tag = 0; tag < PGM_TagCount; tag++)
+	{
+		const char *name = pgMemoryTagName((PGMemoryTag)tag);
+		PUT("memory.%s.live_bytes %lu", name, (unsigned long)m->memory[tag].liveBytes);
+		PUT("memory.%s.peak_bytes %lu", name, (unsigned long)m->memory[tag].peakBytes);
+		PUT("memory.%s.live_allocations %lu", name, m->memory[tag].liveAllocations);
+	}
+
+	PUT("gpu.budget_bytes %lu", (unsigned long)m->gpuBudget);
+	for (int category = 0; category < PGG_CategoryCount; category++)
+	{
+		const char *name = pgGpuMemoryCategoryName((PGGpuCategory)category);
+		const PGGpuMemoryStats *g = &m->gpuMemory[category];
+		PUT("gpu.%s.live_bytes %lu", name, (unsigned long)g->liveBytes);
+		PUT("gpu.%s.peak_bytes %lu", name, (unsigned long)g->peakBytes);
+		PUT("gpu.%s.evictable_bytes %lu", name, (unsigned long)g->evictableBytes);
+		PUT("gpu.%s.evicted_bytes %lu", name, (unsigned long)g->evictedBytes);
+		PUT("gpu.%s.resources %lu", name, g->resources);
+		PUT("gpu.%s.evictions %lu", name, g->evictions);
+		PUT("gpu.%s.reloads %lu", name, g->reloads);
+	}
+
+	unsigned long lookups = m->lookups.hits + m->lookups.misses;
+	PUT("program.lookup_hits %lu", m->lookups.hits);
+	PUT("program.lookup_misses %lu", m->lookups.misses);
+	PUT("program.lookup_hit_rate %.4f", lookups > 0 ? (double)m->lookups.hits / lookups : 1.0);
+	PUT("programs %lu", m->programs);
+	PUT("meshes %lu", m->meshes);
+	PUT("textures %lu", m->textures);
+	PUT("textures_pending %lu", m->texturesPending);
+	PUT("deletes_pending %lu", m->deletesPending);
+
+	PUT("log.written %lu", m->log.written);
+	PUT("log.dropped %lu", m->log.dropped);
+	PUT("log.gl_errors %lu", m->log.glErrors);
+	PUT("profiler.dropped %lu", m->profilerDropped);
+#undef PUT
+
+	return length;
+}
+
+static void sendAll(int client, const char *data, size_t length)
+{
+#ifdef MSG_NOSIGNAL
+	int flags = MSG_NOSIGNAL;
+#else
+	int flags = 0;
+#endif
+	while (length > 0)
+	{
+		ssize_t sent = send(client, data, length, flags);
+		if (sent < 0 && EINTR == errno) continue;
+		if (sent <= 0) return;
+		data += sent;
+		length -= sent;
+	}
+}
+
+static void *serverThreadMain(void *userData)
+{
+	PGMetricsServer server = userData;
+	pgProfilerSetThreadName("metrics");
+
+	char reply[REPLY_SIZE];
+	for (;;)
+	{
+		struct pollfd fds[2] = {
+			{ server->listener, POLLIN, 0 },
+			{ server->wake[0], POLLIN, 0 },
+		};
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (EINTR == errno) continue;
+			pgLog(PGL_Error, "Metrics server stopped: %s", strerror(errno));
+			break;
+		}
+		if (fds[1].revents) break;
+		if (!(fds[0].revents & POLLIN)) continue;
+
+		int client = accept(server->listener, NULL, NULL);
+		if (client < 0) continue;
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+		PGMetrics metrics;
+		pgMetricsServerRead(server, &metrics);
+		sendAll(client, reply, formatMetrics(&metrics, reply, sizeof(reply)));
+		close(client);
+	}
+	return NULL;
+}
+
+PGResult pgMetricsServerCreate(PGMetricsServer *server, const char *path)
+{
+	if (NULL == server) return PGR_NullPointerBarf;
+	*server = NULL;
+
+	if (NULL == path) return PGR_NullPointerBarf;
+
+	PGMetricsServer s = pgMemAlloc(sizeof(struct PGMetricsServerPrivate), PGM_General);
+	if (NULL == s) return PGR_OutOfMemory;
+	memset(s, 0, sizeof(struct PGMetricsServerPrivate));
+	s->listener = s->wake[0] = s->wake[1] = -1;
+	*server = s;
+
+	if (strlen(path) >= sizeof(s->path))
+	{
+		pgLog(PGL_Error, "Metrics socket path is too long: %s", path);
+		return PGR_CouldNotCreateSocket;
+	}
+	strncpy(s->path, path, sizeof(s->path) - 1);
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+	unlink(path);
+	s->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s->listener < 0
+		|| 0 != bind(s->listener, (struct sockaddr *)&address, sizeof(address))
+		|| 0 != listen(s->listener, 4))
+	{
+		pgLog(PGL_Error, "Could not open metrics socket %s: %s", path, strerror(errno));
+		return PGR_CouldNotCreateSocket;
+	}
+
+	// Written to by pgMetricsServerDestroy to stop the thread
+	if (0 != pipe(s->wake))
+	{
+		pgLog(PGL_Error, "Could not create metrics server pipe: %s", strerror(errno));
+		return PGR_LazyGenericError;
+	}
+
+	int error = pthread_create(&s->thread, NULL, serverThreadMain, s);
+	if (0 != error)
+	{
+		pgLog(PGL_Error, "Could not start metrics server thread: %s", strerror(error));
+		return PGR_LazyGenericError;
+	}
+	s->started = 1;
+
+	return PGR_OK;
+}
+
+void pgMetricsServerDestroy(PGMetricsServer *server)
+{
+	if (NULL != server && NULL != *server)
+	{
+		PGMetricsServer s = *server;
+
+		if (s->started)
+		{
+			char stop = 0;
+			while (write(s->wake[1], &stop, 1) < 0 && EINTR == errno)
+			{
+			}
+			pthread_join(s->thread, NULL);
+		}
+
+		if (s->listener >= 0)
+		{
+			close(s->listener);
+			unlink(s->path);
+		}
+		if (s->wake[0] >= 0) close(s->wake[0]);
+		if (s->wake[1] >= 0) close(s->wake[1]);
+
+		memset(s, 0, sizeof(struct PGMetricsServerPrivate));
+		pgMemFree(s);
+
+		*server = NULL;
+	}
+}
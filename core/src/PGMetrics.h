@@ -0,0 +1,73 @@
+//
+//  PGMetrics.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGMetrics_h
+#define PGMetrics_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_METRICS_WINDOW 120
+
+	/**
+	 * Everything the metrics server reports, as published by the render
+	 * thread.
+	 */
+	typedef struct
+	{
+		unsigned long published;
+		PGFrameStats lastFrame;
+		PGStatsSnapshot recent;		// The last PG_METRICS_WINDOW frames
+		PGMemoryStats memory[PGM_TagCount];
+		PGGpuMemoryStats gpuMemory[PGG_CategoryCount];
+		size_t gpuBudget;
+		PGProgramLookupCounts lookups;
+		PGLogCounts log;
+		unsigned long profilerDropped;
+		unsigned long deletesPending;
+		unsigned long programs;
+		unsigned long meshes;
+		unsigned long textures;
+		unsigned long texturesPending;
+	}
+	PGMetrics;
+
+	/**
+	 * Starts a thread serving metrics on a Unix domain socket at `path`,
+	 * replacing any socket file already there. Each client that connects
+	 * is sent the most recently published metrics as text, one
+	 * `name value` pair per line, and the connection is closed:
+	 *
+	 *     nc -U /tmp/app.metrics
+	 *
+	 * If this fails the server must still be destroyed.
+	 */
+	PGResult pgMetricsServerCreate(PGMetricsServer *server, const char *path);
+
+	/**
+	 * Stops the thread and removes the socket file.
+	 */
+	void pgMetricsServerDestroy(PGMetricsServer *server);
+
+	/**
+	 * Gathers the renderer's stats and the library's counters and
+	 * publishes them. Call once per frame on the render thread, after
+	 * pgRendererEndFrame. Never waits for the server thread.
+	 */
+	void pgMetricsServerPublish(PGMetricsServer server, PGRenderer renderer);
+
+	/**
+	 * Copies the most recently published metrics. Safe from any thread.
+	 */
+	void pgMetricsServerRead(PGMetricsServer server, PGMetrics *metrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
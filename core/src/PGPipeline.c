@@ -0,0 +1,545 @@
+//
+//  PGPipeline.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <string.h>
+#include "Pictogram.h"
+
+/**
+ * A description with no pointers and nothing left uninitialised, so two
+ * can be hashed and compared bytewise.
+ */
+struct PGPipelineKey {
+	PGProgram program;
+	PGBlendState blend;
+	PGDepthStencilState depthStencil;
+	PGRasterState raster;
+	GLsizei stride;
+	GLsizei attribCount;
+	struct {
+		char name[PG_MAX_ATTRIB_NAME];
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei offset;
+	} attribs[PG_MAX_MESH_ATTRIBS];
+};
+
+struct PGPipelinePrivate {
+	struct PGPipelineKey key;
+	uint32_t hash;
+	unsigned long references;
+
+	// Handed out by pgPipelineDescription, and pointed back at this item
+	// each time as items move
+	PGPipelineDesc desc;
+	PGVertexAttrib attribs[PG_MAX_MESH_ATTRIBS];
+
+	uint32_t layoutHash;
+	GLint locations[PG_MAX_MESH_ATTRIBS];
+};
+
+// Every live pipeline. Only touched from the GL thread.
+static PGHandlePool Pipelines;
+
+static struct PGPipelinePrivate *lookupPipeline(PGPipeline pipeline)
+{
+	struct PGPipelinePrivate *p = pgHandlePoolGet(Pipelines, pipeline);
+	if (NULL == p && PG_NULL_HANDLE != pipeline)
+	{
+		pgLog(PGL_Warn, "Stale pipeline handle 0x%08x.", pipeline);
+	}
+	return p;
+}
+
+static uint32_t hashKey(const struct PGPipelineKey *key)
+{
+	// FNV-1a
+	const unsigned char *p = (const unsigned char *)key;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < sizeof(struct PGPipelineKey); i++)
+	{
+		hash = (hash ^ p[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Validation ////////////////////////////////////////////////////////////////
+
+static GLboolean isBlendFactor(GLenum factor, GLboolean source)
+{
+	switch (factor)
+	{
+		case GL_ZERO:
+		case GL_ONE:
+		case GL_SRC_COLOR:
+		case GL_ONE_MINUS_SRC_COLOR:
+		case GL_DST_COLOR:
+		case GL_ONE_MINUS_DST_COLOR:
+		case GL_SRC_ALPHA:
+		case GL_ONE_MINUS_SRC_ALPHA:
+		case GL_DST_ALPHA:
+		case GL_ONE_MINUS_DST_ALPHA:
+		case GL_CONSTANT_COLOR:
+		case GL_ONE_MINUS_CONSTANT_COLOR:
+		case GL_CONSTANT_ALPHA:
+		case GL_ONE_MINUS_CONSTANT_ALPHA:
+			return GL_TRUE;
+		case GL_SRC_ALPHA_SATURATE:
+			return source;
+		default:
+			return GL_FALSE;
+	}
+}
+
+static GLboolean isBlendEquation(GLenum equation)
+{
+	return GL_FUNC_ADD == equation || GL_FUNC_SUBTRACT == equation || GL_FUNC_REVERSE_SUBTRACT == equation;
+}
+
+static GLboolean isCompareFunction(GLenum function)
+{
+	return function >= GL_NEVER && function <= GL_ALWAYS;
+}
+
+static GLboolean isStencilOp(GLenum op)
+{
+	switch (op)
+	{
+		case GL_KEEP:
+		case GL_ZERO:
+		case GL_REPLACE:
+		case GL_INCR:
+		case GL_DECR:
+		case GL_INVERT:
+		case GL_INCR_WRAP:
+		case GL_DECR_WRAP:
+			return GL_TRUE;
+		default:
+			return GL_FALSE;
+	}
+}
+
+static GLsizei attribTypeSize(GLenum type)
+{
+	switch (type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_FLOAT:
+		case GL_FIXED:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+static PGResult invalid(const char *what)
+{
+	pgLog(PGL_Error, "Invalid pipeline: %s.", what);
+	return PGR_InvalidPipeline;
+}
+
+static PGResult validate(const PGPipelineDesc *desc)
+{
+	if (!pgProgramIsValid(desc->program)) return PGR_InvalidProgram;
+
+	const PGBlendState *b = &desc->blend;
+	if (!isBlendFactor(b->sourceColour, GL_TRUE) || !isBlendFactor(b->sourceAlpha, GL_TRUE)
+		|| !isBlendFactor(b->destinationColour, GL_FALSE) || !isBlendFactor(b->destinationAlpha, GL_FALSE))
+	{
+		return invalid("blend factor");
+	}
+	if (!isBlendEquation(b->colourEquation) || !isBlendEquation(b->alphaEquation)) return invalid("blend equation");
+
+	const PGDepthStencilState *d = &desc->depthStencil;
+	if (!isCompareFunction(d->depthFunction)) return invalid("depth function");
+	if (!isCompareFunction(d->stencilFunction)) return invalid("stencil function");
+	if (!isStencilOp(d->stencilFail) || !isStencilOp(d->depthFail) || !isStencilOp(d->stencilPass)) return invalid("stencil operation");
+
+	const PGRasterState *r = &desc->raster;
+	if (0 != r->cullFace && GL_FRONT != r->cullFace && GL_BACK != r->cullFace && GL_FRONT_AND_BACK != r->cullFace) return invalid("cull face");
+	if (GL_CW != r->frontFace && GL_CCW != r->frontFace) return invalid("front face");
+
+	const PGVertexLayout *l = &desc->layout;
+	if (l->attribCount < 0 || l->attribCount > PG_MAX_MESH_ATTRIBS || (l->attribCount > 0 && (NULL == l->attribs || l->stride <= 0)))
+	{
+		return invalid("vertex layout");
+	}
+	GLsizei found = 0;
+	for (GLsizei i = 0; i < l->attribCount; i++)
+	{
+		const PGVertexAttrib *a = &l->attribs[i];
+		if (NULL == a->name || '\0' == a->name[0] || strlen(a->name) >= PG_MAX_ATTRIB_NAME) return invalid("attribute name");
+		for (GLsizei j = 0; j < i; j++)
+		{
+			if (0 == strcmp(a->name, l->attribs[j].name)) return invalid("attribute named twice");
+		}
+		GLsizei typeSize = attribTypeSize(a->type);
+		if (0 == typeSize || a->size < 1 || a->size > 4) return invalid("attribute type");
+		if (a->offset < 0 || a->offset + a->size * typeSize > l->stride) return invalid("attribute outside the vertex");
+
+		if (pgProgramAttribLocation(desc->program, a->name) >= 0) found++;
+	}
+	if (l->attribCount > 0 && 0 == found)
+	{
+		pgLog(PGL_Error, "Invalid pipeline: the program has none of the layout's attributes.");
+		return PGR_MissingAttribute;
+	}
+	return PGR_OK;
+}
+
+// Keys are built field by field, as copying whole structs would copy
+// whatever is in their padding
+
+static void buildKey(struct PGPipelineKey *key, const PGPipelineDesc *desc)
+{
+	memset(key, 0, sizeof(struct PGPipelineKey));
+	key->program = desc->program;
+
+	const PGBlendState *b = &desc->blend;
+	key->blend.enabled = b->enabled ? GL_TRUE : GL_FALSE;
+	key->blend.sourceColour = b->sourceColour;
+	key->blend.destinationColour = b->destinationColour;
+	key->blend.sourceAlpha = b->sourceAlpha;
+	key->blend.destinationAlpha = b->destinationAlpha;
+	key->blend.colourEquation = b->colourEquation;
+	key->blend.alphaEquation = b->alphaEquation;
+	for (int i = 0; i < 4; i++)
+	{
+		key->blend.colourMask[i] = b->colourMask[i] ? GL_TRUE : GL_FALSE;
+	}
+
+	const PGDepthStencilState *d = &desc->depthStencil;
+	key->depthStencil.depthTest = d->depthTest ? GL_TRUE : GL_FALSE;
+	key->depthStencil.depthWrite = d->depthWrite ? GL_TRUE : GL_FALSE;
+	key->depthStencil.depthFunction = d->depthFunction;
+	key->depthStencil.stencilTest = d->stencilTest ? GL_TRUE : GL_FALSE;
+	key->depthStencil.stencilFunction = d->stencilFunction;
+	key->depthStencil.stencilReference = d->stencilReference;
+	key->depthStencil.stencilReadMask = d->stencilReadMask;
+	key->depthStencil.stencilWriteMask = d->stencilWriteMask;
+	key->depthStencil.stencilFail = d->stencilFail;
+	key->depthStencil.depthFail = d->depthFail;
+	key->depthStencil.stencilPass = d->stencilPass;
+
+	const PGRasterState *r = &desc->raster;
+	key->raster.cullFace = r->cullFace;
+	key->raster.frontFace = r->frontFace;
+	key->raster.scissorTest = r->scissorTest ? GL_TRUE : GL_FALSE;
+	key->raster.polygonOffsetFactor = r->polygonOffsetFactor;
+	key->raster.polygonOffsetUnits = r->polygonOffsetUnits;
+
+	const PGVertexLayout *l = &desc->layout;
+	key->stride = l->stride;
+	key->attribCount = l->attribCount;
+	for (GLsizei i = 0; i < l->attribCount; i++)
+	{
+		strncpy(key->attribs[i].name, l->attribs[i].name, PG_MAX_ATTRIB_NAME - 1);
+		key->attribs[i].size = l->attribs[i].size;
+		key->attribs[i].type = l->attribs[i].type;
+		key->attribs[i].normalized = l->attribs[i].normalized ? GL_TRUE : GL_FALSE;
+		key->attribs[i].offset = l->attribs[i].offset;
+	}
+}
+
+static void describe(struct PGPipelinePrivate *p)
+{
+	const struct PGPipelineKey *key = &p->key;
+	p->desc.program = key->program;
+	p->desc.blend = key->blend;
+	p->desc.depthStencil = key->depthStencil;
+	p->desc.raster = key->raster;
+	p->desc.layout.stride = key->stride;
+	p->desc.layout.attribCount = key->attribCount;
+	p->desc.layout.attribs = p->attribs;
+	for (GLsizei i = 0; i < key->attribCount; i++)
+	{
+		p->attribs[i].name = key->attribs[i].name;
+		p->attribs[i].size = key->attribs[i].size;
+		p->attribs[i].type = key->attribs[i].type;
+		p->attribs[i].normalized = key->attribs[i].normalized;
+		p->attribs[i].offset = key->attribs[i].offset;
+	}
+}
+
+// Pipelines /////////////////////////////////////////////////////////////////
+
+void pgPipelineDescDefaults(PGPipelineDesc *desc)
+{
+	if (NULL == desc) return;
+	memset(desc, 0, sizeof(PGPipelineDesc));
+
+	desc->program = PG_NULL_HANDLE;
+
+	PGBlendState *b = &desc->blend;
+	b->sourceColour = b->sourceAlpha = GL_ONE;
+	b->destinationColour = b->destinationAlpha = GL_ZERO;
+	b->colourEquation = b->alphaEquation = GL_FUNC_ADD;
+	b->colourMask[0] = b->colourMask[1] = b->colourMask[2] = b->colourMask[3] = GL_TRUE;
+
+	PGDepthStencilState *d = &desc->depthStencil;
+	d->depthWrite = GL_TRUE;
+	d->depthFunction = GL_LESS;
+	d->stencilFunction = GL_ALWAYS;
+	d->stencilReadMask = d->stencilWriteMask = ~0u;
+	d->stencilFail = d->depthFail = d->stencilPass = GL_KEEP;
+
+	desc->raster.frontFace = GL_CCW;
+}
+
+PGResult pgPipelineCreate(PGPipeline *pipeline, const PGPipelineDesc *desc)
+{
+	if (NULL == pipeline) return PGR_NullPointerBarf;
+	*pipeline = PG_NULL_HANDLE;
+	if (NULL == desc) return PGR_NullPointerBarf;
+
+	PGResult result = validate(desc);
+	if (PGR_OK != result) return result;
+
+	if (NULL == Pipelines)
+	{
+		result = pgHandlePoolCreate(&Pipelines, sizeof(struct PGPipelinePrivate), PGM_Renderer);
+		if (PGR_OK != result) return result;
+	}
+
+	struct PGPipelineKey key;
+	buildKey(&key, desc);
+	uint32_t hash = hashKey(&key);
+
+	uint32_t count = pgHandlePoolCount(Pipelines);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		struct PGPipelinePrivate *p = pgHandlePoolItemAt(Pipelines, i);
+		if (hash != p->hash || 0 != memcmp(&key, &p->key, sizeof(struct PGPipelineKey))) continue;
+
+		p->references++;
+		*pipeline = pgHandlePoolHandleAt(Pipelines, i);
+		return PGR_OK;
+	}
+
+	struct PGPipelinePrivate *p = NULL;
+	PGPipeline handle = pgHandlePoolAdd(Pipelines, (void **)&p);
+	if (NULL == p) return PGR_OutOfMemory;
+	p->key = key;
+	p->hash = hash;
+	p->references = 1;
+	describe(p);
+
+	p->layoutHash = pgVertexLayoutHash(p->desc.layout.stride, p->desc.layout.attribs, p->desc.layout.attribCount);
+	for (GLsizei i = 0; i < key.attribCount; i++)
+	{
+		p->locations[i] = pgProgramAttribLocation(key.program, key.attribs[i].name);
+	}
+
+	*pipeline = handle;
+	return PGR_OK;
+}
+
+void pgPipelineDestroy(PGPipeline *pipeline)
+{
+	if (NULL == pipeline || PG_NULL_HANDLE == *pipeline) return;
+
+	struct PGPipelinePrivate *p = lookupPipeline(*pipeline);
+	if (NULL != p && 0 == --p->references)
+	{
+		// The pool stays, like the mesh and program pools, so the generations
+		// keep renderers from taking a new pipeline for one they last bound
+		pgHandlePoolRemove(Pipelines, *pipeline);
+	}
+	*pipeline = PG_NULL_HANDLE;
+}
+
+int pgPipelineIsValid(PGPipeline pipeline)
+{
+	return pgHandlePoolIsValid(Pipelines, pipeline);
+}
+
+PGProgram pgPipelineProgram(PGPipeline pipeline)
+{
+	struct PGPipelinePrivate *p = lookupPipeline(pipeline);
+	return NULL != p ? p->key.program : PG_NULL_HANDLE;
+}
+
+uint32_t pgPipelineHash(PGPipeline pipeline)
+{
+	struct PGPipelinePrivate *p = lookupPipeline(pipeline);
+	return NULL != p ? p->hash : 0;
+}
+
+const PGPipelineDesc *pgPipelineDescription(PGPipeline pipeline)
+{
+	struct PGPipelinePrivate *p = lookupPipeline(pipeline);
+	if (NULL == p) return NULL;
+
+	describe(p);
+	return &p->desc;
+}
+
+const GLint *pgPipelineMeshLocations(PGPipeline pipeline, PGMesh mesh)
+{
+	struct PGPipelinePrivate *p = lookupPipeline(pipeline);
+	if (NULL == p || 0 == p->key.attribCount || p->layoutHash != pgMeshLayoutHash(mesh)) return NULL;
+
+	return p->locations;
+}
+
+unsigned long pgPipelineCount(void)
+{
+	return pgHandlePoolCount(Pipelines);
+}
+
+// Applying state ////////////////////////////////////////////////////////////
+
+static void enable(GLenum capability, GLboolean enabled)
+{
+	if (enabled) glEnable(capability);
+	else glDisable(capability);
+}
+
+unsigned long pgPipelineApplyState(const PGPipelineDesc *next, PGPipelineDesc *current, GLboolean force)
+{
+	if (NULL == next || NULL == current) return 0;
+	unsigned long calls = 0;
+
+	// State which only matters while its test is enabled is left alone
+	// otherwise, and `current` keeps what GL really has
+	const PGBlendState *nb = &next->blend;
+	PGBlendState *cb = &current->blend;
+	if (force || nb->enabled != cb->enabled)
+	{
+		enable(GL_BLEND, nb->enabled);
+		cb->enabled = nb->enabled;
+		calls++;
+	}
+	if (nb->enabled || force)
+	{
+		if (force || nb->sourceColour != cb->sourceColour || nb->destinationColour != cb->destinationColour
+			|| nb->sourceAlpha != cb->sourceAlpha || nb->destinationAlpha != cb->destinationAlpha)
+		{
+			glBlendFuncSeparate(nb->sourceColour, nb->destinationColour, nb->sourceAlpha, nb->destinationAlpha);
+			cb->sourceColour = nb->sourceColour;
+			cb->destinationColour = nb->destinationColour;
+			cb->sourceAlpha = nb->sourceAlpha;
+			cb->destinationAlpha = nb->destinationAlpha;
+			calls++;
+		}
+		if (force || nb->colourEquation != cb->colourEquation || nb->alphaEquation != cb->alphaEquation)
+		{
+			glBlendEquationSeparate(nb->colourEquation, nb->alphaEquation);
+			cb->colourEquation = nb->colourEquation;
+			cb->alphaEquation = nb->alphaEquation;
+			calls++;
+		}
+	}
+	if (force || 0 != memcmp(nb->colourMask, cb->colourMask, sizeof(nb->colourMask)))
+	{
+		glColorMask(nb->colourMask[0], nb->colourMask[1], nb->colourMask[2], nb->colourMask[3]);
+		memcpy(cb->colourMask, nb->colourMask, sizeof(nb->colourMask));
+		calls++;
+	}
+
+	const PGDepthStencilState *nd = &next->depthStencil;
+	PGDepthStencilState *cd = &current->depthStencil;
+	if (force || nd->depthTest != cd->depthTest)
+	{
+		enable(GL_DEPTH_TEST, nd->depthTest);
+		cd->depthTest = nd->depthTest;
+		calls++;
+	}
+	// The depth mask also limits glClear, so it is kept as asked for
+	if (force || nd->depthWrite != cd->depthWrite)
+	{
+		glDepthMask(nd->depthWrite);
+		cd->depthWrite = nd->depthWrite;
+		calls++;
+	}
+	if ((nd->depthTest || force) && (force || nd->depthFunction != cd->depthFunction))
+	{
+		glDepthFunc(nd->depthFunction);
+		cd->depthFunction = nd->depthFunction;
+		calls++;
+	}
+	if (force || nd->stencilTest != cd->stencilTest)
+	{
+		enable(GL_STENCIL_TEST, nd->stencilTest);
+		cd->stencilTest = nd->stencilTest;
+		calls++;
+	}
+	if (force || nd->stencilWriteMask != cd->stencilWriteMask)
+	{
+		glStencilMask(nd->stencilWriteMask);
+		cd->stencilWriteMask = nd->stencilWriteMask;
+		calls++;
+	}
+	if (nd->stencilTest || force)
+	{
+		if (force || nd->stencilFunction != cd->stencilFunction || nd->stencilReference != cd->stencilReference
+			|| nd->stencilReadMask != cd->stencilReadMask)
+		{
+			glStencilFunc(nd->stencilFunction, nd->stencilReference, nd->stencilReadMask);
+			cd->stencilFunction = nd->stencilFunction;
+			cd->stencilReference = nd->stencilReference;
+			cd->stencilReadMask = nd->stencilReadMask;
+			calls++;
+		}
+		if (force || nd->stencilFail != cd->stencilFail || nd->depthFail != cd->depthFail || nd->stencilPass != cd->stencilPass)
+		{
+			glStencilOp(nd->stencilFail, nd->depthFail, nd->stencilPass);
+			cd->stencilFail = nd->stencilFail;
+			cd->depthFail = nd->depthFail;
+			cd->stencilPass = nd->stencilPass;
+			calls++;
+		}
+	}
+
+	const PGRasterState *nr = &next->raster;
+	PGRasterState *cr = &current->raster;
+	GLboolean culling = 0 != nr->cullFace;
+	if (force || culling != (0 != cr->cullFace))
+	{
+		enable(GL_CULL_FACE, culling);
+		calls++;
+	}
+	if (culling && (force || nr->cullFace != cr->cullFace))
+	{
+		glCullFace(nr->cullFace);
+		calls++;
+	}
+	cr->cullFace = nr->cullFace;
+	if (force || nr->frontFace != cr->frontFace)
+	{
+		glFrontFace(nr->frontFace);
+		cr->frontFace = nr->frontFace;
+		calls++;
+	}
+	if (force || nr->scissorTest != cr->scissorTest)
+	{
+		enable(GL_SCISSOR_TEST, nr->scissorTest);
+		cr->scissorTest = nr->scissorTest;
+		calls++;
+	}
+	GLboolean offset = 0.0f != nr->polygonOffsetFactor || 0.0f != nr->polygonOffsetUnits;
+	GLboolean wasOffset = 0.0f != cr->polygonOffsetFactor || 0.0f != cr->polygonOffsetUnits;
+	if (force || offset != wasOffset)
+	{
+		enable(GL_POLYGON_OFFSET_FILL, offset);
+		calls++;
+	}
+	if (force || (offset && (nr->polygonOffsetFactor != cr->polygonOffsetFactor || nr->polygonOffsetUnits != cr->polygonOffsetUnits)))
+	{
+		glPolygonOffset(nr->polygonOffsetFactor, nr->polygonOffsetUnits);
+		calls++;
+	}
+	cr->polygonOffsetFactor = nr->polygonOffsetFactor;
+	cr->polygonOffsetUnits = nr->polygonOffsetUnits;
+
+	return calls;
+}
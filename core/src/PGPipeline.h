@@ -0,0 +1,137 @@
+//
+//  PGPipeline.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGPipeline_h
+#define PGPipeline_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	typedef struct
+	{
+		GLboolean enabled;
+		GLenum sourceColour;		// glBlendFuncSeparate factors
+		GLenum destinationColour;
+		GLenum sourceAlpha;
+		GLenum destinationAlpha;
+		GLenum colourEquation;		// GL_FUNC_ADD, GL_FUNC_SUBTRACT or GL_FUNC_REVERSE_SUBTRACT
+		GLenum alphaEquation;
+		GLboolean colourMask[4];	// Applies whether blending or not
+	}
+	PGBlendState;
+
+	typedef struct
+	{
+		GLboolean depthTest;
+		GLboolean depthWrite;
+		GLenum depthFunction;
+		GLboolean stencilTest;
+		GLenum stencilFunction;		// For both faces
+		GLint stencilReference;
+		GLuint stencilReadMask;
+		GLuint stencilWriteMask;
+		GLenum stencilFail;
+		GLenum depthFail;
+		GLenum stencilPass;
+	}
+	PGDepthStencilState;
+
+	typedef struct
+	{
+		GLenum cullFace;			// GL_FRONT, GL_BACK, GL_FRONT_AND_BACK, or 0 to cull nothing
+		GLenum frontFace;
+		GLboolean scissorTest;
+		GLfloat polygonOffsetFactor;	// Polygon offset is enabled unless both are 0
+		GLfloat polygonOffsetUnits;
+	}
+	PGRasterState;
+
+	/**
+	 * The vertices the pipeline draws, laid out as for pgMeshCreate. The
+	 * attributes are copied.
+	 */
+	typedef struct
+	{
+		GLsizei stride;
+		const PGVertexAttrib *attribs;
+		GLsizei attribCount;
+	}
+	PGVertexLayout;
+
+	/**
+	 * Start from pgPipelineDescDefaults, as a zeroed description masks
+	 * every colour channel out.
+	 */
+	typedef struct
+	{
+		PGProgram program;
+		PGBlendState blend;
+		PGDepthStencilState depthStencil;
+		PGRasterState raster;
+		PGVertexLayout layout;
+	}
+	PGPipelineDesc;
+
+	/**
+	 * Immutable bundles of everything needed to draw a material: the
+	 * program, fixed function state and vertex layout.
+	 *
+	 * Descriptions are checked when the pipeline is made, and identical
+	 * ones share a pipeline, found by hash, which is counted and destroyed
+	 * when the last user destroys it. pgRendererBindPipeline compares the
+	 * pipeline with the state the renderer last set and only makes the GL
+	 * calls for what differs. Meshes laid out as the pipeline says bind
+	 * their attributes at locations looked up when it was made.
+	 *
+	 * Pipelines belong to the GL thread.
+	 */
+
+	/**
+	 * GL's own initial state, with no program or vertex layout.
+	 */
+	void pgPipelineDescDefaults(PGPipelineDesc *desc);
+
+	PGResult pgPipelineCreate(PGPipeline *pipeline, const PGPipelineDesc *desc);
+	void pgPipelineDestroy(PGPipeline *pipeline);
+	int pgPipelineIsValid(PGPipeline pipeline);
+
+	PGProgram pgPipelineProgram(PGPipeline pipeline);
+	uint32_t pgPipelineHash(PGPipeline pipeline);
+
+	/**
+	 * The pipeline's copy of its description. Attribute names point into
+	 * the pipeline, and the pointer is good until a pipeline is next
+	 * created or destroyed.
+	 */
+	const PGPipelineDesc *pgPipelineDescription(PGPipeline pipeline);
+
+	/**
+	 * The attribute locations in the program of a mesh with the pipeline's
+	 * layout, or NULL if the mesh is laid out differently. Good for as
+	 * long as pgPipelineDescription's pointer.
+	 */
+	const GLint *pgPipelineMeshLocations(PGPipeline pipeline, PGMesh mesh);
+
+	/**
+	 * Makes the GL calls to go from the blend, depth, stencil and raster
+	 * state in `current` to that in `next`, or to set all of it if `force`,
+	 * and updates `current`. Returns the number of calls made.
+	 * pgRendererBindPipeline calls this.
+	 */
+	unsigned long pgPipelineApplyState(const PGPipelineDesc *next, PGPipelineDesc *current, GLboolean force);
+
+	/**
+	 * Pipelines live now, counting each shared one once.
+	 */
+	unsigned long pgPipelineCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
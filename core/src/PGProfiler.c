@@ -0,0 +1,355 @@
+//
+//  PGProfiler.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#ifndef DISABLE_pgProfile
+
+#define RING_MASK (PG_PROFILE_RING_SIZE - 1)
+#define THREAD_NAME_SIZE 32
+#define GPU_THREAD_ID 0
+
+// Marks a GPU zone nested inside another, which isn't timed
+#define GPU_ZONE_UNTIMED UINT64_MAX
+
+struct PGProfileEvent {
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+};
+
+/**
+ * One per thread which has made a zone. The owning thread only moves
+ * head and pgProfilerFrame only moves tail, so neither needs a lock.
+ * Rings are never freed, as a thread may exit with events still in its
+ * ring.
+ */
+struct PGProfileRing {
+	struct PGProfileEvent events[PG_PROFILE_RING_SIZE];
+	unsigned long head;
+	unsigned long tail;
+	unsigned long dropped;
+	int threadId;
+	int named;
+	char name[THREAD_NAME_SIZE];
+	struct PGProfileRing *next;
+};
+
+volatile int _pgProfileRecording;
+
+static FILE *Profile;
+static uint64_t ProfileStart;
+static struct PGProfileRing *Rings;
+static int NextThreadId = GPU_THREAD_ID + 1;
+static __thread struct PGProfileRing *ThreadRing;
+
+#ifdef GL_EXT_disjoint_timer_query
+struct PGGpuZone {
+	const char *name;
+	uint64_t start;
+};
+
+static int GpuSupport = -1;
+static int GpuDepth;
+static GLuint GpuQueries[PG_PROFILE_GPU_QUERIES];
+static struct PGGpuZone GpuZones[PG_PROFILE_GPU_QUERIES];
+static unsigned long GpuHead;
+static unsigned long GpuTail;
+#endif
+static unsigned long GpuDropped;
+
+// Writing ///////////////////////////////////////////////////////////////////
+
+static void writeString(const char *string)
+{
+	fputc('"', Profile);
+	for (const char *c = string; *c; c++)
+	{
+		if ('"' == *c || '\\' == *c) fputc('\\', Profile);
+		if ((unsigned char)*c >= ' ') fputc(*c, Profile);
+	}
+	fputc('"', Profile);
+}
+
+static void writeThreadName(int threadId, const char *name)
+{
+	fprintf(Profile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", threadId);
+	writeString(name);
+	fputs("}}", Profile);
+}
+
+static void writeEvent(int threadId, const char *name, uint64_t start, uint64_t duration)
+{
+	// Chrome wants microseconds
+	double ts = (double)(int64_t)(start - ProfileStart) / 1000.0;
+	fputs(",\n{\"name\":", Profile);
+	writeString(name);
+	fprintf(Profile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", threadId, ts, duration / 1000.0);
+}
+
+// CPU zones /////////////////////////////////////////////////////////////////
+
+static struct PGProfileRing *threadRing(const char *name)
+{
+	if (NULL != ThreadRing) return ThreadRing;
+
+	struct PGProfileRing *ring = pgMemAlloc(sizeof(struct PGProfileRing), PGM_Profiler);
+	if (NULL == ring) return NULL;
+	memset(ring, 0, sizeof(struct PGProfileRing));
+
+	ring->threadId = __atomic_fetch_add(&NextThreadId, 1, __ATOMIC_RELAXED);
+	if (NULL != name) strncpy(ring->name, name, sizeof(ring->name) - 1);
+	else snprintf(ring->name, sizeof(ring->name), "Thread %d", ring->threadId);
+
+	ring->next = __atomic_load_n(&Rings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&Rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+	}
+
+	ThreadRing = ring;
+	return ring;
+}
+
+PGProfileZone _pgProfileZoneBeginRecording(const char *name)
+{
+	PGProfileZone zone = { name, pgStatsNowNanoseconds() };
+	return zone;
+}
+
+void _pgProfileZoneEndRecording(PGProfileZone *zone)
+{
+	uint64_t end = pgStatsNowNanoseconds();
+	struct PGProfileRing *ring = threadRing(NULL);
+	if (NULL == ring) return;
+
+	unsigned long head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= PG_PROFILE_RING_SIZE)
+	{
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	struct PGProfileEvent *event = &ring->events[head & RING_MASK];
+	event->name = zone->name;
+	event->start = zone->start;
+	event->duration = end - zone->start;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void pgProfilerSetThreadName(const char *name)
+{
+	if (NULL == name) return;
+	
+	// The name is only read once the ring is published, so it can't be
+	// changed afterwards
+	if (NULL != ThreadRing)
+	{
+		pgLog(PGL_Warn, "Profiler thread %d is already named %s.", ThreadRing->threadId, ThreadRing->name);
+		return;
+	}
+	threadRing(name);
+}
+
+/**
+ * Writes out every ring's events. With `discard` they're thrown away
+ * instead, to lose whatever was left over from an earlier profile.
+ */
+static void drainRings(GLboolean discard)
+{
+	for (struct PGProfileRing *ring = __atomic_load_n(&Rings, __ATOMIC_ACQUIRE); NULL != ring; ring = ring->next)
+	{
+		unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (!discard)
+		{
+			if (!ring->named)
+			{
+				writeThreadName(ring->threadId, ring->name);
+				__atomic_store_n(&ring->named, 1, __ATOMIC_RELEASE);
+			}
+			for (unsigned long i = ring->tail; i != head; i++)
+			{
+				const struct PGProfileEvent *event = &ring->events[i & RING_MASK];
+				writeEvent(ring->threadId, event->name, event->start, event->duration);
+			}
+		}
+		__atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+	}
+}
+
+// GPU zones /////////////////////////////////////////////////////////////////
+
+#ifdef GL_EXT_disjoint_timer_query
+static int gpuSupported(void)
+{
+	if (GpuSupport >= 0) return GpuSupport;
+
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	GpuSupport = NULL != extensions && NULL != strstr(extensions, "GL_EXT_disjoint_timer_query");
+#ifdef PG_GL_LOADS_EXTENSIONS
+	if (NULL == pgglGenQueriesEXT || NULL == pgglBeginQueryEXT || NULL == pgglGetQueryObjectui64vEXT)
+	{
+		GpuSupport = 0;
+	}
+#endif
+	if (GpuSupport)
+	{
+		glGenQueriesEXT(PG_PROFILE_GPU_QUERIES, GpuQueries);
+		writeThreadName(GPU_THREAD_ID, "GPU");
+	}
+	return GpuSupport;
+}
+#endif
+
+PGProfileZone _pgProfileGpuZoneBeginRecording(const char *name)
+{
+	PGProfileZone zone = { NULL, 0 };
+#ifdef GL_EXT_disjoint_timer_query
+	if (!gpuSupported()) return zone;
+
+	zone.name = name;
+	zone.start = GPU_ZONE_UNTIMED;
+	if (GpuDepth++ > 0) return zone;
+
+	if (GpuHead - GpuTail >= PG_PROFILE_GPU_QUERIES)
+	{
+		GpuDropped++;
+		return zone;
+	}
+
+	zone.start = pgStatsNowNanoseconds();
+	glBeginQueryEXT(GL_TIME_ELAPSED_EXT, GpuQueries[GpuHead % PG_PROFILE_GPU_QUERIES]);
+#endif
+	return zone;
+}
+
+void _pgProfileGpuZoneEndRecording(PGProfileZone *zone)
+{
+#ifdef GL_EXT_disjoint_timer_query
+	GpuDepth--;
+	if (GPU_ZONE_UNTIMED == zone->start) return;
+
+	glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+	struct PGGpuZone *gpuZone = &GpuZones[GpuHead % PG_PROFILE_GPU_QUERIES];
+	gpuZone->name = zone->name;
+	gpuZone->start = zone->start;
+	GpuHead++;
+#endif
+}
+
+/**
+ * Writes out GPU zones in the order they were made, stopping at the first
+ * the GPU hasn't finished unless told to wait.
+ */
+static void collectGpuZones(GLboolean wait)
+{
+#ifdef GL_EXT_disjoint_timer_query
+	if (GpuHead == GpuTail) return;
+
+	// A disjoint operation, such as a clock change, invalidates anything
+	// timed since the last check
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+	for (; GpuTail != GpuHead; GpuTail++)
+	{
+		GLuint query = GpuQueries[GpuTail % PG_PROFILE_GPU_QUERIES];
+		if (!wait)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+			if (!available) break;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT_EXT, &elapsed);
+
+		// A zone can't have taken longer than the time since it was
+		// submitted. Some drivers (llvmpipe) report a timestamp rather
+		// than the elapsed time for their first query.
+		const struct PGGpuZone *zone = &GpuZones[GpuTail % PG_PROFILE_GPU_QUERIES];
+		if (disjoint || elapsed > pgStatsNowNanoseconds() - zone->start) GpuDropped++;
+		else writeEvent(GPU_THREAD_ID, zone->name, zone->start, elapsed);
+	}
+#endif
+}
+
+// Profile ///////////////////////////////////////////////////////////////////
+
+PGResult pgProfilerBegin(const char *path)
+{
+	if (NULL == path) return PGR_NullPointerBarf;
+	pgProfilerEnd();
+
+	Profile = fopen(path, "w");
+	if (NULL == Profile)
+	{
+		pgLog(PGL_Error, "Could not open profile %s.", path);
+		return PGR_CouldNotReadFile;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", Profile);
+	fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Pictogram\"}}", Profile);
+
+	drainRings(GL_TRUE);
+	for (struct PGProfileRing *ring = __atomic_load_n(&Rings, __ATOMIC_ACQUIRE); NULL != ring; ring = ring->next)
+	{
+		__atomic_store_n(&ring->named, 0, __ATOMIC_RELEASE);
+		__atomic_store_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+	}
+	GpuDropped = 0;
+
+	ProfileStart = pgStatsNowNanoseconds();
+	_pgProfileRecording = 1;
+	return PGR_OK;
+}
+
+void pgProfilerEnd(void)
+{
+	if (NULL == Profile) return;
+
+	_pgProfileRecording = 0;
+	collectGpuZones(GL_TRUE);
+	drainRings(GL_FALSE);
+
+	fputs("\n]}\n", Profile);
+	fclose(Profile);
+	Profile = NULL;
+
+#ifdef GL_EXT_disjoint_timer_query
+	if (GpuSupport > 0) glDeleteQueriesEXT(PG_PROFILE_GPU_QUERIES, GpuQueries);
+	GpuSupport = -1;
+	GpuDepth = 0;
+	GpuHead = GpuTail = 0;
+#endif
+}
+
+void pgProfilerFrame(void)
+{
+	if (NULL == Profile) return;
+
+	collectGpuZones(GL_FALSE);
+	drainRings(GL_FALSE);
+}
+
+int pgProfilerIsRecording(void)
+{
+	return NULL != Profile;
+}
+
+unsigned long pgProfilerDropped(void)
+{
+	unsigned long dropped = GpuDropped;
+	for (struct PGProfileRing *ring = __atomic_load_n(&Rings, __ATOMIC_ACQUIRE); NULL != ring; ring = ring->next)
+	{
+		dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+	}
+	return dropped;
+}
+
+#endif
@@ -0,0 +1,138 @@
+//
+//  PGProfiler.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGProfiler_h
+#define PGProfiler_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Frame profiler, written out as Chrome trace events (load the file in
+	 * chrome://tracing).
+	 *
+	 * CPU zones time the rest of the enclosing scope:
+	 *
+	 *     void drawScene(void)
+	 *     {
+	 *         pgProfileZone("drawScene");
+	 *         ...
+	 *     }
+	 *
+	 * Each thread writes its zones into its own ring, without locks, and
+	 * pgProfilerFrame moves them to the file. Zone names must be string
+	 * literals, or otherwise outlive the profile. Zones which find their
+	 * ring full are dropped and counted.
+	 *
+	 * GPU zones, pgProfileGpuZone, use EXT_disjoint_timer_query and must
+	 * only be made on the GL thread. The results are collected by later
+	 * calls to pgProfilerFrame once the GPU has them, so nothing waits.
+	 * Timer queries can't nest, so only the outermost GPU zone is timed.
+	 * GPU zones are placed on the timeline at the CPU time they were
+	 * submitted. Without the extension they're ignored.
+	 *
+	 * Building with DISABLE_pgProfile compiles all of it away.
+	 */
+	#define PG_PROFILE_RING_SIZE 4096		// Power of two
+	#define PG_PROFILE_GPU_QUERIES 256
+
+	typedef struct
+	{
+		const char *name;
+		uint64_t start;
+	}
+	PGProfileZone;
+
+#ifdef DISABLE_pgProfile
+#	define pgProfileZone(name) ;
+#	define pgProfileGpuZone(name) ;
+#	define pgProfilerBegin(path) PGR_Unsupported
+#	define pgProfilerEnd() ;
+#	define pgProfilerFrame() ;
+#	define pgProfilerSetThreadName(name) ;
+#	define pgProfilerIsRecording() 0
+#	define pgProfilerDropped() 0ul
+#else
+#	define PG_PROFILE_CONCAT_(a, b) a##b
+#	define PG_PROFILE_CONCAT(a, b) PG_PROFILE_CONCAT_(a, b)
+#	define pgProfileZone(name) \
+		PGProfileZone PG_PROFILE_CONCAT(pgZone, __LINE__) __attribute__((cleanup(_pgProfileZoneEnd))) = _pgProfileZoneBegin(name)
+#	define pgProfileGpuZone(name) \
+		PGProfileZone PG_PROFILE_CONCAT(pgGpuZone, __LINE__) __attribute__((cleanup(_pgProfileGpuZoneEnd))) = _pgProfileGpuZoneBegin(name)
+
+	extern volatile int _pgProfileRecording;
+
+	PGProfileZone _pgProfileZoneBeginRecording(const char *name);
+	void _pgProfileZoneEndRecording(PGProfileZone *zone);
+	PGProfileZone _pgProfileGpuZoneBeginRecording(const char *name);
+	void _pgProfileGpuZoneEndRecording(PGProfileZone *zone);
+
+	// Zones cost a flag test while nothing is recording
+	static inline PGProfileZone _pgProfileZoneBegin(const char *name)
+	{
+		if (_pgProfileRecording) return _pgProfileZoneBeginRecording(name);
+		PGProfileZone none = { NULL, 0 };
+		return none;
+	}
+
+	static inline void _pgProfileZoneEnd(PGProfileZone *zone)
+	{
+		if (NULL != zone->name) _pgProfileZoneEndRecording(zone);
+	}
+
+	static inline PGProfileZone _pgProfileGpuZoneBegin(const char *name)
+	{
+		if (_pgProfileRecording) return _pgProfileGpuZoneBeginRecording(name);
+		PGProfileZone none = { NULL, 0 };
+		return none;
+	}
+
+	static inline void _pgProfileGpuZoneEnd(PGProfileZone *zone)
+	{
+		if (NULL != zone->name) _pgProfileGpuZoneEndRecording(zone);
+	}
+
+	/**
+	 * Starts writing a profile to `path`, replacing any profile already
+	 * open. Call on the GL thread.
+	 */
+	PGResult pgProfilerBegin(const char *path);
+
+	/**
+	 * Waits for outstanding GPU zones, writes everything recorded and
+	 * closes the file. Call on the GL thread.
+	 */
+	void pgProfilerEnd(void);
+
+	/**
+	 * Collects finished GPU zones and writes out what every thread has
+	 * recorded. pgRendererBeginFrame calls this.
+	 */
+	void pgProfilerFrame(void);
+
+	/**
+	 * Names the calling thread in the profile. Call before the thread
+	 * makes its first zone.
+	 */
+	void pgProfilerSetThreadName(const char *name);
+
+	int pgProfilerIsRecording(void);
+
+	/**
+	 * Zones lost to full rings or to the GPU being disjoint.
+	 */
+	unsigned long pgProfilerDropped(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
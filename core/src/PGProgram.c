@@ -16,12 +16,24 @@ struct PGProgramVariable {
 	GLint location;     /* variable's location               */
 	GLint size;
 	GLenum type;
+	GLuint index;       /* index of the active variable      */
+	GLint blockIndex;   /* uniform block, or -1              */
+	GLint offset;       /* bytes into the block, or -1       */
+	GLint arrayStride;
 	char name[UNKNOWN]; /* variable's name. Key for the hash. Actual size made by magic */
 };
+
+struct PGProgramBlock {
+	UT_hash_handle hh;
+	GLuint index;
+	GLint size;         /* bytes the block's buffer needs    */
+	GLint binding;      /* binding point, -1 until set       */
+	char name[UNKNOWN];
+};
 #undef UNKNOWN
 
 struct PGProgramPrivate {
-	GLuint program; /* This must always be the first member so we can masquerade as a GLuint pointer */
+	GLuint program;
 	GLuint vertexShader;
 	GLuint fragmentShader;
 	
@@ -31,6 +43,7 @@ struct PGProgramPrivate {
 	
 	struct PGProgramVariable *attributesHash;
 	struct PGProgramVariable *uniformsHash;
+	struct PGProgramBlock *blocksHash;
 };
 
 /**
@@ -40,6 +53,19 @@ struct PGProgramPrivate {
 typedef void (*GetActiveVariableFn)(GLuint, GLuint, GLsizei, GLsizei *, GLint *, GLenum *, GLchar *);
 typedef GLint (*GetVariableLocationFn)(GLuint, const GLchar *);
 
+// Every live program. Only touched from the GL thread.
+static PGHandlePool Programs;
+
+static struct PGProgramPrivate *lookupProgram(PGProgram program)
+{
+	struct PGProgramPrivate *p = pgHandlePoolGet(Programs, program);
+	if (NULL == p && PG_NULL_HANDLE != program)
+	{
+		pgLog(PGL_Warn, "Stale program handle 0x%08x.", program);
+	}
+	return p;
+}
+
 static PGResult pgCompileShaderString(GLuint *outShader, GLenum type, const char *source, GLchar **outLog)
 {
 	if (NULL == outShader)
@@ -63,14 +89,19 @@ static PGResult pgCompileShaderString(GLuint *outShader, GLenum type, const char
 		GLint logLength;
 		GLchar *log = NULL;
 		glGetShaderiv(*outShader, GL_INFO_LOG_LENGTH, &logLength);
+		log = (GLchar *)pgMemAlloc((logLength > 0 ? logLength : 1) * sizeof(GLchar), PGM_Log);
+		if (NULL == log)
+		{
+			glDeleteShader(*outShader);
+			*outShader = 0;
+			return PGR_OutOfMemory;
+		}
 		if (logLength > 0) 
 		{
-			log = (GLchar *)malloc(logLength * sizeof(GLchar));
 			glGetShaderInfoLog(*outShader, logLength, &logLength, log);
 		}
 		else 
 		{
-			log = (GLchar *)malloc(sizeof(GLchar));
 			log[0] = 0;
 		}
 		*outLog = log;
@@ -132,7 +163,8 @@ static PGResult pgLinkProgram(GLuint program, GLuint vertexShader, GLuint fragme
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
 		if (logLength > 0) 
 		{
-			log = (GLchar *)malloc(logLength * sizeof(GLchar));
+			log = (GLchar *)pgMemAlloc(logLength * sizeof(GLchar), PGM_Log);
+			if (NULL == log) return PGR_OutOfMemory;
 			glGetProgramInfoLog(program, logLength, &logLength, log);
 		}
 		*outLog = log;
@@ -148,6 +180,8 @@ static PGResult pgLinkProgram(GLuint program, GLuint vertexShader, GLuint fragme
 	return PGR_OK;
 }
 
+static PGProgramLookupCounts LookupCounts;
+
 static GLint pgProgramVariableLocation(struct PGProgramVariable *hash, const char* name)
 {
 	if (NULL == hash || NULL == name) return -1;
@@ -157,10 +191,12 @@ static GLint pgProgramVariableLocation(struct PGProgramVariable *hash, const cha
 	
 	if (NULL == var )
 	{
+		pgStatsCount(&LookupCounts, misses, 1);
 		return -1;
 	}
 	else 
 	{
+		pgStatsCount(&LookupCounts, hits, 1);
 		return var->location;
 	}
 }
@@ -210,13 +246,13 @@ static void destroyProgramVariablesHash(struct PGProgramVariable **hash_)
 		HASH_ITER(hh, hash, current, temp) 
 		{
 			HASH_DEL(hash, current);
-			free(current);
+			pgMemFree(current);
 		}
 		*hash_ = hash;
 	}
 }
 
-static void extractVariables(GLuint program, struct PGProgramVariable **hash_, GetActiveVariableFn get, GetVariableLocationFn loc, GLint numVariables, GLint maxVariableLength)
+static PGResult extractVariables(GLuint program, struct PGProgramVariable **hash_, GetActiveVariableFn get, GetVariableLocationFn loc, GLint numVariables, GLint maxVariableLength)
 {
 	destroyProgramVariablesHash(hash_);
 	
@@ -235,10 +271,19 @@ static void extractVariables(GLuint program, struct PGProgramVariable **hash_, G
 			if (nameLength > 0)
 			{
 				size_t recordSize = offsetof(struct PGProgramVariable, name) + nameLength + 1; /* nul */
-				struct PGProgramVariable *var = malloc(recordSize);
+				struct PGProgramVariable *var = pgMemAlloc(recordSize, PGM_Program);
+				if (NULL == var)
+				{
+					destroyProgramVariablesHash(&hash);
+					*hash_ = hash;
+					return PGR_OutOfMemory;
+				}
 				memset(var, 0, recordSize);
 				var->location = loc(program, name);
 				var->size = size;
+				var->index = attrIndex;
+				var->blockIndex = -1;
+				var->offset = -1;
 				if (var->size > 1)
 				{
 					pgLog(PGL_Warn, "%s is an array or struct. Pictogram doesn't handle those well yet - you will have to use traditional GL functions to manipulate it.", name);
@@ -255,49 +300,157 @@ static void extractVariables(GLuint program, struct PGProgramVariable **hash_, G
 		}
 		*hash_ = hash;
 	}
+	return PGR_OK;
 }
 
-PGResult pgProgramCreateAndBuild(PGProgram *program, const char *vertexSource, const char *fragmentSource)
+static void destroyProgramBlocksHash(struct PGProgramBlock **hash_)
 {
-	// Sanitise the params /////////////////////////////////////////////////
-	if (NULL == program) return PGR_NullPointerBarf;
-	*program = NULL;
-	
-	if (NULL == vertexSource || NULL == fragmentSource) return PGR_NullPointerBarf;
+	struct PGProgramBlock *current, *temp, *hash = *hash_;
+	HASH_ITER(hh, hash, current, temp)
+	{
+		HASH_DEL(hash, current);
+		pgMemFree(current);
+	}
+	*hash_ = hash;
+}
+
+static void extractBlocks(struct PGProgramPrivate *p)
+{
+	destroyProgramBlocksHash(&p->blocksHash);
+
+#ifdef GL_ES_VERSION_3_0
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL == version || 0 != strncmp(version, "OpenGL ES 3", 11)) return;
+
+	GLint numBlocks = 0;
+	GLint blockNameMax = 0;
+	glGetProgramiv(p->program, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+	glGetProgramiv(p->program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &blockNameMax);
+	if (numBlocks <= 0 || blockNameMax <= 0) return;
+
+	struct PGProgramBlock *hash = p->blocksHash;
+	GLchar name[blockNameMax];
+	for (GLuint blockIndex = 0; blockIndex < numBlocks; blockIndex++)
+	{
+		GLsizei nameLength = 0;
+		glGetActiveUniformBlockName(p->program, blockIndex, blockNameMax, &nameLength, name);
+		if (nameLength <= 0)
+		{
+			pgLogAnyGlErrors("Failed to get active uniform block");
+			continue;
+		}
+
+		size_t recordSize = offsetof(struct PGProgramBlock, name) + nameLength + 1; /* nul */
+		struct PGProgramBlock *block = pgMemAlloc(recordSize, PGM_Program);
+		if (NULL == block) break;
+		memset(block, 0, recordSize);
+		// Asked by name, rather than trusting the loop, so traces can map
+		// the index to the one the replaying driver picks
+		block->index = glGetUniformBlockIndex(p->program, name);
+		block->binding = -1;
+		glGetActiveUniformBlockiv(p->program, block->index, GL_UNIFORM_BLOCK_DATA_SIZE, &block->size);
+		strncpy(block->name, name, nameLength + 1);
+		HASH_ADD_STR(hash, name, block);
+	}
+	p->blocksHash = hash;
+
+	// Where each uniform lives in its block's std140 layout
+	GLint count = HASH_COUNT(p->uniformsHash);
+	if (0 == count) return;
+
+	GLuint indices[count];
+	GLint blockIndices[count];
+	GLint offsets[count];
+	GLint strides[count];
+	struct PGProgramVariable *var;
+	GLint i = 0;
+	for (var = p->uniformsHash; NULL != var; var = var->hh.next)
+	{
+		indices[i++] = var->index;
+	}
+	glGetActiveUniformsiv(p->program, count, indices, GL_UNIFORM_BLOCK_INDEX, blockIndices);
+	glGetActiveUniformsiv(p->program, count, indices, GL_UNIFORM_OFFSET, offsets);
+	glGetActiveUniformsiv(p->program, count, indices, GL_UNIFORM_ARRAY_STRIDE, strides);
+	i = 0;
+	for (var = p->uniformsHash; NULL != var; var = var->hh.next, i++)
+	{
+		var->blockIndex = blockIndices[i];
+		var->offset = blockIndices[i] >= 0 ? offsets[i] : -1;
+		var->arrayStride = strides[i];
+	}
+#endif
+}
+
+PGResult pgProgramBuild(PGProgramBuild *build, const char *vertexSource, const char *fragmentSource)
+{
+	pgProfileZone(__func__);
 	
-	// Create the structure to hold the details ////////////////////////////
-	PGProgram p = malloc(sizeof(struct PGProgramPrivate));
-	if (NULL == p) return PGR_OutOfMemory;
-	*program = p;
-	memset(p, 0, sizeof(struct PGProgramPrivate));
+	if (NULL == build) return PGR_NullPointerBarf;
+	memset(build, 0, sizeof(PGProgramBuild));
+	build->result = PGR_NullPointerBarf;
+	if (NULL == vertexSource || NULL == fragmentSource) return build->result;
 	
 	// Load the shaders ////////////////////////////////////////////////////
 	pgLogAnyGlErrors("About to load shaders.");
-	PGResult result;
-	result = pgCompileShaderFile(&p->vertexShader, 
-								 GL_VERTEX_SHADER, 
-								 vertexSource, 
-								 &p->vertexShaderCompileLog);
-	if (PGR_OK != result) return result;
-
-	result = pgCompileShaderFile(&p->fragmentShader, 
-								 GL_FRAGMENT_SHADER, 
-								 fragmentSource, 
-								 &p->fragmentShaderCompileLog);
-	if (PGR_OK != result) return result;
+	build->result = pgCompileShaderFile(&build->vertexShader, 
+										GL_VERTEX_SHADER, 
+										vertexSource, 
+										&build->vertexShaderCompileLog);
+	if (PGR_OK != build->result) return build->result;
+
+	build->result = pgCompileShaderFile(&build->fragmentShader, 
+										GL_FRAGMENT_SHADER, 
+										fragmentSource, 
+										&build->fragmentShaderCompileLog);
+	if (PGR_OK != build->result) return build->result;
 
 	// Link the program ////////////////////////////////////////////////////
-    p->program = glCreateProgram();
-	if (0 == p->program)
+	build->program = glCreateProgram();
+	if (0 == build->program)
 	{
 		pgLogAnyGlErrors("Could not create new program.");
-		return PGR_CouldNotCreateNewProgram;
+		build->result = PGR_CouldNotCreateNewProgram;
+		return build->result;
 	}
 	
-	result = pgLinkProgram(p->program,
-						   p->vertexShader,
-						   p->fragmentShader,
-						   &p->programLinkLog);	
+	build->result = pgLinkProgram(build->program,
+								  build->vertexShader,
+								  build->fragmentShader,
+								  &build->programLinkLog);
+	return build->result;
+}
+
+PGResult pgProgramCreateFromBuild(PGProgram *program, PGProgramBuild *build)
+{
+	pgProfileZone(__func__);
+	
+	// Sanitise the params /////////////////////////////////////////////////
+	if (NULL == program) return PGR_NullPointerBarf;
+	*program = PG_NULL_HANDLE;
+	
+	if (NULL == build) return PGR_NullPointerBarf;
+	
+	// Create the structure to hold the details ////////////////////////////
+	if (NULL == Programs)
+	{
+		PGResult result = pgHandlePoolCreate(&Programs, sizeof(struct PGProgramPrivate), PGM_Program);
+		if (PGR_OK != result) return result;
+	}
+	
+	struct PGProgramPrivate *p = NULL;
+	*program = pgHandlePoolAdd(Programs, (void **)&p);
+	if (NULL == p) return PGR_OutOfMemory;
+	
+	// The program owns the build's objects and logs from here, even if it
+	// failed, so the logs can be read and destroying it cleans up
+	p->program = build->program;
+	p->vertexShader = build->vertexShader;
+	p->fragmentShader = build->fragmentShader;
+	p->programLinkLog = build->programLinkLog;
+	p->vertexShaderCompileLog = build->vertexShaderCompileLog;
+	p->fragmentShaderCompileLog = build->fragmentShaderCompileLog;
+	PGResult result = build->result;
+	memset(build, 0, sizeof(PGProgramBuild));
 	if (PGR_OK != result) return result;
 	
 	// Fetch the attributes ////////////////////////////////////////////////
@@ -306,35 +459,51 @@ PGResult pgProgramCreateAndBuild(PGProgram *program, const char *vertexSource, c
 	
 	glGetProgramiv(p->program, GL_ACTIVE_ATTRIBUTES, &numVars);
 	glGetProgramiv(p->program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &varNameMax);
-	extractVariables(p->program, &p->attributesHash, glGetActiveAttrib, glGetAttribLocation, numVars, varNameMax);
+	result = extractVariables(p->program, &p->attributesHash, glGetActiveAttrib, glGetAttribLocation, numVars, varNameMax);
+	if (PGR_OK != result) return result;
 	
 	glGetProgramiv(p->program, GL_ACTIVE_UNIFORMS, &numVars);
 	glGetProgramiv(p->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &varNameMax);
-	extractVariables(p->program, &p->uniformsHash, glGetActiveUniform, glGetUniformLocation, numVars, varNameMax);
+	result = extractVariables(p->program, &p->uniformsHash, glGetActiveUniform, glGetUniformLocation, numVars, varNameMax);
+	if (PGR_OK != result) return result;
+	extractBlocks(p);
 	
 	return PGR_OK;
 }
 
+PGResult pgProgramCreateAndBuild(PGProgram *program, const char *vertexSource, const char *fragmentSource)
+{
+	if (NULL == program) return PGR_NullPointerBarf;
+	*program = PG_NULL_HANDLE;
+	
+	if (NULL == vertexSource || NULL == fragmentSource) return PGR_NullPointerBarf;
+	
+	PGProgramBuild build;
+	pgProgramBuild(&build, vertexSource, fragmentSource);
+	return pgProgramCreateFromBuild(program, &build);
+}
+
 void pgProgramDestroy(PGProgram *program)
 {
 	if (NULL != program)
 	{
-		PGProgram p = *program;
-		
-		// Free the shaders and program ////////////////////////////////////
-		if (0 != p->vertexShader) glDeleteShader(p->vertexShader);
-		if (0 != p->fragmentShader) glDeleteShader(p->fragmentShader);
-		if (0 != p->program)
+		struct PGProgramPrivate *p = lookupProgram(*program);
+		if (NULL == p)
 		{
-			if (0 != p->vertexShader) glDetachShader(p->program, p->vertexShader);
-			if (0 != p->fragmentShader) glDetachShader(p->program, p->fragmentShader);
-			glDeleteProgram(p->program);
+			*program = PG_NULL_HANDLE;
+			return;
 		}
 		
+		// Free the shaders and program once queued frames are done with them.
+		// Deleting the program takes its attached shaders with it.
+		pgDeleteQueuePush(PGD_Program, p->program);
+		pgDeleteQueuePush(PGD_Shader, p->vertexShader);
+		pgDeleteQueuePush(PGD_Shader, p->fragmentShader);
+		
 		// Free the logs
-		free(p->programLinkLog);
-		free(p->vertexShaderCompileLog);
-		free(p->fragmentShaderCompileLog);
+		pgMemFree(p->programLinkLog);
+		pgMemFree(p->vertexShaderCompileLog);
+		pgMemFree(p->fragmentShaderCompileLog);
 
 		// Free the program variables hash /////////////////////////////////
 		destroyProgramVariablesHash(&p->attributesHash);
@@ -343,101 +512,203 @@ void pgProgramDestroy(PGProgram *program)
 		destroyProgramVariablesHash(&p->uniformsHash);
 		assert(p->uniformsHash == NULL);
 
+		destroyProgramBlocksHash(&p->blocksHash);
+
 		// Free the PGProgram //////////////////////////////////////////////
-		memset(p, 0, sizeof(struct PGProgramPrivate));
-		free(p);
+		pgHandlePoolRemove(Programs, *program);
 		
-		*program = NULL;
+		*program = PG_NULL_HANDLE;
 	}
 }
 
+int pgProgramIsValid(PGProgram program)
+{
+	return pgHandlePoolIsValid(Programs, program);
+}
+
+GLuint pgProgramGlHandle(PGProgram program)
+{
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return 0;
+	
+	return p->program;
+}
+
+PGHandlePool pgProgramPool(void)
+{
+	return Programs;
+}
+
 GLuint pgProgramVertexShader(PGProgram program)
 {
-	if (NULL == program) return 0;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return 0;
 	
-	return program->vertexShader;
+	return p->vertexShader;
 }
 
 GLuint pgProgramFragmentShader(PGProgram program)
 {
-	if (NULL == program) return 0;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return 0;
 	
-	return program->fragmentShader;
+	return p->fragmentShader;
 }
 
 const GLchar* pgProgramVertexShaderCompileLog(PGProgram program)
 {
-	if (NULL == program || NULL == program->vertexShaderCompileLog) return "";
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == p->vertexShaderCompileLog) return "";
 	
-	return program->vertexShaderCompileLog;
+	return p->vertexShaderCompileLog;
 }
 
 const GLchar* pgProgramFragmentShaderCompileLog(PGProgram program)
 {
-	if (NULL == program || NULL == program->fragmentShaderCompileLog) return "";
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == p->fragmentShaderCompileLog) return "";
 
-	return program->fragmentShaderCompileLog;
+	return p->fragmentShaderCompileLog;
 }
 
 const GLchar* pgProgramLinkLog(PGProgram program)
 {
-	if (NULL == program || NULL == program->programLinkLog) return "";
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == p->programLinkLog) return "";
 	
-	return program->programLinkLog;
+	return p->programLinkLog;
 }
 
 GLint pgProgramAttribCount(PGProgram program)
 {
-	if (NULL == program) return -1;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return -1;
 	
-	return HASH_COUNT(program->attributesHash);
+	return HASH_COUNT(p->attributesHash);
 }
 
 GLint pgProgramAttribLocation(PGProgram program, const char* name)
 {
-	if (NULL == program) return -1;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return -1;
 	
-	return pgProgramVariableLocation(program->attributesHash, name);
+	return pgProgramVariableLocation(p->attributesHash, name);
 }
 
 GLenum pgProgramAttribType(PGProgram program, const char* name)
 {
-	if (NULL == program) return GL_INVALID_ENUM;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return GL_INVALID_ENUM;
 	
-	return pgProgramVariableType(program->attributesHash, name);
+	return pgProgramVariableType(p->attributesHash, name);
 }
 
 GLsizei pgProgramAttribSize(PGProgram program, const char* name)
 {
-	if (NULL == program) return 0;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return 0;
 	
-	return pgProgramVariableSize(program->attributesHash, name);
+	return pgProgramVariableSize(p->attributesHash, name);
 }
 
 GLint pgProgramUniformCount(PGProgram program)
 {
-	if (NULL == program) return -1;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return -1;
 	
-	return HASH_COUNT(program->uniformsHash);
+	return HASH_COUNT(p->uniformsHash);
 }
 
 GLint pgProgramUniformLocation(PGProgram program, const char* name)
 {
-	if (NULL == program) return -1;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return -1;
 	
-	return pgProgramVariableLocation(program->uniformsHash, name);
+	return pgProgramVariableLocation(p->uniformsHash, name);
 }
 
 GLenum pgProgramUniformType(PGProgram program, const char* name)
 {
-	if (NULL == program) return GL_INVALID_ENUM;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return GL_INVALID_ENUM;
 	
-	return pgProgramVariableType(program->uniformsHash, name);
+	return pgProgramVariableType(p->uniformsHash, name);
 }
 
 GLsizei pgProgramUniformSize(PGProgram program, const char* name)
 {
-	if (NULL == program) return 0;
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return 0;
 	
-	return pgProgramVariableSize(program->uniformsHash, name);
+	return pgProgramVariableSize(p->uniformsHash, name);
+}
+
+GLint pgProgramUniformBlockCount(PGProgram program)
+{
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p) return -1;
+
+	return HASH_COUNT(p->blocksHash);
+}
+
+static struct PGProgramBlock *findBlock(PGProgram program, const char *name)
+{
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == name) return NULL;
+
+	struct PGProgramBlock *block = NULL;
+	HASH_FIND_STR(p->blocksHash, name, block);
+	return block;
+}
+
+GLint pgProgramUniformBlockIndex(PGProgram program, const char *name)
+{
+	struct PGProgramBlock *block = findBlock(program, name);
+	return NULL != block ? (GLint)block->index : -1;
+}
+
+GLsizei pgProgramUniformBlockSize(PGProgram program, const char *name)
+{
+	struct PGProgramBlock *block = findBlock(program, name);
+	return NULL != block ? block->size : 0;
+}
+
+PGResult pgProgramSetUniformBlockBinding(PGProgram program, const char *name, GLuint binding)
+{
+	struct PGProgramBlock *block = findBlock(program, name);
+	if (NULL == block) return PGR_MissingUniform;
+
+#ifdef GL_ES_VERSION_3_0
+	if (block->binding != (GLint)binding)
+	{
+		glUniformBlockBinding(pgProgramGlHandle(program), block->index, binding);
+		block->binding = binding;
+	}
+#endif
+	return PGR_OK;
+}
+
+GLint pgProgramUniformOffset(PGProgram program, const char* name)
+{
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == name) return -1;
+
+	struct PGProgramVariable *var = NULL;
+	HASH_FIND_STR(p->uniformsHash, name, var);
+	return NULL != var ? var->offset : -1;
+}
+
+GLint pgProgramUniformArrayStride(PGProgram program, const char* name)
+{
+	struct PGProgramPrivate *p = lookupProgram(program);
+	if (NULL == p || NULL == name) return 0;
+
+	struct PGProgramVariable *var = NULL;
+	HASH_FIND_STR(p->uniformsHash, name, var);
+	return NULL != var ? var->arrayStride : 0;
+}
+
+void pgProgramGetLookupCounts(PGProgramLookupCounts *counts)
+{
+	if (NULL != counts) *counts = LookupCounts;
 }
@@ -21,9 +21,50 @@ extern "C" {
 	 * occured.
 	 */
 	PGResult pgProgramCreateAndBuild(PGProgram *program, const char *vertexSource, const char *fragmentSource);
+
+	/**
+	 * A compiled and linked program which isn't a PGProgram yet.
+	 */
+	typedef struct
+	{
+		GLuint program;
+		GLuint vertexShader;
+		GLuint fragmentShader;
+		GLchar *programLinkLog;
+		GLchar *vertexShaderCompileLog;
+		GLchar *fragmentShaderCompileLog;
+		PGResult result;
+	}
+	PGProgramBuild;
+
+	/**
+	 * The first half of pgProgramCreateAndBuild: compiles and links, where
+	 * nearly all the time goes. It only touches GL and the files, so it
+	 * can run on a loader thread (see pgContextLoad).
+	 */
+	PGResult pgProgramBuild(PGProgramBuild *build, const char *vertexSource, const char *fragmentSource);
+
+	/**
+	 * The second half, on the render thread once the build's GL objects
+	 * are visible there. Takes over the build's objects and logs whether
+	 * or not it succeeded, and returns its result; as with
+	 * pgProgramCreateAndBuild, destroy the program even on failure.
+	 */
+	PGResult pgProgramCreateFromBuild(PGProgram *program, PGProgramBuild *build);
+
+	/**
+	 * Invalidates the handle straight away. The GL objects are deleted
+	 * through the delete queue, once frames already queued are done.
+	 */
 	void pgProgramDestroy(PGProgram *program);
 
-	#define pgProgramGlHandle(PGProgram) (*((GLuint*)(PGProgram)))
+	/**
+	 * False for PG_NULL_HANDLE and for handles to destroyed programs. All
+	 * the other functions treat a stale handle as null and log a warning.
+	 */
+	int pgProgramIsValid(PGProgram program);
+
+	GLuint pgProgramGlHandle(PGProgram program);
 	GLuint pgProgramVertexShader(PGProgram program);
 	GLuint pgProgramFragmentShader(PGProgram program);
 
@@ -37,9 +78,51 @@ extern "C" {
 	GLsizei pgProgramUniformSize(PGProgram program, const char* name);
 	GLint pgProgramUniformLocation(PGProgram program, const char* name);
 
+	/**
+	 * Uniform blocks, reflected when the program links on OpenGL ES 3. On
+	 * ES 2 a program has none, so the index is always -1 there.
+	 */
+	GLint pgProgramUniformBlockCount(PGProgram program);
+	GLint pgProgramUniformBlockIndex(PGProgram program, const char *name);
+	GLsizei pgProgramUniformBlockSize(PGProgram program, const char *name);
+
+	/**
+	 * Reads the block from the buffer bound at `binding`. Only calls GL if
+	 * the block isn't already there.
+	 */
+	PGResult pgProgramSetUniformBlockBinding(PGProgram program, const char *name, GLuint binding);
+
+	/**
+	 * Where a uniform inside a block sits in the block's std140 layout, in
+	 * bytes, or -1 for uniforms outside blocks. Arrays are named as GL
+	 * reports them, with [0].
+	 */
+	GLint pgProgramUniformOffset(PGProgram program, const char* name);
+	GLint pgProgramUniformArrayStride(PGProgram program, const char* name);
+
 	const GLchar* pgProgramVertexShaderCompileLog(PGProgram program);
 	const GLchar* pgProgramFragmentShaderCompileLog(PGProgram program);
 	const GLchar* pgProgramLinkLog(PGProgram program);
+
+	/**
+	 * The pool holding every live program, for iterating them with
+	 * pgHandlePoolCount and pgHandlePoolHandleAt. NULL until the first
+	 * program is created.
+	 */
+	PGHandlePool pgProgramPool(void);
+
+	/**
+	 * How often attribute and uniform location lookups found the name in
+	 * the locations cached at link time. Counted on the GL thread.
+	 */
+	typedef struct
+	{
+		unsigned long hits;
+		unsigned long misses;
+	}
+	PGProgramLookupCounts;
+
+	void pgProgramGetLookupCounts(PGProgramLookupCounts *counts);
 	
 #ifdef __cplusplus
 }
@@ -0,0 +1,244 @@
+//
+//  PGReadback.c
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#ifdef GL_ES_VERSION_3_0
+#	define PG_READBACK_HAS_PBO 1
+#endif
+
+struct PGReadbackSlot {
+	GLuint buffer;		// Pixel pack buffer, async reads only
+#ifdef PG_READBACK_HAS_PBO
+	GLsync fence;
+#endif
+	GLubyte *pixels;	// Client copy, sync reads only
+	unsigned long frame;
+};
+
+struct PGReadbackPrivate {
+	int width;
+	int height;
+	GLsizeiptr bytes;
+	GLboolean async;
+	GLboolean mapped;
+
+	struct PGReadbackSlot slots[PG_READBACK_MAX_SLOTS];
+	int slotCount;
+	int oldest;
+	int pending;
+	unsigned long nextFrame;
+	PGGpuResource memory;
+};
+
+static GLboolean detectPixelBuffers(void)
+{
+#ifdef PG_READBACK_HAS_PBO
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+	{
+		return GL_TRUE;
+	}
+#endif
+	return GL_FALSE;
+}
+
+PGResult pgReadbackCreate(PGReadback *readback, int width, int height, int slots)
+{
+	if (NULL == readback) return PGR_NullPointerBarf;
+	*readback = NULL;
+
+	if (width <= 0 || height <= 0 || slots < 1 || slots > PG_READBACK_MAX_SLOTS)
+	{
+		pgLog(PGL_Error, "Invalid readback of %dx%d with %d slots.", width, height, slots);
+		return PGR_LazyGenericError;
+	}
+
+	PGReadback r = pgMemAlloc(sizeof(struct PGReadbackPrivate), PGM_Renderer);
+	if (NULL == r) return PGR_OutOfMemory;
+	memset(r, 0, sizeof(struct PGReadbackPrivate));
+	r->width = width;
+	r->height = height;
+	r->bytes = (GLsizeiptr)width * height * 4;
+	r->slotCount = slots;
+	r->async = detectPixelBuffers();
+	*readback = r;
+
+	for (int i = 0; i < slots; i++)
+	{
+		struct PGReadbackSlot *slot = &r->slots[i];
+#ifdef PG_READBACK_HAS_PBO
+		if (r->async)
+		{
+			glGenBuffers(1, &slot->buffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, r->bytes, NULL, GL_STREAM_READ);
+			continue;
+		}
+#endif
+		slot->pixels = pgMemAlloc(r->bytes, PGM_Renderer);
+		if (NULL == slot->pixels)
+		{
+			pgReadbackDestroy(readback);
+			return PGR_OutOfMemory;
+		}
+	}
+
+#ifdef PG_READBACK_HAS_PBO
+	if (r->async)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		GLenum error = glGetError();
+		if (GL_NO_ERROR != error)
+		{
+			pgLog(PGL_Error, "Could not create readback buffers, GL error 0x%04x.", error);
+			pgReadbackDestroy(readback);
+			return PGR_CouldNotCreateBuffer;
+		}
+		if (PGR_OK == pgGpuMemoryAdd(&r->memory, PGG_Buffer, (size_t)r->bytes * slots, NULL))
+		{
+			pgGpuMemorySetLabel(r->memory, "readback");
+		}
+	}
+#endif
+
+	return PGR_OK;
+}
+
+void pgReadbackDestroy(PGReadback *readback)
+{
+	if (NULL != readback && NULL != *readback)
+	{
+		PGReadback r = *readback;
+
+		pgReadbackUnmap(r);
+		pgGpuMemoryRemove(&r->memory);
+		for (int i = 0; i < r->slotCount; i++)
+		{
+			struct PGReadbackSlot *slot = &r->slots[i];
+#ifdef PG_READBACK_HAS_PBO
+			if (NULL != slot->fence) glDeleteSync(slot->fence);
+#endif
+			// A read may still be writing to the buffer
+			pgDeleteQueuePush(PGD_Buffer, slot->buffer);
+			pgMemFree(slot->pixels);
+		}
+
+		memset(r, 0, sizeof(struct PGReadbackPrivate));
+		pgMemFree(r);
+
+		*readback = NULL;
+	}
+}
+
+PGResult pgReadbackQueue(PGReadback readback)
+{
+	if (NULL == readback) return PGR_NullPointerBarf;
+	if (readback->pending == readback->slotCount) return PGR_ReadbackFull;
+
+	struct PGReadbackSlot *slot = &readback->slots[(readback->oldest + readback->pending) % readback->slotCount];
+	slot->frame = readback->nextFrame++;
+	readback->pending++;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+#ifdef PG_READBACK_HAS_PBO
+	if (readback->async)
+	{
+		// Reading into a bound pack buffer returns straight away; the copy
+		// happens when the GPU gets to it
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+		glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		return PGR_OK;
+	}
+#endif
+	glReadPixels(0, 0, readback->width, readback->height, GL_RGBA, GL_UNSIGNED_BYTE, slot->pixels);
+	return PGR_OK;
+}
+
+const GLubyte *pgReadbackMap(PGReadback readback, GLboolean wait, unsigned long *frame)
+{
+	if (NULL == readback || 0 == readback->pending || readback->mapped) return NULL;
+
+	struct PGReadbackSlot *slot = &readback->slots[readback->oldest];
+	const GLubyte *pixels = slot->pixels;
+
+#ifdef PG_READBACK_HAS_PBO
+	if (readback->async)
+	{
+		// The longest wait allowed is implementation defined, so wait a
+		// second at a time
+		GLuint64 timeout = wait ? 1000000000ull : 0;
+		GLenum status;
+		do
+		{
+			status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		}
+		while (wait && GL_TIMEOUT_EXPIRED == status);
+
+		if (GL_TIMEOUT_EXPIRED == status) return NULL;
+		if (GL_WAIT_FAILED == status)
+		{
+			pgLogAnyGlErrors("Waiting for readback fence.");
+		}
+
+		glDeleteSync(slot->fence);
+		slot->fence = NULL;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+		pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback->bytes, GL_MAP_READ_BIT);
+		if (NULL == pixels)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			pgLogAnyGlErrors("Could not map readback buffer.");
+			// Drop the frame so the queue keeps moving
+			readback->oldest = (readback->oldest + 1) % readback->slotCount;
+			readback->pending--;
+			return NULL;
+		}
+	}
+#endif
+
+	readback->mapped = GL_TRUE;
+	if (NULL != frame) *frame = slot->frame;
+	return pixels;
+}
+
+void pgReadbackUnmap(PGReadback readback)
+{
+	if (NULL == readback || !readback->mapped) return;
+
+#ifdef PG_READBACK_HAS_PBO
+	if (readback->async)
+	{
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+#endif
+
+	readback->mapped = GL_FALSE;
+	readback->oldest = (readback->oldest + 1) % readback->slotCount;
+	readback->pending--;
+}
+
+int pgReadbackPending(PGReadback readback)
+{
+	if (NULL == readback) return 0;
+
+	return readback->pending;
+}
+
+GLboolean pgReadbackIsAsync(PGReadback readback)
+{
+	if (NULL == readback) return GL_FALSE;
+
+	return readback->async;
+}
@@ -0,0 +1,63 @@
+//
+//  PGReadback.h
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGReadback_h
+#define PGReadback_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Frames which can be waiting to be read back at once
+	#define PG_READBACK_MAX_SLOTS 4
+
+	/**
+	 * Reads frames back from the bound framebuffer without stalling the
+	 * pipeline. On OpenGL ES 3 each frame is copied into its own pixel
+	 * buffer object, which is only mapped `slots - 1` frames later, by
+	 * which time the GPU has normally finished with it. Elsewhere the read
+	 * falls back to a plain glReadPixels when the frame is queued.
+	 *
+	 * A batch renderer reaches steady state by queueing every frame and
+	 * collecting the oldest one whenever the queue is full:
+	 *
+	 *     draw frame, pgReadbackQueue
+	 *     if pgReadbackPending == slots, pgReadbackMap(wait), write, pgReadbackUnmap
+	 *
+	 * then mapping with `wait` until pgReadbackPending is zero at the end.
+	 */
+	PGResult pgReadbackCreate(PGReadback *readback, int width, int height, int slots);
+	void pgReadbackDestroy(PGReadback *readback);
+
+	/**
+	 * Starts reading the whole of the bound framebuffer. Returns
+	 * PGR_ReadbackFull if every slot is waiting to be mapped.
+	 */
+	PGResult pgReadbackQueue(PGReadback readback);
+
+	/**
+	 * Maps the oldest queued frame as RGBA8 rows, bottom row first. If
+	 * `wait` is false and the GPU has not finished the copy, returns NULL.
+	 * `frame` is set to the frame's index in queue order, counting from 0.
+	 * The pixels are valid until pgReadbackUnmap, which must be called
+	 * before the next map.
+	 */
+	const GLubyte *pgReadbackMap(PGReadback readback, GLboolean wait, unsigned long *frame);
+	void pgReadbackUnmap(PGReadback readback);
+
+	int pgReadbackPending(PGReadback readback);
+
+	/**
+	 * True if reads go through pixel buffer objects.
+	 */
+	GLboolean pgReadbackIsAsync(PGReadback readback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
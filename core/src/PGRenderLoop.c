@@ -0,0 +1,191 @@
+//
+//  PGRenderLoop.c
+//
+//  Created by David Wagner on 08/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "Pictogram.h"
+
+#define NUM_PACKETS 3
+#define SLOT_MASK 0x3u
+#define NEW_PACKET 0x4u
+
+struct PGRenderLoopPrivate {
+	PGRenderLoopCallbacks callbacks;
+	size_t packetStride;
+	unsigned char *packets;
+
+	// Slot most recently submitted, plus NEW_PACKET until it is picked up.
+	// The writer and the render thread each own one other slot.
+	uint32_t ready;
+	uint32_t writeSlot;
+	uint32_t readSlot;
+
+	unsigned long framesRendered;
+	unsigned long packetsDropped;
+
+	pthread_t thread;
+	int started;
+	int32_t quit;
+
+	// The render thread sleeps here when it has no new packet. The writer
+	// only takes the lock when the render thread is asleep.
+	int32_t sleeping;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+};
+
+static void *renderThreadMain(void *arg)
+{
+	PGRenderLoop loop = arg;
+	PGRenderLoopCallbacks *callbacks = &loop->callbacks;
+
+	if (NULL != callbacks->threadStart) callbacks->threadStart(callbacks->userData);
+
+	while (!__atomic_load_n(&loop->quit, __ATOMIC_SEQ_CST))
+	{
+		if (0 == (__atomic_load_n(&loop->ready, __ATOMIC_SEQ_CST) & NEW_PACKET))
+		{
+			pthread_mutex_lock(&loop->lock);
+			__atomic_store_n(&loop->sleeping, 1, __ATOMIC_SEQ_CST);
+			while (0 == (__atomic_load_n(&loop->ready, __ATOMIC_SEQ_CST) & NEW_PACKET)
+				   && !__atomic_load_n(&loop->quit, __ATOMIC_SEQ_CST))
+			{
+				pthread_cond_wait(&loop->wake, &loop->lock);
+			}
+			__atomic_store_n(&loop->sleeping, 0, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&loop->lock);
+			continue;
+		}
+
+		// Swap our slot for the newest one. The writer may have submitted
+		// again since we looked, which is fine, we just get a newer packet.
+		uint32_t newest = __atomic_exchange_n(&loop->ready, loop->readSlot, __ATOMIC_ACQ_REL);
+		loop->readSlot = newest & SLOT_MASK;
+
+		const void *packet = loop->packets + loop->readSlot * loop->packetStride;
+		if (NULL != callbacks->render) callbacks->render(callbacks->userData, packet);
+		if (NULL != callbacks->present) callbacks->present(callbacks->userData);
+		__atomic_add_fetch(&loop->framesRendered, 1, __ATOMIC_RELAXED);
+	}
+
+	if (NULL != callbacks->threadStop) callbacks->threadStop(callbacks->userData);
+
+	return NULL;
+}
+
+PGResult pgRenderLoopCreate(PGRenderLoop *loop, size_t packetSize, const PGRenderLoopCallbacks *callbacks)
+{
+	if (NULL == loop) return PGR_NullPointerBarf;
+	*loop = NULL;
+
+	if (NULL == callbacks || 0 == packetSize) return PGR_NullPointerBarf;
+
+	PGRenderLoop l = pgMemAlloc(sizeof(struct PGRenderLoopPrivate), PGM_Renderer);
+	if (NULL == l) return PGR_OutOfMemory;
+	memset(l, 0, sizeof(struct PGRenderLoopPrivate));
+	*loop = l;
+
+	// Keep each packet on its own cache lines so the two threads don't
+	// fight over them
+	l->packetStride = (packetSize + 63) & ~(size_t)63;
+	l->packets = pgMemAllocAligned(l->packetStride * NUM_PACKETS, 64, PGM_Renderer);
+	if (NULL == l->packets)
+	{
+		pgRenderLoopDestroy(loop);
+		return PGR_OutOfMemory;
+	}
+	memset(l->packets, 0, l->packetStride * NUM_PACKETS);
+
+	l->callbacks = *callbacks;
+	l->writeSlot = 0;
+	l->ready = 1;
+	l->readSlot = 2;
+
+	pthread_mutex_init(&l->lock, NULL);
+	pthread_cond_init(&l->wake, NULL);
+
+	int error = pthread_create(&l->thread, NULL, renderThreadMain, l);
+	if (0 != error)
+	{
+		pgLog(PGL_Error, "Could not start render thread: %s", strerror(error));
+		pthread_cond_destroy(&l->wake);
+		pthread_mutex_destroy(&l->lock);
+		pgRenderLoopDestroy(loop);
+		return PGR_LazyGenericError;
+	}
+	l->started = 1;
+
+	return PGR_OK;
+}
+
+void pgRenderLoopDestroy(PGRenderLoop *loop)
+{
+	if (NULL != loop && NULL != *loop)
+	{
+		PGRenderLoop l = *loop;
+
+		if (l->started)
+		{
+			pthread_mutex_lock(&l->lock);
+			__atomic_store_n(&l->quit, 1, __ATOMIC_SEQ_CST);
+			pthread_cond_signal(&l->wake);
+			pthread_mutex_unlock(&l->lock);
+			pthread_join(l->thread, NULL);
+
+			pthread_cond_destroy(&l->wake);
+			pthread_mutex_destroy(&l->lock);
+		}
+
+		pgMemFree(l->packets);
+		memset(l, 0, sizeof(struct PGRenderLoopPrivate));
+		pgMemFree(l);
+
+		*loop = NULL;
+	}
+}
+
+void *pgRenderLoopBeginPacket(PGRenderLoop loop)
+{
+	if (NULL == loop) return NULL;
+
+	return loop->packets + loop->writeSlot * loop->packetStride;
+}
+
+void pgRenderLoopSubmitPacket(PGRenderLoop loop)
+{
+	if (NULL == loop) return;
+
+	uint32_t previous = __atomic_exchange_n(&loop->ready, loop->writeSlot | NEW_PACKET, __ATOMIC_SEQ_CST);
+	loop->writeSlot = previous & SLOT_MASK;
+	if (previous & NEW_PACKET)
+	{
+		__atomic_add_fetch(&loop->packetsDropped, 1, __ATOMIC_RELAXED);
+	}
+
+	if (__atomic_load_n(&loop->sleeping, __ATOMIC_SEQ_CST))
+	{
+		pthread_mutex_lock(&loop->lock);
+		pthread_cond_signal(&loop->wake);
+		pthread_mutex_unlock(&loop->lock);
+	}
+}
+
+unsigned long pgRenderLoopFramesRendered(PGRenderLoop loop)
+{
+	if (NULL == loop) return 0;
+
+	return __atomic_load_n(&loop->framesRendered, __ATOMIC_RELAXED);
+}
+
+unsigned long pgRenderLoopPacketsDropped(PGRenderLoop loop)
+{
+	if (NULL == loop) return 0;
+
+	return __atomic_load_n(&loop->packetsDropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,70 @@
+//
+//  PGRenderLoop.h
+//
+//  Created by David Wagner on 08/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGRenderLoop_h
+#define PGRenderLoop_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Callbacks made on the render thread. The GL context should be made
+	 * current in threadStart and released in threadStop, so it is only ever
+	 * used from the render thread.
+	 */
+	typedef struct
+	{
+		void (*threadStart)(void *userData);
+		void (*render)(void *userData, const void *packet);
+		void (*present)(void *userData);
+		void (*threadStop)(void *userData);
+		void *userData;
+	}
+	PGRenderLoopCallbacks;
+
+	/**
+	 * Starts a render thread which draws frame packets handed over by
+	 * the simulation thread.
+	 *
+	 * Packets live in a triple buffered mailbox: the simulation thread fills
+	 * one, the render thread draws another, and the third holds the most
+	 * recently submitted packet. Submitting never waits for the render
+	 * thread, and the render thread always picks up the newest packet,
+	 * dropping any it didn't get to in time.
+	 *
+	 * Only one thread may write packets.
+	 */
+	PGResult pgRenderLoopCreate(PGRenderLoop *loop, size_t packetSize, const PGRenderLoopCallbacks *callbacks);
+
+	/**
+	 * Stops and joins the render thread.
+	 */
+	void pgRenderLoopDestroy(PGRenderLoop *loop);
+
+	/**
+	 * Returns the packet the simulation thread should fill in next. The
+	 * contents are whatever was last written to this buffer, three
+	 * submissions ago.
+	 */
+	void *pgRenderLoopBeginPacket(PGRenderLoop loop);
+
+	/**
+	 * Publishes the packet returned by pgRenderLoopBeginPacket.
+	 */
+	void pgRenderLoopSubmitPacket(PGRenderLoop loop);
+
+	unsigned long pgRenderLoopFramesRendered(PGRenderLoop loop);
+	unsigned long pgRenderLoopPacketsDropped(PGRenderLoop loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,486 @@
+//
+//  PGRenderTarget.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "Pictogram.h"
+
+// Apple's ES 2 headers have the extension, and elsewhere it is ES 3
+#if defined(GL_APPLE_framebuffer_multisample) && !defined(PG_GL_LOADS_EXTENSIONS)
+#	define PG_RENDER_TARGET_APPLE_MSAA 1
+#endif
+
+enum {
+	MSAA_Unknown = 0
+,	MSAA_None
+,	MSAA_Core			// glBlitFramebuffer
+,	MSAA_Apple			// glResolveMultisampleFramebufferAPPLE
+};
+
+struct PGRenderTargetPrivate {
+	PGRenderTargetDesc desc;
+	GLuint framebuffer;
+	GLuint colour;				// Renderbuffer, unless drawn straight into `texture`
+	GLuint depth;
+	GLuint resolveFramebuffer;	// Multisampled targets only
+	GLuint resolveColour;		// Renderbuffer, when not `sampled`
+	GLuint texture;
+
+	GLboolean acquired;
+	unsigned long releasedFrame;
+	PGGpuResource memory;
+};
+
+struct PGRenderTargetPoolPrivate {
+	PGHandlePool targets;
+	int msaa;
+	GLsizei maxSamples;
+	unsigned long frame;
+	PGRenderTargetStats stats;
+};
+
+static struct PGRenderTargetPrivate *lookupTarget(PGRenderTargetPool pool, PGRenderTarget target)
+{
+	struct PGRenderTargetPrivate *t = pgHandlePoolGet(pool->targets, target);
+	if (NULL == t && PG_NULL_HANDLE != target)
+	{
+		pgLog(PGL_Warn, "Stale render target handle 0x%08x.", target);
+	}
+	return t;
+}
+
+static void detectMultisampling(PGRenderTargetPool pool)
+{
+	if (MSAA_Unknown != pool->msaa) return;
+
+	pool->msaa = MSAA_None;
+	GLint samples = 0;
+#ifdef GL_ES_VERSION_3_0
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+	{
+		glGetIntegerv(GL_MAX_SAMPLES, &samples);
+		if (samples > 1) pool->msaa = MSAA_Core;
+	}
+#endif
+#ifdef PG_RENDER_TARGET_APPLE_MSAA
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	if (MSAA_None == pool->msaa && NULL != extensions && NULL != strstr(extensions, "GL_APPLE_framebuffer_multisample"))
+	{
+		glGetIntegerv(GL_MAX_SAMPLES_APPLE, &samples);
+		if (samples > 1) pool->msaa = MSAA_Apple;
+	}
+#endif
+	pool->maxSamples = MSAA_None != pool->msaa ? samples : 1;
+}
+
+/**
+ * Unsized texture format and type to match a renderbuffer format, which
+ * ES 2 needs and ES 3 takes.
+ */
+static void textureFormat(GLenum colourFormat, GLenum *format, GLenum *type)
+{
+	switch (colourFormat)
+	{
+		case GL_RGBA4:
+			*format = GL_RGBA;
+			*type = GL_UNSIGNED_SHORT_4_4_4_4;
+			break;
+		case GL_RGB5_A1:
+			*format = GL_RGBA;
+			*type = GL_UNSIGNED_SHORT_5_5_5_1;
+			break;
+		case GL_RGB565:
+			*format = GL_RGB;
+			*type = GL_UNSIGNED_SHORT_5_6_5;
+			break;
+		default:
+			*format = GL_RGBA;
+			*type = GL_UNSIGNED_BYTE;
+			break;
+	}
+}
+
+static GLboolean hasStencil(GLenum depthFormat)
+{
+#ifdef GL_DEPTH24_STENCIL8_OES
+	if (GL_DEPTH24_STENCIL8_OES == depthFormat) return GL_TRUE;
+#endif
+	return GL_STENCIL_INDEX8 == depthFormat;
+}
+
+static void renderbufferStorage(PGRenderTargetPool pool, GLuint renderbuffer, GLsizei samples, GLenum format, GLsizei width, GLsizei height)
+{
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+#ifdef GL_ES_VERSION_3_0
+	if (samples > 1 && MSAA_Core == pool->msaa)
+	{
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height);
+		return;
+	}
+#endif
+#ifdef PG_RENDER_TARGET_APPLE_MSAA
+	if (samples > 1 && MSAA_Apple == pool->msaa)
+	{
+		glRenderbufferStorageMultisampleAPPLE(GL_RENDERBUFFER, samples, format, width, height);
+		return;
+	}
+#endif
+	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+}
+
+static size_t targetBytes(const struct PGRenderTargetPrivate *t)
+{
+	const PGRenderTargetDesc *d = &t->desc;
+	size_t samples = d->samples > 1 ? (size_t)d->samples : 1;
+	size_t bytes = 0;
+	if (0 != d->colourFormat) bytes += pgGpuRenderbufferBytes(d->colourFormat, d->width, d->height) * samples;
+	if (0 != d->depthFormat) bytes += pgGpuRenderbufferBytes(d->depthFormat, d->width, d->height) * samples;
+	if (d->samples > 1 && 0 != d->colourFormat) bytes += pgGpuRenderbufferBytes(d->colourFormat, d->width, d->height);
+	return bytes;
+}
+
+/**
+ * Gives every buffer of the target storage at its current size.
+ */
+static PGResult allocateStorage(PGRenderTargetPool pool, struct PGRenderTargetPrivate *t)
+{
+	const PGRenderTargetDesc *d = &t->desc;
+	pgLogAnyGlErrors("About to allocate render target.");
+
+	if (0 != t->texture)
+	{
+		GLenum format, type;
+		textureFormat(d->colourFormat, &format, &type);
+		glBindTexture(GL_TEXTURE_2D, t->texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, d->width, d->height, 0, format, type, NULL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if (0 != t->colour) renderbufferStorage(pool, t->colour, d->samples, d->colourFormat, d->width, d->height);
+	if (0 != t->depth) renderbufferStorage(pool, t->depth, d->samples, d->depthFormat, d->width, d->height);
+	if (0 != t->resolveColour) renderbufferStorage(pool, t->resolveColour, 1, d->colourFormat, d->width, d->height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	pgGpuMemoryResize(t->memory, targetBytes(t));
+
+	GLenum error = glGetError();
+	if (GL_NO_ERROR != error)
+	{
+		pgLog(PGL_Error, "Could not allocate a %dx%d render target, GL error 0x%04x.", d->width, d->height, error);
+		return PGR_CouldNotCreateBuffer;
+	}
+	return PGR_OK;
+}
+
+static PGResult checkFramebuffer(GLuint framebuffer, const PGRenderTargetDesc *desc)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (GL_FRAMEBUFFER_COMPLETE != status)
+	{
+		pgLog(PGL_Error, "Render target of %dx%d, colour 0x%04x, depth 0x%04x and %d samples is incomplete: 0x%04x.",
+			desc->width, desc->height, desc->colourFormat, desc->depthFormat, desc->samples, status);
+		return PGR_Unsupported;
+	}
+	return PGR_OK;
+}
+
+/**
+ * Makes the GL objects for `t->desc` and attaches them.
+ */
+static PGResult createObjects(PGRenderTargetPool pool, struct PGRenderTargetPrivate *t)
+{
+	const PGRenderTargetDesc *d = &t->desc;
+	GLboolean multisampled = d->samples > 1;
+
+	if (0 != d->colourFormat)
+	{
+		if (d->sampled) glGenTextures(1, &t->texture);
+		if (multisampled || !d->sampled) glGenRenderbuffers(1, &t->colour);
+		if (multisampled && !d->sampled) glGenRenderbuffers(1, &t->resolveColour);
+	}
+	if (0 != d->depthFormat) glGenRenderbuffers(1, &t->depth);
+	glGenFramebuffers(1, &t->framebuffer);
+	if (multisampled && 0 != d->colourFormat) glGenFramebuffers(1, &t->resolveFramebuffer);
+
+	if (0 != t->texture)
+	{
+		glBindTexture(GL_TEXTURE_2D, t->texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	PGResult result = allocateStorage(pool, t);
+	if (PGR_OK != result) return result;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+	if (0 != t->colour)
+	{
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t->colour);
+	}
+	else if (0 != t->texture)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+	}
+	if (0 != t->depth)
+	{
+		if (GL_STENCIL_INDEX8 != d->depthFormat) glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t->depth);
+		if (hasStencil(d->depthFormat)) glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, t->depth);
+	}
+	result = checkFramebuffer(t->framebuffer, d);
+	if (PGR_OK != result) return result;
+
+	if (0 != t->resolveFramebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, t->resolveFramebuffer);
+		if (0 != t->texture) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+		else glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t->resolveColour);
+		result = checkFramebuffer(t->resolveFramebuffer, d);
+		if (PGR_OK != result) return result;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+	return PGR_OK;
+}
+
+static void deleteObjects(struct PGRenderTargetPrivate *t)
+{
+	pgDeleteQueuePush(PGD_Framebuffer, t->framebuffer);
+	pgDeleteQueuePush(PGD_Framebuffer, t->resolveFramebuffer);
+	pgDeleteQueuePush(PGD_Renderbuffer, t->colour);
+	pgDeleteQueuePush(PGD_Renderbuffer, t->depth);
+	pgDeleteQueuePush(PGD_Renderbuffer, t->resolveColour);
+	pgDeleteQueuePush(PGD_Texture, t->texture);
+	pgGpuMemoryRemove(&t->memory);
+}
+
+static GLboolean matches(const PGRenderTargetDesc *a, const PGRenderTargetDesc *b)
+{
+	return a->width == b->width && a->height == b->height
+		&& a->colourFormat == b->colourFormat && a->depthFormat == b->depthFormat
+		&& a->samples == b->samples && a->sampled == b->sampled;
+}
+
+// Pools /////////////////////////////////////////////////////////////////////
+
+PGResult pgRenderTargetPoolCreate(PGRenderTargetPool *pool)
+{
+	if (NULL == pool) return PGR_NullPointerBarf;
+	*pool = NULL;
+
+	PGRenderTargetPool p = pgMemAlloc(sizeof(struct PGRenderTargetPoolPrivate), PGM_Renderer);
+	if (NULL == p) return PGR_OutOfMemory;
+	memset(p, 0, sizeof(struct PGRenderTargetPoolPrivate));
+	*pool = p;
+
+	PGResult result = pgHandlePoolCreate(&p->targets, sizeof(struct PGRenderTargetPrivate), PGM_Renderer);
+	if (PGR_OK != result)
+	{
+		pgRenderTargetPoolDestroy(pool);
+		return result;
+	}
+	return PGR_OK;
+}
+
+void pgRenderTargetPoolDestroy(PGRenderTargetPool *pool)
+{
+	if (NULL != pool && NULL != *pool)
+	{
+		PGRenderTargetPool p = *pool;
+
+		uint32_t count = pgHandlePoolCount(p->targets);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			deleteObjects(pgHandlePoolItemAt(p->targets, i));
+		}
+		pgHandlePoolDestroy(&p->targets);
+
+		memset(p, 0, sizeof(struct PGRenderTargetPoolPrivate));
+		pgMemFree(p);
+
+		*pool = NULL;
+	}
+}
+
+void pgRenderTargetPoolBeginFrame(PGRenderTargetPool pool)
+{
+	if (NULL == pool) return;
+	pool->frame++;
+
+	// Removing moves the last target into the gap, so walk backwards
+	for (uint32_t i = pgHandlePoolCount(pool->targets); i-- > 0; )
+	{
+		struct PGRenderTargetPrivate *t = pgHandlePoolItemAt(pool->targets, i);
+		if (t->acquired || pool->frame - t->releasedFrame <= PG_RENDER_TARGET_IDLE_FRAMES) continue;
+
+		deleteObjects(t);
+		pgHandlePoolRemove(pool->targets, pgHandlePoolHandleAt(pool->targets, i));
+		pool->stats.trimmed++;
+	}
+}
+
+void pgRenderTargetPoolStats(PGRenderTargetPool pool, PGRenderTargetStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGRenderTargetStats));
+	if (NULL == pool) return;
+
+	*stats = pool->stats;
+	stats->targets = pgHandlePoolCount(pool->targets);
+	for (uint32_t i = 0; i < stats->targets; i++)
+	{
+		const struct PGRenderTargetPrivate *t = pgHandlePoolItemAt(pool->targets, i);
+		if (t->acquired) stats->acquired++;
+	}
+}
+
+// Targets ///////////////////////////////////////////////////////////////////
+
+PGResult pgRenderTargetAcquire(PGRenderTargetPool pool, PGRenderTarget *target, const PGRenderTargetDesc *desc)
+{
+	if (NULL == target) return PGR_NullPointerBarf;
+	*target = PG_NULL_HANDLE;
+	if (NULL == pool || NULL == desc) return PGR_NullPointerBarf;
+
+	if (desc->width <= 0 || desc->height <= 0 || (0 == desc->colourFormat && 0 == desc->depthFormat) || (desc->sampled && 0 == desc->colourFormat))
+	{
+		pgLog(PGL_Error, "Invalid %dx%d render target.", desc->width, desc->height);
+		return PGR_LazyGenericError;
+	}
+
+	detectMultisampling(pool);
+	PGRenderTargetDesc d = *desc;
+	if (d.samples < 1) d.samples = 1;
+	if (d.samples > pool->maxSamples) d.samples = pool->maxSamples;
+
+	uint32_t count = pgHandlePoolCount(pool->targets);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		struct PGRenderTargetPrivate *t = pgHandlePoolItemAt(pool->targets, i);
+		if (t->acquired || !matches(&t->desc, &d)) continue;
+
+		t->acquired = GL_TRUE;
+		pool->stats.reuses++;
+		*target = pgHandlePoolHandleAt(pool->targets, i);
+		return PGR_OK;
+	}
+
+	struct PGRenderTargetPrivate *t = NULL;
+	PGRenderTarget handle = pgHandlePoolAdd(pool->targets, (void **)&t);
+	if (NULL == t) return PGR_OutOfMemory;
+	t->desc = d;
+	t->acquired = GL_TRUE;
+
+	if (PGR_OK == pgGpuMemoryAdd(&t->memory, PGG_RenderTarget, 0, NULL))
+	{
+		char label[PG_GPU_MEMORY_LABEL_SIZE];
+		snprintf(label, sizeof(label), "render target %dx%d x%d", d.width, d.height, d.samples);
+		pgGpuMemorySetLabel(t->memory, label);
+	}
+
+	PGResult result = createObjects(pool, t);
+	if (PGR_OK != result)
+	{
+		deleteObjects(t);
+		pgHandlePoolRemove(pool->targets, handle);
+		return result;
+	}
+	pool->stats.allocations++;
+
+	*target = handle;
+	return PGR_OK;
+}
+
+void pgRenderTargetRelease(PGRenderTargetPool pool, PGRenderTarget *target)
+{
+	if (NULL == pool || NULL == target || PG_NULL_HANDLE == *target) return;
+
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, *target);
+	if (NULL != t)
+	{
+		t->acquired = GL_FALSE;
+		t->releasedFrame = pool->frame;
+	}
+	*target = PG_NULL_HANDLE;
+}
+
+PGResult pgRenderTargetResize(PGRenderTargetPool pool, PGRenderTarget target, GLsizei width, GLsizei height)
+{
+	if (NULL == pool) return PGR_NullPointerBarf;
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, target);
+	if (NULL == t) return PGR_StaleHandle;
+	if (width <= 0 || height <= 0) return PGR_LazyGenericError;
+	if (width == t->desc.width && height == t->desc.height) return PGR_OK;
+
+	t->desc.width = width;
+	t->desc.height = height;
+	pool->stats.resizes++;
+	return allocateStorage(pool, t);
+}
+
+PGResult pgRenderTargetBind(PGRenderTargetPool pool, PGRenderTarget target)
+{
+	if (NULL == pool) return PGR_NullPointerBarf;
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, target);
+	if (NULL == t) return PGR_StaleHandle;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+	glViewport(0, 0, t->desc.width, t->desc.height);
+	return PGR_OK;
+}
+
+PGResult pgRenderTargetResolve(PGRenderTargetPool pool, PGRenderTarget target)
+{
+	if (NULL == pool) return PGR_NullPointerBarf;
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, target);
+	if (NULL == t) return PGR_StaleHandle;
+	if (0 == t->resolveFramebuffer) return PGR_OK;
+
+	pgProfileZone("pgRenderTargetResolve");
+#ifdef GL_ES_VERSION_3_0
+	if (MSAA_Core == pool->msaa)
+	{
+		GLsizei width = t->desc.width, height = t->desc.height;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, t->framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, t->resolveFramebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+#endif
+#ifdef PG_RENDER_TARGET_APPLE_MSAA
+	if (MSAA_Apple == pool->msaa)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER_APPLE, t->framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER_APPLE, t->resolveFramebuffer);
+		glResolveMultisampleFramebufferAPPLE();
+	}
+#endif
+	glBindFramebuffer(GL_FRAMEBUFFER, t->framebuffer);
+	pgLogAnyGlErrors("Resolved render target.");
+	return PGR_OK;
+}
+
+GLuint pgRenderTargetTexture(PGRenderTargetPool pool, PGRenderTarget target)
+{
+	if (NULL == pool) return 0;
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, target);
+	return NULL != t ? t->texture : 0;
+}
+
+PGResult pgRenderTargetDescription(PGRenderTargetPool pool, PGRenderTarget target, PGRenderTargetDesc *desc)
+{
+	if (NULL == desc) return PGR_NullPointerBarf;
+	memset(desc, 0, sizeof(PGRenderTargetDesc));
+	if (NULL == pool) return PGR_NullPointerBarf;
+
+	struct PGRenderTargetPrivate *t = lookupTarget(pool, target);
+	if (NULL == t) return PGR_StaleHandle;
+
+	*desc = t->desc;
+	return PGR_OK;
+}
@@ -0,0 +1,116 @@
+//
+//  PGRenderTarget.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGRenderTarget_h
+#define PGRenderTarget_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_RENDER_TARGET_IDLE_FRAMES 60
+
+	typedef struct
+	{
+		GLsizei width;
+		GLsizei height;
+		GLenum colourFormat;		// GL_RGBA8_OES, GL_RGBA4, GL_RGB5_A1 or GL_RGB565, or 0 for none
+		GLenum depthFormat;			// GL_DEPTH_COMPONENT16, GL_DEPTH24_STENCIL8_OES and so on, or 0 for none
+		GLsizei samples;			// More than 1 to multisample
+		GLboolean sampled;			// Colour can be read as a texture, once resolved if multisampled
+	}
+	PGRenderTargetDesc;
+
+	typedef struct
+	{
+		unsigned long targets;
+		unsigned long acquired;
+		unsigned long allocations;	// Over the lifetime of the pool
+		unsigned long reuses;
+		unsigned long resizes;
+		unsigned long trimmed;
+	}
+	PGRenderTargetStats;
+
+	/**
+	 * Offscreen framebuffers, pooled by size, formats and samples. Each
+	 * renderer has one, from pgRendererRenderTargets.
+	 *
+	 * A pass acquires a target, draws into it and releases it once
+	 * whatever reads it has been drawn, so passes later in the frame can
+	 * use the same memory. Targets kept across frames are simply not
+	 * released. Released targets unused for PG_RENDER_TARGET_IDLE_FRAMES
+	 * are deleted.
+	 *
+	 * Multisampled targets draw into multisampled renderbuffers, and
+	 * pgRenderTargetResolve copies them into a single sampled colour
+	 * buffer, a texture if the target is `sampled`. Where GL can't
+	 * multisample, targets get one sample and resolving does nothing.
+	 *
+	 * Pools belong to the GL thread.
+	 */
+	PGResult pgRenderTargetPoolCreate(PGRenderTargetPool *pool);
+
+	/**
+	 * Deletes every target through the delete queue, released or not.
+	 */
+	void pgRenderTargetPoolDestroy(PGRenderTargetPool *pool);
+
+	/**
+	 * Deletes targets which have been idle too long. pgRendererBeginFrame
+	 * calls this.
+	 */
+	void pgRenderTargetPoolBeginFrame(PGRenderTargetPool pool);
+
+	void pgRenderTargetPoolStats(PGRenderTargetPool pool, PGRenderTargetStats *stats);
+
+	/**
+	 * A released target matching `desc` if there is one, or a new one.
+	 * `samples` is lowered to what GL supports before matching.
+	 */
+	PGResult pgRenderTargetAcquire(PGRenderTargetPool pool, PGRenderTarget *target, const PGRenderTargetDesc *desc);
+
+	/**
+	 * Gives the target back to the pool. Its contents are undefined once
+	 * it has been acquired again.
+	 */
+	void pgRenderTargetRelease(PGRenderTargetPool pool, PGRenderTarget *target);
+
+	/**
+	 * Reallocates the target's storage at a new size, keeping its GL
+	 * names, so anything holding them stays valid. The contents are lost.
+	 */
+	PGResult pgRenderTargetResize(PGRenderTargetPool pool, PGRenderTarget target, GLsizei width, GLsizei height);
+
+	/**
+	 * Binds the target's framebuffer and sets the viewport to cover it.
+	 * pgRendererBindFramebuffer goes back to the renderer's own.
+	 */
+	PGResult pgRenderTargetBind(PGRenderTargetPool pool, PGRenderTarget target);
+
+	/**
+	 * Copies a multisampled target's colour into its resolve buffer, then
+	 * binds the target's framebuffer again.
+	 */
+	PGResult pgRenderTargetResolve(PGRenderTargetPool pool, PGRenderTarget target);
+
+	/**
+	 * The colour texture of a `sampled` target, or 0.
+	 */
+	GLuint pgRenderTargetTexture(PGRenderTargetPool pool, PGRenderTarget target);
+
+	/**
+	 * The target as it was made, with the size it has now and the samples
+	 * it really has.
+	 */
+	PGResult pgRenderTargetDescription(PGRenderTargetPool pool, PGRenderTarget target, PGRenderTargetDesc *desc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,8 @@
 //
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <assert.h>
 #include "Pictogram.h"
 
@@ -14,17 +16,92 @@ const int NUM_FRAME_BUFFERS = 1;
 const int NUM_RENDER_BUFFERS = 1;
 
 struct PGRendererPrivate {
+	PGRendererBackend backend;
+	PGSoftRaster soft;
+	
     GLuint renderbuffer;
     GLuint framebuffer;
+	int width;
+	int height;
+	PGRenderTargetPool targets;
+	PGUniformBuffer uniforms;
+	PGUploadQueue uploads;
+	
+	// Partial redraw
+	PGDamage damage;
+	int bufferAge;
+	GLboolean repaintScissor;	// Scissor stays on whatever pipelines say
+	PGDamageRect repaintRect;
+	
 	// Currently active settings
 	PGProgram activeProgram;
+	PGPipeline activePipeline;
+	PGPipelineDesc pipelineState;	// What GL has, once pipelineStateKnown
+	GLboolean pipelineStateKnown;
+	
+	// Instancing
+	PGInstancingSupport instancing;
+	GLuint instanceBuffer;
+	GLsizeiptr instanceBufferSize;
+	
+	// GPU memory accounting
+	PGGpuResource colourMemory;
+	PGGpuResource instanceMemory;
+	
+	// Stats, with the last PG_STATS_HISTORY frames in a ring
+	PGFrameStats frame;
+	PGFrameStats history[PG_STATS_HISTORY];
+	unsigned long framesRecorded;
+	uint64_t frameStart;
+	GLboolean frameOpen;
+	
+	unsigned long sharedFrame;	// Frames begun, in step with SharedFrame
 };
 
+// GL renderers alive. The delete queue and placeholder texture are
+// shared, so only the last renderer to go may empty them.
+static int LiveRenderers;
+
+// Real frames, counted by whichever renderer begins each first. The
+// delete queue, GPU memory ages and texture streaming are shared, and
+// move on once a frame however many renderers draw it.
+static unsigned long SharedFrame;
+
+static const char * const InstanceAttribNames[] = {
+	"instanceTransform0",
+	"instanceTransform1",
+	"instanceColor",
+	"instanceUVRect",
+};
+#define NUM_INSTANCE_ATTRIBS (sizeof(InstanceAttribNames) / sizeof(InstanceAttribNames[0]))
+#define INSTANCE_VECTORS (sizeof(PGInstance) / (4 * sizeof(GLfloat)))
+
+static PGInstancingSupport detectInstancingSupport(PGRenderer renderer)
+{
+#ifdef GL_ES_VERSION_3_0
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+	{
+		return PGI_Core;
+	}
+#endif
+#ifdef GL_EXT_instanced_arrays
+	if (pgRendererHasExtension(renderer, "GL_EXT_instanced_arrays"))
+	{
+#ifdef PG_GL_LOADS_EXTENSIONS
+		if (NULL == pgglVertexAttribDivisorEXT || NULL == pgglDrawArraysInstancedEXT) return PGI_None;
+#endif
+		return PGI_Extension;
+	}
+#endif
+	return PGI_None;
+}
+
 static void clearRendererContext(PGRenderer renderer)
 {
 	memset(renderer, 0, sizeof(struct PGRendererPrivate));
 	
-	renderer->activeProgram = NULL;
+	renderer->activeProgram = PG_NULL_HANDLE;
 }
 
 PGResult pgRendererCreate(PGRenderer *renderer)
@@ -35,16 +112,45 @@ PGResult pgRendererCreate(PGRenderer *renderer)
 	}
 	*renderer = NULL;
 	
-	PGRenderer r = malloc(sizeof(struct PGRendererPrivate));
+	PGRenderer r = pgMemAlloc(sizeof(struct PGRendererPrivate), PGM_Renderer);
 	if (NULL == r) return PGR_OutOfMemory;
 	*renderer = r;
 	clearRendererContext(r);
+	__atomic_add_fetch(&LiveRenderers, 1, __ATOMIC_ACQ_REL);
+	r->sharedFrame = __atomic_load_n(&SharedFrame, __ATOMIC_ACQUIRE);
 	
     // Create & bind the color buffer so that the caller can allocate its space.
     glGenRenderbuffers(NUM_RENDER_BUFFERS, &r->renderbuffer);
     glBindRenderbuffer(GL_RENDERBUFFER, r->renderbuffer);
 	
-	return PGR_OK;
+	r->instancing = detectInstancingSupport(r);
+	
+	PGResult result = pgDamageCreate(&r->damage);
+	if (PGR_OK == result) result = pgRenderTargetPoolCreate(&r->targets);
+	if (PGR_OK == result) result = pgUniformBufferCreate(&r->uniforms, PG_UNIFORM_BUFFER_FRAME_BYTES);
+	if (PGR_OK == result) result = pgUploadQueueCreate(&r->uploads);
+	if (PGR_OK != result) pgRendererDestroy(renderer);
+	return result;
+}
+
+PGResult pgRendererCreateSoftware(PGRenderer *renderer, PGJobScheduler jobs)
+{
+	if (NULL == renderer)
+	{
+		return PGR_NullPointerBarf;
+	}
+	*renderer = NULL;
+	
+	PGRenderer r = pgMemAlloc(sizeof(struct PGRendererPrivate), PGM_Renderer);
+	if (NULL == r) return PGR_OutOfMemory;
+	*renderer = r;
+	clearRendererContext(r);
+	
+	r->backend = PGB_Software;
+	PGResult result = pgDamageCreate(&r->damage);
+	if (PGR_OK == result) result = pgSoftRasterCreate(&r->soft, jobs);
+	if (PGR_OK != result) pgRendererDestroy(renderer);
+	return result;
 }
 
 void pgRendererDestroy(PGRenderer *renderer)
@@ -53,11 +159,34 @@ void pgRendererDestroy(PGRenderer *renderer)
 	{
 		PGRenderer r = *renderer;
 		
-		glDeleteFramebuffers(1, &r->framebuffer);
-		glDeleteRenderbuffers(1, &r->renderbuffer);
+		if (PGB_Software == r->backend)
+		{
+			pgSoftRasterDestroy(&r->soft);
+		}
+		else
+		{
+			// The renderer's own objects go through the delete queue, which
+			// a remaining renderer goes on advancing. Once the last has
+			// gone nothing is in flight.
+			pgUploadQueueDestroy(&r->uploads);
+			pgRenderTargetPoolDestroy(&r->targets);
+			pgUniformBufferDestroy(&r->uniforms);
+			if (0 == __atomic_sub_fetch(&LiveRenderers, 1, __ATOMIC_ACQ_REL))
+			{
+				pgDeleteQueueFlush();
+				pgTextureReleasePlaceholder();
+			}
+			
+			glDeleteFramebuffers(1, &r->framebuffer);
+			glDeleteRenderbuffers(1, &r->renderbuffer);
+			if (0 != r->instanceBuffer) glDeleteBuffers(1, &r->instanceBuffer);
+			pgGpuMemoryRemove(&r->colourMemory);
+			pgGpuMemoryRemove(&r->instanceMemory);
+		}
 		
+		pgDamageDestroy(&r->damage);
 		memset(r, 0, sizeof(struct PGRendererPrivate));
-		free(r);
+		pgMemFree(r);
 		
 		*renderer = NULL;
 	}
@@ -66,25 +195,691 @@ void pgRendererDestroy(PGRenderer *renderer)
 
 PGResult pgRendererSetup(PGRenderer renderer, int width, int height)
 {
-    // Create the framebuffer object and attach the color buffer.
-    glGenFramebuffers(NUM_FRAME_BUFFERS, &renderer->framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->framebuffer);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER,
-                              GL_COLOR_ATTACHMENT0,
-                              GL_RENDERBUFFER,
-                              renderer->renderbuffer);
+	pgDamageResize(renderer->damage, width, height);
+	if (PGB_Software == renderer->backend)
+	{
+		return pgSoftRasterResize(renderer->soft, width, height);
+	}
+	
+    // Create the framebuffer object and attach the color buffer. Setup is
+    // called again on every resize, and the attachment survives that.
+    if (0 == renderer->framebuffer)
+    {
+        glGenFramebuffers(NUM_FRAME_BUFFERS, &renderer->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, renderer->framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                  GL_COLOR_ATTACHMENT0,
+                                  GL_RENDERBUFFER,
+                                  renderer->renderbuffer);
+    }
     
-    glViewport(0, 0, width, height);
+    renderer->width = width;
+    renderer->height = height;
+    pgRendererBindFramebuffer(renderer);
 	
 	return PGR_OK;
 }
 
-PGResult pgRendererUseProgram(PGRenderer renderer, PGProgram program)
+void pgRendererBindFramebuffer(PGRenderer renderer)
+{
+	if (NULL == renderer || PGB_Software == renderer->backend) return;
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->framebuffer);
+	glViewport(0, 0, renderer->width, renderer->height);
+}
+
+PGRenderTargetPool pgRendererRenderTargets(PGRenderer renderer)
+{
+	if (NULL == renderer) return NULL;
+	
+	return renderer->targets;
+}
+
+PGResult pgRendererSetupOffscreen(PGRenderer renderer, int width, int height)
+{
+	if (NULL == renderer) return PGR_NullPointerBarf;
+	if (PGB_Software == renderer->backend) return pgRendererSetup(renderer, width, height);
+	
+	// RGBA8 is core in ES 3, and an extension before that, with the same value
+	GLenum format = GL_RGBA4;
+#ifdef GL_OES_rgb8_rgba8
+	if (PGI_Core == renderer->instancing || pgRendererHasExtension(renderer, "GL_OES_rgb8_rgba8"))
+	{
+		format = GL_RGBA8_OES;
+	}
+#endif
+	
+	glBindRenderbuffer(GL_RENDERBUFFER, renderer->renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+	pgLogAnyGlErrors("Allocated offscreen colour buffer.");
+	
+	size_t bytes = pgGpuRenderbufferBytes(format, width, height);
+	if (PG_NULL_HANDLE != renderer->colourMemory)
+	{
+		pgGpuMemoryResize(renderer->colourMemory, bytes);
+	}
+	else if (PGR_OK == pgGpuMemoryAdd(&renderer->colourMemory, PGG_RenderTarget, bytes, NULL))
+	{
+		pgGpuMemorySetLabel(renderer->colourMemory, "renderer colour buffer");
+	}
+	
+	PGResult result = pgRendererSetup(renderer, width, height);
+	if (PGR_OK != result) return result;
+	
+	// Nothing swaps the colour buffer, so it always holds the last frame
+	renderer->bufferAge = 1;
+	
+	if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))
+	{
+		pgLog(PGL_Error, "Offscreen framebuffer of %dx%d is incomplete.", width, height);
+		return PGR_CouldNotCreateBuffer;
+	}
+	return PGR_OK;
+}
+
+PGUniformBuffer pgRendererUniforms(PGRenderer renderer)
+{
+	if (NULL == renderer) return NULL;
+	
+	return renderer->uniforms;
+}
+
+PGUploadQueue pgRendererUploads(PGRenderer renderer)
+{
+	if (NULL == renderer) return NULL;
+	
+	return renderer->uploads;
+}
+
+GLboolean pgRendererHasPendingWork(PGRenderer renderer)
+{
+	if (NULL == renderer || PGB_Software == renderer->backend) return GL_FALSE;
+	
+	return pgUploadQueuePending(renderer->uploads) > 0 || pgTextureUploadsPending() > 0;
+}
+
+PGDamage pgRendererDamage(PGRenderer renderer)
+{
+	if (NULL == renderer) return NULL;
+	
+	return renderer->damage;
+}
+
+void pgRendererSetBufferAge(PGRenderer renderer, int age)
+{
+	if (NULL == renderer) return;
+	
+	renderer->bufferAge = age;
+}
+
+void pgRendererScissorRepaint(PGRenderer renderer, const PGDamageRect *rect)
+{
+	if (NULL == renderer || PGB_Software == renderer->backend) return;
+	
+	// A full repaint needs no scissor
+	GLboolean scissor = NULL != rect && !pgDamageIsFull(renderer->damage);
+	if (scissor)
+	{
+		glScissor(rect->x, rect->y, rect->width, rect->height);
+		renderer->repaintRect = *rect;
+	}
+	
+	renderer->repaintScissor = scissor;
+	
+	// The active pipeline may want the scissor it had, so it binds again
+	renderer->activePipeline = PG_NULL_HANDLE;
+	if (!renderer->pipelineStateKnown || renderer->pipelineState.raster.scissorTest != scissor)
+	{
+		// Leaves the pipeline state as known as it was
+		if (scissor) glEnable(GL_SCISSOR_TEST);
+		else glDisable(GL_SCISSOR_TEST);
+		renderer->pipelineState.raster.scissorTest = scissor;
+	}
+}
+
+GLboolean pgRendererRepaintScissor(PGRenderer renderer, PGDamageRect *rect)
+{
+	if (NULL == renderer || !renderer->repaintScissor) return GL_FALSE;
+	
+	if (NULL != rect) *rect = renderer->repaintRect;
+	return GL_TRUE;
+}
+
+PGRendererBackend pgRendererBackend(PGRenderer renderer)
+{
+	if (NULL == renderer) return PGB_OpenGLES;
+	
+	return renderer->backend;
+}
+
+PGSoftRaster pgRendererSoftRaster(PGRenderer renderer)
+{
+	if (NULL == renderer) return NULL;
+	
+	return renderer->soft;
+}
+
+void pgRendererBeginFrame(PGRenderer renderer)
+{
+	pgProfilerFrame();
+	
+	if (NULL != renderer)
+	{
+#ifndef DISABLE_pgStats
+		pgRendererEndFrame(renderer);
+		memset(&renderer->frame, 0, sizeof(PGFrameStats));
+		renderer->frame.frame = renderer->framesRecorded;
+		renderer->frameStart = pgStatsNowMicroseconds();
+		renderer->frameOpen = GL_TRUE;
+#endif
+		pgDamageBeginFrame(renderer->damage, renderer->bufferAge);
+		
+		// The software renderer never queues GL objects
+		if (PGB_Software == renderer->backend) return;
+	}
+	
+	// A renderer which falls behind the others leaves the shared state
+	// alone until it catches up
+	GLboolean advance = GL_TRUE;
+	if (NULL != renderer)
+	{
+		unsigned long frame = ++renderer->sharedFrame;
+		unsigned long shared = __atomic_load_n(&SharedFrame, __ATOMIC_ACQUIRE);
+		do
+		{
+			advance = frame > shared;
+		}
+		while (advance && !__atomic_compare_exchange_n(&SharedFrame, &shared, frame, GL_TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	}
+	
+	if (advance)
+	{
+		pgTraceFrame();
+		pgGpuMemoryUpdate();
+		pgDeleteQueueAdvanceFrame();
+		pgTextureUpdate();
+	}
+	if (NULL != renderer)
+	{
+		pgRenderTargetPoolBeginFrame(renderer->targets);
+		pgUniformBufferBeginFrame(renderer->uniforms);
+		pgUploadQueueUpdate(renderer->uploads);
+	}
+}
+
+void pgRendererEndFrame(PGRenderer renderer)
+{
+#ifndef DISABLE_pgStats
+	if (NULL == renderer || !renderer->frameOpen) return;
+	
+	PGFrameStats *frame = &renderer->frame;
+	pgStatsCollectUploads(frame);
+	frame->cpuMicroseconds = pgStatsNowMicroseconds() - renderer->frameStart;
+	renderer->history[renderer->framesRecorded % PG_STATS_HISTORY] = *frame;
+	renderer->framesRecorded++;
+	renderer->frameOpen = GL_FALSE;
+#endif
+}
+
+unsigned long pgRendererStatsHistory(PGRenderer renderer, PGFrameStats *frames, unsigned long maxFrames)
+{
+	if (NULL == renderer || NULL == frames) return 0;
+	
+	unsigned long count = renderer->framesRecorded;
+	if (count > PG_STATS_HISTORY) count = PG_STATS_HISTORY;
+	if (count > maxFrames) count = maxFrames;
+	
+	unsigned long first = renderer->framesRecorded - count;
+	for (unsigned long i = 0; i < count; i++)
+	{
+		frames[i] = renderer->history[(first + i) % PG_STATS_HISTORY];
+	}
+	return count;
+}
+
+PGResult pgRendererStatsSnapshot(PGRenderer renderer, unsigned long frames, PGStatsSnapshot *snapshot)
+{
+	if (NULL == renderer || NULL == snapshot) return PGR_NullPointerBarf;
+	
+	PGFrameStats recent[PG_STATS_HISTORY];
+	unsigned long count = pgRendererStatsHistory(renderer, recent, frames);
+	pgStatsSummarize(recent, count, snapshot);
+	return PGR_OK;
+}
+
+static void useProgram(PGRenderer renderer, PGProgram program)
 {
 	if(program != renderer->activeProgram)
 	{
-		glUseProgram(pgProgramGlHandle(program));
+		if (PGB_OpenGLES == renderer->backend)
+		{
+			glUseProgram(pgProgramGlHandle(program));
+		}
 		renderer->activeProgram = program;
+		pgStatsCount(&renderer->frame, programBinds, 1);
+	}
+	else
+	{
+		pgStatsCount(&renderer->frame, redundantProgramBinds, 1);
+	}
+}
+
+PGResult pgRendererUseProgram(PGRenderer renderer, PGProgram program)
+{
+	useProgram(renderer, program);
+	renderer->activePipeline = PG_NULL_HANDLE;
+	return PGR_OK;
+}
+
+PGResult pgRendererBindPipeline(PGRenderer renderer, PGPipeline pipeline)
+{
+	if (NULL == renderer) return PGR_NullPointerBarf;
+	if (pipeline == renderer->activePipeline && renderer->pipelineStateKnown)
+	{
+		pgStatsCount(&renderer->frame, redundantPipelineBinds, 1);
+		return PGR_OK;
+	}
+	
+	const PGPipelineDesc *desc = pgPipelineDescription(pipeline);
+	if (NULL == desc) return PGR_StaleHandle;
+	
+	useProgram(renderer, desc->program);
+	renderer->activePipeline = pipeline;
+	pgStatsCount(&renderer->frame, pipelineBinds, 1);
+	
+	// The software rasterizer has no fixed function state to set
+	if (PGB_Software == renderer->backend) return PGR_OK;
+	
+	// Repaints stay scissored to the damage
+	PGPipelineDesc scissored;
+	if (renderer->repaintScissor && !desc->raster.scissorTest)
+	{
+		scissored = *desc;
+		scissored.raster.scissorTest = GL_TRUE;
+		desc = &scissored;
+	}
+	
+	unsigned long changes = pgPipelineApplyState(desc, &renderer->pipelineState, !renderer->pipelineStateKnown);
+	renderer->pipelineStateKnown = GL_TRUE;
+	pgStatsCount(&renderer->frame, stateChanges, changes);
+	return PGR_OK;
+}
+
+void pgRendererInvalidateState(PGRenderer renderer)
+{
+	if (NULL == renderer) return;
+	
+	renderer->activePipeline = PG_NULL_HANDLE;
+	renderer->pipelineStateKnown = GL_FALSE;
+}
+
+/**
+ * Enables the mesh's attributes, at the locations the bound pipeline
+ * looked up if it has the mesh's layout.
+ */
+static GLuint enableMesh(PGRenderer renderer, PGMesh mesh)
+{
+	if (PG_NULL_HANDLE != renderer->activePipeline)
+	{
+		const GLint *locations = pgPipelineMeshLocations(renderer->activePipeline, mesh);
+		if (NULL != locations) return pgMeshEnableLocations(mesh, locations);
+	}
+	return pgMeshEnableAttributes(mesh, renderer->activeProgram);
+}
+
+PGResult pgRendererSetUniformMatrix4(PGRenderer renderer, const char *name, const GLfloat matrix[16])
+{
+	if (NULL == renderer || NULL == name || NULL == matrix) return PGR_NullPointerBarf;
+	pgStatsCount(&renderer->frame, uniformUploads, 1);
+	
+	if (PGB_Software == renderer->backend)
+	{
+		// The software pipeline only has the two mvp_col matrices
+		if (0 == strcmp(name, "projectionMatrix"))
+		{
+			pgSoftRasterSetProjection(renderer->soft, matrix);
+		}
+		else if (0 == strcmp(name, "modelViewMatrix"))
+		{
+			pgSoftRasterSetModelView(renderer->soft, matrix);
+		}
+		else
+		{
+			return PGR_MissingUniform;
+		}
+		return PGR_OK;
+	}
+	
+	if (!pgProgramIsValid(renderer->activeProgram)) return PGR_NoActiveProgram;
+	
+	GLint location = pgProgramUniformLocation(renderer->activeProgram, name);
+	if (location < 0) return PGR_MissingUniform;
+	
+	glUniformMatrix4fv(location, 1, GL_FALSE, matrix);
+	return PGR_OK;
+}
+
+void pgRendererClear(PGRenderer renderer, GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	if (NULL == renderer) return;
+	
+	if (PGB_Software == renderer->backend)
+	{
+		const GLfloat color[4] = { red, green, blue, alpha };
+		pgSoftRasterClear(renderer->soft, color);
+		return;
+	}
+	
+	pgProfileGpuZone(__func__);
+	glClearColor(red, green, blue, alpha);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void pgRendererFlush(PGRenderer renderer)
+{
+	if (NULL == renderer) return;
+	
+	if (PGB_Software == renderer->backend)
+	{
+		pgSoftRasterFlush(renderer->soft);
+		return;
+	}
+	
+	glFlush();
+}
+
+void pgRendererReadPixels(PGRenderer renderer, int x, int y, int width, int height, GLubyte *pixels)
+{
+	if (NULL == renderer || NULL == pixels) return;
+	pgProfileZone(__func__);
+	
+	if (PGB_Software == renderer->backend)
+	{
+		pgSoftRasterReadPixels(renderer->soft, x, y, width, height, pixels);
+		return;
+	}
+	
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+static PGResult drawSoftware(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount)
+{
+	PGVertexAttrib position, color;
+	if (!pgMeshFindAttribute(mesh, "position", &position)) return PGR_MissingAttribute;
+	GLboolean hasColor = pgMeshFindAttribute(mesh, "color", &color);
+	
+	const GLvoid *vertices = pgMeshVertices(mesh);
+	GLsizei stride = pgMeshStride(mesh);
+	GLsizei count = pgMeshVertexCount(mesh);
+	GLsizei copies = NULL == instances ? 1 : instanceCount;
+	pgStatsCount(&renderer->frame, drawCalls, copies);
+	pgStatsCount(&renderer->frame, instances, copies);
+	pgStatsCount(&renderer->frame, vertices, count * copies);
+	
+	if (NULL == instances)
+	{
+		return pgSoftRasterDraw(renderer->soft, mode, vertices, stride, count, &position, hasColor ? &color : NULL, NULL);
+	}
+	
+	for (GLsizei i = 0; i < instanceCount; i++)
+	{
+		PGResult result = pgSoftRasterDraw(renderer->soft, mode, vertices, stride, count, &position, hasColor ? &color : NULL, &instances[i]);
+		if (PGR_OK != result) return result;
 	}
 	return PGR_OK;
 }
+
+GLboolean pgRendererHasExtension(PGRenderer renderer, const char *extension)
+{
+	if (NULL == extension) return GL_FALSE;
+	
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	if (NULL == extensions) return GL_FALSE;
+	
+	// Match whole, space separated names only so that, for example,
+	// GL_EXT_foo doesn't match GL_EXT_foo_bar
+	size_t length = strlen(extension);
+	const char *found = extensions;
+	while (NULL != (found = strstr(found, extension)))
+	{
+		GLboolean startsName = (found == extensions || ' ' == found[-1]);
+		GLboolean endsName = ('\0' == found[length] || ' ' == found[length]);
+		if (startsName && endsName) return GL_TRUE;
+		found += length;
+	}
+	return GL_FALSE;
+}
+
+PGInstancingSupport pgRendererInstancingSupport(PGRenderer renderer)
+{
+	if (NULL == renderer) return PGI_None;
+	
+	return renderer->instancing;
+}
+
+PGResult pgRendererDrawMesh(PGRenderer renderer, PGMesh mesh, GLenum mode)
+{
+	if (NULL == renderer || PG_NULL_HANDLE == mesh) return PGR_NullPointerBarf;
+	if (!pgMeshIsValid(mesh)) return PGR_StaleHandle;
+	if (PGB_Software == renderer->backend) return drawSoftware(renderer, mesh, mode, NULL, 0);
+	if (!pgProgramIsValid(renderer->activeProgram)) return PGR_NoActiveProgram;
+	pgProfileZone(__func__);
+	pgProfileGpuZone(__func__);
+	
+	PGResult uniforms = pgUniformBufferApply(renderer->uniforms, renderer->activeProgram);
+	if (PGR_InvalidProgram == uniforms) return uniforms;
+	GLuint enabled = enableMesh(renderer, mesh);
+	glDrawArrays(mode, 0, pgMeshVertexCount(mesh));
+	pgMeshDisableAttributes(enabled);
+	
+	pgStatsCount(&renderer->frame, drawCalls, 1);
+	pgStatsCount(&renderer->frame, instances, 1);
+	pgStatsCount(&renderer->frame, vertices, pgMeshVertexCount(mesh));
+	
+	return PGR_OK;
+}
+
+static void setInstanceDivisor(PGRenderer renderer, GLuint location, GLuint divisor)
+{
+#ifdef GL_ES_VERSION_3_0
+	if (PGI_Core == renderer->instancing)
+	{
+		glVertexAttribDivisor(location, divisor);
+		return;
+	}
+#endif
+#ifdef GL_EXT_instanced_arrays
+	glVertexAttribDivisorEXT(location, divisor);
+#endif
+}
+
+static void drawArraysInstanced(PGRenderer renderer, GLenum mode, GLsizei count, GLsizei instanceCount)
+{
+#ifdef GL_ES_VERSION_3_0
+	if (PGI_Core == renderer->instancing)
+	{
+		glDrawArraysInstanced(mode, 0, count, instanceCount);
+		return;
+	}
+#endif
+#ifdef GL_EXT_instanced_arrays
+	glDrawArraysInstancedEXT(mode, 0, count, instanceCount);
+#endif
+}
+
+static PGResult drawHardwareInstanced(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount)
+{
+	PGProgram program = renderer->activeProgram;
+	GLsizeiptr bytes = (GLsizeiptr)sizeof(PGInstance) * instanceCount;
+	
+	if (0 == renderer->instanceBuffer)
+	{
+		glGenBuffers(1, &renderer->instanceBuffer);
+		if (0 == renderer->instanceBuffer)
+		{
+			pgLogAnyGlErrors("Could not create instance buffer.");
+			return PGR_CouldNotCreateBuffer;
+		}
+	}
+	
+	// Orphan the old contents rather than overwriting storage a previous
+	// draw may still be reading from
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->instanceBuffer);
+	if (bytes > renderer->instanceBufferSize)
+	{
+		renderer->instanceBufferSize = bytes;
+		if (PG_NULL_HANDLE != renderer->instanceMemory)
+		{
+			pgGpuMemoryResize(renderer->instanceMemory, (size_t)bytes);
+		}
+		else if (PGR_OK == pgGpuMemoryAdd(&renderer->instanceMemory, PGG_Buffer, (size_t)bytes, NULL))
+		{
+			pgGpuMemorySetLabel(renderer->instanceMemory, "renderer instances");
+		}
+	}
+	glBufferData(GL_ARRAY_BUFFER, renderer->instanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances);
+	pgStatsCount(&renderer->frame, bufferUploads, 1);
+	pgStatsCount(&renderer->frame, bufferBytes, bytes);
+	
+	GLuint instanceEnabled = 0;
+	for (GLuint i = 0; i < NUM_INSTANCE_ATTRIBS; i++)
+	{
+		GLint location = pgProgramAttribLocation(program, InstanceAttribNames[i]);
+		if (location < 0 || location >= 32) continue;
+		
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(PGInstance), (const GLvoid *)(intptr_t)(i * 4 * sizeof(GLfloat)));
+		setInstanceDivisor(renderer, location, 1);
+		instanceEnabled |= 1u << location;
+	}
+	
+	GLuint meshEnabled = enableMesh(renderer, mesh);
+	drawArraysInstanced(renderer, mode, pgMeshVertexCount(mesh), instanceCount);
+	pgLogAnyGlErrors("Instanced draw.");
+	pgStatsCount(&renderer->frame, drawCalls, 1);
+	pgStatsCount(&renderer->frame, instances, instanceCount);
+	pgStatsCount(&renderer->frame, vertices, pgMeshVertexCount(mesh) * instanceCount);
+	
+	// Divisors are sticky per attribute location, so put them back before
+	// a non-instanced draw picks the location up
+	for (GLuint location = 0, mask = instanceEnabled; mask != 0; location++, mask >>= 1)
+	{
+		if (mask & 1u) setInstanceDivisor(renderer, location, 0);
+	}
+	pgMeshDisableAttributes(meshEnabled | instanceEnabled);
+	
+	return PGR_OK;
+}
+
+static GLint batchDataLocation(PGProgram program, GLsizei *instancesPerBatch)
+{
+	// Arrays are reported by GL as name[0], but allow for drivers which
+	// report the bare name too.
+	const char *name = "instanceData[0]";
+	GLint location = pgProgramUniformLocation(program, name);
+	if (location < 0)
+	{
+		name = "instanceData";
+		location = pgProgramUniformLocation(program, name);
+	}
+	if (location >= 0)
+	{
+		*instancesPerBatch = pgProgramUniformSize(program, name) / INSTANCE_VECTORS;
+	}
+	return location;
+}
+
+static GLboolean isListPrimitive(GLenum mode)
+{
+	return GL_TRIANGLES == mode || GL_LINES == mode || GL_POINTS == mode;
+}
+
+static PGResult drawBatched(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount, GLint dataLocation, GLsizei instancesPerBatch)
+{
+	PGProgram program = renderer->activeProgram;
+	GLint indexLocation = pgProgramAttribLocation(program, "instanceIndex");
+	if (indexLocation < 0) return PGR_MissingAttribute;
+	
+	GLsizei copies = instanceCount < instancesPerBatch ? instanceCount : instancesPerBatch;
+	GLuint enabled = pgMeshEnableBatchAttributes(mesh, program, copies, indexLocation);
+	if (0 == enabled) return PGR_CouldNotCreateBuffer;
+	
+	GLsizei vertexCount = pgMeshVertexCount(mesh);
+	for (GLsizei first = 0; first < instanceCount; first += instancesPerBatch)
+	{
+		GLsizei batch = instanceCount - first;
+		if (batch > instancesPerBatch) batch = instancesPerBatch;
+		
+		glUniform4fv(dataLocation, batch * INSTANCE_VECTORS, &instances[first].transform[0][0]);
+		glDrawArrays(mode, 0, vertexCount * batch);
+		pgStatsCount(&renderer->frame, uniformUploads, 1);
+		pgStatsCount(&renderer->frame, drawCalls, 1);
+	}
+	pgStatsCount(&renderer->frame, instances, instanceCount);
+	pgStatsCount(&renderer->frame, vertices, vertexCount * instanceCount);
+	pgLogAnyGlErrors("Batched instance draw.");
+	pgMeshDisableAttributes(enabled);
+	
+	return PGR_OK;
+}
+
+static PGResult drawConstantInstanced(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount)
+{
+	PGProgram program = renderer->activeProgram;
+	GLint locations[NUM_INSTANCE_ATTRIBS];
+	for (GLuint i = 0; i < NUM_INSTANCE_ATTRIBS; i++)
+	{
+		locations[i] = pgProgramAttribLocation(program, InstanceAttribNames[i]);
+	}
+	if (locations[0] < 0) return PGR_MissingAttribute;
+	
+	GLuint enabled = enableMesh(renderer, mesh);
+	GLsizei vertexCount = pgMeshVertexCount(mesh);
+	for (GLsizei instance = 0; instance < instanceCount; instance++)
+	{
+		const GLfloat *data = &instances[instance].transform[0][0];
+		for (GLuint i = 0; i < NUM_INSTANCE_ATTRIBS; i++)
+		{
+			if (locations[i] >= 0) glVertexAttrib4fv(locations[i], data + i * 4);
+		}
+		glDrawArrays(mode, 0, vertexCount);
+	}
+	pgMeshDisableAttributes(enabled);
+	pgStatsCount(&renderer->frame, drawCalls, instanceCount);
+	pgStatsCount(&renderer->frame, instances, instanceCount);
+	pgStatsCount(&renderer->frame, vertices, vertexCount * instanceCount);
+	
+	return PGR_OK;
+}
+
+PGResult pgRendererDrawInstanced(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount)
+{
+	if (NULL == renderer || PG_NULL_HANDLE == mesh || NULL == instances) return PGR_NullPointerBarf;
+	if (!pgMeshIsValid(mesh)) return PGR_StaleHandle;
+	if (instanceCount <= 0) return PGR_OK;
+	if (PGB_Software == renderer->backend) return drawSoftware(renderer, mesh, mode, instances, instanceCount);
+	if (!pgProgramIsValid(renderer->activeProgram)) return PGR_NoActiveProgram;
+	pgProfileZone(__func__);
+	pgProfileGpuZone(__func__);
+	
+	PGProgram program = renderer->activeProgram;
+	PGResult uniforms = pgUniformBufferApply(renderer->uniforms, program);
+	if (PGR_InvalidProgram == uniforms) return uniforms;
+	GLboolean hasInstanceAttribs = pgProgramAttribLocation(program, InstanceAttribNames[0]) >= 0;
+	
+	if (PGI_None != renderer->instancing && hasInstanceAttribs)
+	{
+		return drawHardwareInstanced(renderer, mesh, mode, instances, instanceCount);
+	}
+	
+	GLsizei instancesPerBatch = 0;
+	GLint dataLocation = batchDataLocation(program, &instancesPerBatch);
+	if (dataLocation >= 0 && instancesPerBatch > 0 && isListPrimitive(mode))
+	{
+		return drawBatched(renderer, mesh, mode, instances, instanceCount, dataLocation, instancesPerBatch);
+	}
+	
+	return drawConstantInstanced(renderer, mesh, mode, instances, instanceCount);
+}
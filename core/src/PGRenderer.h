@@ -12,12 +12,223 @@
 extern "C" {
 #endif
 	
+	typedef enum
+	{
+		PGB_OpenGLES = 0
+	,	PGB_Software	// PGSoftRaster, no GL context needed
+	}
+	PGRendererBackend;
+
+	typedef enum
+	{
+		PGI_None = 0	// No hardware instancing; instances go through uniform arrays
+	,	PGI_Extension	// GL_EXT_instanced_arrays
+	,	PGI_Core		// OpenGL ES 3.0
+	}
+	PGInstancingSupport;
+
+	/**
+	 * Per instance data for pgRendererDrawInstanced. With hardware instancing
+	 * each member is streamed to the attribute of the same name in the
+	 * active program (instanceTransform0, instanceTransform1, instanceColor,
+	 * instanceUVRect). The transform rows are the top two rows of a 2D affine
+	 * transform, (a, b, 0, tx) and (c, d, 0, ty).
+	 *
+	 * The layout is also the layout of the `instanceData` vec4 uniform array
+	 * used by the batched fallback, four vectors per instance.
+	 */
+	typedef struct
+	{
+		GLfloat transform[2][4];
+		GLfloat color[4];
+		GLfloat uvRect[4];
+	}
+	PGInstance;
+
 	PGResult pgRendererCreate(PGRenderer *renderer);
+
+	/**
+	 * Creates a renderer which draws on the CPU with PGSoftRaster, for
+	 * machines without a GPU. Meshes draw as mvp_col would, or as
+	 * mvp_col_instanced for pgRendererDrawInstanced, whichever program is
+	 * in use. Tiles are shared out over `jobs`, which may be NULL. Call
+	 * pgRendererSetup to size the framebuffer before drawing.
+	 */
+	PGResult pgRendererCreateSoftware(PGRenderer *renderer, PGJobScheduler jobs);
+
+	/**
+	 * The delete queue and texture placeholder are shared by every GL
+	 * renderer, so they are only emptied when the last one is destroyed.
+	 * GL renderers alive at the same time should be in one share group.
+	 */
 	void pgRendererDestroy(PGRenderer *renderer);
 	
 	PGResult pgRendererSetup(PGRenderer renderer, int width, int height);
-	
+
+	/**
+	 * Like pgRendererSetup, but allocates the colour buffer itself as RGBA8,
+	 * for contexts with no window such as EGL pbuffer or surfaceless ones.
+	 */
+	PGResult pgRendererSetupOffscreen(PGRenderer renderer, int width, int height);
+
+	/**
+	 * Binds the renderer's own framebuffer again after drawing into a
+	 * render target, and sets the viewport back to its size.
+	 */
+	void pgRendererBindFramebuffer(PGRenderer renderer);
+
+	/**
+	 * The renderer's pool of offscreen render targets. NULL for the
+	 * software backend.
+	 */
+	PGRenderTargetPool pgRendererRenderTargets(PGRenderer renderer);
+
+	/**
+	 * The uniforms shared by every program, applied before each draw. NULL
+	 * for the software backend.
+	 */
+	PGUniformBuffer pgRendererUniforms(PGRenderer renderer);
+
+	/**
+	 * Buffer and texture updates spread over frames within a budget. NULL
+	 * for the software backend.
+	 */
+	PGUploadQueue pgRendererUploads(PGRenderer renderer);
+
+	/**
+	 * True while textures are streaming in or uploads are queued, which
+	 * only move on in pgRendererBeginFrame. For a frame scheduler's
+	 * workPending callback; loads queued with pgContextLoad are the
+	 * caller's to add.
+	 */
+	GLboolean pgRendererHasPendingWork(PGRenderer renderer);
+
+	/**
+	 * Where changes are reported, with pgDamageAdd, for partial redraws.
+	 * Each frame, call pgRendererScissorRepaint with pgDamageRepaintBounds,
+	 * draw the scene once, then call pgRendererScissorRepaint with NULL.
+	 * Scenes cheap enough to draw more than once can instead draw once per
+	 * rect of pgDamageRepaintRects, scissored to each, to touch fewer
+	 * pixels. With nothing to repaint nothing changed and the frame need
+	 * not be drawn or presented.
+	 */
+	PGDamage pgRendererDamage(PGRenderer renderer);
+
+	/**
+	 * How many frames old the back buffer's contents are when the next
+	 * frame begins: 1 if presenting preserves them, as with retained
+	 * backing, N as reported by EGL_EXT_buffer_age, or 0 if they can't be
+	 * relied on, which repaints everything. 0 until set, except for
+	 * pgRendererSetupOffscreen's colour buffer, which is never swapped.
+	 */
+	void pgRendererSetBufferAge(PGRenderer renderer, int age);
+
+	/**
+	 * Scissors drawing to a rect of the repaint, until called with NULL.
+	 * Pipelines bound meanwhile keep the scissor whatever their raster
+	 * state, so ones which scissor themselves should stay within the
+	 * rect. Does nothing for full repaints or the software backend.
+	 */
+	void pgRendererScissorRepaint(PGRenderer renderer, const PGDamageRect *rect);
+
+	/**
+	 * True while a repaint is scissored, with the rect it is scissored to.
+	 * Whatever clears or discards the framebuffer should keep to it, as
+	 * the rest still shows earlier frames.
+	 */
+	GLboolean pgRendererRepaintScissor(PGRenderer renderer, PGDamageRect *rect);
+
+	PGRendererBackend pgRendererBackend(PGRenderer renderer);
+
+	/**
+	 * The software rasterizer, for its stats. NULL for GL renderers.
+	 */
+	PGSoftRaster pgRendererSoftRaster(PGRenderer renderer);
+
+	/**
+	 * Call at the start of every frame. Deletes GL objects which were
+	 * destroyed PG_FRAMES_IN_FLIGHT frames ago, trims idle render targets,
+	 * uploads the frame's share of the textures still loading and of the
+	 * upload queue, and works out what the frame must repaint.
+	 *
+	 * Renderers drawing the same frames each call this once a frame. The
+	 * delete queue, GPU memory ages and texture streaming are shared by
+	 * every renderer, and move on once per frame, with the first renderer
+	 * to begin it.
+	 */
+	void pgRendererBeginFrame(PGRenderer renderer);
+
+	/**
+	 * Closes the frame's stats. Optional: call it after the last draw to
+	 * time only the renderer's own work, otherwise the frame runs until
+	 * the next pgRendererBeginFrame.
+	 */
+	void pgRendererEndFrame(PGRenderer renderer);
+
+	/**
+	 * Copies the stats of up to `maxFrames` of the most recent finished
+	 * frames, oldest first, and returns how many were copied. At most
+	 * PG_STATS_HISTORY frames are kept. Nothing is kept when built with
+	 * DISABLE_pgStats.
+	 */
+	unsigned long pgRendererStatsHistory(PGRenderer renderer, PGFrameStats *frames, unsigned long maxFrames);
+
+	/**
+	 * Summarizes the last `frames` finished frames, with percentiles of
+	 * their CPU time.
+	 */
+	PGResult pgRendererStatsSnapshot(PGRenderer renderer, unsigned long frames, PGStatsSnapshot *snapshot);
+
 	PGResult pgRendererUseProgram(PGRenderer renderer, PGProgram program);
+
+	/**
+	 * Uses the pipeline's program and sets only the blend, depth, stencil
+	 * and raster state which differs from what the renderer last set.
+	 * Binding the pipeline already bound does nothing.
+	 */
+	PGResult pgRendererBindPipeline(PGRenderer renderer, PGPipeline pipeline);
+
+	/**
+	 * For code which changes GL state behind the renderer's back. The next
+	 * pipeline bound sets all of its state.
+	 */
+	void pgRendererInvalidateState(PGRenderer renderer);
+
+	/**
+	 * Sets a mat4 uniform on the active program. The software backend only
+	 * knows projectionMatrix and modelViewMatrix.
+	 */
+	PGResult pgRendererSetUniformMatrix4(PGRenderer renderer, const char *name, const GLfloat matrix[16]);
+
+	void pgRendererClear(PGRenderer renderer, GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
+	/**
+	 * Submits queued work. The software backend rasterizes here.
+	 */
+	void pgRendererFlush(PGRenderer renderer);
+
+	/**
+	 * Reads RGBA8 pixels, bottom row first, like glReadPixels. Waits for
+	 * everything drawn so far.
+	 */
+	void pgRendererReadPixels(PGRenderer renderer, int x, int y, int width, int height, GLubyte *pixels);
+	
+	GLboolean pgRendererHasExtension(PGRenderer renderer, const char *extension);
+	PGInstancingSupport pgRendererInstancingSupport(PGRenderer renderer);
+
+	PGResult pgRendererDrawMesh(PGRenderer renderer, PGMesh mesh, GLenum mode);
+
+	/**
+	 * Draws `instanceCount` copies of the mesh with the active program.
+	 *
+	 * If the program declares instanceTransform0 and the device supports
+	 * instancing, all instances go out in a single instanced draw. If the
+	 * program instead declares an `instanceData` uniform array and an
+	 * `instanceIndex` attribute, instances are drawn in batches sized to fit
+	 * the array (list primitives only). Otherwise each instance is drawn on
+	 * its own with the instance attributes set as constant vertex values.
+	 */
+	PGResult pgRendererDrawInstanced(PGRenderer renderer, PGMesh mesh, GLenum mode, const PGInstance *instances, GLsizei instanceCount);
 	
 	
 #ifdef __cplusplus
@@ -0,0 +1,906 @@
+//
+//  PGSoftRaster.c
+//
+//  Created by David Wagner on 15/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include "Pictogram.h"
+
+// Vertices snap to 1/16th of a pixel
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+
+// Pixels shaded per step
+#define SPAN 8
+
+// Triangles are clipped to this far outside the framebuffer, which keeps
+// the fixed point edge functions well inside 64 bits
+#define GUARD_BAND_PIXELS 8192.0f
+
+// Triangles per binning job
+#define BIN_CHUNK 512
+
+// Clipping against the near, far and guard band planes can add a vertex per plane
+#define MAX_CLIPPED_VERTICES 12
+
+typedef int64_t v8l __attribute__((vector_size(8 * sizeof(int64_t))));
+typedef int32_t v8i __attribute__((vector_size(8 * sizeof(int32_t))));
+typedef uint32_t v8u __attribute__((vector_size(8 * sizeof(uint32_t))));
+typedef float v8f __attribute__((vector_size(8 * sizeof(float))));
+
+// What the vertex stage hands on: clip position and colour
+struct PGSoftVertex {
+	GLfloat clip[4];
+	GLfloat color[4];
+};
+
+enum {
+	PLANE_ONE_OVER_W = 0,
+	PLANE_RED,
+	PLANE_GREEN,
+	PLANE_BLUE,
+	PLANE_ALPHA,
+	NUM_PLANES
+};
+
+struct PGSoftTriangle {
+	// Edge functions a * x + b * y + c over subpixel coordinates, which are
+	// non-negative inside the triangle. The fill rule bias is folded into c.
+	int64_t a[3];
+	int64_t b[3];
+	int64_t c[3];
+
+	// Inclusive pixel bounds, clipped to the framebuffer
+	int minX, minY, maxX, maxY;
+
+	// 1/w and colour/w as planes over pixel coordinates, relative to the
+	// first vertex, for perspective correct colour
+	GLfloat originX, originY;
+	GLfloat plane[NUM_PLANES][3];
+};
+
+struct PGSoftRasterPrivate {
+	PGJobScheduler jobs;
+
+	int width;
+	int height;
+	int stride;				// Pixels per row, padded to whole tiles
+	int tilesX;
+	int tilesY;
+	uint32_t *pixels;
+
+	GLfloat projection[16];
+	GLfloat modelView[16];
+
+	int clearPending;
+	uint32_t clearColor;
+
+	struct PGSoftTriangle *triangles;
+	size_t triangleCount;
+	size_t triangleCapacity;
+
+	// Binning. Counts and offsets are per chunk of triangles per tile, and
+	// each tile's triangle indices end up contiguous and in draw order.
+	uint32_t *binCounts;
+	uint32_t *binOffsets;
+	size_t binCapacity;
+	uint32_t *tileFirst;
+	uint32_t *binIndices;
+	size_t binIndexCapacity;
+
+	PGSoftRasterStats stats;
+	uint64_t busyMicroseconds;
+};
+
+static const GLfloat Identity[16] = {
+	1, 0, 0, 0,
+	0, 1, 0, 0,
+	0, 0, 1, 0,
+	0, 0, 0, 1,
+};
+
+static uint64_t nowMicroseconds(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000u + now.tv_usec;
+}
+
+static uint32_t packColor(const GLfloat color[4])
+{
+	uint32_t packed = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		GLfloat c = color[i] < 0 ? 0 : (color[i] > 1 ? 1 : color[i]);
+		packed |= (uint32_t)(c * 255.0f + 0.5f) << (8 * i);
+	}
+	return packed;
+}
+
+PGResult pgSoftRasterCreate(PGSoftRaster *raster, PGJobScheduler jobs)
+{
+	if (NULL == raster) return PGR_NullPointerBarf;
+	*raster = NULL;
+
+	PGSoftRaster r = pgMemAlloc(sizeof(struct PGSoftRasterPrivate), PGM_Renderer);
+	if (NULL == r) return PGR_OutOfMemory;
+	memset(r, 0, sizeof(struct PGSoftRasterPrivate));
+
+	r->jobs = jobs;
+	memcpy(r->projection, Identity, sizeof(Identity));
+	memcpy(r->modelView, Identity, sizeof(Identity));
+
+	*raster = r;
+	return PGR_OK;
+}
+
+void pgSoftRasterDestroy(PGSoftRaster *raster)
+{
+	if (NULL != raster && NULL != *raster)
+	{
+		PGSoftRaster r = *raster;
+
+		pgMemFree(r->pixels);
+		pgMemFree(r->triangles);
+		pgMemFree(r->binCounts);
+		pgMemFree(r->binOffsets);
+		pgMemFree(r->tileFirst);
+		pgMemFree(r->binIndices);
+
+		memset(r, 0, sizeof(struct PGSoftRasterPrivate));
+		pgMemFree(r);
+
+		*raster = NULL;
+	}
+}
+
+PGResult pgSoftRasterResize(PGSoftRaster raster, int width, int height)
+{
+	if (NULL == raster) return PGR_NullPointerBarf;
+	if (width <= 0 || height <= 0 || width > PG_SOFT_MAX_SIZE || height > PG_SOFT_MAX_SIZE)
+	{
+		pgLog(PGL_Error, "Software framebuffer size %dx%d out of range.", width, height);
+		return PGR_LazyGenericError;
+	}
+
+	int tilesX = (width + PG_SOFT_TILE_SIZE - 1) / PG_SOFT_TILE_SIZE;
+	int tilesY = (height + PG_SOFT_TILE_SIZE - 1) / PG_SOFT_TILE_SIZE;
+	int stride = tilesX * PG_SOFT_TILE_SIZE;
+
+	// Whole tiles, so spans never need bounds checks
+	uint32_t *pixels = pgMemAllocAligned(sizeof(uint32_t) * stride * tilesY * PG_SOFT_TILE_SIZE, 64, PGM_Renderer);
+	uint32_t *tileFirst = pgMemAlloc(sizeof(uint32_t) * (tilesX * tilesY + 1), PGM_Renderer);
+	if (NULL == pixels || NULL == tileFirst)
+	{
+		pgMemFree(pixels);
+		pgMemFree(tileFirst);
+		return PGR_OutOfMemory;
+	}
+
+	pgMemFree(raster->pixels);
+	pgMemFree(raster->tileFirst);
+	raster->pixels = pixels;
+	raster->tileFirst = tileFirst;
+	raster->width = width;
+	raster->height = height;
+	raster->stride = stride;
+	raster->tilesX = tilesX;
+	raster->tilesY = tilesY;
+
+	// Queued triangles were set up for the old size
+	raster->triangleCount = 0;
+
+	return PGR_OK;
+}
+
+void pgSoftRasterSetProjection(PGSoftRaster raster, const GLfloat matrix[16])
+{
+	if (NULL == raster || NULL == matrix) return;
+
+	memcpy(raster->projection, matrix, sizeof(raster->projection));
+}
+
+void pgSoftRasterSetModelView(PGSoftRaster raster, const GLfloat matrix[16])
+{
+	if (NULL == raster || NULL == matrix) return;
+
+	memcpy(raster->modelView, matrix, sizeof(raster->modelView));
+}
+
+void pgSoftRasterClear(PGSoftRaster raster, const GLfloat color[4])
+{
+	if (NULL == raster || NULL == color) return;
+
+	raster->clearPending = 1;
+	raster->clearColor = packColor(color);
+	raster->triangleCount = 0;
+}
+
+// Vertex stage ////////////////////////////////////////////////////////////
+
+static void fetchAttribute(const GLubyte *vertex, const PGVertexAttrib *attrib, GLfloat out[4])
+{
+	out[0] = 0;
+	out[1] = 0;
+	out[2] = 0;
+	out[3] = 1;
+	if (NULL == attrib) return;
+
+	const GLubyte *p = vertex + attrib->offset;
+	GLint size = attrib->size < 4 ? attrib->size : 4;
+	for (GLint i = 0; i < size; i++)
+	{
+		switch (attrib->type)
+		{
+			case GL_FLOAT:
+			{
+				GLfloat f;
+				memcpy(&f, p + i * sizeof(GLfloat), sizeof(f));
+				out[i] = f;
+				break;
+			}
+			case GL_UNSIGNED_BYTE:
+				out[i] = attrib->normalized ? p[i] / 255.0f : p[i];
+				break;
+			case GL_BYTE:
+			{
+				GLbyte b = (GLbyte)p[i];
+				out[i] = attrib->normalized ? (b < -127 ? -1.0f : b / 127.0f) : b;
+				break;
+			}
+			case GL_UNSIGNED_SHORT:
+			{
+				GLushort s;
+				memcpy(&s, p + i * sizeof(s), sizeof(s));
+				out[i] = attrib->normalized ? s / 65535.0f : s;
+				break;
+			}
+			case GL_SHORT:
+			{
+				GLshort s;
+				memcpy(&s, p + i * sizeof(s), sizeof(s));
+				out[i] = attrib->normalized ? (s < -32767 ? -1.0f : s / 32767.0f) : s;
+				break;
+			}
+		}
+	}
+}
+
+static void transform(const GLfloat m[16], const GLfloat in[4], GLfloat out[4])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		out[row] = m[row] * in[0] + m[4 + row] * in[1] + m[8 + row] * in[2] + m[12 + row] * in[3];
+	}
+}
+
+static void shadeVertex(PGSoftRaster raster, const GLubyte *vertex, const PGVertexAttrib *position, const PGVertexAttrib *color, const PGInstance *instance, struct PGSoftVertex *out)
+{
+	GLfloat in[4], local[4];
+	fetchAttribute(vertex, position, in);
+	transform(raster->modelView, in, local);
+
+	if (NULL != instance)
+	{
+		GLfloat placed[4];
+		for (int row = 0; row < 2; row++)
+		{
+			const GLfloat *t = instance->transform[row];
+			placed[row] = t[0] * local[0] + t[1] * local[1] + t[2] * local[2] + t[3] * local[3];
+		}
+		placed[2] = local[2];
+		placed[3] = local[3];
+		transform(raster->projection, placed, out->clip);
+	}
+	else
+	{
+		transform(raster->projection, local, out->clip);
+	}
+
+	if (NULL != color)
+	{
+		fetchAttribute(vertex, color, out->color);
+	}
+	else
+	{
+		// An unbound generic attribute reads as (0, 0, 0, 1)
+		out->color[0] = 0;
+		out->color[1] = 0;
+		out->color[2] = 0;
+		out->color[3] = 1;
+	}
+
+	if (NULL != instance)
+	{
+		for (int i = 0; i < 4; i++) out->color[i] *= instance->color[i];
+	}
+}
+
+// Clipping ////////////////////////////////////////////////////////////////
+
+struct PGClipPlane {
+	GLfloat x, y, z, w;
+};
+
+static GLfloat planeDistance(const struct PGClipPlane *plane, const struct PGSoftVertex *v)
+{
+	return plane->x * v->clip[0] + plane->y * v->clip[1] + plane->z * v->clip[2] + plane->w * v->clip[3];
+}
+
+static int clipPolygon(const struct PGClipPlane *plane, const struct PGSoftVertex *in, int count, struct PGSoftVertex *out)
+{
+	int outCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const struct PGSoftVertex *a = &in[i];
+		const struct PGSoftVertex *b = &in[(i + 1) % count];
+		GLfloat da = planeDistance(plane, a);
+		GLfloat db = planeDistance(plane, b);
+
+		if (da >= 0) out[outCount++] = *a;
+		if ((da >= 0) != (db >= 0))
+		{
+			GLfloat t = da / (da - db);
+			struct PGSoftVertex *v = &out[outCount++];
+			for (int k = 0; k < 4; k++)
+			{
+				v->clip[k] = a->clip[k] + (b->clip[k] - a->clip[k]) * t;
+				v->color[k] = a->color[k] + (b->color[k] - a->color[k]) * t;
+			}
+		}
+	}
+	return outCount;
+}
+
+// Triangle setup //////////////////////////////////////////////////////////
+
+struct PGScreenVertex {
+	int64_t x, y;			// Subpixels
+	GLfloat fx, fy;			// Pixels, snapped
+	GLfloat q[NUM_PLANES];	// 1/w and colour/w
+};
+
+static void toScreen(PGSoftRaster raster, const struct PGSoftVertex *v, struct PGScreenVertex *out)
+{
+	GLfloat oneOverW = 1.0f / v->clip[3];
+	GLfloat sx = (v->clip[0] * oneOverW * 0.5f + 0.5f) * raster->width;
+	GLfloat sy = (v->clip[1] * oneOverW * 0.5f + 0.5f) * raster->height;
+
+	out->x = (int64_t)lrintf(sx * SUBPIXEL_ONE);
+	out->y = (int64_t)lrintf(sy * SUBPIXEL_ONE);
+	out->fx = (GLfloat)out->x / SUBPIXEL_ONE;
+	out->fy = (GLfloat)out->y / SUBPIXEL_ONE;
+
+	out->q[PLANE_ONE_OVER_W] = oneOverW;
+	for (int i = 0; i < 4; i++)
+	{
+		out->q[PLANE_RED + i] = v->color[i] * oneOverW;
+	}
+}
+
+static struct PGSoftTriangle *newTriangle(PGSoftRaster raster)
+{
+	if (raster->triangleCount == raster->triangleCapacity)
+	{
+		size_t capacity = raster->triangleCapacity > 0 ? raster->triangleCapacity * 2 : 256;
+		struct PGSoftTriangle *triangles = pgMemAlloc(sizeof(struct PGSoftTriangle) * capacity, PGM_Renderer);
+		if (NULL == triangles) return NULL;
+		if (raster->triangleCount > 0)
+		{
+			memcpy(triangles, raster->triangles, sizeof(struct PGSoftTriangle) * raster->triangleCount);
+		}
+		pgMemFree(raster->triangles);
+		raster->triangles = triangles;
+		raster->triangleCapacity = capacity;
+	}
+	return &raster->triangles[raster->triangleCount++];
+}
+
+static PGResult setupTriangle(PGSoftRaster raster, const struct PGScreenVertex *v0, const struct PGScreenVertex *v1, const struct PGScreenVertex *v2)
+{
+	int64_t area = (v1->x - v0->x) * (v2->y - v0->y) - (v2->x - v0->x) * (v1->y - v0->y);
+	if (0 == area) return PGR_OK;
+
+	// Wind everything counter clockwise so the inside is always positive.
+	// Nothing is culled, as GL has culling off by default.
+	if (area < 0)
+	{
+		const struct PGScreenVertex *swap = v1;
+		v1 = v2;
+		v2 = swap;
+	}
+
+	int64_t minX = v0->x < v1->x ? (v0->x < v2->x ? v0->x : v2->x) : (v1->x < v2->x ? v1->x : v2->x);
+	int64_t maxX = v0->x > v1->x ? (v0->x > v2->x ? v0->x : v2->x) : (v1->x > v2->x ? v1->x : v2->x);
+	int64_t minY = v0->y < v1->y ? (v0->y < v2->y ? v0->y : v2->y) : (v1->y < v2->y ? v1->y : v2->y);
+	int64_t maxY = v0->y > v1->y ? (v0->y > v2->y ? v0->y : v2->y) : (v1->y > v2->y ? v1->y : v2->y);
+
+	// Pixels whose centres could be inside
+	int64_t pixelMinX = (minX - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+	int64_t pixelMaxX = (maxX - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+	int64_t pixelMinY = (minY - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+	int64_t pixelMaxY = (maxY - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+	if (pixelMinX < 0) pixelMinX = 0;
+	if (pixelMinY < 0) pixelMinY = 0;
+	if (pixelMaxX >= raster->width) pixelMaxX = raster->width - 1;
+	if (pixelMaxY >= raster->height) pixelMaxY = raster->height - 1;
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY) return PGR_OK;
+
+	struct PGSoftTriangle *t = newTriangle(raster);
+	if (NULL == t) return PGR_OutOfMemory;
+
+	t->minX = (int)pixelMinX;
+	t->maxX = (int)pixelMaxX;
+	t->minY = (int)pixelMinY;
+	t->maxY = (int)pixelMaxY;
+
+	const struct PGScreenVertex *v[3] = { v0, v1, v2 };
+	for (int e = 0; e < 3; e++)
+	{
+		const struct PGScreenVertex *from = v[e];
+		const struct PGScreenVertex *to = v[(e + 1) % 3];
+		int64_t a = from->y - to->y;
+		int64_t b = to->x - from->x;
+		int64_t c = (to->y - from->y) * from->x - (to->x - from->x) * from->y;
+
+		// Top left rule. Counter clockwise with y up, left edges go down and
+		// top edges go left. Pixels exactly on any other edge belong to the
+		// neighbouring triangle.
+		if (!(a > 0 || (0 == a && b < 0))) c -= 1;
+
+		t->a[e] = a;
+		t->b[e] = b;
+		t->c[e] = c;
+	}
+
+	GLfloat d1x = v1->fx - v0->fx, d1y = v1->fy - v0->fy;
+	GLfloat d2x = v2->fx - v0->fx, d2y = v2->fy - v0->fy;
+	GLfloat denominator = d1x * d2y - d2x * d1y;
+	t->originX = v0->fx;
+	t->originY = v0->fy;
+	for (int p = 0; p < NUM_PLANES; p++)
+	{
+		GLfloat dq1 = v1->q[p] - v0->q[p];
+		GLfloat dq2 = v2->q[p] - v0->q[p];
+		t->plane[p][0] = v0->q[p];
+		t->plane[p][1] = (dq1 * d2y - dq2 * d1y) / denominator;
+		t->plane[p][2] = (dq2 * d1x - dq1 * d2x) / denominator;
+	}
+
+	return PGR_OK;
+}
+
+static PGResult clipAndSetup(PGSoftRaster raster, const struct PGSoftVertex *a, const struct PGSoftVertex *b, const struct PGSoftVertex *c)
+{
+	GLfloat guardX = GUARD_BAND_PIXELS / (raster->width * 0.5f);
+	GLfloat guardY = GUARD_BAND_PIXELS / (raster->height * 0.5f);
+	const struct PGClipPlane planes[] = {
+		{ 0, 0, 1, 1 },				// Near, z >= -w
+		{ 0, 0, -1, 1 },			// Far, z <= w
+		{ -1, 0, 0, guardX },		// Guard band, which also keeps w positive
+		{ 1, 0, 0, guardX },
+		{ 0, -1, 0, guardY },
+		{ 0, 1, 0, guardY },
+	};
+	const int numPlanes = sizeof(planes) / sizeof(planes[0]);
+
+	struct PGSoftVertex buffers[2][MAX_CLIPPED_VERTICES];
+	struct PGSoftVertex *polygon = buffers[0];
+	int count = 3;
+	int clipped = 0;
+	polygon[0] = *a;
+	polygon[1] = *b;
+	polygon[2] = *c;
+
+	for (int p = 0; p < numPlanes && count >= 3; p++)
+	{
+		GLfloat da = planeDistance(&planes[p], a);
+		GLfloat db = planeDistance(&planes[p], b);
+		GLfloat dc = planeDistance(&planes[p], c);
+		if (da < 0 && db < 0 && dc < 0) return PGR_OK;
+		if (!clipped && da >= 0 && db >= 0 && dc >= 0) continue;
+
+		struct PGSoftVertex *out = (polygon == buffers[0]) ? buffers[1] : buffers[0];
+		count = clipPolygon(&planes[p], polygon, count, out);
+		polygon = out;
+		clipped = 1;
+	}
+	if (count < 3) return PGR_OK;
+
+	// Anything with w this small is at the camera, and the near plane
+	// should already have removed it
+	for (int i = 0; i < count; i++)
+	{
+		if (polygon[i].clip[3] < 1e-6f) return PGR_OK;
+	}
+
+	struct PGScreenVertex screen[MAX_CLIPPED_VERTICES];
+	for (int i = 0; i < count; i++)
+	{
+		toScreen(raster, &polygon[i], &screen[i]);
+	}
+	for (int i = 1; i + 1 < count; i++)
+	{
+		PGResult result = setupTriangle(raster, &screen[0], &screen[i], &screen[i + 1]);
+		if (PGR_OK != result) return result;
+	}
+	return PGR_OK;
+}
+
+PGResult pgSoftRasterDraw(PGSoftRaster raster, GLenum mode, const GLvoid *vertices, GLsizei stride, GLsizei count, const PGVertexAttrib *position, const PGVertexAttrib *color, const PGInstance *instance)
+{
+	if (NULL == raster || NULL == vertices || NULL == position) return PGR_NullPointerBarf;
+	if (NULL == raster->pixels) return PGR_LazyGenericError;
+	if (GL_TRIANGLES != mode && GL_TRIANGLE_STRIP != mode && GL_TRIANGLE_FAN != mode)
+	{
+		pgLog(PGL_Error, "The software renderer only draws triangles, not mode 0x%x.", mode);
+		return PGR_Unsupported;
+	}
+	if (count < 3) return PGR_OK;
+
+	const GLubyte *data = vertices;
+	struct PGSoftVertex shaded[3];
+	int triangles = (GL_TRIANGLES == mode) ? count / 3 : count - 2;
+	for (int i = 0; i < triangles; i++)
+	{
+		GLsizei index[3];
+		if (GL_TRIANGLES == mode)
+		{
+			index[0] = 3 * i;
+			index[1] = 3 * i + 1;
+			index[2] = 3 * i + 2;
+		}
+		else if (GL_TRIANGLE_STRIP == mode)
+		{
+			index[0] = i;
+			index[1] = i + 1;
+			index[2] = i + 2;
+		}
+		else
+		{
+			index[0] = 0;
+			index[1] = i + 1;
+			index[2] = i + 2;
+		}
+
+		// Strips and fans share vertices, but shading is cheap next to
+		// rasterizing, so each triangle shades its own
+		for (int k = 0; k < 3; k++)
+		{
+			shadeVertex(raster, data + (size_t)index[k] * stride, position, color, instance, &shaded[k]);
+		}
+
+		PGResult result = clipAndSetup(raster, &shaded[0], &shaded[1], &shaded[2]);
+		if (PGR_OK != result) return result;
+	}
+	return PGR_OK;
+}
+
+// Binning /////////////////////////////////////////////////////////////////
+
+static int triangleTouchesTile(PGSoftRaster raster, const struct PGSoftTriangle *t, int tileX, int tileY)
+{
+	int x0 = tileX * PG_SOFT_TILE_SIZE;
+	int y0 = tileY * PG_SOFT_TILE_SIZE;
+	int x1 = x0 + PG_SOFT_TILE_SIZE - 1;
+	int y1 = y0 + PG_SOFT_TILE_SIZE - 1;
+
+	// If the tile corner furthest inside an edge is still outside it, the
+	// whole tile is
+	for (int e = 0; e < 3; e++)
+	{
+		int64_t px = (int64_t)(t->a[e] > 0 ? x1 : x0) * SUBPIXEL_ONE + SUBPIXEL_HALF;
+		int64_t py = (int64_t)(t->b[e] > 0 ? y1 : y0) * SUBPIXEL_ONE + SUBPIXEL_HALF;
+		if (t->a[e] * px + t->b[e] * py + t->c[e] < 0) return 0;
+	}
+	return 1;
+}
+
+static void countBinsRange(void *userData, size_t first, size_t count)
+{
+	PGSoftRaster raster = userData;
+	uint64_t start = nowMicroseconds();
+	size_t tiles = (size_t)raster->tilesX * raster->tilesY;
+
+	for (size_t chunk = first; chunk < first + count; chunk++)
+	{
+		uint32_t *counts = raster->binCounts + chunk * tiles;
+		memset(counts, 0, sizeof(uint32_t) * tiles);
+
+		size_t end = (chunk + 1) * BIN_CHUNK;
+		if (end > raster->triangleCount) end = raster->triangleCount;
+		for (size_t i = chunk * BIN_CHUNK; i < end; i++)
+		{
+			const struct PGSoftTriangle *t = &raster->triangles[i];
+			for (int ty = t->minY / PG_SOFT_TILE_SIZE; ty <= t->maxY / PG_SOFT_TILE_SIZE; ty++)
+			{
+				for (int tx = t->minX / PG_SOFT_TILE_SIZE; tx <= t->maxX / PG_SOFT_TILE_SIZE; tx++)
+				{
+					if (triangleTouchesTile(raster, t, tx, ty)) counts[ty * raster->tilesX + tx]++;
+				}
+			}
+		}
+	}
+
+	__atomic_add_fetch(&raster->busyMicroseconds, nowMicroseconds() - start, __ATOMIC_RELAXED);
+}
+
+static void fillBinsRange(void *userData, size_t first, size_t count)
+{
+	PGSoftRaster raster = userData;
+	uint64_t start = nowMicroseconds();
+	size_t tiles = (size_t)raster->tilesX * raster->tilesY;
+
+	for (size_t chunk = first; chunk < first + count; chunk++)
+	{
+		uint32_t *cursor = raster->binOffsets + chunk * tiles;
+
+		size_t end = (chunk + 1) * BIN_CHUNK;
+		if (end > raster->triangleCount) end = raster->triangleCount;
+		for (size_t i = chunk * BIN_CHUNK; i < end; i++)
+		{
+			const struct PGSoftTriangle *t = &raster->triangles[i];
+			for (int ty = t->minY / PG_SOFT_TILE_SIZE; ty <= t->maxY / PG_SOFT_TILE_SIZE; ty++)
+			{
+				for (int tx = t->minX / PG_SOFT_TILE_SIZE; tx <= t->maxX / PG_SOFT_TILE_SIZE; tx++)
+				{
+					if (triangleTouchesTile(raster, t, tx, ty)) raster->binIndices[cursor[ty * raster->tilesX + tx]++] = (uint32_t)i;
+				}
+			}
+		}
+	}
+
+	__atomic_add_fetch(&raster->busyMicroseconds, nowMicroseconds() - start, __ATOMIC_RELAXED);
+}
+
+// Rasterizing /////////////////////////////////////////////////////////////
+
+static int anyLane(const v8i *mask)
+{
+	uint64_t words[4];
+	memcpy(words, mask, sizeof(words));
+	return 0 != (words[0] | words[1] | words[2] | words[3]);
+}
+
+static void rasterizeTriangle(PGSoftRaster raster, const struct PGSoftTriangle *t, int tileX0, int tileY0)
+{
+	int x0 = t->minX > tileX0 ? t->minX : tileX0;
+	int y0 = t->minY > tileY0 ? t->minY : tileY0;
+	int x1 = t->maxX < tileX0 + PG_SOFT_TILE_SIZE - 1 ? t->maxX : tileX0 + PG_SOFT_TILE_SIZE - 1;
+	int y1 = t->maxY < tileY0 + PG_SOFT_TILE_SIZE - 1 ? t->maxY : tileY0 + PG_SOFT_TILE_SIZE - 1;
+	if (x0 > x1 || y0 > y1) return;
+
+	// Spans start on a multiple of SPAN, and tiles are a multiple of SPAN
+	// wide, so a span never leaves the tile. Lanes outside the triangle's
+	// bounds are always outside an edge too.
+	x0 &= ~(SPAN - 1);
+
+	const v8l laneIndex = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	const v8f laneOffset = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+	v8l laneStep[3];
+	int64_t spanStep[3];
+	for (int e = 0; e < 3; e++)
+	{
+		laneStep[e] = laneIndex * (t->a[e] * SUBPIXEL_ONE);
+		spanStep[e] = t->a[e] * SUBPIXEL_ONE * SPAN;
+	}
+
+	const v8f zero = { 0 };
+	const v8f one = zero + 1.0f;
+
+	for (int y = y0; y <= y1; y++)
+	{
+		int64_t py = (int64_t)y * SUBPIXEL_ONE + SUBPIXEL_HALF;
+		int64_t px = (int64_t)x0 * SUBPIXEL_ONE + SUBPIXEL_HALF;
+		int64_t row[3];
+		for (int e = 0; e < 3; e++)
+		{
+			row[e] = t->a[e] * px + t->b[e] * py + t->c[e];
+		}
+
+		GLfloat fy = (GLfloat)y + 0.5f - t->originY;
+		uint32_t *out = raster->pixels + (size_t)y * raster->stride;
+
+		for (int x = x0; x <= x1; x += SPAN)
+		{
+			v8l e0 = laneStep[0] + row[0];
+			v8l e1 = laneStep[1] + row[1];
+			v8l e2 = laneStep[2] + row[2];
+			row[0] += spanStep[0];
+			row[1] += spanStep[1];
+			row[2] += spanStep[2];
+
+			v8i inside = __builtin_convertvector((e0 | e1 | e2) >= 0, v8i);
+			if (!anyLane(&inside)) continue;
+
+			v8f fx = laneOffset + ((GLfloat)x - t->originX);
+			v8f q[NUM_PLANES];
+			for (int p = 0; p < NUM_PLANES; p++)
+			{
+				q[p] = t->plane[p][0] + t->plane[p][1] * fx + t->plane[p][2] * fy;
+			}
+			v8f w = one / q[PLANE_ONE_OVER_W];
+
+			v8u color = { 0 };
+			for (int c = 0; c < 4; c++)
+			{
+				v8f value = q[PLANE_RED + c] * w;
+				// Clamp with masks, NaN from a degenerate lane ends up as zero
+				v8i low = value > zero;
+				v8i high = value > one;
+				value = (v8f)(((v8i)value & low & ~high) | ((v8i)one & high));
+				v8i scaled = __builtin_convertvector(value * 255.0f + 0.5f, v8i);
+				color |= (v8u)scaled << (uint32_t)(8 * c);
+			}
+
+			v8u *dst = (v8u *)(out + x);
+			*dst = (color & (v8u)inside) | (*dst & ~(v8u)inside);
+		}
+	}
+}
+
+static void rasterizeTilesRange(void *userData, size_t first, size_t count)
+{
+	PGSoftRaster raster = userData;
+	uint64_t start = nowMicroseconds();
+
+	for (size_t tile = first; tile < first + count; tile++)
+	{
+		int tileX0 = (int)(tile % raster->tilesX) * PG_SOFT_TILE_SIZE;
+		int tileY0 = (int)(tile / raster->tilesX) * PG_SOFT_TILE_SIZE;
+
+		if (raster->clearPending)
+		{
+			for (int y = tileY0; y < tileY0 + PG_SOFT_TILE_SIZE; y++)
+			{
+				uint32_t *row = raster->pixels + (size_t)y * raster->stride + tileX0;
+				for (int x = 0; x < PG_SOFT_TILE_SIZE; x++) row[x] = raster->clearColor;
+			}
+		}
+
+		for (uint32_t i = raster->tileFirst[tile]; i < raster->tileFirst[tile + 1]; i++)
+		{
+			rasterizeTriangle(raster, &raster->triangles[raster->binIndices[i]], tileX0, tileY0);
+		}
+	}
+
+	__atomic_add_fetch(&raster->busyMicroseconds, nowMicroseconds() - start, __ATOMIC_RELAXED);
+}
+
+static void runRange(PGSoftRaster raster, size_t count, PGJobRangeFunction function)
+{
+	if (0 == count) return;
+
+	// Jobs can only be made from threads belonging to the scheduler
+	if (NULL != raster->jobs && count > 1 && pgJobSchedulerCurrentThread(raster->jobs) >= 0)
+	{
+		PGJob job = pgJobParallelFor(raster->jobs, NULL, count, 1, function, raster);
+		if (NULL != job)
+		{
+			pgJobRun(raster->jobs, job);
+			pgJobWait(raster->jobs, job);
+			return;
+		}
+	}
+	function(raster, 0, count);
+}
+
+static PGResult reserveBins(PGSoftRaster raster, size_t chunks, size_t tiles)
+{
+	size_t bins = chunks * tiles;
+	if (bins > raster->binCapacity)
+	{
+		uint32_t *counts = pgMemAlloc(sizeof(uint32_t) * bins, PGM_Renderer);
+		uint32_t *offsets = pgMemAlloc(sizeof(uint32_t) * bins, PGM_Renderer);
+		if (NULL == counts || NULL == offsets)
+		{
+			pgMemFree(counts);
+			pgMemFree(offsets);
+			return PGR_OutOfMemory;
+		}
+		pgMemFree(raster->binCounts);
+		pgMemFree(raster->binOffsets);
+		raster->binCounts = counts;
+		raster->binOffsets = offsets;
+		raster->binCapacity = bins;
+	}
+	return PGR_OK;
+}
+
+void pgSoftRasterFlush(PGSoftRaster raster)
+{
+	if (NULL == raster || NULL == raster->pixels) return;
+	if (0 == raster->triangleCount && !raster->clearPending) return;
+	pgProfileZone(__func__);
+
+	uint64_t start = nowMicroseconds();
+	size_t tiles = (size_t)raster->tilesX * raster->tilesY;
+	size_t chunks = (raster->triangleCount + BIN_CHUNK - 1) / BIN_CHUNK;
+
+	if (PGR_OK != reserveBins(raster, chunks, tiles))
+	{
+		pgLog(PGL_Error, "Out of memory binning %zu triangles.", raster->triangleCount);
+		raster->triangleCount = 0;
+		chunks = 0;
+	}
+
+	// Count, then lay each tile's list out chunk by chunk so triangles stay
+	// in draw order, then fill
+	runRange(raster, chunks, countBinsRange);
+
+	uint32_t total = 0;
+	for (size_t tile = 0; tile < tiles; tile++)
+	{
+		raster->tileFirst[tile] = total;
+		for (size_t chunk = 0; chunk < chunks; chunk++)
+		{
+			raster->binOffsets[chunk * tiles + tile] = total;
+			total += raster->binCounts[chunk * tiles + tile];
+		}
+	}
+	raster->tileFirst[tiles] = total;
+
+	if (total > raster->binIndexCapacity)
+	{
+		uint32_t *indices = pgMemAlloc(sizeof(uint32_t) * total, PGM_Renderer);
+		if (NULL == indices)
+		{
+			pgLog(PGL_Error, "Out of memory binning %zu triangles.", raster->triangleCount);
+			memset(raster->tileFirst, 0, sizeof(uint32_t) * (tiles + 1));
+			chunks = 0;
+		}
+		else
+		{
+			pgMemFree(raster->binIndices);
+			raster->binIndices = indices;
+			raster->binIndexCapacity = total;
+		}
+	}
+
+	runRange(raster, chunks, fillBinsRange);
+	runRange(raster, tiles, rasterizeTilesRange);
+
+	raster->stats.frames++;
+	raster->stats.triangles += raster->triangleCount;
+	raster->stats.wallSeconds += (nowMicroseconds() - start) / 1e6;
+
+	raster->triangleCount = 0;
+	raster->clearPending = 0;
+}
+
+void pgSoftRasterReadPixels(PGSoftRaster raster, int x, int y, int width, int height, GLubyte *pixels)
+{
+	if (NULL == raster || NULL == pixels || NULL == raster->pixels) return;
+
+	pgSoftRasterFlush(raster);
+
+	if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > raster->width || y + height > raster->height)
+	{
+		pgLog(PGL_Error, "Read of %dx%d at %d,%d is outside the %dx%d framebuffer.", width, height, x, y, raster->width, raster->height);
+		return;
+	}
+
+	// Pixels are packed R in the low byte, which is RGBA byte order on the
+	// little endian CPUs we run on
+	for (int row = 0; row < height; row++)
+	{
+		memcpy(pixels + (size_t)row * width * 4, raster->pixels + (size_t)(y + row) * raster->stride + x, (size_t)width * 4);
+	}
+}
+
+void pgSoftRasterStats(PGSoftRaster raster, PGSoftRasterStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGSoftRasterStats));
+	if (NULL == raster) return;
+
+	*stats = raster->stats;
+	stats->busySeconds = __atomic_load_n(&raster->busyMicroseconds, __ATOMIC_RELAXED) / 1e6;
+}
@@ -0,0 +1,91 @@
+//
+//  PGSoftRaster.h
+//
+//  Created by David Wagner on 15/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGSoftRaster_h
+#define PGSoftRaster_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Triangles are binned into square tiles of this many pixels, and each
+	// tile is rasterized by one job
+	#define PG_SOFT_TILE_SIZE 32
+
+	// Largest framebuffer, in either direction
+	#define PG_SOFT_MAX_SIZE 4096
+
+	typedef struct
+	{
+		unsigned long frames;		// Flushes which had anything to draw or clear
+		unsigned long triangles;	// Triangles binned, after clipping
+		double wallSeconds;			// Time spent inside pgSoftRasterFlush
+		double busySeconds;			// Time spent binning and shading, summed over every thread
+	}
+	PGSoftRasterStats;
+
+	/**
+	 * A tile based software rasterizer which runs the mvp_col pipeline, and
+	 * the per instance transform and colour of mvp_col_instanced, on the
+	 * CPU. Draws are queued and rasterized together on flush. With a job
+	 * scheduler, binning and tiles are spread across its threads, as long as
+	 * the flush happens on one of them.
+	 *
+	 * The framebuffer is RGBA8 with the origin at the bottom left, like GL.
+	 * There is no depth buffer or blending; later triangles overwrite
+	 * earlier ones, as with the GL pipeline.
+	 */
+	PGResult pgSoftRasterCreate(PGSoftRaster *raster, PGJobScheduler jobs);
+	void pgSoftRasterDestroy(PGSoftRaster *raster);
+
+	/**
+	 * Resizes the framebuffer. Its contents are undefined until cleared.
+	 */
+	PGResult pgSoftRasterResize(PGSoftRaster raster, int width, int height);
+
+	/**
+	 * The projectionMatrix and modelViewMatrix uniforms, column major.
+	 * Changing them affects later draws only.
+	 */
+	void pgSoftRasterSetProjection(PGSoftRaster raster, const GLfloat matrix[16]);
+	void pgSoftRasterSetModelView(PGSoftRaster raster, const GLfloat matrix[16]);
+
+	/**
+	 * Clears the colour buffer. Queued draws are thrown away, as the clear
+	 * would cover them.
+	 */
+	void pgSoftRasterClear(PGSoftRaster raster, const GLfloat color[4]);
+
+	/**
+	 * Queues `count` vertices of interleaved vertex data. `color` may be
+	 * NULL, in which case vertices are black, as an unbound GL attribute
+	 * would be. `instance` is NULL unless drawing an instance. Supports
+	 * GL_TRIANGLES, GL_TRIANGLE_STRIP and GL_TRIANGLE_FAN.
+	 */
+	PGResult pgSoftRasterDraw(PGSoftRaster raster, GLenum mode, const GLvoid *vertices, GLsizei stride, GLsizei count, const PGVertexAttrib *position, const PGVertexAttrib *color, const PGInstance *instance);
+
+	/**
+	 * Rasterizes everything queued.
+	 */
+	void pgSoftRasterFlush(PGSoftRaster raster);
+
+	/**
+	 * Flushes, then copies a rectangle out as RGBA8 rows, bottom row first,
+	 * as glReadPixels would.
+	 */
+	void pgSoftRasterReadPixels(PGSoftRaster raster, int x, int y, int width, int height, GLubyte *pixels);
+
+	/**
+	 * Throughput in frames per second per core is frames / busySeconds.
+	 */
+	void pgSoftRasterStats(PGSoftRaster raster, PGSoftRasterStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
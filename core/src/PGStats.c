@@ -0,0 +1,122 @@
+//
+//  PGStats.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__APPLE__)
+#	include <mach/mach_time.h>
+#endif
+#include "Pictogram.h"
+
+static unsigned long PendingUploads;
+static unsigned long PendingUploadBytes;
+static unsigned long PendingTextureUploads;
+static unsigned long PendingTextureBytes;
+
+#ifndef DISABLE_pgStats
+void _pgStatsBufferUpload(unsigned long bytes)
+{
+	PendingUploads++;
+	PendingUploadBytes += bytes;
+}
+
+void _pgStatsTextureUpload(unsigned long bytes)
+{
+	PendingTextureUploads++;
+	PendingTextureBytes += bytes;
+}
+#endif
+
+void pgStatsCollectUploads(PGFrameStats *stats)
+{
+	if (NULL == stats) return;
+
+	stats->bufferUploads += PendingUploads;
+	stats->bufferBytes += PendingUploadBytes;
+	stats->textureUploads += PendingTextureUploads;
+	stats->textureBytes += PendingTextureBytes;
+	PendingUploads = 0;
+	PendingUploadBytes = 0;
+	PendingTextureUploads = 0;
+	PendingTextureBytes = 0;
+}
+
+uint64_t pgStatsNowNanoseconds(void)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (0 == timebase.denom) mach_timebase_info(&timebase);
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+uint64_t pgStatsNowMicroseconds(void)
+{
+	return pgStatsNowNanoseconds() / 1000;
+}
+
+static int compareTimes(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *sorted, unsigned long count, unsigned long percent)
+{
+	// Nearest rank
+	unsigned long rank = (percent * count + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void pgStatsSummarize(const PGFrameStats *frames, unsigned long count, PGStatsSnapshot *snapshot)
+{
+	if (NULL == snapshot) return;
+	memset(snapshot, 0, sizeof(PGStatsSnapshot));
+	if (NULL == frames || 0 == count) return;
+
+	if (count > PG_STATS_HISTORY) count = PG_STATS_HISTORY;
+	uint64_t times[PG_STATS_HISTORY];
+	uint64_t totalTime = 0;
+
+	PGFrameStats *total = &snapshot->total;
+	for (unsigned long i = 0; i < count; i++)
+	{
+		const PGFrameStats *f = &frames[i];
+		total->drawCalls += f->drawCalls;
+		total->instances += f->instances;
+		total->vertices += f->vertices;
+		total->programBinds += f->programBinds;
+		total->redundantProgramBinds += f->redundantProgramBinds;
+		total->pipelineBinds += f->pipelineBinds;
+		total->redundantPipelineBinds += f->redundantPipelineBinds;
+		total->stateChanges += f->stateChanges;
+		total->uniformUploads += f->uniformUploads;
+		total->bufferUploads += f->bufferUploads;
+		total->bufferBytes += f->bufferBytes;
+		total->textureUploads += f->textureUploads;
+		total->textureBytes += f->textureBytes;
+		total->cpuMicroseconds += f->cpuMicroseconds;
+
+		times[i] = f->cpuMicroseconds;
+		totalTime += f->cpuMicroseconds;
+	}
+	total->frame = frames[count - 1].frame;
+
+	qsort(times, count, sizeof(uint64_t), compareTimes);
+	snapshot->frames = count;
+	snapshot->cpuMin = times[0];
+	snapshot->cpuP50 = percentile(times, count, 50);
+	snapshot->cpuP95 = percentile(times, count, 95);
+	snapshot->cpuP99 = percentile(times, count, 99);
+	snapshot->cpuMax = times[count - 1];
+	snapshot->cpuMean = (double)totalTime / count;
+}
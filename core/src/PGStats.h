@@ -0,0 +1,100 @@
+//
+//  PGStats.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGStats_h
+#define PGStats_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_STATS_HISTORY 256
+
+	/**
+	 * What one frame asked of GL. Counted with plain increments as the
+	 * renderer goes, and compiled out entirely with DISABLE_pgStats.
+	 */
+	typedef struct
+	{
+		unsigned long frame;
+		unsigned long drawCalls;
+		unsigned long instances;
+		unsigned long vertices;
+		unsigned long programBinds;
+		unsigned long redundantProgramBinds;	// Filtered out before reaching GL
+		unsigned long pipelineBinds;
+		unsigned long redundantPipelineBinds;
+		unsigned long stateChanges;				// GL calls made binding pipelines
+		unsigned long uniformUploads;
+		unsigned long bufferUploads;
+		unsigned long bufferBytes;
+		unsigned long textureUploads;			// glTexSubImage2D calls
+		unsigned long textureBytes;
+		uint64_t cpuMicroseconds;
+	}
+	PGFrameStats;
+
+	/**
+	 * A summary of the last few frames. The counters are totals over the
+	 * frames, and the CPU times are per frame.
+	 */
+	typedef struct
+	{
+		unsigned long frames;
+		PGFrameStats total;
+		uint64_t cpuMin;
+		uint64_t cpuP50;
+		uint64_t cpuP95;
+		uint64_t cpuP99;
+		uint64_t cpuMax;
+		double cpuMean;
+	}
+	PGStatsSnapshot;
+
+#ifdef DISABLE_pgStats
+#	define pgStatsCount(stats, counter, n) ((void)(n))
+#	define pgStatsBufferUpload(bytes) ((void)(bytes))
+#	define pgStatsTextureUpload(bytes) ((void)(bytes))
+#else
+#	define pgStatsCount(stats, counter, n) ((stats)->counter += (n))
+#	define pgStatsBufferUpload(bytes) _pgStatsBufferUpload(bytes)
+#	define pgStatsTextureUpload(bytes) _pgStatsTextureUpload(bytes)
+	/**
+	 * For uploads made away from the renderer, such as a mesh creating
+	 * its buffer or a texture streaming in. They are added to whichever
+	 * frame is current when the renderer next collects them. GL thread
+	 * only.
+	 */
+	void _pgStatsBufferUpload(unsigned long bytes);
+	void _pgStatsTextureUpload(unsigned long bytes);
+#endif
+
+	/**
+	 * Moves the uploads counted by pgStatsBufferUpload and
+	 * pgStatsTextureUpload into `stats`.
+	 */
+	void pgStatsCollectUploads(PGFrameStats *stats);
+
+	/**
+	 * A monotonic clock.
+	 */
+	uint64_t pgStatsNowNanoseconds(void);
+	uint64_t pgStatsNowMicroseconds(void);
+
+	/**
+	 * Sums the counters of `count` frames and works out CPU time
+	 * percentiles over them.
+	 */
+	void pgStatsSummarize(const PGFrameStats *frames, unsigned long count, PGStatsSnapshot *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,953 @@
+//
+//  PGTexture.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+typedef uint32_t v8u __attribute__((vector_size(8 * sizeof(uint32_t))));
+typedef uint16_t v8s __attribute__((vector_size(8 * sizeof(uint16_t))));
+
+enum {
+	LOAD_Decoding = 0
+,	LOAD_Decoded
+,	LOAD_Failed
+};
+
+struct PGTexturePrivate {
+	GLuint name;		// Made when the upload starts, but not handed out until Ready
+	GLsizei width;
+	GLsizei height;
+	PGTextureFormat format;
+	PGTextureState state;
+
+	// For loading again after being evicted
+	PGTexture texture;
+	PGTextureOptions options;
+	char *path;			// NULL for pgTextureCreateFromPixels, which can't be evicted
+	PGGpuResource memory;
+};
+
+/**
+ * A texture on its way in. Kept apart from the pool, which moves its
+ * items, so a decoding job can write to it. The job owns everything but
+ * `next` and the upload position until it sets `state`, which is the last
+ * thing it does, and the GL thread owns all of it after that.
+ */
+struct PGTextureLoad {
+	PGTexture texture;
+	PGTextureOptions options;
+	char *path;			// NULL for pgTextureCreateFromPixels
+	int state;
+
+	PGJobScheduler scheduler;
+	PGJob job;
+
+	GLsizei width;
+	GLsizei height;
+	int levelCount;
+	GLubyte *levels[PG_TEXTURE_MAX_LEVELS];
+
+	uint32_t nativeFormats;		// Bits of CompressedFormats which GL takes
+	GLenum compressedFormat;	// Non zero when levels are uploaded as they are in the file
+	size_t levelSizes[PG_TEXTURE_MAX_LEVELS];
+	void *file;					// Backs compressed levels
+	size_t fileSize;
+
+	int level;			// Upload position
+	GLsizei row;
+
+	struct PGTextureLoad *next;
+};
+
+// Everything below is only touched from the GL thread
+static PGHandlePool Textures;
+static struct PGTextureLoad *Loads;
+static struct PGTextureLoad **LoadsTail = &Loads;
+static PGJobScheduler Scheduler;
+static size_t UploadBudget = PG_TEXTURE_DEFAULT_UPLOAD_BUDGET;
+static GLuint Placeholder;
+static int NpotMipmaps = -1;
+static int MaxLevel = -1;			// Whether GL_TEXTURE_MAX_LEVEL can be set
+static long NativeFormats = -1;
+
+// Compressed formats worth uploading as they are, if GL takes them
+static const GLenum CompressedFormats[] = {
+	GL_ETC1_RGB8_OES
+,	GL_COMPRESSED_RGB8_ETC2
+,	GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+,	GL_COMPRESSED_RGBA8_ETC2_EAC
+,	0x93B0, 0x93B1, 0x93B2, 0x93B3, 0x93B4, 0x93B5, 0x93B6	// ASTC 4x4 to 8x6
+,	0x93B7, 0x93B8, 0x93B9, 0x93BA, 0x93BB, 0x93BC, 0x93BD	// ASTC 8x8 to 12x12
+};
+
+#define COMPRESSED_FORMAT_COUNT (sizeof(CompressedFormats) / sizeof(CompressedFormats[0]))
+
+static struct PGTexturePrivate *lookupTexture(PGTexture texture)
+{
+	struct PGTexturePrivate *t = pgHandlePoolGet(Textures, texture);
+	if (NULL == t && PG_NULL_HANDLE != texture)
+	{
+		pgLog(PGL_Warn, "Stale texture handle 0x%08x.", texture);
+	}
+	return t;
+}
+
+static size_t bytesPerPixel(PGTextureFormat format)
+{
+	return PGTF_RGBA8 == format ? 4 : 2;
+}
+
+static void glFormat(PGTextureFormat format, GLenum *glformat, GLenum *type)
+{
+	switch (format)
+	{
+		case PGTF_RGB565:
+			*glformat = GL_RGB;
+			*type = GL_UNSIGNED_SHORT_5_6_5;
+			break;
+		case PGTF_RGBA4444:
+			*glformat = GL_RGBA;
+			*type = GL_UNSIGNED_SHORT_4_4_4_4;
+			break;
+		default:
+			*glformat = GL_RGBA;
+			*type = GL_UNSIGNED_BYTE;
+			break;
+	}
+}
+
+static GLsizei levelSize(GLsizei size, int level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+// Decoding //////////////////////////////////////////////////////////////////
+
+/**
+ * Halves a level with a 2x2 box filter. Odd sizes repeat their last row
+ * or column.
+ */
+static void downsample(const GLubyte *from, GLsizei width, GLsizei height, GLubyte *to, GLsizei toWidth, GLsizei toHeight)
+{
+	for (GLsizei y = 0; y < toHeight; y++)
+	{
+		const GLubyte *row0 = from + (size_t)(2 * y) * width * 4;
+		const GLubyte *row1 = from + (size_t)(2 * y + 1 < height ? 2 * y + 1 : 2 * y) * width * 4;
+		for (GLsizei x = 0; x < toWidth; x++, to += 4)
+		{
+			size_t x0 = (size_t)(2 * x) * 4;
+			size_t x1 = (size_t)(2 * x + 1 < width ? 2 * x + 1 : 2 * x) * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				to[c] = (GLubyte)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+/**
+ * c * max / 255, rounded to nearest, in place.
+ */
+static inline void scaleChannel(v8u *c, uint32_t max)
+{
+	v8u x = *c * max + 128;
+	*c = (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t scaleChannelScalar(uint32_t c, uint32_t max)
+{
+	uint32_t x = c * max + 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * Packs RGBA8 pixels down to 16 bits, rounding to nearest, in place. Each
+ * pixel is read before its half sized result is written over the front
+ * of it.
+ */
+static void convertLevel(GLubyte *pixels, size_t count, PGTextureFormat format)
+{
+	uint16_t *out = (uint16_t *)pixels;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		v8u p;
+		memcpy(&p, pixels + i * 4, sizeof(p));
+		v8u r = p & 0xff, g = (p >> 8) & 0xff, b = (p >> 16) & 0xff, a = p >> 24;
+		v8u packed;
+		if (PGTF_RGB565 == format)
+		{
+			scaleChannel(&r, 31);
+			scaleChannel(&g, 63);
+			scaleChannel(&b, 31);
+			packed = r << 11 | g << 5 | b;
+		}
+		else
+		{
+			scaleChannel(&r, 15);
+			scaleChannel(&g, 15);
+			scaleChannel(&b, 15);
+			scaleChannel(&a, 15);
+			packed = r << 12 | g << 8 | b << 4 | a;
+		}
+		v8s narrow = __builtin_convertvector(packed, v8s);
+		memcpy(out + i, &narrow, sizeof(narrow));
+	}
+	for (; i < count; i++)
+	{
+		const GLubyte *p = pixels + i * 4;
+		uint32_t r = p[0], g = p[1], b = p[2], a = p[3];
+		if (PGTF_RGB565 == format) out[i] = (uint16_t)(scaleChannelScalar(r, 31) << 11 | scaleChannelScalar(g, 63) << 5 | scaleChannelScalar(b, 31));
+		else out[i] = (uint16_t)(scaleChannelScalar(r, 15) << 12 | scaleChannelScalar(g, 15) << 8 | scaleChannelScalar(b, 15) << 4 | scaleChannelScalar(a, 15));
+	}
+}
+
+static int takesFormat(uint32_t nativeFormats, GLenum format)
+{
+	for (size_t i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+	{
+		if (CompressedFormats[i] == format) return 0 != (nativeFormats & 1u << i);
+	}
+	return 0;
+}
+
+/**
+ * Keeps the levels of a KTX compressed if GL takes its format, and decodes
+ * them to RGBA8 if not.
+ */
+static PGResult decodeKtx(struct PGTextureLoad *load)
+{
+	PGKtx ktx;
+	PGResult result = pgKtxParse(&ktx, load->file, load->fileSize);
+	if (PGR_OK != result) return result;
+
+	GLenum format = ktx.internalFormat;
+	if (!takesFormat(load->nativeFormats, format) && GL_ETC1_RGB8_OES == format && takesFormat(load->nativeFormats, GL_COMPRESSED_RGB8_ETC2))
+	{
+		// ETC1 is a subset of ETC2, so ES 3 takes it without the extension
+		format = GL_COMPRESSED_RGB8_ETC2;
+	}
+
+	int levelCount = ktx.levelCount < PG_TEXTURE_MAX_LEVELS ? ktx.levelCount : PG_TEXTURE_MAX_LEVELS;
+	load->width = ktx.width;
+	load->height = ktx.height;
+	if (takesFormat(load->nativeFormats, format))
+	{
+		load->compressedFormat = format;
+		for (int i = 0; i < levelCount; i++)
+		{
+			load->levels[i] = (GLubyte *)ktx.levels[i];
+			load->levelSizes[i] = ktx.levelSizes[i];
+		}
+		load->levelCount = levelCount;
+		return PGR_OK;
+	}
+
+	if (!pgEtcCanDecode(format))
+	{
+		pgLog(PGL_Error, "GL doesn't take texture format 0x%04x, and it can't be decoded.", format);
+		return PGR_Unsupported;
+	}
+
+	for (int i = 0; i < levelCount; i++)
+	{
+		GLsizei width = levelSize(ktx.width, i), height = levelSize(ktx.height, i);
+		load->levels[i] = pgMemAlloc((size_t)width * height * 4, PGM_Texture);
+		if (NULL == load->levels[i]) return PGR_OutOfMemory;
+		load->levelCount = i + 1;
+
+		result = pgEtcDecode(format, ktx.levels[i], ktx.levelSizes[i], width, height, load->levels[i]);
+		if (PGR_OK != result) return result;
+	}
+	return PGR_OK;
+}
+
+static PGResult readFile(struct PGTextureLoad *load)
+{
+	PGResult result = pgImageReadFile(load->path, &load->file, &load->fileSize);
+	if (PGR_OK != result) return result;
+
+	if (pgKtxIsKtx(load->file, load->fileSize))
+	{
+		result = decodeKtx(load);
+	}
+	else
+	{
+		PGImage image;
+		result = pgImageDecode(&image, load->file, load->fileSize);
+		load->width = image.width;
+		load->height = image.height;
+		load->levels[0] = image.pixels;
+		load->levelCount = NULL != image.pixels;
+	}
+
+	if (0 == load->compressedFormat)
+	{
+		pgMemFree(load->file);
+		load->file = NULL;
+	}
+	if (PGR_OK != result) pgLog(PGL_Error, "Could not decode %s.", load->path);
+	return result;
+}
+
+static PGResult decodeLoad(struct PGTextureLoad *load)
+{
+	if (NULL != load->path)
+	{
+		PGResult result = readFile(load);
+		if (PGR_OK != result) return result;
+
+		// Compressed levels go to GL untouched
+		if (0 != load->compressedFormat) return PGR_OK;
+	}
+
+	if (load->options.premultiply)
+	{
+		for (int i = 0; i < load->levelCount; i++)
+		{
+			pgImagePremultiply(load->levels[i], (size_t)levelSize(load->width, i) * levelSize(load->height, i));
+		}
+	}
+
+	if (load->options.mipmaps && 1 == load->levelCount)
+	{
+		GLsizei width = load->width, height = load->height;
+		while ((width > 1 || height > 1) && load->levelCount < PG_TEXTURE_MAX_LEVELS)
+		{
+			GLsizei toWidth = width > 1 ? width / 2 : 1;
+			GLsizei toHeight = height > 1 ? height / 2 : 1;
+			GLubyte *level = pgMemAlloc((size_t)toWidth * toHeight * 4, PGM_Texture);
+			if (NULL == level) return PGR_OutOfMemory;
+
+			downsample(load->levels[load->levelCount - 1], width, height, level, toWidth, toHeight);
+			load->levels[load->levelCount++] = level;
+			width = toWidth;
+			height = toHeight;
+		}
+	}
+
+	if (PGTF_RGBA8 != load->options.format)
+	{
+		for (int i = 0; i < load->levelCount; i++)
+		{
+			convertLevel(load->levels[i], (size_t)levelSize(load->width, i) * levelSize(load->height, i), load->options.format);
+		}
+	}
+
+	return PGR_OK;
+}
+
+static void decode(struct PGTextureLoad *load)
+{
+	pgProfileZone("pgTexture decode");
+	int state = PGR_OK == decodeLoad(load) ? LOAD_Decoded : LOAD_Failed;
+	__atomic_store_n(&load->state, state, __ATOMIC_RELEASE);
+}
+
+static void decodeJob(PGJob job, void *data)
+{
+	decode(*(struct PGTextureLoad **)data);
+}
+
+static void freeLoad(struct PGTextureLoad *load)
+{
+	if (0 == load->compressedFormat)
+	{
+		for (int i = 0; i < load->levelCount; i++) pgMemFree(load->levels[i]);
+	}
+	pgMemFree(load->file);
+	pgMemFree(load->path);
+	pgMemFree(load);
+}
+
+// Creating //////////////////////////////////////////////////////////////////
+
+static char *copyPath(const char *path)
+{
+	size_t length = strlen(path) + 1;
+	char *copy = pgMemAlloc(length, PGM_Texture);
+	if (NULL != copy) memcpy(copy, path, length);
+	return copy;
+}
+
+/**
+ * Adds a texture and the load which will fill it. On failure both are
+ * gone and *texture is PG_NULL_HANDLE.
+ */
+static struct PGTextureLoad *createTexture(PGTexture *texture, const PGTextureOptions *options)
+{
+	if (NULL == Textures)
+	{
+		if (PGR_OK != pgHandlePoolCreate(&Textures, sizeof(struct PGTexturePrivate), PGM_Texture)) return NULL;
+	}
+
+	struct PGTextureLoad *load = pgMemAlloc(sizeof(struct PGTextureLoad), PGM_Texture);
+	if (NULL == load) return NULL;
+	memset(load, 0, sizeof(struct PGTextureLoad));
+	if (NULL != options) load->options = *options;
+
+	struct PGTexturePrivate *t = NULL;
+	load->texture = pgHandlePoolAdd(Textures, (void **)&t);
+	if (NULL == t)
+	{
+		pgMemFree(load);
+		return NULL;
+	}
+	t->format = load->options.format;
+	t->state = PGTS_Loading;
+	t->texture = load->texture;
+	t->options = load->options;
+
+	*texture = load->texture;
+	return load;
+}
+
+/**
+ * Decodes on the scheduler if there is one, or here, and queues the load
+ * for uploading.
+ */
+static void startLoad(struct PGTextureLoad *load)
+{
+	*LoadsTail = load;
+	LoadsTail = &load->next;
+
+	if (NULL != Scheduler)
+	{
+		load->scheduler = Scheduler;
+		load->job = pgJobCreate(Scheduler, decodeJob, &load, sizeof(load));
+		if (NULL != load->job)
+		{
+			pgJobRun(Scheduler, load->job);
+			return;
+		}
+		pgLog(PGL_Warn, "Could not make a texture decoding job. Decoding on the calling thread.");
+	}
+	decode(load);
+}
+
+/**
+ * The bits of CompressedFormats which GL lists as supported. Asked for on
+ * the GL thread, so decoding jobs can decide without it.
+ */
+static uint32_t nativeFormats(void)
+{
+	if (NativeFormats >= 0) return (uint32_t)NativeFormats;
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+	GLint *formats = pgMemAlloc((count > 0 ? (size_t)count : 1) * sizeof(GLint), PGM_Texture);
+	if (NULL == formats) return 0;
+
+	NativeFormats = 0;
+	if (count > 0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
+	for (GLint i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < COMPRESSED_FORMAT_COUNT; j++)
+		{
+			if ((GLenum)formats[i] == CompressedFormats[j]) NativeFormats |= 1L << j;
+		}
+	}
+	pgMemFree(formats);
+	return (uint32_t)NativeFormats;
+}
+
+PGResult pgTextureLoad(PGTexture *texture, const char *path, const PGTextureOptions *options)
+{
+	if (NULL == texture) return PGR_NullPointerBarf;
+	*texture = PG_NULL_HANDLE;
+
+	if (NULL == path) return PGR_NullPointerBarf;
+
+	struct PGTextureLoad *load = createTexture(texture, options);
+	if (NULL == load) return PGR_OutOfMemory;
+
+	// The texture keeps its own copy, as the load may outlive it
+	struct PGTexturePrivate *t = pgHandlePoolGet(Textures, *texture);
+	load->path = copyPath(path);
+	t->path = copyPath(path);
+	if (NULL == load->path || NULL == t->path)
+	{
+		pgMemFree(t->path);
+		pgHandlePoolRemove(Textures, *texture);
+		*texture = PG_NULL_HANDLE;
+		freeLoad(load);
+		return PGR_OutOfMemory;
+	}
+	load->nativeFormats = nativeFormats();
+
+	startLoad(load);
+	return PGR_OK;
+}
+
+PGResult pgTextureCreateFromPixels(PGTexture *texture, const GLubyte *pixels, GLsizei width, GLsizei height, const PGTextureOptions *options)
+{
+	if (NULL == texture) return PGR_NullPointerBarf;
+	*texture = PG_NULL_HANDLE;
+
+	if (NULL == pixels) return PGR_NullPointerBarf;
+	if (width <= 0 || height <= 0 || width > PG_IMAGE_MAX_SIZE || height > PG_IMAGE_MAX_SIZE)
+	{
+		pgLog(PGL_Error, "Invalid texture size %dx%d.", width, height);
+		return PGR_LazyGenericError;
+	}
+
+	struct PGTextureLoad *load = createTexture(texture, options);
+	if (NULL == load) return PGR_OutOfMemory;
+
+	size_t bytes = (size_t)width * height * 4;
+	load->levels[0] = pgMemAlloc(bytes, PGM_Texture);
+	if (NULL == load->levels[0])
+	{
+		pgHandlePoolRemove(Textures, *texture);
+		*texture = PG_NULL_HANDLE;
+		freeLoad(load);
+		return PGR_OutOfMemory;
+	}
+	memcpy(load->levels[0], pixels, bytes);
+	load->levelCount = 1;
+	load->width = width;
+	load->height = height;
+
+	startLoad(load);
+	return PGR_OK;
+}
+
+void pgTextureDestroy(PGTexture *texture)
+{
+	if (NULL != texture && PG_NULL_HANDLE != *texture)
+	{
+		struct PGTexturePrivate *t = lookupTexture(*texture);
+		if (NULL != t)
+		{
+			// A load in progress notices the handle has gone and cleans up
+			pgDeleteQueuePush(PGD_Texture, t->name);
+			pgGpuMemoryRemove(&t->memory);
+			pgMemFree(t->path);
+			pgHandlePoolRemove(Textures, *texture);
+		}
+
+		*texture = PG_NULL_HANDLE;
+	}
+}
+
+int pgTextureIsValid(PGTexture texture)
+{
+	return pgHandlePoolIsValid(Textures, texture);
+}
+
+PGTextureState pgTextureState(PGTexture texture)
+{
+	struct PGTexturePrivate *t = lookupTexture(texture);
+	if (NULL == t) return PGTS_Failed;
+
+	return t->state;
+}
+
+GLuint pgTextureGlHandle(PGTexture texture)
+{
+	struct PGTexturePrivate *t = lookupTexture(texture);
+	if (NULL != t && PGTS_Ready == t->state)
+	{
+		pgGpuMemoryUse(t->memory);
+		return t->name;
+	}
+
+	// Starts loading it again, so the placeholder stands in for a while
+	if (NULL != t && PGTS_Evicted == t->state) pgGpuMemoryUse(t->memory);
+
+	if (0 == Placeholder)
+	{
+		static const GLubyte Transparent[4] = { 0, 0, 0, 0 };
+		glGenTextures(1, &Placeholder);
+		glBindTexture(GL_TEXTURE_2D, Placeholder);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, Transparent);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		pgLogAnyGlErrors("Created placeholder texture.");
+	}
+	return Placeholder;
+}
+
+void pgTextureSize(PGTexture texture, GLsizei *width, GLsizei *height)
+{
+	struct PGTexturePrivate *t = lookupTexture(texture);
+	if (NULL != width) *width = NULL != t ? t->width : 0;
+	if (NULL != height) *height = NULL != t ? t->height : 0;
+}
+
+void pgTextureSetJobScheduler(PGJobScheduler scheduler)
+{
+	Scheduler = scheduler;
+}
+
+void pgTextureSetUploadBudget(size_t bytes)
+{
+	UploadBudget = bytes;
+}
+
+PGHandlePool pgTexturePool(void)
+{
+	return Textures;
+}
+
+void pgTextureReleasePlaceholder(void)
+{
+	if (0 != Placeholder) glDeleteTextures(1, &Placeholder);
+	Placeholder = 0;
+	NpotMipmaps = -1;
+	MaxLevel = -1;
+	NativeFormats = -1;
+}
+
+// Uploading /////////////////////////////////////////////////////////////////
+
+static int npotMipmapsSupported(void)
+{
+	if (NpotMipmaps >= 0) return NpotMipmaps;
+
+	const char *version = (const char *)glGetString(GL_VERSION);
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	NpotMipmaps = (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+		|| (NULL != extensions && NULL != strstr(extensions, "GL_OES_texture_npot"));
+	return NpotMipmaps;
+}
+
+static int maxLevelSupported(void)
+{
+	if (MaxLevel >= 0) return MaxLevel;
+
+	MaxLevel = 0;
+#ifdef GL_ES_VERSION_3_0
+	const char *version = (const char *)glGetString(GL_VERSION);
+	MaxLevel = NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11);
+#endif
+	return MaxLevel;
+}
+
+/**
+ * Whether `levelCount` levels go all the way down to 1x1, which ES 2
+ * needs before it will sample a mipmapped texture at all.
+ */
+static GLboolean isMipChainComplete(GLsizei width, GLsizei height, int levelCount)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width >>= 1;
+		height >>= 1;
+		levels++;
+	}
+	return levelCount >= levels;
+}
+
+static GLboolean evictTexture(void *userData)
+{
+	struct PGTexturePrivate *t = pgHandlePoolGet(Textures, (PGTexture)(uintptr_t)userData);
+	if (NULL == t || PGTS_Ready != t->state) return GL_FALSE;
+
+	pgDeleteQueuePush(PGD_Texture, t->name);
+	t->name = 0;
+	t->state = PGTS_Evicted;
+	return GL_TRUE;
+}
+
+static PGResult reloadTexture(void *userData)
+{
+	struct PGTexturePrivate *t = pgHandlePoolGet(Textures, (PGTexture)(uintptr_t)userData);
+	if (NULL == t) return PGR_StaleHandle;
+
+	struct PGTextureLoad *load = pgMemAlloc(sizeof(struct PGTextureLoad), PGM_Texture);
+	if (NULL == load) return PGR_OutOfMemory;
+	memset(load, 0, sizeof(struct PGTextureLoad));
+	load->texture = t->texture;
+	load->options = t->options;
+	load->path = copyPath(t->path);
+	if (NULL == load->path)
+	{
+		freeLoad(load);
+		return PGR_OutOfMemory;
+	}
+	load->nativeFormats = nativeFormats();
+
+	t->state = PGTS_Loading;
+	startLoad(load);
+	return PGR_OK;
+}
+
+/**
+ * Starts accounting for the texture's GL memory, or updates it after a
+ * reload. Textures from files can be evicted and loaded again.
+ */
+static void trackMemory(struct PGTexturePrivate *t, const struct PGTextureLoad *load)
+{
+	size_t bytes = 0;
+	if (0 != load->compressedFormat)
+	{
+		for (int i = 0; i < load->levelCount; i++) bytes += load->levelSizes[i];
+	}
+	else
+	{
+		GLenum format, type;
+		glFormat(t->format, &format, &type);
+		bytes = pgGpuTextureBytes(format, type, load->width, load->height, load->levelCount);
+	}
+
+	if (PG_NULL_HANDLE != t->memory)
+	{
+		pgGpuMemoryResize(t->memory, bytes);
+		return;
+	}
+
+	PGGpuEviction eviction = { evictTexture, reloadTexture, (void *)(uintptr_t)t->texture };
+	if (PGR_OK == pgGpuMemoryAdd(&t->memory, PGG_Texture, bytes, NULL != t->path ? &eviction : NULL))
+	{
+		pgGpuMemorySetLabel(t->memory, NULL != t->path ? t->path : "texture from pixels");
+	}
+}
+
+/**
+ * Makes the GL texture and allocates every level, ready for the rows to
+ * be filled in.
+ */
+static PGResult beginUpload(struct PGTexturePrivate *t, struct PGTextureLoad *load)
+{
+	GLsizei width = load->width, height = load->height;
+	if (load->levelCount > 1 && ((width & (width - 1)) || (height & (height - 1))) && !npotMipmapsSupported())
+	{
+		pgLog(PGL_Warn, "Mipmaps need power of two textures here. Dropping them for %dx%d.", width, height);
+		if (0 == load->compressedFormat)
+		{
+			for (int i = 1; i < load->levelCount; i++) pgMemFree(load->levels[i]);
+		}
+		load->levelCount = 1;
+	}
+
+	pgLogAnyGlErrors("About to create texture.");
+	glGenTextures(1, &t->name);
+	if (0 == t->name)
+	{
+		pgLogAnyGlErrors("Could not create texture.");
+		return PGR_OutOfMemory;
+	}
+
+	GLenum format, type;
+	glFormat(t->format, &format, &type);
+	glBindTexture(GL_TEXTURE_2D, t->name);
+
+	// A chain stopping short of 1x1 samples as black unless GL is told
+	// where it stops, which ES 2 can't be
+	GLboolean mipmapped = load->levelCount > 1;
+	if (mipmapped && maxLevelSupported())
+	{
+#ifdef GL_ES_VERSION_3_0
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, load->levelCount - 1);
+#endif
+	}
+	else if (mipmapped && !isMipChainComplete(width, height, load->levelCount))
+	{
+		mipmapped = GL_FALSE;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Compressed levels are made whole as they are uploaded
+	for (int level = 0; 0 == load->compressedFormat && level < load->levelCount; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, format, levelSize(width, level), levelSize(height, level), 0, format, type, NULL);
+	}
+	pgLogAnyGlErrors("Created texture.");
+	trackMemory(t, load);
+
+	t->state = PGTS_Uploading;
+	return PGR_OK;
+}
+
+/**
+ * As continueUpload, but a level at a time, as compressed levels can't be
+ * split into rows everywhere.
+ */
+static size_t continueCompressedUpload(struct PGTexturePrivate *t, struct PGTextureLoad *load, size_t budget, GLboolean atLeastOneLevel)
+{
+	glBindTexture(GL_TEXTURE_2D, t->name);
+	while (load->level < load->levelCount)
+	{
+		size_t bytes = load->levelSizes[load->level];
+		if (bytes > budget && !atLeastOneLevel) break;
+		atLeastOneLevel = GL_FALSE;
+
+		glCompressedTexImage2D(GL_TEXTURE_2D, load->level, load->compressedFormat, levelSize(load->width, load->level), levelSize(load->height, load->level), 0, (GLsizei)bytes, load->levels[load->level]);
+		pgStatsTextureUpload(bytes);
+		budget = bytes < budget ? budget - bytes : 0;
+		load->level++;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (load->level == load->levelCount)
+	{
+		pgLogAnyGlErrors("Uploaded compressed texture.");
+		t->state = PGTS_Ready;
+	}
+	return budget;
+}
+
+/**
+ * Sends rows until the load is finished or `budget` is spent, and returns
+ * what is left of it. Levels are freed as soon as they are in GL. With
+ * `atLeastOneRow` a row is sent even if it is bigger than the budget.
+ */
+static size_t continueUpload(struct PGTexturePrivate *t, struct PGTextureLoad *load, size_t budget, GLboolean atLeastOneRow)
+{
+	if (0 != load->compressedFormat) return continueCompressedUpload(t, load, budget, atLeastOneRow);
+
+	GLenum format, type;
+	glFormat(t->format, &format, &type);
+	size_t pixelBytes = bytesPerPixel(t->format);
+
+	glBindTexture(GL_TEXTURE_2D, t->name);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	while (load->level < load->levelCount)
+	{
+		GLsizei width = levelSize(load->width, load->level);
+		GLsizei height = levelSize(load->height, load->level);
+		size_t rowBytes = (size_t)width * pixelBytes;
+
+		GLsizei rows = height - load->row;
+		if ((size_t)rows * rowBytes > budget)
+		{
+			rows = (GLsizei)(budget / rowBytes);
+			if (0 == rows)
+			{
+				if (!atLeastOneRow) break;
+				rows = 1;
+			}
+		}
+		atLeastOneRow = GL_FALSE;
+
+		const GLubyte *pixels = load->levels[load->level] + (size_t)load->row * rowBytes;
+		glTexSubImage2D(GL_TEXTURE_2D, load->level, 0, load->row, width, rows, format, type, pixels);
+		size_t bytes = (size_t)rows * rowBytes;
+		pgStatsTextureUpload(bytes);
+		budget = bytes < budget ? budget - bytes : 0;
+
+		load->row += rows;
+		if (load->row == height)
+		{
+			pgMemFree(load->levels[load->level]);
+			load->levels[load->level] = NULL;
+			load->level++;
+			load->row = 0;
+		}
+		if (0 == budget) break;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (load->level == load->levelCount)
+	{
+		pgLogAnyGlErrors("Uploaded texture.");
+		t->state = PGTS_Ready;
+	}
+	return budget;
+}
+
+/**
+ * Moves every load along as far as `budget` allows, oldest first, and
+ * retires the ones which are done with. SIZE_MAX uploads everything.
+ */
+static void updateLoads(size_t budget)
+{
+	GLboolean sentAny = GL_FALSE;
+	struct PGTextureLoad **link = &Loads;
+	while (NULL != *link)
+	{
+		struct PGTextureLoad *load = *link;
+		int state = __atomic_load_n(&load->state, __ATOMIC_ACQUIRE);
+		struct PGTexturePrivate *t = pgHandlePoolGet(Textures, load->texture);
+
+		GLboolean retire = GL_FALSE;
+		if (LOAD_Decoding == state)
+		{
+			// Waiting for the job. Destroyed textures are retired later,
+			// as the job still owns the load.
+		}
+		else if (NULL == t)
+		{
+			retire = GL_TRUE;
+		}
+		else if (LOAD_Failed == state)
+		{
+			pgLog(PGL_Error, "Could not load texture %s.", NULL != load->path ? load->path : "from pixels");
+			pgGpuMemoryRemove(&t->memory);
+			t->state = PGTS_Failed;
+			retire = GL_TRUE;
+		}
+		else if (budget > 0 || !sentAny)
+		{
+			t->width = load->width;
+			t->height = load->height;
+			if (0 == t->name && PGR_OK != beginUpload(t, load))
+			{
+				t->state = PGTS_Failed;
+				retire = GL_TRUE;
+			}
+			else
+			{
+				budget = continueUpload(t, load, budget, !sentAny);
+				sentAny = GL_TRUE;
+				retire = PGTS_Ready == t->state;
+			}
+		}
+
+		if (retire)
+		{
+			*link = load->next;
+			if (NULL == *link) LoadsTail = link;
+			freeLoad(load);
+		}
+		else
+		{
+			link = &load->next;
+		}
+	}
+}
+
+void pgTextureUpdate(void)
+{
+	if (NULL == Loads) return;
+
+	pgProfileZone("pgTextureUpdate");
+	updateLoads(UploadBudget);
+}
+
+void pgTextureFlushUploads(void)
+{
+	pgProfileZone("pgTextureFlushUploads");
+	for (struct PGTextureLoad *load = Loads; NULL != load; load = load->next)
+	{
+		// The job can't have been recycled while the load is decoding
+		while (LOAD_Decoding == __atomic_load_n(&load->state, __ATOMIC_ACQUIRE))
+		{
+			pgJobWait(load->scheduler, load->job);
+		}
+	}
+	updateLoads(SIZE_MAX);
+}
+
+unsigned long pgTextureUploadsPending(void)
+{
+	unsigned long pending = 0;
+	for (const struct PGTextureLoad *load = Loads; NULL != load; load = load->next)
+	{
+		if (pgHandlePoolIsValid(Textures, load->texture)) pending++;
+	}
+	return pending;
+}
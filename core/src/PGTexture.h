@@ -0,0 +1,157 @@
+//
+//  PGTexture.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGTexture_h
+#define PGTexture_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_TEXTURE_MAX_LEVELS 16
+	#define PG_TEXTURE_DEFAULT_UPLOAD_BUDGET (1024 * 1024)
+
+	typedef enum
+	{
+		PGTF_RGBA8 = 0
+	,	PGTF_RGB565
+	,	PGTF_RGBA4444
+	}
+	PGTextureFormat;
+
+	typedef struct
+	{
+		PGTextureFormat format;
+		GLboolean mipmaps;			// Box filtered on the CPU as the image is decoded
+		GLboolean premultiply;		// Multiply colour by alpha before mipmapping
+	}
+	PGTextureOptions;
+
+	typedef enum
+	{
+		PGTS_Loading = 0			// Being read and decoded
+	,	PGTS_Uploading				// Being copied to GL a slice per frame
+	,	PGTS_Ready
+	,	PGTS_Failed
+	,	PGTS_Evicted				// To stay within the GPU memory budget
+	}
+	PGTextureState;
+
+	/**
+	 * Textures are loaded in the background and trickled into GL:
+	 *
+	 *   1. pgTextureLoad hands back a handle straight away. The file is
+	 *      read, decoded, premultiplied, mipmapped and converted to its
+	 *      final format by a job on the scheduler given to
+	 *      pgTextureSetJobScheduler, or on the calling thread without one.
+	 *   2. Each pgTextureUpdate copies decoded levels into GL with
+	 *      glTexSubImage2D, a band of rows at a time, until the frame's
+	 *      upload budget is spent. Compressed levels go a level at a time
+	 *      with glCompressedTexImage2D.
+	 *   3. Once every level is in, the texture is Ready.
+	 *
+	 * Until then pgTextureGlHandle gives a 1x1 transparent placeholder, so
+	 * textures can be drawn with from the moment they are made.
+	 *
+	 * Textures loaded from files can be evicted to stay within the budget
+	 * set with pgGpuMemorySetBudget. Asking for an evicted texture's GL
+	 * handle loads it again the same way, with the placeholder standing in
+	 * until it is back.
+	 *
+	 * Textures, like meshes, belong to the GL thread. Only the decoding
+	 * runs elsewhere.
+	 */
+
+	/**
+	 * Starts loading a PNG, TGA or KTX file. `options` may be NULL for
+	 * RGBA8 without mipmaps or premultiplying. Fails only if the handle
+	 * can't be made; problems reading the file show up later as
+	 * PGTS_Failed. With a job scheduler set, the calling thread must belong
+	 * to it.
+	 *
+	 * KTX levels are uploaded compressed if GL lists their format, and
+	 * `options` are ignored. ETC1 counts as ETC2 on ES 3. Otherwise ETC1,
+	 * ETC2 and EAC are decoded to RGBA8 on the CPU and treated like any
+	 * other image, while ASTC fails.
+	 */
+	PGResult pgTextureLoad(PGTexture *texture, const char *path, const PGTextureOptions *options);
+
+	/**
+	 * Makes a texture from RGBA8 pixels, top row first. The pixels are
+	 * copied before returning, then processed and uploaded like a loaded
+	 * file.
+	 */
+	PGResult pgTextureCreateFromPixels(PGTexture *texture, const GLubyte *pixels, GLsizei width, GLsizei height, const PGTextureOptions *options);
+
+	/**
+	 * Invalidates the handle straight away. The GL texture is deleted
+	 * through the delete queue, and a load still in progress is thrown
+	 * away when it finishes.
+	 */
+	void pgTextureDestroy(PGTexture *texture);
+	int pgTextureIsValid(PGTexture texture);
+
+	PGTextureState pgTextureState(PGTexture texture);
+
+	/**
+	 * The GL texture to bind. The placeholder until the texture is Ready,
+	 * and for stale handles. Counts as using the texture, for eviction.
+	 */
+	GLuint pgTextureGlHandle(PGTexture texture);
+
+	/**
+	 * The size of the top level, 0 by 0 until it has been decoded.
+	 */
+	void pgTextureSize(PGTexture texture, GLsizei *width, GLsizei *height);
+
+	/**
+	 * Decoding happens on `scheduler` from now on. NULL, the default,
+	 * decodes on the thread calling pgTextureLoad. The scheduler must
+	 * outlive the loads started on it.
+	 */
+	void pgTextureSetJobScheduler(PGJobScheduler scheduler);
+
+	/**
+	 * Bytes pgTextureUpdate may send to GL each frame, across all
+	 * textures. At least one row is always sent, so a texture with wider
+	 * rows than the budget still finishes.
+	 */
+	void pgTextureSetUploadBudget(size_t bytes);
+
+	/**
+	 * Hands finished decodes to the upload queue and uploads up to the
+	 * budget. pgRendererBeginFrame calls this.
+	 */
+	void pgTextureUpdate(void);
+
+	/**
+	 * Waits for every load and uploads everything, ignoring the budget.
+	 * For when a hitch doesn't matter, such as behind a loading screen
+	 * which has already been drawn.
+	 */
+	void pgTextureFlushUploads(void);
+
+	/**
+	 * Textures not yet Ready or Failed.
+	 */
+	unsigned long pgTextureUploadsPending(void);
+
+	/**
+	 * The pool holding every live texture, NULL until the first is made.
+	 */
+	PGHandlePool pgTexturePool(void);
+
+	/**
+	 * Deletes the placeholder. For tearing down a context.
+	 */
+	void pgTextureReleasePlaceholder(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1158 @@
+//
+//  PGTrace.c
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+// The wrappers below call the driver, so must not see PGTraceGL.h
+#define PG_TRACE_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "Pictogram.h"
+
+#ifdef PG_GL_TRACE
+
+#define TRACE_BUFFER_SIZE (256 * 1024)
+#define MAX_TRACKED_ATTRIBS 16
+#define MAX_LIVE_FENCES 64
+
+// What a draw needs to know to copy client side arrays
+struct PGTraceAttrib {
+	GLboolean enabled;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	const GLvoid *pointer;
+	GLuint buffer;
+	GLuint divisor;
+};
+
+struct PGTraceFence {
+	GLsync sync;
+	uint32_t id;
+};
+
+static FILE *Trace;
+static char *TraceBuffer;
+
+// Bindings are tracked whether or not a trace is open
+static GLuint ArrayBuffer;
+static GLuint PackBuffer;
+static GLint UnpackAlignment = 4;
+static struct PGTraceAttrib Attribs[MAX_TRACKED_ATTRIBS];
+
+static struct PGTraceFence Fences[MAX_LIVE_FENCES];
+static uint32_t NextFence;
+
+// Encoding //////////////////////////////////////////////////////////////////
+
+static void putCall(PGTraceCall call)
+{
+	fputc((int)call, Trace);
+}
+
+static void putU32(uint32_t value)
+{
+	unsigned char bytes[4] = {
+		(unsigned char)value,
+		(unsigned char)(value >> 8),
+		(unsigned char)(value >> 16),
+		(unsigned char)(value >> 24)
+	};
+	fwrite(bytes, 1, sizeof(bytes), Trace);
+}
+
+static void putU64(uint64_t value)
+{
+	putU32((uint32_t)value);
+	putU32((uint32_t)(value >> 32));
+}
+
+static void putF32(GLfloat value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	putU32(bits);
+}
+
+static void putBlob(const void *data, size_t bytes)
+{
+	putU32((uint32_t)bytes);
+	if (bytes > 0) fwrite(data, 1, bytes, Trace);
+}
+
+static void putString(const char *string)
+{
+	putBlob(string, NULL != string ? strlen(string) : 0);
+}
+
+static void putNames(PGTraceCall call, GLsizei n, const GLuint *names)
+{
+	putCall(call);
+	putU32((uint32_t)n);
+	for (GLsizei i = 0; i < n; i++) putU32(names[i]);
+}
+
+static size_t typeSize(GLenum type)
+{
+	switch (type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+/**
+ * Bytes glTexImage2D and glTexSubImage2D read for the formats the core
+ * uploads, honouring the unpack alignment.
+ */
+static size_t pixelDataSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+	if (width <= 0 || height <= 0) return 0;
+
+	size_t pixelBytes = 2;
+	if (GL_UNSIGNED_BYTE == type)
+	{
+		switch (format)
+		{
+			case GL_RGBA: pixelBytes = 4; break;
+			case GL_RGB: pixelBytes = 3; break;
+			case GL_LUMINANCE_ALPHA: pixelBytes = 2; break;
+			default: pixelBytes = 1; break;
+		}
+	}
+	size_t rowBytes = (size_t)width * pixelBytes;
+	size_t stride = (rowBytes + UnpackAlignment - 1) / UnpackAlignment * UnpackAlignment;
+	return stride * (height - 1) + rowBytes;
+}
+
+/**
+ * Records the client memory each enabled attribute will read, so replay
+ * doesn't depend on the pointers recorded by glVertexAttribPointer.
+ */
+static void putClientArrays(GLint first, GLsizei count, GLsizei instances)
+{
+	if (count <= 0) return;
+
+	for (GLuint i = 0; i < MAX_TRACKED_ATTRIBS; i++)
+	{
+		const struct PGTraceAttrib *a = &Attribs[i];
+		if (!a->enabled || 0 != a->buffer || NULL == a->pointer) continue;
+
+		size_t elementSize = a->size * typeSize(a->type);
+		size_t stride = a->stride > 0 ? (size_t)a->stride : elementSize;
+		size_t elements = a->divisor > 0 ? (instances + a->divisor - 1) / a->divisor : (size_t)(first + count);
+		if (0 == elements) continue;
+
+		putCall(PGTC_ClientArray);
+		putU32(i);
+		putU32((uint32_t)a->size);
+		putU32(a->type);
+		putU32(a->normalized);
+		putU32((uint32_t)a->stride);
+		putBlob(a->pointer, (elements - 1) * stride + elementSize);
+	}
+}
+
+static uint32_t fenceId(GLsync sync)
+{
+	for (int i = 0; i < MAX_LIVE_FENCES; i++)
+	{
+		if (sync == Fences[i].sync) return Fences[i].id;
+	}
+	return 0;
+}
+
+// Control ///////////////////////////////////////////////////////////////////
+
+PGResult pgTraceBegin(const char *path)
+{
+	if (NULL == path) return PGR_NullPointerBarf;
+	pgTraceEnd();
+
+	Trace = fopen(path, "wb");
+	if (NULL == Trace)
+	{
+		pgLog(PGL_Error, "Could not open GL trace %s.", path);
+		return PGR_CouldNotReadFile;
+	}
+
+	TraceBuffer = pgMemAlloc(TRACE_BUFFER_SIZE, PGM_General);
+	if (NULL != TraceBuffer) setvbuf(Trace, TraceBuffer, _IOFBF, TRACE_BUFFER_SIZE);
+
+	fwrite("PGTR", 1, 4, Trace);
+	putU32(PG_TRACE_VERSION);
+	putString((const char *)glGetString(GL_VERSION));
+	putString((const char *)glGetString(GL_RENDERER));
+
+	GLint viewport[4] = { 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	putU32((uint32_t)viewport[2]);
+	putU32((uint32_t)viewport[3]);
+
+	return PGR_OK;
+}
+
+void pgTraceEnd(void)
+{
+	if (NULL == Trace) return;
+
+	fclose(Trace);
+	Trace = NULL;
+	pgMemFree(TraceBuffer);
+	TraceBuffer = NULL;
+}
+
+void pgTraceFrame(void)
+{
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Frame);
+}
+
+int pgTraceIsRecording(void)
+{
+	return NULL != Trace;
+}
+
+// Wrappers //////////////////////////////////////////////////////////////////
+
+void pgtAttachShader(GLuint program, GLuint shader)
+{
+	glAttachShader(program, shader);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_AttachShader);
+	putU32(program);
+	putU32(shader);
+}
+
+void pgtBindBuffer(GLenum target, GLuint buffer)
+{
+	if (GL_ARRAY_BUFFER == target) ArrayBuffer = buffer;
+#ifdef GL_PIXEL_PACK_BUFFER
+	if (GL_PIXEL_PACK_BUFFER == target) PackBuffer = buffer;
+#endif
+	glBindBuffer(target, buffer);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BindBuffer);
+	putU32(target);
+	putU32(buffer);
+}
+
+void pgtBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	glBindFramebuffer(target, framebuffer);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BindFramebuffer);
+	putU32(target);
+	putU32(framebuffer);
+}
+
+void pgtBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+	glBindRenderbuffer(target, renderbuffer);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BindRenderbuffer);
+	putU32(target);
+	putU32(renderbuffer);
+}
+
+void pgtBindTexture(GLenum target, GLuint texture)
+{
+	glBindTexture(target, texture);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BindTexture);
+	putU32(target);
+	putU32(texture);
+}
+
+void pgtBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BufferData);
+	putU32(target);
+	putU32((uint32_t)size);
+	putU32(usage);
+	putU32(NULL != data);
+	if (NULL != data) fwrite(data, 1, size, Trace);
+}
+
+void pgtBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data)
+{
+	glBufferSubData(target, offset, size, data);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BufferSubData);
+	putU32(target);
+	putU32((uint32_t)offset);
+	putBlob(data, size);
+}
+
+void pgtClear(GLbitfield mask)
+{
+	glClear(mask);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Clear);
+	putU32(mask);
+}
+
+void pgtClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
+{
+	glClearColor(red, green, blue, alpha);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_ClearColor);
+	putF32(red);
+	putF32(green);
+	putF32(blue);
+	putF32(alpha);
+}
+
+void pgtClearDepthf(GLclampf depth)
+{
+	glClearDepthf(depth);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_ClearDepthf);
+	putF32(depth);
+}
+
+void pgtClearStencil(GLint s)
+{
+	glClearStencil(s);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_ClearStencil);
+	putU32((uint32_t)s);
+}
+
+void pgtCompileShader(GLuint shader)
+{
+	glCompileShader(shader);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_CompileShader);
+	putU32(shader);
+}
+
+void pgtCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data)
+{
+	glCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_CompressedTexImage2D);
+	putU32(target);
+	putU32((uint32_t)level);
+	putU32(internalformat);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+	putU32((uint32_t)border);
+	putBlob(data, (size_t)imageSize);
+}
+
+GLuint pgtCreateProgram(void)
+{
+	GLuint program = glCreateProgram();
+	if (NULL == Trace) return program;
+
+	putCall(PGTC_CreateProgram);
+	putU32(program);
+	return program;
+}
+
+GLuint pgtCreateShader(GLenum type)
+{
+	GLuint shader = glCreateShader(type);
+	if (NULL == Trace) return shader;
+
+	putCall(PGTC_CreateShader);
+	putU32(type);
+	putU32(shader);
+	return shader;
+}
+
+void pgtDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+	if (NULL != Trace) putNames(PGTC_DeleteBuffers, n, buffers);
+	for (GLsizei i = 0; i < n; i++)
+	{
+		if (buffers[i] == ArrayBuffer) ArrayBuffer = 0;
+		if (buffers[i] == PackBuffer) PackBuffer = 0;
+	}
+	glDeleteBuffers(n, buffers);
+}
+
+void pgtDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	if (NULL != Trace) putNames(PGTC_DeleteFramebuffers, n, framebuffers);
+	glDeleteFramebuffers(n, framebuffers);
+}
+
+void pgtDeleteProgram(GLuint program)
+{
+	glDeleteProgram(program);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DeleteProgram);
+	putU32(program);
+}
+
+void pgtDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
+{
+	if (NULL != Trace) putNames(PGTC_DeleteRenderbuffers, n, renderbuffers);
+	glDeleteRenderbuffers(n, renderbuffers);
+}
+
+void pgtDeleteShader(GLuint shader)
+{
+	glDeleteShader(shader);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DeleteShader);
+	putU32(shader);
+}
+
+void pgtDeleteTextures(GLsizei n, const GLuint *textures)
+{
+	if (NULL != Trace) putNames(PGTC_DeleteTextures, n, textures);
+	glDeleteTextures(n, textures);
+}
+
+void pgtDetachShader(GLuint program, GLuint shader)
+{
+	glDetachShader(program, shader);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DetachShader);
+	putU32(program);
+	putU32(shader);
+}
+
+void pgtDisableVertexAttribArray(GLuint index)
+{
+	if (index < MAX_TRACKED_ATTRIBS) Attribs[index].enabled = GL_FALSE;
+	glDisableVertexAttribArray(index);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DisableVertexAttribArray);
+	putU32(index);
+}
+
+void pgtDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	if (NULL != Trace)
+	{
+		putClientArrays(first, count, 0);
+		putCall(PGTC_DrawArrays);
+		putU32(mode);
+		putU32((uint32_t)first);
+		putU32((uint32_t)count);
+	}
+	glDrawArrays(mode, first, count);
+}
+
+void pgtEnableVertexAttribArray(GLuint index)
+{
+	if (index < MAX_TRACKED_ATTRIBS) Attribs[index].enabled = GL_TRUE;
+	glEnableVertexAttribArray(index);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_EnableVertexAttribArray);
+	putU32(index);
+}
+
+void pgtFlush(void)
+{
+	glFlush();
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Flush);
+}
+
+void pgtFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+{
+	glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_FramebufferRenderbuffer);
+	putU32(target);
+	putU32(attachment);
+	putU32(renderbuffertarget);
+	putU32(renderbuffer);
+}
+
+void pgtFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+{
+	glFramebufferTexture2D(target, attachment, textarget, texture, level);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_FramebufferTexture2D);
+	putU32(target);
+	putU32(attachment);
+	putU32(textarget);
+	putU32(texture);
+	putU32((uint32_t)level);
+}
+
+void pgtGenBuffers(GLsizei n, GLuint *buffers)
+{
+	glGenBuffers(n, buffers);
+	if (NULL != Trace) putNames(PGTC_GenBuffers, n, buffers);
+}
+
+void pgtGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+	glGenFramebuffers(n, framebuffers);
+	if (NULL != Trace) putNames(PGTC_GenFramebuffers, n, framebuffers);
+}
+
+void pgtGenRenderbuffers(GLsizei n, GLuint *renderbuffers)
+{
+	glGenRenderbuffers(n, renderbuffers);
+	if (NULL != Trace) putNames(PGTC_GenRenderbuffers, n, renderbuffers);
+}
+
+void pgtGenTextures(GLsizei n, GLuint *textures)
+{
+	glGenTextures(n, textures);
+	if (NULL != Trace) putNames(PGTC_GenTextures, n, textures);
+}
+
+GLint pgtGetAttribLocation(GLuint program, const GLchar *name)
+{
+	GLint location = glGetAttribLocation(program, name);
+	if (NULL == Trace) return location;
+
+	// Recorded so replay can map locations onto whatever its driver picks
+	putCall(PGTC_GetAttribLocation);
+	putU32(program);
+	putString(name);
+	putU32((uint32_t)location);
+	return location;
+}
+
+GLint pgtGetUniformLocation(GLuint program, const GLchar *name)
+{
+	GLint location = glGetUniformLocation(program, name);
+	if (NULL == Trace) return location;
+
+	putCall(PGTC_GetUniformLocation);
+	putU32(program);
+	putString(name);
+	putU32((uint32_t)location);
+	return location;
+}
+
+void pgtLinkProgram(GLuint program)
+{
+	glLinkProgram(program);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_LinkProgram);
+	putU32(program);
+}
+
+void pgtPixelStorei(GLenum pname, GLint param)
+{
+	if (GL_UNPACK_ALIGNMENT == pname) UnpackAlignment = param;
+	glPixelStorei(pname, param);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_PixelStorei);
+	putU32(pname);
+	putU32((uint32_t)param);
+}
+
+void pgtReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels)
+{
+	if (NULL != Trace)
+	{
+		putCall(PGTC_ReadPixels);
+		putU32((uint32_t)x);
+		putU32((uint32_t)y);
+		putU32((uint32_t)width);
+		putU32((uint32_t)height);
+		putU32(format);
+		putU32(type);
+		putU32(0 != PackBuffer ? (uint32_t)(uintptr_t)pixels : ~0u);
+	}
+	glReadPixels(x, y, width, height, format, type, pixels);
+}
+
+void pgtRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	glRenderbufferStorage(target, internalformat, width, height);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_RenderbufferStorage);
+	putU32(target);
+	putU32(internalformat);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+}
+
+void pgtShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+	glShaderSource(shader, count, string, length);
+	if (NULL == Trace) return;
+
+	size_t total = 0;
+	for (GLsizei i = 0; i < count; i++)
+	{
+		total += (NULL != length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+	}
+
+	putCall(PGTC_ShaderSource);
+	putU32(shader);
+	putU32((uint32_t)total);
+	for (GLsizei i = 0; i < count; i++)
+	{
+		size_t bytes = (NULL != length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+		fwrite(string[i], 1, bytes, Trace);
+	}
+}
+
+void pgtTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_TexImage2D);
+	putU32(target);
+	putU32((uint32_t)level);
+	putU32((uint32_t)internalformat);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+	putU32((uint32_t)border);
+	putU32(format);
+	putU32(type);
+	putBlob(pixels, NULL != pixels ? pixelDataSize(width, height, format, type) : 0);
+}
+
+void pgtTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	glTexParameteri(target, pname, param);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_TexParameteri);
+	putU32(target);
+	putU32(pname);
+	putU32((uint32_t)param);
+}
+
+void pgtTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_TexSubImage2D);
+	putU32(target);
+	putU32((uint32_t)level);
+	putU32((uint32_t)xoffset);
+	putU32((uint32_t)yoffset);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+	putU32(format);
+	putU32(type);
+	putBlob(pixels, pixelDataSize(width, height, format, type));
+}
+
+void pgtUniform1fv(GLint location, GLsizei count, const GLfloat *v)
+{
+	glUniform1fv(location, count, v);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Uniform1fv);
+	putU32((uint32_t)location);
+	putU32((uint32_t)count);
+	putBlob(v, sizeof(GLfloat) * 1 * count);
+}
+
+void pgtUniform2fv(GLint location, GLsizei count, const GLfloat *v)
+{
+	glUniform2fv(location, count, v);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Uniform2fv);
+	putU32((uint32_t)location);
+	putU32((uint32_t)count);
+	putBlob(v, sizeof(GLfloat) * 2 * count);
+}
+
+void pgtUniform3fv(GLint location, GLsizei count, const GLfloat *v)
+{
+	glUniform3fv(location, count, v);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Uniform3fv);
+	putU32((uint32_t)location);
+	putU32((uint32_t)count);
+	putBlob(v, sizeof(GLfloat) * 3 * count);
+}
+
+void pgtUniform4fv(GLint location, GLsizei count, const GLfloat *v)
+{
+	glUniform4fv(location, count, v);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Uniform4fv);
+	putU32((uint32_t)location);
+	putU32((uint32_t)count);
+	putBlob(v, sizeof(GLfloat) * 4 * count);
+}
+
+void pgtUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	glUniformMatrix4fv(location, count, transpose, value);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_UniformMatrix4fv);
+	putU32((uint32_t)location);
+	putU32((uint32_t)count);
+	putU32(transpose);
+	putBlob(value, sizeof(GLfloat) * 16 * count);
+}
+
+void pgtUseProgram(GLuint program)
+{
+	glUseProgram(program);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_UseProgram);
+	putU32(program);
+}
+
+void pgtVertexAttrib4fv(GLuint index, const GLfloat *values)
+{
+	glVertexAttrib4fv(index, values);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_VertexAttrib4fv);
+	putU32(index);
+	for (int i = 0; i < 4; i++) putF32(values[i]);
+}
+
+void pgtVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer)
+{
+	if (index < MAX_TRACKED_ATTRIBS)
+	{
+		struct PGTraceAttrib *a = &Attribs[index];
+		a->size = size;
+		a->type = type;
+		a->normalized = normalized;
+		a->stride = stride;
+		a->pointer = pointer;
+		a->buffer = ArrayBuffer;
+	}
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_VertexAttribPointer);
+	putU32(index);
+	putU32((uint32_t)size);
+	putU32(type);
+	putU32(normalized);
+	putU32((uint32_t)stride);
+	putU32(0 != ArrayBuffer ? (uint32_t)(uintptr_t)pointer : ~0u);
+}
+
+void pgtViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glViewport(x, y, width, height);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Viewport);
+	putU32((uint32_t)x);
+	putU32((uint32_t)y);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+}
+
+void pgtScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glScissor(x, y, width, height);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Scissor);
+	putU32((uint32_t)x);
+	putU32((uint32_t)y);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+}
+
+static void putDivisor(GLuint index, GLuint divisor)
+{
+	if (index < MAX_TRACKED_ATTRIBS) Attribs[index].divisor = divisor;
+	if (NULL == Trace) return;
+
+	putCall(PGTC_VertexAttribDivisor);
+	putU32(index);
+	putU32(divisor);
+}
+
+static void putDrawInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+	if (NULL == Trace) return;
+
+	putClientArrays(first, count, instances);
+	putCall(PGTC_DrawArraysInstanced);
+	putU32(mode);
+	putU32((uint32_t)first);
+	putU32((uint32_t)count);
+	putU32((uint32_t)instances);
+}
+
+// Fixed function state, set by pipelines
+
+void pgtBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
+{
+	glBlendEquationSeparate(modeRGB, modeAlpha);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BlendEquationSeparate);
+	putU32(modeRGB);
+	putU32(modeAlpha);
+}
+
+void pgtBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+{
+	glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BlendFuncSeparate);
+	putU32(srcRGB);
+	putU32(dstRGB);
+	putU32(srcAlpha);
+	putU32(dstAlpha);
+}
+
+void pgtColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	glColorMask(red, green, blue, alpha);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_ColorMask);
+	putU32(red);
+	putU32(green);
+	putU32(blue);
+	putU32(alpha);
+}
+
+void pgtCullFace(GLenum mode)
+{
+	glCullFace(mode);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_CullFace);
+	putU32(mode);
+}
+
+void pgtDepthFunc(GLenum func)
+{
+	glDepthFunc(func);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DepthFunc);
+	putU32(func);
+}
+
+void pgtDepthMask(GLboolean flag)
+{
+	glDepthMask(flag);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DepthMask);
+	putU32(flag);
+}
+
+void pgtDisable(GLenum cap)
+{
+	glDisable(cap);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Disable);
+	putU32(cap);
+}
+
+void pgtEnable(GLenum cap)
+{
+	glEnable(cap);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_Enable);
+	putU32(cap);
+}
+
+void pgtFrontFace(GLenum mode)
+{
+	glFrontFace(mode);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_FrontFace);
+	putU32(mode);
+}
+
+void pgtPolygonOffset(GLfloat factor, GLfloat units)
+{
+	glPolygonOffset(factor, units);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_PolygonOffset);
+	putF32(factor);
+	putF32(units);
+}
+
+void pgtStencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	glStencilFunc(func, ref, mask);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_StencilFunc);
+	putU32(func);
+	putU32((uint32_t)ref);
+	putU32(mask);
+}
+
+void pgtStencilMask(GLuint mask)
+{
+	glStencilMask(mask);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_StencilMask);
+	putU32(mask);
+}
+
+void pgtStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
+{
+	glStencilOp(fail, zfail, zpass);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_StencilOp);
+	putU32(fail);
+	putU32(zfail);
+	putU32(zpass);
+}
+
+#ifdef GL_EXT_instanced_arrays
+// Both flavours of instancing are recorded as the ES 3 calls
+
+void pgtVertexAttribDivisorEXT(GLuint index, GLuint divisor)
+{
+	putDivisor(index, divisor);
+	glVertexAttribDivisorEXT(index, divisor);
+}
+
+void pgtDrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count, GLsizei primcount)
+{
+	putDrawInstanced(mode, first, count, primcount);
+	glDrawArraysInstancedEXT(mode, first, count, primcount);
+}
+#endif
+
+#if defined(GL_EXT_discard_framebuffer) || defined(GL_ES_VERSION_3_0)
+static void putInvalidate(GLenum target, GLsizei count, const GLenum *attachments)
+{
+	if (NULL == Trace) return;
+
+	putCall(PGTC_InvalidateFramebuffer);
+	putU32(target);
+	putU32((uint32_t)count);
+	for (GLsizei i = 0; i < count; i++)
+	{
+		putU32(attachments[i]);
+	}
+}
+#endif
+
+#ifdef GL_EXT_discard_framebuffer
+// Recorded as the ES 3 call, which does the same
+
+void pgtDiscardFramebufferEXT(GLenum target, GLsizei numAttachments, const GLenum *attachments)
+{
+	glDiscardFramebufferEXT(target, numAttachments, attachments);
+	putInvalidate(target, numAttachments, attachments);
+}
+#endif
+
+#ifdef GL_ES_VERSION_3_0
+void pgtVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+	putDivisor(index, divisor);
+	glVertexAttribDivisor(index, divisor);
+}
+
+void pgtDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+	putDrawInstanced(mode, first, count, instancecount);
+	glDrawArraysInstanced(mode, first, count, instancecount);
+}
+
+void *pgtMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	void *pointer = glMapBufferRange(target, offset, length, access);
+	if (NULL == Trace) return pointer;
+
+	putCall(PGTC_MapBufferRange);
+	putU32(target);
+	putU32((uint32_t)offset);
+	putU32((uint32_t)length);
+	putU32(access);
+	return pointer;
+}
+
+GLboolean pgtUnmapBuffer(GLenum target)
+{
+	GLboolean result = glUnmapBuffer(target);
+	if (NULL == Trace) return result;
+
+	putCall(PGTC_UnmapBuffer);
+	putU32(target);
+	return result;
+}
+
+void pgtRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	glRenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_RenderbufferStorageMultisample);
+	putU32(target);
+	putU32((uint32_t)samples);
+	putU32(internalformat);
+	putU32((uint32_t)width);
+	putU32((uint32_t)height);
+}
+
+void pgtBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+{
+	glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BlitFramebuffer);
+	putU32((uint32_t)srcX0);
+	putU32((uint32_t)srcY0);
+	putU32((uint32_t)srcX1);
+	putU32((uint32_t)srcY1);
+	putU32((uint32_t)dstX0);
+	putU32((uint32_t)dstY0);
+	putU32((uint32_t)dstX1);
+	putU32((uint32_t)dstY1);
+	putU32(mask);
+	putU32(filter);
+}
+
+void pgtInvalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments)
+{
+	glInvalidateFramebuffer(target, numAttachments, attachments);
+	putInvalidate(target, numAttachments, attachments);
+}
+
+GLsync pgtFenceSync(GLenum condition, GLbitfield flags)
+{
+	GLsync sync = glFenceSync(condition, flags);
+	if (NULL == sync) return sync;
+
+	// Ids are handed out even while not recording, so fences made before
+	// a trace starts are never confused with ones made during it
+	struct PGTraceFence *slot = &Fences[NextFence % MAX_LIVE_FENCES];
+	for (int i = 0; i < MAX_LIVE_FENCES; i++)
+	{
+		if (NULL == Fences[i].sync)
+		{
+			slot = &Fences[i];
+			break;
+		}
+	}
+	slot->sync = sync;
+	slot->id = ++NextFence;
+
+	if (NULL == Trace) return sync;
+
+	putCall(PGTC_FenceSync);
+	putU32(slot->id);
+	return sync;
+}
+
+GLenum pgtClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	if (NULL != Trace)
+	{
+		putCall(PGTC_ClientWaitSync);
+		putU32(fenceId(sync));
+		putU32(flags);
+		putU64(timeout);
+	}
+	return glClientWaitSync(sync, flags, timeout);
+}
+
+void pgtDeleteSync(GLsync sync)
+{
+	uint32_t id = fenceId(sync);
+	for (int i = 0; i < MAX_LIVE_FENCES; i++)
+	{
+		if (sync == Fences[i].sync) Fences[i].sync = NULL;
+	}
+	glDeleteSync(sync);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_DeleteSync);
+	putU32(id);
+}
+
+GLuint pgtGetUniformBlockIndex(GLuint program, const GLchar *name)
+{
+	GLuint index = glGetUniformBlockIndex(program, name);
+	if (NULL == Trace) return index;
+
+	putCall(PGTC_GetUniformBlockIndex);
+	putU32(program);
+	putString(name);
+	putU32(index);
+	return index;
+}
+
+void pgtUniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding)
+{
+	glUniformBlockBinding(program, blockIndex, binding);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_UniformBlockBinding);
+	putU32(program);
+	putU32(blockIndex);
+	putU32(binding);
+}
+
+void pgtBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(target, index, buffer, offset, size);
+	if (NULL == Trace) return;
+
+	putCall(PGTC_BindBufferRange);
+	putU32(target);
+	putU32(index);
+	putU32(buffer);
+	putU32((uint32_t)offset);
+	putU32((uint32_t)size);
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+//
+//  PGTrace.h
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGTrace_h
+#define PGTrace_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * GL command capture. Building with PG_GL_TRACE defined routes the GL
+	 * entry points the core uses through PGTraceGL.h, which records each
+	 * call while a trace is open and passes it on to the driver. Without
+	 * it the functions below compile away.
+	 *
+	 * Traces are replayed by tools/pgreplay. Like the rest of the core's GL
+	 * use, capture expects every call to come from one thread.
+	 *
+	 * File format, all little endian:
+	 *
+	 *     header  "PGTR", u32 version, blob GL_VERSION, blob GL_RENDERER,
+	 *             u32 viewport width, u32 viewport height
+	 *     record  u8 PGTraceCall, then that call's arguments
+	 *
+	 * Enums, names, ints and sizes are u32, floats are f32, and a u64 is
+	 * two u32s, low word first. Blobs are a u32 byte count then the bytes,
+	 * and carry buffer data, texture pixels, uniform values and shader
+	 * sources. Names made by the driver are recorded as the value the
+	 * driver returned, and replay maps them to its own. Sync objects are
+	 * numbered in the order they were made.
+	 *
+	 * Client side vertex arrays are captured at draw time, as a
+	 * PGTC_ClientArray record before the draw for each enabled attribute
+	 * not sourced from a buffer.
+	 *
+	 * Objects made before the trace starts aren't in it. Replay draws
+	 * anything sent to them into a framebuffer the size of the viewport at
+	 * the start, which covers a trace started after pgRendererSetup.
+	 */
+	#define PG_TRACE_VERSION 9
+
+	typedef enum
+	{
+		PGTC_Frame = 0					// pgTraceFrame, no arguments
+	,	PGTC_AttachShader				// program, shader
+	,	PGTC_BindBuffer					// target, buffer
+	,	PGTC_BindFramebuffer			// target, framebuffer
+	,	PGTC_BindRenderbuffer			// target, renderbuffer
+	,	PGTC_BufferData					// target, size, usage, u32 has data, then size bytes if it has
+	,	PGTC_BufferSubData				// target, offset, blob data
+	,	PGTC_Clear						// mask
+	,	PGTC_ClearColor					// red, green, blue, alpha
+	,	PGTC_ClientArray				// index, size, type, normalized, stride, blob data
+	,	PGTC_CompileShader				// shader
+	,	PGTC_CreateProgram				// program
+	,	PGTC_CreateShader				// type, shader
+	,	PGTC_DeleteBuffers				// count, buffers
+	,	PGTC_DeleteFramebuffers			// count, framebuffers
+	,	PGTC_DeleteProgram				// program
+	,	PGTC_DeleteRenderbuffers		// count, renderbuffers
+	,	PGTC_DeleteShader				// shader
+	,	PGTC_DeleteTextures				// count, textures
+	,	PGTC_DetachShader				// program, shader
+	,	PGTC_DisableVertexAttribArray	// index
+	,	PGTC_DrawArrays					// mode, first, count
+	,	PGTC_DrawArraysInstanced		// mode, first, count, instances
+	,	PGTC_EnableVertexAttribArray	// index
+	,	PGTC_Flush
+	,	PGTC_FramebufferRenderbuffer	// target, attachment, renderbuffer target, renderbuffer
+	,	PGTC_GenBuffers					// count, buffers
+	,	PGTC_GenFramebuffers			// count, framebuffers
+	,	PGTC_GenRenderbuffers			// count, renderbuffers
+	,	PGTC_GetAttribLocation			// program, blob name, location
+	,	PGTC_GetUniformLocation			// program, blob name, location
+	,	PGTC_LinkProgram				// program
+	,	PGTC_PixelStorei				// name, value
+	,	PGTC_ReadPixels					// x, y, width, height, format, type, offset into a pack buffer or ~0u
+	,	PGTC_RenderbufferStorage		// target, format, width, height
+	,	PGTC_ShaderSource				// shader, blob source (all strings joined)
+	,	PGTC_Uniform4fv					// location, count, blob values
+	,	PGTC_UniformMatrix4fv			// location, count, transpose, blob values
+	,	PGTC_UseProgram					// program
+	,	PGTC_VertexAttrib4fv			// index, x, y, z, w
+	,	PGTC_VertexAttribDivisor		// index, divisor
+	,	PGTC_VertexAttribPointer		// index, size, type, normalized, stride, offset or ~0u for client memory
+	,	PGTC_Viewport					// x, y, width, height
+	,	PGTC_MapBufferRange				// target, offset, length, access
+	,	PGTC_UnmapBuffer				// target
+	,	PGTC_FenceSync					// sync
+	,	PGTC_ClientWaitSync				// sync, flags, u64 timeout
+	,	PGTC_DeleteSync					// sync
+	,	PGTC_GenTextures				// count, textures
+	,	PGTC_BindTexture				// target, texture
+	,	PGTC_TexParameteri				// target, name, value
+	,	PGTC_TexImage2D					// target, level, internal format, width, height, border, format, type, blob pixels (empty for NULL)
+	,	PGTC_TexSubImage2D				// target, level, x, y, width, height, format, type, blob pixels
+	,	PGTC_CompressedTexImage2D		// target, level, internal format, width, height, border, blob data
+	,	PGTC_FramebufferTexture2D		// target, attachment, texture target, texture, level
+	,	PGTC_RenderbufferStorageMultisample	// target, samples, internal format, width, height
+	,	PGTC_BlitFramebuffer			// source x0, y0, x1, y1, destination x0, y0, x1, y1, mask, filter
+	,	PGTC_InvalidateFramebuffer		// target, count, attachments
+	,	PGTC_BlendEquationSeparate		// colour mode, alpha mode
+	,	PGTC_BlendFuncSeparate			// source colour, destination colour, source alpha, destination alpha
+	,	PGTC_ColorMask					// red, green, blue, alpha
+	,	PGTC_CullFace					// mode
+	,	PGTC_DepthFunc					// function
+	,	PGTC_DepthMask					// flag
+	,	PGTC_Disable					// capability
+	,	PGTC_Enable						// capability
+	,	PGTC_FrontFace					// mode
+	,	PGTC_PolygonOffset				// f32 factor, f32 units
+	,	PGTC_StencilFunc				// function, reference, mask
+	,	PGTC_StencilMask				// mask
+	,	PGTC_StencilOp					// stencil fail, depth fail, pass
+	,	PGTC_Uniform1fv					// location, count, blob values
+	,	PGTC_Uniform2fv					// location, count, blob values
+	,	PGTC_Uniform3fv					// location, count, blob values
+	,	PGTC_GetUniformBlockIndex		// program, blob name, index
+	,	PGTC_UniformBlockBinding		// program, block index, binding
+	,	PGTC_BindBufferRange			// target, binding, buffer, offset, size
+	,	PGTC_Scissor					// x, y, width, height
+	,	PGTC_ClearDepthf				// depth
+	,	PGTC_ClearStencil				// stencil
+
+	,	PGTC_Count
+	}
+	PGTraceCall;
+
+#ifdef PG_GL_TRACE
+	/**
+	 * Starts recording to `path`, replacing any trace already open. The
+	 * GL context must be current.
+	 */
+	PGResult pgTraceBegin(const char *path);
+	void pgTraceEnd(void);
+
+	/**
+	 * Marks the start of a frame. pgRendererBeginFrame calls this.
+	 */
+	void pgTraceFrame(void);
+
+	/**
+	 * True while a trace is open.
+	 */
+	int pgTraceIsRecording(void);
+#else
+#	define pgTraceBegin(path) PGR_Unsupported
+#	define pgTraceEnd() ;
+#	define pgTraceFrame() ;
+#	define pgTraceIsRecording() 0
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+//
+//  PGTraceGL.h
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Included by PGGL.h when PG_GL_TRACE is defined. Every GL entry point
+//  the core uses that changes state or draws is redirected to a recording
+//  wrapper in PGTrace.c. Queries such as glGetError and glGetProgramiv
+//  are left alone, as replay doesn't need them.
+//
+
+#ifndef PGTraceGL_h
+#define PGTraceGL_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	void pgtAttachShader(GLuint program, GLuint shader);
+	void pgtBindBuffer(GLenum target, GLuint buffer);
+	void pgtBindFramebuffer(GLenum target, GLuint framebuffer);
+	void pgtBindRenderbuffer(GLenum target, GLuint renderbuffer);
+	void pgtBindTexture(GLenum target, GLuint texture);
+	void pgtBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage);
+	void pgtBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data);
+	void pgtClear(GLbitfield mask);
+	void pgtClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+	void pgtClearDepthf(GLclampf depth);
+	void pgtClearStencil(GLint s);
+	void pgtCompileShader(GLuint shader);
+	void pgtCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data);
+	GLuint pgtCreateProgram(void);
+	GLuint pgtCreateShader(GLenum type);
+	void pgtDeleteBuffers(GLsizei n, const GLuint *buffers);
+	void pgtDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+	void pgtDeleteProgram(GLuint program);
+	void pgtDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers);
+	void pgtDeleteShader(GLuint shader);
+	void pgtDeleteTextures(GLsizei n, const GLuint *textures);
+	void pgtDetachShader(GLuint program, GLuint shader);
+	void pgtDisableVertexAttribArray(GLuint index);
+	void pgtDrawArrays(GLenum mode, GLint first, GLsizei count);
+	void pgtEnableVertexAttribArray(GLuint index);
+	void pgtFlush(void);
+	void pgtFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+	void pgtFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+	void pgtGenBuffers(GLsizei n, GLuint *buffers);
+	void pgtGenFramebuffers(GLsizei n, GLuint *framebuffers);
+	void pgtGenRenderbuffers(GLsizei n, GLuint *renderbuffers);
+	void pgtGenTextures(GLsizei n, GLuint *textures);
+	GLint pgtGetAttribLocation(GLuint program, const GLchar *name);
+	GLint pgtGetUniformLocation(GLuint program, const GLchar *name);
+	void pgtLinkProgram(GLuint program);
+	void pgtPixelStorei(GLenum pname, GLint param);
+	void pgtReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels);
+	void pgtRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+	void pgtShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+	void pgtTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels);
+	void pgtTexParameteri(GLenum target, GLenum pname, GLint param);
+	void pgtTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels);
+	void pgtUniform1fv(GLint location, GLsizei count, const GLfloat *v);
+	void pgtUniform2fv(GLint location, GLsizei count, const GLfloat *v);
+	void pgtUniform3fv(GLint location, GLsizei count, const GLfloat *v);
+	void pgtUniform4fv(GLint location, GLsizei count, const GLfloat *v);
+	void pgtUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+	void pgtUseProgram(GLuint program);
+	void pgtVertexAttrib4fv(GLuint index, const GLfloat *values);
+	void pgtVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+	void pgtViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void pgtScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+	void pgtBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha);
+	void pgtBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+	void pgtColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	void pgtCullFace(GLenum mode);
+	void pgtDepthFunc(GLenum func);
+	void pgtDepthMask(GLboolean flag);
+	void pgtDisable(GLenum cap);
+	void pgtEnable(GLenum cap);
+	void pgtFrontFace(GLenum mode);
+	void pgtPolygonOffset(GLfloat factor, GLfloat units);
+	void pgtStencilFunc(GLenum func, GLint ref, GLuint mask);
+	void pgtStencilMask(GLuint mask);
+	void pgtStencilOp(GLenum fail, GLenum zfail, GLenum zpass);
+
+#	define glAttachShader pgtAttachShader
+#	define glBindBuffer pgtBindBuffer
+#	define glBindFramebuffer pgtBindFramebuffer
+#	define glBindRenderbuffer pgtBindRenderbuffer
+#	define glBindTexture pgtBindTexture
+#	define glBufferData pgtBufferData
+#	define glBufferSubData pgtBufferSubData
+#	define glClear pgtClear
+#	define glClearColor pgtClearColor
+#	define glClearDepthf pgtClearDepthf
+#	define glClearStencil pgtClearStencil
+#	define glCompileShader pgtCompileShader
+#	define glCompressedTexImage2D pgtCompressedTexImage2D
+#	define glCreateProgram pgtCreateProgram
+#	define glCreateShader pgtCreateShader
+#	define glDeleteBuffers pgtDeleteBuffers
+#	define glDeleteFramebuffers pgtDeleteFramebuffers
+#	define glDeleteProgram pgtDeleteProgram
+#	define glDeleteRenderbuffers pgtDeleteRenderbuffers
+#	define glDeleteShader pgtDeleteShader
+#	define glDeleteTextures pgtDeleteTextures
+#	define glDetachShader pgtDetachShader
+#	define glDisableVertexAttribArray pgtDisableVertexAttribArray
+#	define glDrawArrays pgtDrawArrays
+#	define glEnableVertexAttribArray pgtEnableVertexAttribArray
+#	define glFlush pgtFlush
+#	define glFramebufferRenderbuffer pgtFramebufferRenderbuffer
+#	define glFramebufferTexture2D pgtFramebufferTexture2D
+#	define glGenBuffers pgtGenBuffers
+#	define glGenFramebuffers pgtGenFramebuffers
+#	define glGenRenderbuffers pgtGenRenderbuffers
+#	define glGenTextures pgtGenTextures
+#	define glGetAttribLocation pgtGetAttribLocation
+#	define glGetUniformLocation pgtGetUniformLocation
+#	define glLinkProgram pgtLinkProgram
+#	define glPixelStorei pgtPixelStorei
+#	define glReadPixels pgtReadPixels
+#	define glRenderbufferStorage pgtRenderbufferStorage
+#	define glShaderSource pgtShaderSource
+#	define glTexImage2D pgtTexImage2D
+#	define glTexParameteri pgtTexParameteri
+#	define glTexSubImage2D pgtTexSubImage2D
+#	define glUniform1fv pgtUniform1fv
+#	define glUniform2fv pgtUniform2fv
+#	define glUniform3fv pgtUniform3fv
+#	define glUniform4fv pgtUniform4fv
+#	define glUniformMatrix4fv pgtUniformMatrix4fv
+#	define glUseProgram pgtUseProgram
+#	define glVertexAttrib4fv pgtVertexAttrib4fv
+#	define glVertexAttribPointer pgtVertexAttribPointer
+#	define glViewport pgtViewport
+#	define glScissor pgtScissor
+#	define glBlendEquationSeparate pgtBlendEquationSeparate
+#	define glBlendFuncSeparate pgtBlendFuncSeparate
+#	define glColorMask pgtColorMask
+#	define glCullFace pgtCullFace
+#	define glDepthFunc pgtDepthFunc
+#	define glDepthMask pgtDepthMask
+#	define glDisable pgtDisable
+#	define glEnable pgtEnable
+#	define glFrontFace pgtFrontFace
+#	define glPolygonOffset pgtPolygonOffset
+#	define glStencilFunc pgtStencilFunc
+#	define glStencilMask pgtStencilMask
+#	define glStencilOp pgtStencilOp
+
+#ifdef GL_EXT_instanced_arrays
+	void pgtVertexAttribDivisorEXT(GLuint index, GLuint divisor);
+	void pgtDrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+
+#	undef glVertexAttribDivisorEXT
+#	undef glDrawArraysInstancedEXT
+#	define glVertexAttribDivisorEXT pgtVertexAttribDivisorEXT
+#	define glDrawArraysInstancedEXT pgtDrawArraysInstancedEXT
+#endif
+
+#ifdef GL_EXT_discard_framebuffer
+	void pgtDiscardFramebufferEXT(GLenum target, GLsizei numAttachments, const GLenum *attachments);
+
+#	undef glDiscardFramebufferEXT
+#	define glDiscardFramebufferEXT pgtDiscardFramebufferEXT
+#endif
+
+#ifdef GL_ES_VERSION_3_0
+	void pgtVertexAttribDivisor(GLuint index, GLuint divisor);
+	void pgtDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+	void *pgtMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+	GLboolean pgtUnmapBuffer(GLenum target);
+	void pgtRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
+	void pgtBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+	void pgtInvalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments);
+	GLsync pgtFenceSync(GLenum condition, GLbitfield flags);
+	GLenum pgtClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+	void pgtDeleteSync(GLsync sync);
+	GLuint pgtGetUniformBlockIndex(GLuint program, const GLchar *name);
+	void pgtUniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding);
+	void pgtBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+#	define glVertexAttribDivisor pgtVertexAttribDivisor
+#	define glDrawArraysInstanced pgtDrawArraysInstanced
+#	define glMapBufferRange pgtMapBufferRange
+#	define glUnmapBuffer pgtUnmapBuffer
+#	define glRenderbufferStorageMultisample pgtRenderbufferStorageMultisample
+#	define glBlitFramebuffer pgtBlitFramebuffer
+#	define glInvalidateFramebuffer pgtInvalidateFramebuffer
+#	define glFenceSync pgtFenceSync
+#	define glClientWaitSync pgtClientWaitSync
+#	define glDeleteSync pgtDeleteSync
+#	define glGetUniformBlockIndex pgtGetUniformBlockIndex
+#	define glUniformBlockBinding pgtUniformBlockBinding
+#	define glBindBufferRange pgtBindBufferRange
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
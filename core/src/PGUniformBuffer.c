@@ -0,0 +1,522 @@
+//
+//  PGUniformBuffer.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Pictogram.h"
+
+#ifdef GL_ES_VERSION_3_0
+#	define PG_UNIFORM_BUFFER_HAS_UBO 1
+#endif
+
+// A frame's part of the buffer is written again once the frames in flight
+// after it have begun, as with the delete queue's buckets
+#define NUM_SEGMENTS (PG_FRAMES_IN_FLIGHT + 1)
+
+static const char * const BlockNames[PGUB_Count] = {
+	"PGFrame",
+	"PGView",
+	"PGDraw",
+};
+
+struct PGUniformMemberPrivate {
+	const char *name;
+	char glName[PG_UNIFORM_NAME_MAX];	// As GL reports it, with [0] for arrays
+	GLenum type;
+	GLsizei count;
+	GLsizei components;
+	GLsizei value;		// First of the member's floats in values
+	GLint offset;		// Into the block's std140 layout, -1 if unknown
+	GLint stride;		// Between array elements
+};
+
+struct PGUniformBlockPrivate {
+	struct PGUniformMemberPrivate members[PG_UNIFORM_BLOCK_MAX_MEMBERS];
+	GLsizei memberCount;
+	GLfloat *values;
+
+	unsigned long generation;	// Bumped by every set
+	unsigned long uploaded;		// Generation written to the ring and bound
+	unsigned long applied;		// Generation the fallback gave the last program
+	GLboolean usesBuffer;		// The last program declares the block
+
+	GLsizei size;				// Bytes, 0 until a program with the block is seen
+	GLubyte *staging;
+};
+
+struct PGUniformBufferPrivate {
+	GLboolean supported;
+	GLuint buffer;
+	GLsizeiptr segmentBytes;
+	GLint alignment;
+	int segment;
+	GLsizeiptr used;			// Bytes of the frame's segment written
+
+	PGProgram program;			// Last applied
+	PGResult programResult;		// Not PGR_OK if its blocks don't match
+	GLboolean dirty;			// A block changed since
+
+	struct PGUniformBlockPrivate blocks[PGUB_Count];
+	PGUniformBufferStats stats;
+	PGGpuResource memory;
+};
+
+static GLboolean detectUniformBuffers(void)
+{
+#ifdef PG_UNIFORM_BUFFER_HAS_UBO
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11))
+	{
+		return GL_TRUE;
+	}
+#endif
+	return GL_FALSE;
+}
+
+static GLsizei typeComponents(GLenum type)
+{
+	switch (type)
+	{
+		case GL_FLOAT: return 1;
+		case GL_FLOAT_VEC2: return 2;
+		case GL_FLOAT_VEC3: return 3;
+		case GL_FLOAT_VEC4: return 4;
+		case GL_FLOAT_MAT4: return 16;
+		default: return 0;
+	}
+}
+
+static void clearBlock(struct PGUniformBlockPrivate *block)
+{
+	pgMemFree(block->values);
+	pgMemFree(block->staging);
+	memset(block, 0, sizeof(struct PGUniformBlockPrivate));
+}
+
+PGResult pgUniformBufferCreate(PGUniformBuffer *buffer, GLsizeiptr bytesPerFrame)
+{
+	if (NULL == buffer) return PGR_NullPointerBarf;
+	*buffer = NULL;
+
+	if (bytesPerFrame <= 0)
+	{
+		pgLog(PGL_Error, "Invalid uniform buffer of %ld bytes a frame.", (long)bytesPerFrame);
+		return PGR_LazyGenericError;
+	}
+
+	PGUniformBuffer b = pgMemAlloc(sizeof(struct PGUniformBufferPrivate), PGM_Renderer);
+	if (NULL == b) return PGR_OutOfMemory;
+	memset(b, 0, sizeof(struct PGUniformBufferPrivate));
+	b->segmentBytes = bytesPerFrame;
+	b->program = PG_NULL_HANDLE;
+	b->supported = detectUniformBuffers();
+	*buffer = b;
+
+#ifdef PG_UNIFORM_BUFFER_HAS_UBO
+	if (b->supported)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &b->alignment);
+		if (b->alignment <= 0) b->alignment = 256;
+
+		glGenBuffers(1, &b->buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, b->buffer);
+		glBufferData(GL_UNIFORM_BUFFER, b->segmentBytes * NUM_SEGMENTS, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		GLenum error = glGetError();
+		if (0 == b->buffer || GL_NO_ERROR != error)
+		{
+			pgLog(PGL_Error, "Could not create uniform buffer, GL error 0x%04x.", error);
+			pgUniformBufferDestroy(buffer);
+			return PGR_CouldNotCreateBuffer;
+		}
+		if (PGR_OK == pgGpuMemoryAdd(&b->memory, PGG_Buffer, (size_t)b->segmentBytes * NUM_SEGMENTS, NULL))
+		{
+			pgGpuMemorySetLabel(b->memory, "uniforms");
+		}
+	}
+#endif
+
+	return PGR_OK;
+}
+
+void pgUniformBufferDestroy(PGUniformBuffer *buffer)
+{
+	if (NULL != buffer && NULL != *buffer)
+	{
+		PGUniformBuffer b = *buffer;
+
+		pgDeleteQueuePush(PGD_Buffer, b->buffer);
+		pgGpuMemoryRemove(&b->memory);
+		for (int i = 0; i < PGUB_Count; i++)
+		{
+			clearBlock(&b->blocks[i]);
+		}
+
+		memset(b, 0, sizeof(struct PGUniformBufferPrivate));
+		pgMemFree(b);
+
+		*buffer = NULL;
+	}
+}
+
+PGResult pgUniformBufferDeclare(PGUniformBuffer buffer, PGUniformBlock block, const PGUniformMember *members, GLsizei count)
+{
+	if (NULL == buffer || (NULL == members && count > 0)) return PGR_NullPointerBarf;
+	if (block < 0 || block >= PGUB_Count || count < 0 || count > PG_UNIFORM_BLOCK_MAX_MEMBERS)
+	{
+		pgLog(PGL_Error, "Invalid uniform block %d with %d members.", block, count);
+		return PGR_LazyGenericError;
+	}
+
+	struct PGUniformBlockPrivate *b = &buffer->blocks[block];
+	clearBlock(b);
+
+	GLsizei valueCount = 0;
+	for (GLsizei i = 0; i < count; i++)
+	{
+		const PGUniformMember *member = &members[i];
+		GLsizei components = typeComponents(member->type);
+		size_t nameLength = NULL != member->name ? strlen(member->name) : 0;
+		if (0 == components || member->count < 1 || 0 == nameLength || nameLength + 4 > PG_UNIFORM_NAME_MAX)
+		{
+			pgLog(PGL_Error, "Invalid member %d of uniform block %s.", i, BlockNames[block]);
+			clearBlock(b);
+			return PGR_LazyGenericError;
+		}
+
+		struct PGUniformMemberPrivate *m = &b->members[i];
+		m->name = member->name;
+		snprintf(m->glName, sizeof(m->glName), member->count > 1 ? "%s[0]" : "%s", member->name);
+		m->type = member->type;
+		m->count = member->count;
+		m->components = components;
+		m->value = valueCount;
+		m->offset = -1;
+		valueCount += components * member->count;
+	}
+
+	if (valueCount > 0)
+	{
+		b->values = pgMemAlloc(sizeof(GLfloat) * valueCount, PGM_Renderer);
+		if (NULL == b->values) return PGR_OutOfMemory;
+		memset(b->values, 0, sizeof(GLfloat) * valueCount);
+	}
+	b->memberCount = count;
+	b->generation = 1;
+
+	// Programs need looking at again for the new layout
+	buffer->program = PG_NULL_HANDLE;
+	buffer->dirty = GL_TRUE;
+	return PGR_OK;
+}
+
+PGResult pgUniformBufferSet(PGUniformBuffer buffer, PGUniformBlock block, const char *name, const GLfloat *values)
+{
+	if (NULL == buffer || NULL == name || NULL == values) return PGR_NullPointerBarf;
+	if (block < 0 || block >= PGUB_Count) return PGR_LazyGenericError;
+
+	struct PGUniformBlockPrivate *b = &buffer->blocks[block];
+	for (GLsizei i = 0; i < b->memberCount; i++)
+	{
+		struct PGUniformMemberPrivate *m = &b->members[i];
+		if (0 == strcmp(m->name, name))
+		{
+			memcpy(b->values + m->value, values, sizeof(GLfloat) * m->components * m->count);
+			b->generation++;
+			buffer->dirty = GL_TRUE;
+			return PGR_OK;
+		}
+	}
+	return PGR_MissingUniform;
+}
+
+void pgUniformBufferBeginFrame(PGUniformBuffer buffer)
+{
+	if (NULL == buffer) return;
+
+	buffer->segment = (buffer->segment + 1) % NUM_SEGMENTS;
+	buffer->used = 0;
+	memset(&buffer->stats, 0, sizeof(PGUniformBufferStats));
+
+	// Last frame's copies are in another segment, so each block is written
+	// again the first time it's needed
+	for (int i = 0; i < PGUB_Count; i++)
+	{
+		buffer->blocks[i].uploaded = 0;
+	}
+	buffer->dirty = GL_TRUE;
+}
+
+/**
+ * Takes the block's layout from the first program which declares it. Every
+ * program declaring it with the std140 layout agrees.
+ */
+static void findLayout(PGUniformBuffer buffer, PGUniformBlock block, PGProgram program)
+{
+	struct PGUniformBlockPrivate *b = &buffer->blocks[block];
+	const char *blockName = BlockNames[block];
+	GLsizei size = pgProgramUniformBlockSize(program, blockName);
+
+	// Room for every block after an orphan, however they're aligned
+	if (size <= 0 || (size + buffer->alignment) * PGUB_Count > buffer->segmentBytes)
+	{
+		pgLog(PGL_Error, "Uniform block %s of %d bytes doesn't fit a frame of %ld.", blockName, size, (long)buffer->segmentBytes);
+		return;
+	}
+
+	b->staging = pgMemAlloc(size, PGM_Renderer);
+	if (NULL == b->staging) return;
+
+	for (GLsizei i = 0; i < b->memberCount; i++)
+	{
+		struct PGUniformMemberPrivate *m = &b->members[i];
+		m->offset = pgProgramUniformOffset(program, m->glName);
+		m->stride = pgProgramUniformArrayStride(program, m->glName);
+		GLsizei bytes = sizeof(GLfloat) * m->components;
+		if (m->offset < 0 || m->offset + (m->count - 1) * m->stride + bytes > size)
+		{
+			pgLog(PGL_Warn, "Uniform block %s has no member %s.", blockName, m->glName);
+			m->offset = -1;
+		}
+	}
+	b->size = size;
+}
+
+/**
+ * Checks a block declared by another program against the layout found
+ * so far. Members both declare must be at the same offsets, but either
+ * may have members the other lacks: ones seen for the first time take
+ * this program's offsets, and a longer block grows, so the range bound
+ * covers every program which uses it. PGR_InvalidProgram if a member
+ * moved, as values would land in the wrong places.
+ */
+static PGResult matchLayout(PGUniformBuffer buffer, PGUniformBlock block, PGProgram program)
+{
+	struct PGUniformBlockPrivate *b = &buffer->blocks[block];
+	const char *blockName = BlockNames[block];
+	GLsizei size = pgProgramUniformBlockSize(program, blockName);
+
+	GLboolean adopt = GL_FALSE;
+	for (GLsizei i = 0; i < b->memberCount; i++)
+	{
+		const struct PGUniformMemberPrivate *m = &b->members[i];
+		GLint offset = pgProgramUniformOffset(program, m->glName);
+		if (offset < 0) continue;
+
+		if (m->offset < 0)
+		{
+			adopt = GL_TRUE;
+		}
+		else if (offset != m->offset || (m->count > 1 && pgProgramUniformArrayStride(program, m->glName) != m->stride))
+		{
+			pgLog(PGL_Error, "Uniform block %s is laid out differently by program 0x%08x, so it can't draw.", blockName, program);
+			return PGR_InvalidProgram;
+		}
+	}
+
+	if (size > b->size)
+	{
+		if ((size + buffer->alignment) * PGUB_Count > buffer->segmentBytes)
+		{
+			pgLog(PGL_Error, "Uniform block %s of %d bytes doesn't fit a frame of %ld.", blockName, size, (long)buffer->segmentBytes);
+			return PGR_InvalidProgram;
+		}
+		GLubyte *staging = pgMemAlloc(size, PGM_Renderer);
+		if (NULL == staging) return PGR_OutOfMemory;
+
+		pgMemFree(b->staging);
+		b->staging = staging;
+		b->size = size;
+
+		// Bound again at the new size by the next apply
+		b->uploaded = 0;
+	}
+
+	for (GLsizei i = 0; adopt && i < b->memberCount; i++)
+	{
+		struct PGUniformMemberPrivate *m = &b->members[i];
+		if (m->offset >= 0) continue;
+
+		GLint offset = pgProgramUniformOffset(program, m->glName);
+		GLint stride = pgProgramUniformArrayStride(program, m->glName);
+		if (offset < 0 || offset + (m->count - 1) * stride + (GLint)sizeof(GLfloat) * m->components > size) continue;
+
+		m->offset = offset;
+		m->stride = stride;
+		b->uploaded = 0;
+	}
+	return PGR_OK;
+}
+
+#ifdef PG_UNIFORM_BUFFER_HAS_UBO
+static void pack(struct PGUniformBlockPrivate *b)
+{
+	memset(b->staging, 0, b->size);
+	for (GLsizei i = 0; i < b->memberCount; i++)
+	{
+		const struct PGUniformMemberPrivate *m = &b->members[i];
+		if (m->offset < 0) continue;
+
+		const GLfloat *value = b->values + m->value;
+		GLsizei bytes = sizeof(GLfloat) * m->components;
+		if (1 == m->count || bytes == m->stride)
+		{
+			memcpy(b->staging + m->offset, value, bytes * m->count);
+			continue;
+		}
+		// std140 pads array elements out to whole vec4s
+		for (GLsizei e = 0; e < m->count; e++)
+		{
+			memcpy(b->staging + m->offset + e * m->stride, value + e * m->components, bytes);
+		}
+	}
+}
+
+/**
+ * Writes the block to the next free range of the frame's segment and binds
+ * it there. Returns GL_TRUE if the buffer had to be orphaned, after which
+ * the other blocks have to be written again too.
+ */
+static GLboolean upload(PGUniformBuffer buffer, PGUniformBlock block)
+{
+	struct PGUniformBlockPrivate *b = &buffer->blocks[block];
+	GLboolean orphaned = GL_FALSE;
+	pack(b);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer->buffer);
+	GLsizeiptr offset = (buffer->used + buffer->alignment - 1) / buffer->alignment * buffer->alignment;
+	if (offset + b->size > buffer->segmentBytes)
+	{
+		// Draws already made keep the old storage
+		glBufferData(GL_UNIFORM_BUFFER, buffer->segmentBytes * NUM_SEGMENTS, NULL, GL_DYNAMIC_DRAW);
+		for (int i = 0; i < PGUB_Count; i++)
+		{
+			buffer->blocks[i].uploaded = 0;
+		}
+		buffer->stats.orphans++;
+		offset = 0;
+		orphaned = GL_TRUE;
+	}
+
+	GLintptr start = buffer->segment * buffer->segmentBytes + offset;
+	glBufferSubData(GL_UNIFORM_BUFFER, start, b->size, b->staging);
+	glBindBufferRange(GL_UNIFORM_BUFFER, block, buffer->buffer, start, b->size);
+	buffer->used = offset + b->size;
+	b->uploaded = b->generation;
+
+	buffer->stats.blockUploads++;
+	buffer->stats.bytes = buffer->used;
+	return orphaned;
+}
+#endif
+
+static void setUniforms(PGUniformBuffer buffer, struct PGUniformBlockPrivate *b, PGProgram program)
+{
+	for (GLsizei i = 0; i < b->memberCount; i++)
+	{
+		const struct PGUniformMemberPrivate *m = &b->members[i];
+		GLint location = pgProgramUniformLocation(program, m->glName);
+		if (location < 0 && m->count > 1)
+		{
+			// Some drivers report arrays by their bare name
+			location = pgProgramUniformLocation(program, m->name);
+		}
+		if (location < 0) continue;
+
+		const GLfloat *value = b->values + m->value;
+		switch (m->type)
+		{
+			case GL_FLOAT: glUniform1fv(location, m->count, value); break;
+			case GL_FLOAT_VEC2: glUniform2fv(location, m->count, value); break;
+			case GL_FLOAT_VEC3: glUniform3fv(location, m->count, value); break;
+			case GL_FLOAT_VEC4: glUniform4fv(location, m->count, value); break;
+			case GL_FLOAT_MAT4: glUniformMatrix4fv(location, m->count, GL_FALSE, value); break;
+		}
+		buffer->stats.uniformCalls++;
+	}
+}
+
+PGResult pgUniformBufferApply(PGUniformBuffer buffer, PGProgram program)
+{
+	if (NULL == buffer) return PGR_NullPointerBarf;
+	if (program == buffer->program && !buffer->dirty) return buffer->programResult;
+
+	if (program != buffer->program)
+	{
+		buffer->program = program;
+		buffer->programResult = PGR_OK;
+		for (int i = 0; i < PGUB_Count; i++)
+		{
+			struct PGUniformBlockPrivate *b = &buffer->blocks[i];
+			b->applied = 0;
+			b->usesBuffer = buffer->supported && b->memberCount > 0
+				&& PGR_OK == pgProgramSetUniformBlockBinding(program, BlockNames[i], i);
+			if (!b->usesBuffer) continue;
+
+			if (0 == b->size)
+			{
+				findLayout(buffer, i, program);
+				continue;
+			}
+
+			PGResult result = matchLayout(buffer, i, program);
+			if (PGR_OK != result) buffer->programResult = result;
+		}
+	}
+	buffer->dirty = GL_FALSE;
+
+	// Binding blocks the program reads differently would only draw garbage
+	if (PGR_OK != buffer->programResult) return buffer->programResult;
+
+	PGResult result = PGR_OK;
+	for (int i = 0; i < PGUB_Count; i++)
+	{
+		struct PGUniformBlockPrivate *b = &buffer->blocks[i];
+		if (0 == b->memberCount) continue;
+
+		if (!b->usesBuffer)
+		{
+			if (b->applied != b->generation)
+			{
+				setUniforms(buffer, b, program);
+				b->applied = b->generation;
+			}
+			continue;
+		}
+
+		if (0 == b->size)
+		{
+			result = PGR_MissingUniform;
+			continue;
+		}
+#ifdef PG_UNIFORM_BUFFER_HAS_UBO
+		if (b->uploaded != b->generation && upload(buffer, i))
+		{
+			// Blocks before this one were bound to the old storage
+			i = -1;
+		}
+#endif
+	}
+	return result;
+}
+
+GLboolean pgUniformBufferIsSupported(PGUniformBuffer buffer)
+{
+	if (NULL == buffer) return GL_FALSE;
+
+	return buffer->supported;
+}
+
+void pgUniformBufferStats(PGUniformBuffer buffer, PGUniformBufferStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGUniformBufferStats));
+	if (NULL == buffer) return;
+
+	*stats = buffer->stats;
+}
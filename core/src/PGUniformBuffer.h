@@ -0,0 +1,113 @@
+//
+//  PGUniformBuffer.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGUniformBuffer_h
+#define PGUniformBuffer_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	#define PG_UNIFORM_BLOCK_MAX_MEMBERS 16
+	#define PG_UNIFORM_NAME_MAX 64
+
+	// Default bytes of per frame, per view and per draw data a frame can use
+	#define PG_UNIFORM_BUFFER_FRAME_BYTES (64 * 1024)
+
+	/**
+	 * The shared blocks. Each is bound at the binding point of its value,
+	 * and programs declare it by the name in the comment.
+	 */
+	typedef enum
+	{
+		PGUB_Frame = 0	// PGFrame: set once a frame, such as the time
+	,	PGUB_View		// PGView: set per camera, such as projectionMatrix
+	,	PGUB_Draw		// PGDraw: set per draw, such as modelViewMatrix
+	,	PGUB_Count
+	}
+	PGUniformBlock;
+
+	typedef struct
+	{
+		const char *name;	// Without [0] for arrays
+		GLenum type;		// GL_FLOAT, GL_FLOAT_VEC2, 3 or 4, or GL_FLOAT_MAT4
+		GLsizei count;		// Array length, or 1
+	}
+	PGUniformMember;
+
+	typedef struct
+	{
+		unsigned long blockUploads;		// Blocks written to the ring this frame
+		unsigned long bytes;			// Ring bytes used this frame
+		unsigned long uniformCalls;		// glUniform calls made by the fallback
+		unsigned long orphans;			// Times the ring filled and was replaced
+	}
+	PGUniformBufferStats;
+
+	/**
+	 * Uniforms shared by every program, so a value set once reaches every
+	 * program which uses it.
+	 *
+	 * On OpenGL ES 3, programs which declare the PGFrame, PGView or PGDraw
+	 * blocks (std140, with no instance name) read them from one buffer.
+	 * Each changed block is written to the next free range of the frame's
+	 * part of the buffer and bound there, so the per frame and per view
+	 * blocks are written and bound once however many programs use them,
+	 * and each draw gets its own range of per draw data without waiting
+	 * for earlier draws. The buffer has a part for each frame in flight;
+	 * if a frame runs out of room the buffer is orphaned and started again.
+	 * Offsets come from the first program seen with each member. Later
+	 * programs may declare the block with fewer or more members, when the
+	 * longest size is bound, but not with a member anywhere else.
+	 *
+	 * Programs without the blocks, which is every program on ES 2, get the
+	 * members as ordinary uniforms of the same names instead, set when the
+	 * program is switched to and whenever they change.
+	 *
+	 * The renderer owns one, and applies it to the active program before
+	 * each draw. Belongs to the GL thread.
+	 */
+	PGResult pgUniformBufferCreate(PGUniformBuffer *buffer, GLsizeiptr bytesPerFrame);
+	void pgUniformBufferDestroy(PGUniformBuffer *buffer);
+
+	/**
+	 * Describes a block's members. Values start as zero.
+	 */
+	PGResult pgUniformBufferDeclare(PGUniformBuffer buffer, PGUniformBlock block, const PGUniformMember *members, GLsizei count);
+
+	/**
+	 * Copies a member's value, `count` times its type's floats, with
+	 * matrices in column order.
+	 */
+	PGResult pgUniformBufferSet(PGUniformBuffer buffer, PGUniformBlock block, const char *name, const GLfloat *values);
+
+	/**
+	 * Moves on to the next frame's part of the buffer. The renderer calls
+	 * this from pgRendererBeginFrame.
+	 */
+	void pgUniformBufferBeginFrame(PGUniformBuffer buffer);
+
+	/**
+	 * Brings the program up to date with the blocks, uploading and binding
+	 * any which changed. The renderer calls this before each draw, and
+	 * skips the draw on PGR_InvalidProgram, from a program whose block
+	 * members aren't where earlier programs had them.
+	 */
+	PGResult pgUniformBufferApply(PGUniformBuffer buffer, PGProgram program);
+
+	/**
+	 * True if the context has uniform buffers, as on ES 3.
+	 */
+	GLboolean pgUniformBufferIsSupported(PGUniformBuffer buffer);
+
+	void pgUniformBufferStats(PGUniformBuffer buffer, PGUniformBufferStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
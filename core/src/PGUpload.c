@@ -0,0 +1,458 @@
+//
+//  PGUpload.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+#include "Pictogram.h"
+
+enum {
+	JOB_Buffer = 0
+,	JOB_Texture
+};
+
+struct PGUploadJobPrivate {
+	int kind;
+	PGUploadPriority priority;
+	uint64_t order;				// Oldest first within a priority
+	PGUploadJob prev;			// Neighbours in the priority's list
+	PGUploadJob next;
+	PGUploadCompletion complete;
+	void *userData;
+
+	const GLubyte *data;
+	size_t size;
+	size_t sent;
+
+	// Buffers
+	GLenum target;
+	GLuint buffer;
+	GLintptr offset;
+
+	// Textures, sent a whole number of rows at a time
+	GLuint texture;
+	GLint level;
+	GLint x;
+	GLint y;
+	GLsizei width;
+	GLenum format;
+	GLenum type;
+	size_t rowBytes;
+};
+
+// Jobs of each priority, oldest first
+typedef struct
+{
+	PGUploadJob head;
+	PGUploadJob tail;
+}
+JobList;
+
+struct PGUploadQueuePrivate {
+	PGHandlePool jobs;
+	JobList lists[PGUP_Now + 1];
+	uint64_t nextOrder;
+	size_t budgetBytes;
+	uint64_t budgetMicroseconds;
+	PGUploadStats stats;
+};
+
+static size_t pixelBytes(GLenum format, GLenum type)
+{
+	switch (type)
+	{
+		case GL_UNSIGNED_SHORT_5_6_5:
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+			return 2;
+		case GL_UNSIGNED_BYTE:
+		case GL_FLOAT:
+			break;
+		default:
+			return 0;
+	}
+
+	size_t componentBytes = GL_FLOAT == type ? sizeof(GLfloat) : 1;
+	switch (format)
+	{
+		case GL_RGBA: return 4 * componentBytes;
+		case GL_RGB: return 3 * componentBytes;
+		case GL_LUMINANCE_ALPHA: return 2 * componentBytes;
+		case GL_LUMINANCE:
+		case GL_ALPHA: return componentBytes;
+	}
+	return 0;
+}
+
+static PGUploadPriority clampPriority(PGUploadPriority priority)
+{
+	if ((int)priority < PGUP_Low) return PGUP_Low;
+	if ((int)priority > PGUP_Now) return PGUP_Now;
+	return priority;
+}
+
+static struct PGUploadJobPrivate *jobAt(PGUploadQueue queue, PGUploadJob handle)
+{
+	return pgHandlePoolGet(queue->jobs, handle);
+}
+
+static void unlinkJob(PGUploadQueue queue, struct PGUploadJobPrivate *j)
+{
+	JobList *list = &queue->lists[j->priority];
+	if (PG_NULL_HANDLE != j->prev) jobAt(queue, j->prev)->next = j->next;
+	else list->head = j->next;
+	if (PG_NULL_HANDLE != j->next) jobAt(queue, j->next)->prev = j->prev;
+	else list->tail = j->prev;
+	j->prev = PG_NULL_HANDLE;
+	j->next = PG_NULL_HANDLE;
+}
+
+/**
+ * Puts the job in its priority's list by age. New jobs are the youngest,
+ * and bumped ones are usually too, so this rarely walks far.
+ */
+static void linkJob(PGUploadQueue queue, PGUploadJob handle, struct PGUploadJobPrivate *j)
+{
+	JobList *list = &queue->lists[j->priority];
+	PGUploadJob after = list->tail;
+	while (PG_NULL_HANDLE != after && jobAt(queue, after)->order > j->order) after = jobAt(queue, after)->prev;
+
+	j->prev = after;
+	if (PG_NULL_HANDLE != after)
+	{
+		struct PGUploadJobPrivate *a = jobAt(queue, after);
+		j->next = a->next;
+		a->next = handle;
+	}
+	else
+	{
+		j->next = list->head;
+		list->head = handle;
+	}
+	if (PG_NULL_HANDLE != j->next) jobAt(queue, j->next)->prev = handle;
+	else list->tail = handle;
+}
+
+static PGResult addJob(PGUploadQueue queue, PGUploadJob *job, const PGUploadOptions *options, struct PGUploadJobPrivate **item)
+{
+	PGUploadJob handle = pgHandlePoolAdd(queue->jobs, (void **)item);
+	if (PG_NULL_HANDLE == handle) return PGR_OutOfMemory;
+
+	struct PGUploadJobPrivate *j = *item;
+	j->priority = PGUP_Normal;
+	j->order = queue->nextOrder++;
+	if (NULL != options)
+	{
+		j->priority = options->priority;
+		j->complete = options->complete;
+		j->userData = options->userData;
+	}
+	j->priority = clampPriority(j->priority);
+	linkJob(queue, handle, j);
+	if (NULL != job) *job = handle;
+	return PGR_OK;
+}
+
+/**
+ * Removes the job before calling its completion, which may add or remove
+ * others.
+ */
+static void finishJob(PGUploadQueue queue, PGUploadJob handle, PGResult result)
+{
+	struct PGUploadJobPrivate *j = jobAt(queue, handle);
+	PGUploadCompletion complete = j->complete;
+	void *userData = j->userData;
+	unlinkJob(queue, j);
+	pgHandlePoolRemove(queue->jobs, handle);
+
+	if (PGR_OK == result) queue->stats.completed++;
+	if (NULL != complete) complete(handle, result, userData);
+}
+
+/**
+ * The oldest job of the highest priority, or PG_NULL_HANDLE if there are
+ * none.
+ */
+static PGUploadJob nextJob(PGUploadQueue queue)
+{
+	for (int p = PGUP_Now; p >= PGUP_Low; p--)
+	{
+		if (PG_NULL_HANDLE != queue->lists[p].head) return queue->lists[p].head;
+	}
+	return PG_NULL_HANDLE;
+}
+
+/**
+ * Sends up to `limit` bytes of the job and returns how many went. With
+ * `atLeastOneRow` a texture row is sent even if it is bigger than the
+ * limit.
+ */
+static size_t sendSlice(struct PGUploadJobPrivate *j, size_t limit, GLboolean atLeastOneRow)
+{
+	size_t bytes = j->size - j->sent;
+	if (bytes > limit) bytes = limit;
+
+	if (JOB_Buffer == j->kind)
+	{
+		if (0 == bytes) return 0;
+		glBindBuffer(j->target, j->buffer);
+		glBufferSubData(j->target, j->offset + (GLintptr)j->sent, (GLsizeiptr)bytes, j->data + j->sent);
+		glBindBuffer(j->target, 0);
+		pgStatsBufferUpload(bytes);
+	}
+	else
+	{
+		GLsizei rows = (GLsizei)(bytes / j->rowBytes);
+		if (0 == rows)
+		{
+			if (!atLeastOneRow) return 0;
+			rows = 1;
+		}
+		bytes = (size_t)rows * j->rowBytes;
+
+		GLint row = (GLint)(j->sent / j->rowBytes);
+		glBindTexture(GL_TEXTURE_2D, j->texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, j->level, j->x, j->y + row, j->width, rows, j->format, j->type, j->data + j->sent);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		pgStatsTextureUpload(bytes);
+	}
+	j->sent += bytes;
+	return bytes;
+}
+
+static void update(PGUploadQueue queue, GLboolean ignoreBudget)
+{
+	uint64_t start = pgStatsNowMicroseconds();
+	size_t bytesLeft = 0 != queue->budgetBytes ? queue->budgetBytes : SIZE_MAX;
+	GLboolean sentAny = GL_FALSE;
+	GLboolean starved = GL_FALSE;
+
+	PGUploadJob handle;
+	while (PG_NULL_HANDLE != (handle = nextJob(queue)))
+	{
+		struct PGUploadJobPrivate *j = jobAt(queue, handle);
+		if (j->sent < j->size)
+		{
+			GLboolean unlimited = ignoreBudget || PGUP_Now == j->priority || !sentAny;
+			if (!unlimited && (0 == bytesLeft || (0 != queue->budgetMicroseconds && pgStatsNowMicroseconds() - start >= queue->budgetMicroseconds)))
+			{
+				starved = GL_TRUE;
+				break;
+			}
+
+			size_t limit = unlimited || bytesLeft > PG_UPLOAD_SLICE_BYTES ? PG_UPLOAD_SLICE_BYTES : bytesLeft;
+			size_t bytes = sendSlice(j, limit, unlimited);
+			if (0 == bytes)
+			{
+				// The next row doesn't fit what is left
+				starved = GL_TRUE;
+				break;
+			}
+			sentAny = GL_TRUE;
+			bytesLeft = bytes < bytesLeft ? bytesLeft - bytes : 0;
+			queue->stats.calls++;
+			queue->stats.bytes += bytes;
+		}
+		if (j->sent == j->size) finishJob(queue, handle, PGR_OK);
+	}
+
+	if (starved) queue->stats.starvedFrames++;
+	queue->stats.microseconds += pgStatsNowMicroseconds() - start;
+}
+
+PGResult pgUploadQueueCreate(PGUploadQueue *queue)
+{
+	if (NULL == queue) return PGR_NullPointerBarf;
+	*queue = NULL;
+
+	PGUploadQueue q = pgMemAlloc(sizeof(struct PGUploadQueuePrivate), PGM_Renderer);
+	if (NULL == q) return PGR_OutOfMemory;
+	memset(q, 0, sizeof(struct PGUploadQueuePrivate));
+	*queue = q;
+
+	q->budgetBytes = PG_UPLOAD_DEFAULT_BYTES;
+	q->budgetMicroseconds = PG_UPLOAD_DEFAULT_MICROSECONDS;
+	PGResult result = pgHandlePoolCreate(&q->jobs, sizeof(struct PGUploadJobPrivate), PGM_Renderer);
+	if (PGR_OK != result)
+	{
+		pgUploadQueueDestroy(queue);
+		return result;
+	}
+	return PGR_OK;
+}
+
+void pgUploadQueueDestroy(PGUploadQueue *queue)
+{
+	if (NULL != queue && NULL != *queue)
+	{
+		PGUploadQueue q = *queue;
+
+		if (NULL != q->jobs)
+		{
+			while (pgHandlePoolCount(q->jobs) > 0)
+			{
+				finishJob(q, pgHandlePoolHandleAt(q->jobs, 0), PGR_Cancelled);
+			}
+			pgHandlePoolDestroy(&q->jobs);
+		}
+
+		memset(q, 0, sizeof(struct PGUploadQueuePrivate));
+		pgMemFree(q);
+
+		*queue = NULL;
+	}
+}
+
+void pgUploadQueueSetBudget(PGUploadQueue queue, size_t bytes, uint64_t microseconds)
+{
+	if (NULL == queue) return;
+
+	queue->budgetBytes = bytes;
+	queue->budgetMicroseconds = microseconds;
+}
+
+PGResult pgUploadQueueBuffer(PGUploadQueue queue, PGUploadJob *job, GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const GLvoid *data, const PGUploadOptions *options)
+{
+	if (NULL != job) *job = PG_NULL_HANDLE;
+	if (NULL == queue || (NULL == data && size > 0)) return PGR_NullPointerBarf;
+	if (0 == buffer || size < 0) return PGR_LazyGenericError;
+
+	struct PGUploadJobPrivate *j;
+	PGResult result = addJob(queue, job, options, &j);
+	if (PGR_OK != result) return result;
+
+	j->kind = JOB_Buffer;
+	j->data = data;
+	j->size = (size_t)size;
+	j->target = target;
+	j->buffer = buffer;
+	j->offset = offset;
+	return PGR_OK;
+}
+
+PGResult pgUploadQueueTexture(PGUploadQueue queue, PGUploadJob *job, GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels, const PGUploadOptions *options)
+{
+	if (NULL != job) *job = PG_NULL_HANDLE;
+	if (NULL == queue || NULL == pixels) return PGR_NullPointerBarf;
+	if (0 == texture || width <= 0 || height <= 0) return PGR_LazyGenericError;
+
+	size_t bytes = pixelBytes(format, type);
+	if (0 == bytes)
+	{
+		pgLog(PGL_Error, "Can't queue uploads of texture format 0x%04x, type 0x%04x.", format, type);
+		return PGR_Unsupported;
+	}
+
+	struct PGUploadJobPrivate *j;
+	PGResult result = addJob(queue, job, options, &j);
+	if (PGR_OK != result) return result;
+
+	j->kind = JOB_Texture;
+	j->data = pixels;
+	j->rowBytes = (size_t)width * bytes;
+	j->size = j->rowBytes * (size_t)height;
+	j->texture = texture;
+	j->level = level;
+	j->x = x;
+	j->y = y;
+	j->width = width;
+	j->format = format;
+	j->type = type;
+	return PGR_OK;
+}
+
+PGResult pgUploadQueueBump(PGUploadQueue queue, PGUploadJob job, PGUploadPriority priority)
+{
+	if (NULL == queue) return PGR_NullPointerBarf;
+
+	struct PGUploadJobPrivate *j = jobAt(queue, job);
+	if (NULL == j) return PGR_StaleHandle;
+
+	priority = clampPriority(priority);
+	if (priority > j->priority)
+	{
+		unlinkJob(queue, j);
+		j->priority = priority;
+		linkJob(queue, job, j);
+	}
+
+	// The resource is about to be drawn, so it can't wait for the next update
+	if (PGUP_Now == priority)
+	{
+		pgProfileZone("pgUploadQueueBump");
+		while (j->sent < j->size)
+		{
+			size_t bytes = sendSlice(j, PG_UPLOAD_SLICE_BYTES, GL_TRUE);
+			queue->stats.calls++;
+			queue->stats.bytes += bytes;
+		}
+		finishJob(queue, job, PGR_OK);
+	}
+	return PGR_OK;
+}
+
+PGResult pgUploadQueueCancel(PGUploadQueue queue, PGUploadJob job)
+{
+	if (NULL == queue) return PGR_NullPointerBarf;
+	if (!pgHandlePoolIsValid(queue->jobs, job)) return PGR_StaleHandle;
+
+	finishJob(queue, job, PGR_Cancelled);
+	return PGR_OK;
+}
+
+GLboolean pgUploadQueueIsPending(PGUploadQueue queue, PGUploadJob job)
+{
+	if (NULL == queue) return GL_FALSE;
+
+	return pgHandlePoolIsValid(queue->jobs, job) ? GL_TRUE : GL_FALSE;
+}
+
+unsigned long pgUploadQueuePending(PGUploadQueue queue)
+{
+	if (NULL == queue) return 0;
+
+	return pgHandlePoolCount(queue->jobs);
+}
+
+void pgUploadQueueUpdate(PGUploadQueue queue)
+{
+	if (NULL == queue) return;
+
+	queue->stats.completed = 0;
+	queue->stats.calls = 0;
+	queue->stats.bytes = 0;
+	queue->stats.microseconds = 0;
+	if (0 == pgHandlePoolCount(queue->jobs)) return;
+
+	pgProfileZone("pgUploadQueueUpdate");
+	update(queue, GL_FALSE);
+}
+
+void pgUploadQueueFlush(PGUploadQueue queue)
+{
+	if (NULL == queue || 0 == pgHandlePoolCount(queue->jobs)) return;
+
+	pgProfileZone("pgUploadQueueFlush");
+	update(queue, GL_TRUE);
+}
+
+void pgUploadQueueStats(PGUploadQueue queue, PGUploadStats *stats)
+{
+	if (NULL == stats) return;
+	memset(stats, 0, sizeof(PGUploadStats));
+	if (NULL == queue) return;
+
+	*stats = queue->stats;
+	uint32_t count = pgHandlePoolCount(queue->jobs);
+	stats->pending = count;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const struct PGUploadJobPrivate *j = pgHandlePoolItemAt(queue->jobs, i);
+		stats->pendingBytes += j->size - j->sent;
+	}
+}
@@ -0,0 +1,129 @@
+//
+//  PGUpload.h
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGUpload_h
+#define PGUpload_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	// Default per frame budget, whichever runs out first
+	#define PG_UPLOAD_DEFAULT_BYTES (1024 * 1024)
+	#define PG_UPLOAD_DEFAULT_MICROSECONDS 2000
+
+	// Most bytes sent to GL in one call, so the time budget is checked often
+	#define PG_UPLOAD_SLICE_BYTES (64 * 1024)
+
+	typedef enum
+	{
+		PGUP_Low = 0	// Streaming ahead of need
+	,	PGUP_Normal
+	,	PGUP_High
+	,	PGUP_Now		// Needed this frame, so finished on the next update whatever the budget
+	}
+	PGUploadPriority;
+
+	typedef void (*PGUploadCompletion)(PGUploadJob job, PGResult result, void *userData);
+
+	typedef struct
+	{
+		PGUploadPriority priority;
+		PGUploadCompletion complete;	// May be NULL
+		void *userData;
+	}
+	PGUploadOptions;
+
+	typedef struct
+	{
+		unsigned long pending;
+		unsigned long pendingBytes;
+		unsigned long completed;		// This frame
+		unsigned long calls;			// glBufferSubData and glTexSubImage2D calls this frame
+		unsigned long bytes;			// This frame
+		uint64_t microseconds;			// Spent uploading this frame
+		unsigned long starvedFrames;	// Frames which ran out of budget with work left, over the lifetime of the queue
+	}
+	PGUploadStats;
+
+	/**
+	 * Buffer and texture updates spread over frames, so streaming a level
+	 * in doesn't land all of its uploads on one frame.
+	 *
+	 * Jobs go out highest priority first, oldest first within a priority,
+	 * and are cut into slices of at most PG_UPLOAD_SLICE_BYTES (whole rows
+	 * for textures). Each update sends slices until the frame's byte or
+	 * time budget is spent, always sending at least one so every job
+	 * finishes eventually. PGUP_Now jobs ignore the budget, though what
+	 * they send still counts against it.
+	 *
+	 * The queue doesn't copy: the data must stay as it is until the job's
+	 * completion is called, which is also where to free it. Completions
+	 * are called from pgUploadQueueUpdate and pgUploadQueueBump, or from
+	 * pgUploadQueueCancel with PGR_Cancelled, and may queue more jobs.
+	 * Cancel jobs whose buffer or texture is deleted before they finish.
+	 *
+	 * The renderer owns one and updates it in pgRendererBeginFrame.
+	 * Belongs to the GL thread.
+	 */
+	PGResult pgUploadQueueCreate(PGUploadQueue *queue);
+
+	/**
+	 * Cancels every job still queued.
+	 */
+	void pgUploadQueueDestroy(PGUploadQueue *queue);
+
+	/**
+	 * Zero for either means no limit of that kind.
+	 */
+	void pgUploadQueueSetBudget(PGUploadQueue queue, size_t bytes, uint64_t microseconds);
+
+	/**
+	 * Queues glBufferSubData of `size` bytes at `offset` into `buffer`,
+	 * bound to `target`. `job` and `options` may be NULL.
+	 */
+	PGResult pgUploadQueueBuffer(PGUploadQueue queue, PGUploadJob *job, GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const GLvoid *data, const PGUploadOptions *options);
+
+	/**
+	 * Queues glTexSubImage2D of a region of a 2D texture level, with rows
+	 * tightly packed. Uncompressed formats only.
+	 */
+	PGResult pgUploadQueueTexture(PGUploadQueue queue, PGUploadJob *job, GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels, const PGUploadOptions *options);
+
+	/**
+	 * Raises a job's priority, for a resource about to be drawn. Lower
+	 * priorities are ignored. Bumping to PGUP_Now sends the rest of the job
+	 * and completes it before returning. PGR_StaleHandle once the job is
+	 * finished.
+	 */
+	PGResult pgUploadQueueBump(PGUploadQueue queue, PGUploadJob job, PGUploadPriority priority);
+
+	PGResult pgUploadQueueCancel(PGUploadQueue queue, PGUploadJob job);
+	GLboolean pgUploadQueueIsPending(PGUploadQueue queue, PGUploadJob job);
+
+	/**
+	 * Jobs not yet finished.
+	 */
+	unsigned long pgUploadQueuePending(PGUploadQueue queue);
+
+	/**
+	 * Sends the frame's share of the queue. pgRendererBeginFrame calls this.
+	 */
+	void pgUploadQueueUpdate(PGUploadQueue queue);
+
+	/**
+	 * Sends everything queued, ignoring the budget, as for a loading screen.
+	 */
+	void pgUploadQueueFlush(PGUploadQueue queue);
+
+	void pgUploadQueueStats(PGUploadQueue queue, PGUploadStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,16 +8,42 @@
 #ifndef Pictogram_h
 #define Pictogram_h
 
-#include <OpenGLES/ES2/gl.h>
-#include <OpenGLES/ES2/glext.h>
+#include "PGGL.h"
 
+#include "PGAllocator.h"
 #include "../../external/uthash/uthash-1.9.6/src/uthash.h"
 #include "PGLog.h"
 
 #include "PGDataTypes.h"
+#include "PGHandle.h"
+#include "PGDeleteQueue.h"
+#include "PGGpuMemory.h"
+#include "PGTrace.h"
+#include "PGStats.h"
+#include "PGProfiler.h"
 
 #include "PGProgram.h"
+#include "PGMesh.h"
+#include "PGPipeline.h"
+#include "PGInflate.h"
+#include "PGImage.h"
+#include "PGEtc.h"
+#include "PGKtx.h"
+#include "PGTexture.h"
+#include "PGAtlas.h"
+#include "PGRenderTarget.h"
+#include "PGUniformBuffer.h"
+#include "PGUpload.h"
+#include "PGDamage.h"
+#include "PGFrameScheduler.h"
 #include "PGRenderer.h"
+#include "PGFrameGraph.h"
+#include "PGSoftRaster.h"
+#include "PGReadback.h"
+#include "PGJobs.h"
+#include "PGRenderLoop.h"
+#include "PGArena.h"
+#include "PGMetrics.h"
 
 #include "PGContext.h"
 
@@ -20,8 +20,25 @@
 @interface PGView : UIView
 
 @property (unsafe_unretained, nonatomic, readonly)PGRenderer renderer;
+
+/**
+ * Decides which display link ticks draw. On demand by default, so the
+ * view draws only once invalidated, for which damageRect: and damageAll
+ * do, and the display link is paused while nothing is waiting. Set it
+ * to PGFS_Continuous to draw every tick.
+ */
+@property (unsafe_unretained, nonatomic, readonly)PGFrameScheduler scheduler;
 @property (unsafe_unretained, nonatomic)id<PGViewDelegate> delegate;
 
 - (BOOL)makeContextCurrent;
 
+/**
+ * Marks part of the view, in points, to be drawn again on the next frame.
+ * Only damaged parts are redrawn, and both invalidate the scheduler.
+ * Frames the scheduler asks for with nothing damaged, as for animations,
+ * redraw the whole view.
+ */
+- (void)damageRect:(CGRect)rect;
+- (void)damageAll;
+
 @end
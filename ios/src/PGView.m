@@ -63,6 +63,7 @@ static void ApplyRotation(LGPrg * prg, float degrees)
 @property (strong, nonatomic) CADisplayLink *displayLink;
 
 @property (unsafe_unretained, nonatomic) PGRenderer renderer;
+@property (unsafe_unretained, nonatomic) PGFrameScheduler scheduler;
 
 @end
 
@@ -72,14 +73,38 @@ static void ApplyRotation(LGPrg * prg, float degrees)
 @synthesize delegate = _delegate;
 @synthesize eaglContext = _eaglContext;
 @synthesize renderer = _renderer;
+@synthesize scheduler = _scheduler;
 
 + (Class) layerClass
 {
     return [CAEAGLLayer class];
 }
 
+static GLboolean RendererHasPendingWork(void *userData)
+{
+	PGView *view = (__bridge PGView *)userData;
+	return pgRendererHasPendingWork(view.renderer);
+}
+
+static void WakeDisplayLink(void *userData)
+{
+	PGView *view = (__bridge PGView *)userData;
+	if ([NSThread isMainThread])
+	{
+		view.displayLink.paused = NO;
+	}
+	else
+	{
+		dispatch_async(dispatch_get_main_queue(), ^{
+			view.displayLink.paused = NO;
+		});
+	}
+}
+
 - (void)dealloc
 {
+	[_displayLink invalidate];
+	pgFrameSchedulerDestroy(&_scheduler);
     pgRendererDestroy(&_renderer);
 }
 
@@ -121,6 +146,11 @@ static void ApplyRotation(LGPrg * prg, float degrees)
 {
 	CAEAGLLayer* eaglLayer = (CAEAGLLayer*) super.layer;
 	eaglLayer.opaque = YES;
+	// Keeping the last frame lets drawView: repaint only what was damaged
+	eaglLayer.drawableProperties = [NSDictionary dictionaryWithObjectsAndKeys:
+									[NSNumber numberWithBool:YES], kEAGLDrawablePropertyRetainedBacking,
+									kEAGLColorFormatRGBA8, kEAGLDrawablePropertyColorFormat,
+									nil];
 	
 	self.eaglContext = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
 	if (!_eaglContext || ![self makeContextCurrent])
@@ -137,7 +167,16 @@ static void ApplyRotation(LGPrg * prg, float degrees)
 	
 	pgLogAnyGlErrors("About to setup PGRenderer");
 	pgRendererSetup(_renderer, CGRectGetWidth(self.bounds), CGRectGetHeight(self.bounds));
+	pgRendererSetBufferAge(_renderer, 1);
 	pgLogAnyGlErrors("Setup PGRenderer");
+	
+	PGFrameSchedulerCallbacks callbacks = {
+		NULL,
+		RendererHasPendingWork,
+		WakeDisplayLink,
+		(__bridge void *)self
+	};
+	pgFrameSchedulerCreate(&_scheduler, &callbacks);
 
 	self.displayLink = [CADisplayLink displayLinkWithTarget:self
 												   selector:@selector(drawView:)];
@@ -159,14 +198,68 @@ static void ApplyRotation(LGPrg * prg, float degrees)
 - (void) drawView:(CADisplayLink*) displayLink
 {
 	// TODO: I wonder if I should call [self makeContextCurrent];
-	if (nil != _delegate)
+	if (!pgFrameSchedulerShouldRender(_scheduler))
+	{
+		// Sleep until something invalidates the view
+		if (PG_FRAME_SCHEDULER_IDLE == pgFrameSchedulerNextFrameTime(_scheduler))
+		{
+			_displayLink.paused = YES;
+		}
+		return;
+	}
+	
+	// Frames asked for without damage, by animations, deadlines or bare
+	// invalidations, may have changed anything
+	PGDamage damage = pgRendererDamage(_renderer);
+	if (!pgDamageHasPending(damage))
+	{
+		pgDamageAddAll(damage);
+	}
+	
+	pgRendererBeginFrame(_renderer);
+	pgProfileZone(__func__);
+	
+	// The delegate draws once, scissored around everything which changed
+	PGDamageRect bounds;
+	GLboolean repaint = pgDamageRepaintBounds(damage, &bounds);
+	if (repaint)
 	{
-		[_delegate renderPGView:self];
+		pgProfileGpuZone("PGView render");
+		pgRendererScissorRepaint(_renderer, &bounds);
+		if (nil != _delegate)
+		{
+			[_delegate renderPGView:self];
+		}
+		
+		[self renderPGView:self];
+		pgRendererScissorRepaint(_renderer, NULL);
 	}
 	
-	[self renderPGView:self];
+	pgRendererEndFrame(_renderer);
 	
-    [_eaglContext presentRenderbuffer:GL_RENDERBUFFER];
+	// The layer keeps showing the last frame when nothing changed
+	if (repaint)
+	{
+		[_eaglContext presentRenderbuffer:GL_RENDERBUFFER];
+	}
+}
+
+- (void)damageRect:(CGRect)rect
+{
+	// UIKit's origin is the top left, GL's the bottom left
+	CGFloat height = CGRectGetHeight(self.bounds);
+	GLint left = (GLint)floor(CGRectGetMinX(rect));
+	GLint right = (GLint)ceil(CGRectGetMaxX(rect));
+	GLint bottom = (GLint)floor(height - CGRectGetMaxY(rect));
+	GLint top = (GLint)ceil(height - CGRectGetMinY(rect));
+	pgDamageAdd(pgRendererDamage(_renderer), left, bottom, right - left, top - bottom);
+	pgFrameSchedulerInvalidate(_scheduler);
+}
+
+- (void)damageAll
+{
+	pgDamageAddAll(pgRendererDamage(_renderer));
+	pgFrameSchedulerInvalidate(_scheduler);
 }
 
 - (void)hacky
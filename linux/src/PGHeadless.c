@@ -0,0 +1,272 @@
+//
+//  PGHeadless.c
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "PGHeadless.h"
+
+#ifndef EGL_OPENGL_ES3_BIT
+#	define EGL_OPENGL_ES3_BIT 0x00000040
+#endif
+
+struct PGHeadlessPrivate {
+	EGLDisplay display;
+	EGLConfig config;
+	EGLContext context;
+	EGLSurface surface;
+	int glVersion;
+
+	// Second context in the same share group, for a loader thread
+	EGLContext sharedContext;
+	EGLSurface sharedSurface;
+
+	PGRenderer renderer;
+};
+
+static GLboolean hasEGLExtension(EGLDisplay display, const char *extension)
+{
+	const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (NULL == extensions) return GL_FALSE;
+
+	size_t length = strlen(extension);
+	for (const char *found = strstr(extensions, extension); NULL != found; found = strstr(found + length, extension))
+	{
+		if ((found == extensions || ' ' == found[-1]) && (' ' == found[length] || '\0' == found[length]))
+		{
+			return GL_TRUE;
+		}
+	}
+	return GL_FALSE;
+}
+
+static EGLDisplay openDisplay(void)
+{
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+	// Client extensions are queried without a display
+	if (hasEGLExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (NULL != getPlatformDisplay)
+		{
+			EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+			if (EGL_NO_DISPLAY != display && eglInitialize(display, NULL, NULL)) return display;
+		}
+	}
+#endif
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (EGL_NO_DISPLAY != display && eglInitialize(display, NULL, NULL)) return display;
+
+	return EGL_NO_DISPLAY;
+}
+
+static PGResult createContext(PGHeadless h)
+{
+	// Rendering goes to the renderer's framebuffer, so a surface is only
+	// needed where contexts can't be current without one
+	GLboolean surfaceless = hasEGLExtension(h->display, "EGL_KHR_surfaceless_context");
+
+	const int versions[] = { 3, 2 };
+	for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++)
+	{
+		EGLint configAttribs[] = {
+			EGL_RENDERABLE_TYPE, 3 == versions[i] ? EGL_OPENGL_ES3_BIT : EGL_OPENGL_ES2_BIT,
+			EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(h->display, configAttribs, &config, 1, &configCount) || 0 == configCount) continue;
+
+		EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, versions[i], EGL_NONE };
+		h->context = eglCreateContext(h->display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (EGL_NO_CONTEXT == h->context) continue;
+
+		if (!surfaceless)
+		{
+			EGLint surfaceAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			h->surface = eglCreatePbufferSurface(h->display, config, surfaceAttribs);
+			if (EGL_NO_SURFACE == h->surface)
+			{
+				eglDestroyContext(h->display, h->context);
+				h->context = EGL_NO_CONTEXT;
+				continue;
+			}
+		}
+
+		h->config = config;
+		h->glVersion = versions[i];
+		return PGR_OK;
+	}
+
+	pgLog(PGL_Error, "Could not create an OpenGL ES context, EGL error 0x%04x.", eglGetError());
+	return PGR_Unsupported;
+}
+
+PGResult pgHeadlessCreate(PGHeadless *headless, int width, int height)
+{
+	if (NULL == headless) return PGR_NullPointerBarf;
+	*headless = NULL;
+
+	PGHeadless h = pgMemAlloc(sizeof(struct PGHeadlessPrivate), PGM_Renderer);
+	if (NULL == h) return PGR_OutOfMemory;
+	memset(h, 0, sizeof(struct PGHeadlessPrivate));
+	h->display = EGL_NO_DISPLAY;
+	h->context = EGL_NO_CONTEXT;
+	h->surface = EGL_NO_SURFACE;
+	h->sharedContext = EGL_NO_CONTEXT;
+	h->sharedSurface = EGL_NO_SURFACE;
+	*headless = h;
+
+	h->display = openDisplay();
+	if (EGL_NO_DISPLAY == h->display)
+	{
+		pgLog(PGL_Error, "Could not open an EGL display, EGL error 0x%04x.", eglGetError());
+		pgHeadlessDestroy(headless);
+		return PGR_Unsupported;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_ES_API))
+	{
+		pgLog(PGL_Error, "EGL display has no OpenGL ES support.");
+		pgHeadlessDestroy(headless);
+		return PGR_Unsupported;
+	}
+
+	PGResult result = createContext(h);
+	if (PGR_OK == result) result = pgHeadlessMakeCurrent(h);
+	if (PGR_OK != result)
+	{
+		pgHeadlessDestroy(headless);
+		return result;
+	}
+
+	pgGLLoadExtensions((PGGLProcLoader)eglGetProcAddress);
+
+	result = pgRendererCreate(&h->renderer);
+	if (PGR_OK == result) result = pgRendererSetupOffscreen(h->renderer, width, height);
+	if (PGR_OK != result)
+	{
+		pgHeadlessDestroy(headless);
+		return result;
+	}
+
+	return PGR_OK;
+}
+
+void pgHeadlessDestroy(PGHeadless *headless)
+{
+	if (NULL != headless && NULL != *headless)
+	{
+		PGHeadless h = *headless;
+
+		if (EGL_NO_CONTEXT != h->context)
+		{
+			// The renderer's GL objects need the context
+			pgHeadlessMakeCurrent(h);
+			pgRendererDestroy(&h->renderer);
+			eglMakeCurrent(h->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(h->display, h->context);
+		}
+		if (EGL_NO_CONTEXT != h->sharedContext) eglDestroyContext(h->display, h->sharedContext);
+		if (EGL_NO_SURFACE != h->sharedSurface) eglDestroySurface(h->display, h->sharedSurface);
+		if (EGL_NO_SURFACE != h->surface) eglDestroySurface(h->display, h->surface);
+		if (EGL_NO_DISPLAY != h->display) eglTerminate(h->display);
+
+		memset(h, 0, sizeof(struct PGHeadlessPrivate));
+		pgMemFree(h);
+
+		*headless = NULL;
+	}
+}
+
+PGRenderer pgHeadlessRenderer(PGHeadless headless)
+{
+	if (NULL == headless) return NULL;
+
+	return headless->renderer;
+}
+
+PGResult pgHeadlessMakeCurrent(PGHeadless headless)
+{
+	if (NULL == headless) return PGR_NullPointerBarf;
+
+	if (!eglMakeCurrent(headless->display, headless->surface, headless->surface, headless->context))
+	{
+		pgLog(PGL_Error, "Could not make the headless context current, EGL error 0x%04x.", eglGetError());
+		return PGR_LazyGenericError;
+	}
+	return PGR_OK;
+}
+
+void pgHeadlessReleaseCurrent(PGHeadless headless)
+{
+	if (NULL == headless) return;
+
+	eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+int pgHeadlessGLVersion(PGHeadless headless)
+{
+	if (NULL == headless) return 0;
+
+	return headless->glVersion;
+}
+
+static PGResult makeSharedCurrent(void *userData)
+{
+	PGHeadless h = userData;
+	if (!eglBindAPI(EGL_OPENGL_ES_API) || !eglMakeCurrent(h->display, h->sharedSurface, h->sharedSurface, h->sharedContext))
+	{
+		pgLog(PGL_Error, "Could not make the shared context current, EGL error 0x%04x.", eglGetError());
+		return PGR_LazyGenericError;
+	}
+	return PGR_OK;
+}
+
+static void releaseSharedCurrent(void *userData)
+{
+	PGHeadless h = userData;
+	eglMakeCurrent(h->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+PGResult pgHeadlessSharedContext(PGHeadless headless, PGSharedContext *shared)
+{
+	if (NULL == headless || NULL == shared) return PGR_NullPointerBarf;
+
+	if (EGL_NO_CONTEXT == headless->sharedContext)
+	{
+		EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, headless->glVersion, EGL_NONE };
+		headless->sharedContext = eglCreateContext(headless->display, headless->config, headless->context, contextAttribs);
+		if (EGL_NO_CONTEXT == headless->sharedContext)
+		{
+			pgLog(PGL_Error, "Could not create a shared context, EGL error 0x%04x.", eglGetError());
+			return PGR_Unsupported;
+		}
+
+		// A surface can only be current on one thread, so the loader needs
+		// its own where the render context has one
+		if (EGL_NO_SURFACE != headless->surface)
+		{
+			EGLint surfaceAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			headless->sharedSurface = eglCreatePbufferSurface(headless->display, headless->config, surfaceAttribs);
+			if (EGL_NO_SURFACE == headless->sharedSurface)
+			{
+				pgLog(PGL_Error, "Could not create a surface for the shared context, EGL error 0x%04x.", eglGetError());
+				eglDestroyContext(headless->display, headless->sharedContext);
+				headless->sharedContext = EGL_NO_CONTEXT;
+				return PGR_Unsupported;
+			}
+		}
+	}
+
+	shared->makeCurrent = makeSharedCurrent;
+	shared->releaseCurrent = releaseSharedCurrent;
+	shared->userData = headless;
+	return PGR_OK;
+}
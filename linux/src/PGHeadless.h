@@ -0,0 +1,58 @@
+//
+//  PGHeadless.h
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+
+#ifndef PGHeadless_h
+#define PGHeadless_h
+
+#include "Pictogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	typedef struct PGHeadlessPrivate* PGHeadless;
+
+	/**
+	 * Creates an EGL context with no window and a GL renderer drawing into
+	 * an offscreen RGBA8 framebuffer of the given size. Mesa's surfaceless
+	 * platform is used when available, so no X or Wayland server is needed,
+	 * and falls back to a pbuffer on the default display. ES 3 is preferred
+	 * so that pgReadback can read asynchronously.
+	 *
+	 * The context is left current on the calling thread.
+	 */
+	PGResult pgHeadlessCreate(PGHeadless *headless, int width, int height);
+	void pgHeadlessDestroy(PGHeadless *headless);
+
+	PGRenderer pgHeadlessRenderer(PGHeadless headless);
+
+	/**
+	 * Makes the context current on the calling thread, for instance in a
+	 * PGRenderLoop's threadStart. Release it first from the thread which
+	 * currently has it.
+	 */
+	PGResult pgHeadlessMakeCurrent(PGHeadless headless);
+	void pgHeadlessReleaseCurrent(PGHeadless headless);
+
+	/**
+	 * The client version of the context, 2 or 3.
+	 */
+	int pgHeadlessGLVersion(PGHeadless headless);
+
+	/**
+	 * A second context sharing objects with the headless one, for
+	 * pgContextStartLoader. It is made the first time this is called and
+	 * lives as long as the headless context. Stop the loader before
+	 * destroying the headless context.
+	 */
+	PGResult pgHeadlessSharedContext(PGHeadless headless, PGSharedContext *shared);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
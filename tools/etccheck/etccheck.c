@@ -0,0 +1,427 @@
+//
+//  etccheck.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Checks pgEtcDecode against reference decodes. Golden blocks cover each
+//  ETC1, ETC2 and EAC mode with their expected pixels, and a sweep of
+//  random blocks per format is checked against a hash of its expected
+//  pixels. The references came from Mesa. On its own:
+//
+//      cc -std=gnu99 -O2 -Icore/src -o etccheck tools/etccheck/etccheck.c
+//          core/src/*.c tools/nullgl/PGNullGL.c -lm -lpthread
+//
+//  Against the GL driver as well, in a headless context. --generate
+//  prints the driver's decodes as a new etcgolden.h:
+//
+//      cc -std=gnu99 -O2 -DPG_ETC_CHECK_GL -Icore/src -Ilinux/src -o etccheck
+//          tools/etccheck/etccheck.c core/src/*.c linux/src/*.c
+//          -lEGL -lGLESv2 -lm -lpthread
+//
+//  Usage: etccheck [--generate]
+//
+//  Exits with 1 if any decode differs.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Pictogram.h"
+#ifdef PG_ETC_CHECK_GL
+#	include "PGHeadless.h"
+#endif
+
+// Random blocks per format in the sweep, decoded as a SWEEP_BLOCKS_WIDE
+// by SWEEP_BLOCKS_WIDE image
+#define SWEEP_BLOCKS_WIDE 16
+#define SWEEP_SIZE (SWEEP_BLOCKS_WIDE * 4)
+
+typedef struct
+{
+	const char *name;
+	GLenum format;
+	GLubyte block[16];		// The first 8 bytes but for RGBA8, whose alpha comes first
+	GLubyte pixels[64];		// RGBA8, bottom row first
+}
+GoldenBlock;
+
+typedef struct
+{
+	GLenum format;
+	uint32_t seed;
+	uint64_t hash;			// FNV-1a of the sweep's RGBA8 pixels
+}
+GoldenSweep;
+
+// Golden data /////////////////////////////////////////////////////////////
+
+#include "etcgolden.h"
+
+#define GOLDEN_BLOCK_COUNT (sizeof(GoldenBlocks) / sizeof(GoldenBlocks[0]))
+#define GOLDEN_SWEEP_COUNT (sizeof(GoldenSweeps) / sizeof(GoldenSweeps[0]))
+
+// Blocks //////////////////////////////////////////////////////////////////
+
+static uint32_t nextRandom(uint32_t *state)
+{
+	// xorshift32, the same everywhere
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static size_t blockBytes(GLenum format)
+{
+	return GL_COMPRESSED_RGBA8_ETC2_EAC == format ? 16 : 8;
+}
+
+static const char *formatName(GLenum format)
+{
+	switch (format)
+	{
+		case GL_ETC1_RGB8_OES: return "GL_ETC1_RGB8_OES";
+		case GL_COMPRESSED_RGB8_ETC2: return "GL_COMPRESSED_RGB8_ETC2";
+		case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2: return "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2";
+		case GL_COMPRESSED_RGBA8_ETC2_EAC: return "GL_COMPRESSED_RGBA8_ETC2_EAC";
+	}
+	return "unknown";
+}
+
+static void randomBlocks(GLenum format, uint32_t seed, GLubyte *blocks, size_t count)
+{
+	uint32_t state = seed;
+	size_t bytes = blockBytes(format) * count;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		blocks[i] = (GLubyte)(nextRandom(&state) >> 24);
+	}
+}
+
+static uint64_t hashPixels(const GLubyte *pixels, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pixels[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static void printPixelDifferences(const GLubyte *expected, const GLubyte *actual, GLsizei width, GLsizei height)
+{
+	int shown = 0;
+	for (GLsizei y = 0; y < height && shown < 4; y++)
+	{
+		for (GLsizei x = 0; x < width && shown < 4; x++)
+		{
+			const GLubyte *e = expected + (y * width + x) * 4;
+			const GLubyte *a = actual + (y * width + x) * 4;
+			if (0 != memcmp(e, a, 4))
+			{
+				printf("    (%d, %d) expected %3d %3d %3d %3d, decoded %3d %3d %3d %3d\n", x, y, e[0], e[1], e[2], e[3], a[0], a[1], a[2], a[3]);
+				shown++;
+			}
+		}
+	}
+}
+
+// Driver decodes //////////////////////////////////////////////////////////
+
+#ifdef PG_ETC_CHECK_GL
+
+static const GLenum Formats[] = {
+	GL_ETC1_RGB8_OES,
+	GL_COMPRESSED_RGB8_ETC2,
+	GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+	GL_COMPRESSED_RGBA8_ETC2_EAC,
+};
+#define FORMAT_COUNT (sizeof(Formats) / sizeof(Formats[0]))
+
+static const char *VertexSource =
+	"attribute vec2 position;\n"
+	"varying vec2 uv;\n"
+	"void main() { uv = position * 0.5 + 0.5; gl_Position = vec4(position, 0.0, 1.0); }\n";
+
+static const char *FragmentSource =
+	"precision mediump float;\n"
+	"uniform sampler2D blocks;\n"
+	"varying vec2 uv;\n"
+	"void main() { gl_FragColor = texture2D(blocks, uv); }\n";
+
+static GLuint compile(GLenum type, const char *source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	return shader;
+}
+
+/**
+ * Draws the blocks as a texture into an RGBA8 framebuffer of the same
+ * size, one texel a pixel, and reads it back.
+ */
+static GLboolean driverDecode(GLenum format, const GLubyte *blocks, size_t size, GLsizei width, GLsizei height, GLubyte *pixels)
+{
+	static GLuint program;
+	if (0 == program)
+	{
+		program = glCreateProgram();
+		glAttachShader(program, compile(GL_VERTEX_SHADER, VertexSource));
+		glAttachShader(program, compile(GL_FRAGMENT_SHADER, FragmentSource));
+		glBindAttribLocation(program, 0, "position");
+		glLinkProgram(program);
+	}
+
+	GLuint texture, colour, framebuffer;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	while (GL_NO_ERROR != glGetError()) {}
+	glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, (GLsizei)size, blocks);
+	GLboolean supported = GL_NO_ERROR == glGetError();
+
+	glGenRenderbuffers(1, &colour);
+	glBindRenderbuffer(GL_RENDERBUFFER, colour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8_OES, width, height);
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+
+	if (supported)
+	{
+		static const GLfloat quad[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+		glViewport(0, 0, width, height);
+		glDisable(GL_BLEND);
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "blocks"), 0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, quad);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glDisableVertexAttribArray(0);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colour);
+	glDeleteTextures(1, &texture);
+	return supported;
+}
+
+/**
+ * Builds a block in a chosen mode, with random pixel indices. The colour
+ * block's first four bytes pick the mode: bit 1 of the fourth is the
+ * differential bit (opaque for punchthrough), and in differential mode a
+ * base plus delta outside 0 to 31 selects T (red), H (green) or planar
+ * (blue) in ETC2. ETC1 wraps the sum instead.
+ */
+static void buildBlock(GLubyte *block, GLenum format, const char *mode, uint32_t *state)
+{
+	GLubyte *colour = block;
+	if (GL_COMPRESSED_RGBA8_ETC2_EAC == format)
+	{
+		// EAC alpha: base, multiplier and table, then 48 bits of indices
+		for (int i = 0; i < 8; i++) block[i] = (GLubyte)(nextRandom(state) >> 24);
+		block[1] = (GLubyte)(((nextRandom(state) >> 28) | 1) << 4 | (block[1] & 0x0f));
+		colour = block + 8;
+	}
+	for (int i = 0; i < 8; i++) colour[i] = (GLubyte)(nextRandom(state) >> 24);
+
+	GLboolean transparent = NULL != strstr(mode, "transparent");
+	GLubyte differential = transparent ? 0 : 2;
+	if (0 == strncmp(mode, "individual", 10))
+	{
+		colour[3] &= ~2;
+		return;
+	}
+
+	// Base colours of 10 with no delta stay in range
+	colour[0] = 10 << 3;
+	colour[1] = 10 << 3;
+	colour[2] = 10 << 3;
+	if (0 == strncmp(mode, "T", 1) || 0 == strncmp(mode, "wrapped", 7)) colour[0] = 31 << 3 | 3;
+	else if (0 == strncmp(mode, "H", 1)) colour[1] = 31 << 3 | 3;
+	else if (0 == strncmp(mode, "planar", 6)) colour[2] = 31 << 3 | 3;
+	else if (0 == strncmp(mode, "differential", 12))
+	{
+		colour[0] = (GLubyte)((nextRandom(state) >> 27) & 0x0f) << 3 | 1;
+		colour[1] = (GLubyte)((nextRandom(state) >> 27) & 0x0f) << 3 | 2;
+		colour[2] = (GLubyte)((nextRandom(state) >> 27) & 0x0f) << 3 | 7;
+	}
+	colour[3] = (colour[3] & ~2) | differential;
+	if (NULL != strstr(mode, "flipped")) colour[3] |= 1;
+}
+
+static const struct { GLenum format; const char *mode; } GeneratedBlocks[] = {
+	{ GL_ETC1_RGB8_OES, "individual" },
+	{ GL_ETC1_RGB8_OES, "individual flipped" },
+	{ GL_ETC1_RGB8_OES, "differential" },
+	{ GL_ETC1_RGB8_OES, "differential flipped" },
+	{ GL_ETC1_RGB8_OES, "wrapped" },
+	{ GL_COMPRESSED_RGB8_ETC2, "individual" },
+	{ GL_COMPRESSED_RGB8_ETC2, "differential" },
+	{ GL_COMPRESSED_RGB8_ETC2, "T" },
+	{ GL_COMPRESSED_RGB8_ETC2, "H" },
+	{ GL_COMPRESSED_RGB8_ETC2, "planar" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "differential" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "differential transparent" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "T transparent" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "H transparent" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "planar" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "individual" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "differential" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "T" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "H" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "planar" },
+};
+
+static void printBytes(const GLubyte *bytes, size_t count)
+{
+	printf("{ ");
+	for (size_t i = 0; i < count; i++) printf("%s0x%02x", i > 0 ? ", " : "", bytes[i]);
+	printf(" }");
+}
+
+/**
+ * Prints etcgolden.h from the driver's decodes.
+ */
+static int generate(void)
+{
+	printf("//\n//  etcgolden.h\n//\n//  Made by etccheck --generate, from the decodes of %s.\n//\n\n", (const char *)glGetString(GL_RENDERER));
+	printf("static const GoldenBlock GoldenBlocks[] = {\n");
+	uint32_t state = 0x9e3779b9u;
+	for (size_t i = 0; i < sizeof(GeneratedBlocks) / sizeof(GeneratedBlocks[0]); i++)
+	{
+		GLenum format = GeneratedBlocks[i].format;
+		GLubyte block[16] = { 0 }, pixels[64];
+		buildBlock(block, format, GeneratedBlocks[i].mode, &state);
+		if (!driverDecode(format, block, blockBytes(format), 4, 4, pixels))
+		{
+			fprintf(stderr, "The driver can't decode %s.\n", formatName(format));
+			return 1;
+		}
+		printf("\t{ \"%s %s\", %s,\n\t\t", formatName(format), GeneratedBlocks[i].mode, formatName(format));
+		printBytes(block, sizeof(block));
+		printf(",\n\t\t");
+		printBytes(pixels, sizeof(pixels));
+		printf(" },\n");
+	}
+	printf("};\n\nstatic const GoldenSweep GoldenSweeps[] = {\n");
+
+	size_t blockCount = SWEEP_BLOCKS_WIDE * SWEEP_BLOCKS_WIDE;
+	GLubyte *blocks = malloc(16 * blockCount);
+	GLubyte *pixels = malloc(SWEEP_SIZE * SWEEP_SIZE * 4);
+	for (size_t i = 0; i < FORMAT_COUNT; i++)
+	{
+		uint32_t seed = 0x1234567u + (uint32_t)i;
+		randomBlocks(Formats[i], seed, blocks, blockCount);
+		if (!driverDecode(Formats[i], blocks, blockBytes(Formats[i]) * blockCount, SWEEP_SIZE, SWEEP_SIZE, pixels)) return 1;
+		printf("\t{ %s, 0x%08x, 0x%016llxull },\n", formatName(Formats[i]), seed, (unsigned long long)hashPixels(pixels, SWEEP_SIZE * SWEEP_SIZE * 4));
+	}
+	printf("};\n");
+	free(blocks);
+	free(pixels);
+	return 0;
+}
+
+#endif
+
+// Checks //////////////////////////////////////////////////////////////////
+
+static int checkGoldenBlocks(void)
+{
+	int failures = 0;
+	for (size_t i = 0; i < GOLDEN_BLOCK_COUNT; i++)
+	{
+		const GoldenBlock *g = &GoldenBlocks[i];
+		GLubyte pixels[64];
+		PGResult result = pgEtcDecode(g->format, g->block, blockBytes(g->format), 4, 4, pixels);
+		GLboolean match = PGR_OK == result && 0 == memcmp(pixels, g->pixels, sizeof(pixels));
+		printf("%-4s %s\n", match ? "ok" : "FAIL", g->name);
+		if (!match)
+		{
+			failures++;
+			if (PGR_OK == result) printPixelDifferences(g->pixels, pixels, 4, 4);
+		}
+	}
+	return failures;
+}
+
+static int checkSweeps(void)
+{
+	int failures = 0;
+	size_t blockCount = SWEEP_BLOCKS_WIDE * SWEEP_BLOCKS_WIDE;
+	GLubyte *blocks = malloc(16 * blockCount);
+	GLubyte *pixels = malloc(SWEEP_SIZE * SWEEP_SIZE * 4);
+#ifdef PG_ETC_CHECK_GL
+	GLubyte *reference = malloc(SWEEP_SIZE * SWEEP_SIZE * 4);
+#endif
+	for (size_t i = 0; i < GOLDEN_SWEEP_COUNT; i++)
+	{
+		const GoldenSweep *g = &GoldenSweeps[i];
+		size_t size = blockBytes(g->format) * blockCount;
+		randomBlocks(g->format, g->seed, blocks, blockCount);
+		PGResult result = pgEtcDecode(g->format, blocks, size, SWEEP_SIZE, SWEEP_SIZE, pixels);
+		GLboolean match = PGR_OK == result && g->hash == hashPixels(pixels, SWEEP_SIZE * SWEEP_SIZE * 4);
+		printf("%-4s %s sweep of %zu random blocks\n", match ? "ok" : "FAIL", formatName(g->format), blockCount);
+		if (!match) failures++;
+
+#ifdef PG_ETC_CHECK_GL
+		if (driverDecode(g->format, blocks, size, SWEEP_SIZE, SWEEP_SIZE, reference))
+		{
+			GLboolean same = PGR_OK == result && 0 == memcmp(pixels, reference, SWEEP_SIZE * SWEEP_SIZE * 4);
+			printf("%-4s %s sweep against %s\n", same ? "ok" : "FAIL", formatName(g->format), (const char *)glGetString(GL_RENDERER));
+			if (!same)
+			{
+				failures++;
+				printPixelDifferences(reference, pixels, SWEEP_SIZE, SWEEP_SIZE);
+			}
+		}
+#endif
+	}
+#ifdef PG_ETC_CHECK_GL
+	free(reference);
+#endif
+	free(blocks);
+	free(pixels);
+	return failures;
+}
+
+int main(int argc, char **argv)
+{
+#ifdef PG_ETC_CHECK_GL
+	PGHeadless headless;
+	if (PGR_OK != pgHeadlessCreate(&headless, 1, 1))
+	{
+		fprintf(stderr, "Could not create a GL context.\n");
+		return 1;
+	}
+	if (argc > 1 && 0 == strcmp(argv[1], "--generate"))
+	{
+		int status = generate();
+		pgHeadlessDestroy(&headless);
+		return status;
+	}
+#else
+	if (argc > 1 && 0 == strcmp(argv[1], "--generate"))
+	{
+		fprintf(stderr, "--generate needs a build with -DPG_ETC_CHECK_GL.\n");
+		return 1;
+	}
+#endif
+
+	int failures = checkGoldenBlocks() + checkSweeps();
+	printf("%d failed\n", failures);
+
+#ifdef PG_ETC_CHECK_GL
+	pgHeadlessDestroy(&headless);
+#endif
+	return 0 == failures ? 0 : 1;
+}
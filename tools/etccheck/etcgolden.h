@@ -0,0 +1,75 @@
+//
+//  etcgolden.h
+//
+//  Made by etccheck --generate, from the decodes of llvmpipe (LLVM 15.0.6, 256 bits).
+//
+
+static const GoldenBlock GoldenBlocks[] = {
+	{ "GL_ETC1_RGB8_OES individual", GL_ETC1_RGB8_OES,
+		{ 0x51, 0xe0, 0x7b, 0x01, 0xe6, 0xf9, 0xba, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x53, 0xec, 0x75, 0xff, 0x4d, 0xe6, 0x6f, 0xff, 0x57, 0xf0, 0x79, 0xff, 0x5d, 0xf6, 0x7f, 0xff, 0x57, 0xf0, 0x79, 0xff, 0x4d, 0xe6, 0x6f, 0xff, 0x4d, 0xe6, 0x6f, 0xff, 0x4d, 0xe6, 0x6f, 0xff, 0x19, 0x08, 0xc3, 0xff, 0x09, 0x00, 0xb3, 0xff, 0x0f, 0x00, 0xb9, 0xff, 0x0f, 0x00, 0xb9, 0xff, 0x09, 0x00, 0xb3, 0xff, 0x09, 0x00, 0xb3, 0xff, 0x19, 0x08, 0xc3, 0xff, 0x09, 0x00, 0xb3, 0xff } },
+	{ "GL_ETC1_RGB8_OES individual flipped", GL_ETC1_RGB8_OES,
+		{ 0xa8, 0xb5, 0x1a, 0xf9, 0x6d, 0x47, 0x0c, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x04, 0x00, 0xff, 0xd9, 0xea, 0x40, 0xff, 0x7b, 0x8c, 0x00, 0xff, 0xd9, 0xea, 0x40, 0xff, 0x00, 0x04, 0x00, 0xff, 0xd9, 0xea, 0x40, 0xff, 0xd9, 0xea, 0x40, 0xff, 0x7b, 0x8c, 0x00, 0xff, 0x67, 0x34, 0x89, 0xff, 0x1e, 0x00, 0x40, 0xff, 0x1e, 0x00, 0x40, 0xff, 0x67, 0x34, 0x89, 0xff, 0xa9, 0x76, 0xcb, 0xff, 0xa9, 0x76, 0xcb, 0xff, 0x1e, 0x00, 0x40, 0xff, 0xa9, 0x76, 0xcb, 0xff } },
+	{ "GL_ETC1_RGB8_OES differential", GL_ETC1_RGB8_OES,
+		{ 0x31, 0x32, 0x57, 0xf7, 0x84, 0xa5, 0x79, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x02, 0x02, 0x23, 0xff, 0x60, 0x60, 0x81, 0xff, 0xe8, 0xe8, 0xff, 0xff, 0xe8, 0xe8, 0xff, 0xff, 0xe8, 0xe8, 0xff, 0xff, 0x02, 0x02, 0x23, 0xff, 0x60, 0x60, 0x81, 0xff, 0xe8, 0xe8, 0xff, 0xff, 0x21, 0x2a, 0x32, 0xff, 0x51, 0x5a, 0x62, 0xff, 0x21, 0x2a, 0x32, 0xff, 0x89, 0x92, 0x9a, 0xff, 0x51, 0x5a, 0x62, 0xff, 0x21, 0x2a, 0x32, 0xff, 0x89, 0x92, 0x9a, 0xff, 0x21, 0x2a, 0x32, 0xff } },
+	{ "GL_ETC1_RGB8_OES differential flipped", GL_ETC1_RGB8_OES,
+		{ 0x49, 0x1a, 0x57, 0xaf, 0x83, 0xbd, 0xe8, 0xfd, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x02, 0xff, 0x00, 0x00, 0x02, 0xff, 0x32, 0x00, 0x3a, 0xff, 0x62, 0x30, 0x6a, 0xff, 0x62, 0x30, 0x6a, 0xff, 0x00, 0x00, 0x02, 0xff, 0x32, 0x00, 0x3a, 0xff, 0x9a, 0x68, 0xa2, 0xff, 0x28, 0x00, 0x20, 0xff, 0x7c, 0x53, 0x74, 0xff, 0x5f, 0x36, 0x57, 0xff, 0x7c, 0x53, 0x74, 0xff, 0x28, 0x00, 0x20, 0xff, 0x28, 0x00, 0x20, 0xff, 0x7c, 0x53, 0x74, 0xff, 0x28, 0x00, 0x20, 0xff } },
+	{ "GL_ETC1_RGB8_OES wrapped", GL_ETC1_RGB8_OES,
+		{ 0xfb, 0x50, 0x50, 0x66, 0x1e, 0x7b, 0xc6, 0xe5, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0xd5, 0x28, 0x28, 0xff, 0xf2, 0x45, 0x45, 0xff, 0x1d, 0x57, 0x57, 0xff, 0x13, 0x4d, 0x4d, 0xff, 0xf2, 0x45, 0x45, 0xff, 0xd5, 0x28, 0x28, 0xff, 0x07, 0x41, 0x41, 0xff, 0x1d, 0x57, 0x57, 0xff, 0xff, 0x7c, 0x7c, 0xff, 0xd5, 0x28, 0x28, 0xff, 0x07, 0x41, 0x41, 0xff, 0x29, 0x63, 0x63, 0xff, 0xf2, 0x45, 0x45, 0xff, 0xff, 0x7c, 0x7c, 0xff, 0x13, 0x4d, 0x4d, 0xff, 0x29, 0x63, 0x63, 0xff } },
+	{ "GL_COMPRESSED_RGB8_ETC2 individual", GL_COMPRESSED_RGB8_ETC2,
+		{ 0xeb, 0xfe, 0x7d, 0xd1, 0x9e, 0x5d, 0x14, 0x49, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x84, 0x95, 0x0d, 0xff, 0xcd, 0xde, 0x56, 0xff, 0xff, 0xff, 0x98, 0xff, 0x84, 0x95, 0x0d, 0xff, 0xff, 0xff, 0x98, 0xff, 0xff, 0xff, 0x98, 0xff, 0xcd, 0xde, 0x56, 0xff, 0xff, 0xff, 0x98, 0xff, 0xa9, 0xdc, 0xcb, 0xff, 0x7f, 0xb2, 0xa1, 0xff, 0x7f, 0xb2, 0xa1, 0xff, 0xcd, 0xff, 0xef, 0xff, 0x7f, 0xb2, 0xa1, 0xff, 0xcd, 0xff, 0xef, 0xff, 0xa9, 0xdc, 0xcb, 0xff, 0xa9, 0xdc, 0xcb, 0xff } },
+	{ "GL_COMPRESSED_RGB8_ETC2 differential", GL_COMPRESSED_RGB8_ETC2,
+		{ 0x11, 0x3a, 0x37, 0x6a, 0x14, 0x97, 0x6a, 0x9f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x0f, 0x07, 0xff, 0x00, 0x0f, 0x07, 0xff, 0x21, 0x53, 0x32, 0xff, 0x0f, 0x41, 0x20, 0xff, 0x00, 0x0f, 0x07, 0xff, 0x1d, 0x46, 0x3e, 0xff, 0x35, 0x67, 0x46, 0xff, 0x35, 0x67, 0x46, 0xff, 0x00, 0x0f, 0x07, 0xff, 0x1d, 0x46, 0x3e, 0xff, 0x0f, 0x41, 0x20, 0xff, 0x35, 0x67, 0x46, 0xff, 0x3a, 0x63, 0x5b, 0xff, 0x00, 0x0f, 0x07, 0xff, 0x35, 0x67, 0x46, 0xff, 0x21, 0x53, 0x32, 0xff } },
+	{ "GL_COMPRESSED_RGB8_ETC2 T", GL_COMPRESSED_RGB8_ETC2,
+		{ 0xfb, 0x50, 0x50, 0x4f, 0xb8, 0xb3, 0xf0, 0x85, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x15, 0x00, 0x04, 0xff, 0x55, 0x00, 0x44, 0xff, 0xff, 0x55, 0x00, 0xff, 0x15, 0x00, 0x04, 0xff, 0x55, 0x00, 0x44, 0xff, 0x55, 0x00, 0x44, 0xff, 0xff, 0x55, 0x00, 0xff, 0x15, 0x00, 0x04, 0xff, 0x95, 0x40, 0x84, 0xff, 0xff, 0x55, 0x00, 0xff, 0xff, 0x55, 0x00, 0xff, 0x95, 0x40, 0x84, 0xff, 0xff, 0x55, 0x00, 0xff, 0x15, 0x00, 0x04, 0xff, 0x55, 0x00, 0x44, 0xff, 0x15, 0x00, 0x04, 0xff } },
+	{ "GL_COMPRESSED_RGB8_ETC2 H", GL_COMPRESSED_RGB8_ETC2,
+		{ 0x50, 0xfb, 0x50, 0xaa, 0xaa, 0x7e, 0xb3, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0xb0, 0x17, 0xf4, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xa4, 0x0b, 0xe8, 0xff, 0xa4, 0x0b, 0xe8, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xa4, 0x0b, 0x4f, 0xff, 0xa4, 0x0b, 0x4f, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xb0, 0x17, 0xf4, 0xff, 0xb0, 0x17, 0xf4, 0xff, 0xa4, 0x0b, 0x4f, 0xff, 0xa4, 0x0b, 0xe8, 0xff, 0xb0, 0x17, 0x5b, 0xff, 0xa4, 0x0b, 0x4f, 0xff } },
+	{ "GL_COMPRESSED_RGB8_ETC2 planar", GL_COMPRESSED_RGB8_ETC2,
+		{ 0x50, 0x50, 0xfb, 0xb2, 0xf3, 0x3f, 0x59, 0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0xa2, 0x50, 0x7d, 0xff, 0x92, 0x79, 0x85, 0xff, 0x82, 0xa2, 0x8e, 0xff, 0x71, 0xca, 0x96, 0xff, 0xb4, 0x6e, 0x96, 0xff, 0xa4, 0x97, 0x9e, 0xff, 0x94, 0xc0, 0xa6, 0xff, 0x84, 0xe9, 0xae, 0xff, 0xc7, 0x8d, 0xae, 0xff, 0xb6, 0xb5, 0xb6, 0xff, 0xa6, 0xde, 0xbf, 0xff, 0x96, 0xff, 0xc7, 0xff, 0xd9, 0xab, 0xc7, 0xff, 0xc9, 0xd4, 0xcf, 0xff, 0xb8, 0xfc, 0xd7, 0xff, 0xa8, 0xff, 0xdf, 0xff } },
+	{ "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 differential", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+		{ 0x49, 0x1a, 0x5f, 0x3e, 0x67, 0x74, 0x08, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x5b, 0x29, 0x6b, 0xff, 0x45, 0x13, 0x55, 0xff, 0x23, 0x00, 0x23, 0xff, 0x81, 0x58, 0x81, 0xff, 0x4f, 0x1d, 0x5f, 0xff, 0x45, 0x13, 0x55, 0xff, 0x23, 0x00, 0x23, 0xff, 0x23, 0x00, 0x23, 0xff, 0x45, 0x13, 0x55, 0xff, 0x45, 0x13, 0x55, 0xff, 0x23, 0x00, 0x23, 0xff, 0x23, 0x00, 0x23, 0xff, 0x4f, 0x1d, 0x5f, 0xff, 0x4f, 0x1d, 0x5f, 0xff, 0xff, 0xe0, 0xff, 0xff, 0x81, 0x58, 0x81, 0xff } },
+	{ "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 differential transparent", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+		{ 0x41, 0x7a, 0x4f, 0xb8, 0x25, 0xd2, 0x1e, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x92, 0xcb, 0x9a, 0xff, 0x00, 0x2b, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0xb4, 0xf6, 0xac, 0xff, 0x00, 0x2b, 0x00, 0xff, 0x92, 0xcb, 0x9a, 0xff, 0xb4, 0xf6, 0xac, 0xff, 0x00, 0x00, 0x00, 0x00, 0x92, 0xcb, 0x9a, 0xff, 0x00, 0x2b, 0x00, 0xff, 0x00, 0x22, 0x00, 0xff, 0x4a, 0x8c, 0x42, 0xff, 0x92, 0xcb, 0x9a, 0xff, 0x00, 0x2b, 0x00, 0xff, 0xb4, 0xf6, 0xac, 0xff, 0x4a, 0x8c, 0x42, 0xff } },
+	{ "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 T transparent", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+		{ 0xfb, 0x50, 0x50, 0xa8, 0x58, 0xb1, 0x11, 0xe8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6c, 0x17, 0xc1, 0xff, 0x3e, 0x00, 0x93, 0xff, 0xff, 0x55, 0x00, 0xff, 0x3e, 0x00, 0x93, 0xff, 0xff, 0x55, 0x00, 0xff, 0xff, 0x55, 0x00, 0xff, 0xff, 0x55, 0x00, 0xff, 0x6c, 0x17, 0xc1, 0xff, 0xff, 0x55, 0x00, 0xff, 0x00, 0x00, 0x00, 0x00, 0x6c, 0x17, 0xc1, 0xff, 0x3e, 0x00, 0x93, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0x55, 0x00, 0xff } },
+	{ "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 H transparent", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+		{ 0x50, 0xfb, 0x50, 0xc5, 0xa0, 0xe8, 0x0c, 0xd5, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0x6a, 0x00, 0xae, 0xff, 0x6a, 0x00, 0xae, 0xff, 0xea, 0x51, 0xff, 0xff, 0xea, 0x51, 0xff, 0xff, 0xea, 0x51, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xea, 0x51, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x6a, 0x00, 0xae, 0xff, 0x6a, 0x00, 0x48, 0xff, 0x6a, 0x00, 0xae, 0xff, 0xea, 0x51, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x6a, 0x00, 0x48, 0xff, 0x6a, 0x00, 0xae, 0xff, 0x00, 0x00, 0x00, 0x00 } },
+	{ "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 planar", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+		{ 0x50, 0x50, 0xfb, 0xf7, 0x82, 0x7b, 0xab, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0xa2, 0x50, 0x7d, 0xff, 0xb5, 0x5d, 0x6d, 0xff, 0xc9, 0x6a, 0x5d, 0xff, 0xdc, 0x76, 0x4c, 0xff, 0x97, 0x53, 0x75, 0xff, 0xaa, 0x5f, 0x65, 0xff, 0xbd, 0x6c, 0x55, 0xff, 0xd1, 0x79, 0x44, 0xff, 0x8c, 0x55, 0x6d, 0xff, 0x9f, 0x62, 0x5d, 0xff, 0xb2, 0x6f, 0x4d, 0xff, 0xc5, 0x7b, 0x3c, 0xff, 0x80, 0x58, 0x65, 0xff, 0x94, 0x64, 0x55, 0xff, 0xa7, 0x71, 0x45, 0xff, 0xba, 0x7e, 0x34, 0xff } },
+	{ "GL_COMPRESSED_RGBA8_ETC2_EAC individual", GL_COMPRESSED_RGBA8_ETC2_EAC,
+		{ 0x30, 0xb0, 0x5f, 0xe8, 0x10, 0xf6, 0x93, 0x42, 0x87, 0x0b, 0x23, 0x78, 0xae, 0x7d, 0xc9, 0x35 },
+		{ 0x5e, 0x00, 0x00, 0x00, 0x5e, 0x00, 0x00, 0x46, 0xe1, 0xff, 0x9d, 0xca, 0x98, 0xdc, 0x54, 0x00, 0x95, 0x0d, 0x2f, 0xca, 0x5e, 0x00, 0x00, 0x0f, 0x56, 0x9a, 0x12, 0x67, 0x56, 0x9a, 0x12, 0x67, 0x5e, 0x00, 0x00, 0xca, 0x7b, 0x00, 0x15, 0x00, 0x56, 0x9a, 0x12, 0x67, 0xe1, 0xff, 0x9d, 0x0f, 0x7b, 0x00, 0x15, 0x88, 0x95, 0x0d, 0x2f, 0x0f, 0x0d, 0x51, 0x00, 0x00, 0x0d, 0x51, 0x00, 0x00 } },
+	{ "GL_COMPRESSED_RGBA8_ETC2_EAC differential", GL_COMPRESSED_RGBA8_ETC2_EAC,
+		{ 0x50, 0x58, 0x86, 0xdd, 0xb4, 0x77, 0x8b, 0x8f, 0x29, 0x42, 0x3f, 0x12, 0x9f, 0x71, 0xb7, 0x85 },
+		{ 0x21, 0x3a, 0x31, 0x55, 0x27, 0x40, 0x37, 0x73, 0x00, 0x16, 0x00, 0x1e, 0x00, 0x16, 0x00, 0x69, 0x2b, 0x44, 0x3b, 0x32, 0x27, 0x40, 0x37, 0x73, 0x00, 0x16, 0x00, 0x69, 0x6d, 0x8e, 0x6d, 0x73, 0x31, 0x4a, 0x41, 0x69, 0x27, 0x40, 0x37, 0x73, 0x00, 0x16, 0x00, 0x7d, 0x43, 0x64, 0x43, 0x32, 0x2b, 0x44, 0x3b, 0x69, 0x31, 0x4a, 0x41, 0x55, 0x1f, 0x40, 0x1f, 0x46, 0x00, 0x16, 0x00, 0x7d } },
+	{ "GL_COMPRESSED_RGBA8_ETC2_EAC T", GL_COMPRESSED_RGBA8_ETC2_EAC,
+		{ 0xdf, 0x5c, 0xb8, 0x49, 0x22, 0xe9, 0xc4, 0x99, 0xfb, 0x50, 0x50, 0x87, 0xa9, 0x8e, 0xb8, 0xfa },
+		{ 0xff, 0x55, 0x00, 0xee, 0x65, 0x10, 0x98, 0xe9, 0x55, 0x00, 0x88, 0xff, 0x65, 0x10, 0x98, 0xbc, 0x45, 0x00, 0x78, 0xfd, 0x65, 0x10, 0x98, 0xe9, 0xff, 0x55, 0x00, 0xbc, 0x45, 0x00, 0x78, 0xbc, 0x55, 0x00, 0x88, 0xd0, 0x65, 0x10, 0x98, 0xe9, 0xff, 0x55, 0x00, 0xad, 0xff, 0x55, 0x00, 0xad, 0x45, 0x00, 0x78, 0xe9, 0x45, 0x00, 0x78, 0xbc, 0x45, 0x00, 0x78, 0xe9, 0x45, 0x00, 0x78, 0xcb } },
+	{ "GL_COMPRESSED_RGBA8_ETC2_EAC H", GL_COMPRESSED_RGBA8_ETC2_EAC,
+		{ 0x65, 0x90, 0xf9, 0xfb, 0x60, 0x3e, 0x7d, 0x3d, 0x50, 0xfb, 0x50, 0xce, 0xbe, 0x03, 0x76, 0xb2 },
+		{ 0xca, 0x31, 0xb9, 0xe3, 0x8a, 0x00, 0xce, 0x92, 0xca, 0x31, 0xff, 0x2f, 0x8a, 0x00, 0x79, 0xad, 0x8a, 0x00, 0x79, 0xad, 0x8a, 0x00, 0xce, 0x92, 0x8a, 0x00, 0x79, 0xe3, 0x8a, 0x00, 0x79, 0x77, 0xca, 0x31, 0xff, 0x00, 0xca, 0x31, 0xff, 0x77, 0x8a, 0x00, 0x79, 0x77, 0x8a, 0x00, 0xce, 0xe3, 0xca, 0x31, 0xff, 0xe3, 0x8a, 0x00, 0xce, 0x4a, 0xca, 0x31, 0xb9, 0xe3, 0xca, 0x31, 0xb9, 0x92 } },
+	{ "GL_COMPRESSED_RGBA8_ETC2_EAC planar", GL_COMPRESSED_RGBA8_ETC2_EAC,
+		{ 0xaa, 0xf0, 0xd2, 0x43, 0x94, 0x20, 0xb3, 0xc8, 0x50, 0x50, 0xfb, 0x86, 0x3b, 0x77, 0xef, 0xe0 },
+		{ 0xa2, 0x50, 0x7d, 0xff, 0x7c, 0x4b, 0x8c, 0x50, 0x55, 0x45, 0x9c, 0x50, 0x2f, 0x40, 0xab, 0x50, 0xb9, 0x5c, 0x7e, 0xc8, 0x93, 0x56, 0x8e, 0xff, 0x6c, 0x51, 0x9d, 0x7d, 0x46, 0x4b, 0xac, 0xff, 0xd1, 0x67, 0x80, 0xc8, 0xaa, 0x62, 0x8f, 0x23, 0x84, 0x5c, 0x9e, 0x50, 0x5d, 0x57, 0xad, 0x50, 0xe8, 0x73, 0x81, 0xc8, 0xc1, 0x6d, 0x90, 0xc8, 0x9b, 0x68, 0x9f, 0x00, 0x74, 0x62, 0xaf, 0x7d } },
+};
+
+static const GoldenSweep GoldenSweeps[] = {
+	{ GL_ETC1_RGB8_OES, 0x01234567, 0xd8b8c5436ed1031bull },
+	{ GL_COMPRESSED_RGB8_ETC2, 0x01234568, 0xdd0b91c10ac18739ull },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 0x01234569, 0x60c3d88c9481856dull },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, 0x0123456a, 0x09d24d64a3279c69ull },
+};
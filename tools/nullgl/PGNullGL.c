@@ -0,0 +1,584 @@
+//
+//  PGNullGL.c
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  An OpenGL ES 3 "driver" which does nothing, for measuring what the core
+//  and pgreplay cost on the CPU with the real driver taken out. Link it in
+//  place of libGLESv2:
+//
+//      cc -std=gnu99 -O2 -Icore/src app.c core/src/*.c tools/nullgl/PGNullGL.c -lm -lpthread
+//
+//  Names are handed out from counters and never reused. Shaders keep their
+//  source so that linking can find the attributes and uniforms they
+//  declare, which keeps the core's binding paths doing the same work as
+//  they would on a real driver. Everything else is accepted and ignored.
+//
+
+// These are the driver's entry points, so must not be renamed to the trace
+// wrappers in a PG_GL_TRACE build
+#define PG_TRACE_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "PGGL.h"
+
+#define MAX_VARIABLES 32
+#define MAX_VARIABLE_NAME 64
+#define MAX_DEFINES 32
+
+struct NullVariable {
+	char name[MAX_VARIABLE_NAME];
+	GLenum type;
+	GLint size;
+	GLint location;
+};
+
+// Shaders and programs share a namespace, as in GL
+struct NullObject {
+	GLenum type;			// Shader type, or 0 for a program
+	char *source;
+	GLuint shaders[2];
+	struct NullVariable attribs[MAX_VARIABLES];
+	GLint attribCount;
+	struct NullVariable uniforms[MAX_VARIABLES];
+	GLint uniformCount;
+};
+
+static struct NullObject *Objects;
+static GLuint ObjectCount;
+static GLuint NextBuffer;
+static GLuint NextFramebuffer;
+static GLuint NextRenderbuffer;
+static GLuint NextTexture;
+static GLuint NextSync;
+
+// Mapped buffers all share one scratch allocation
+static void *MapScratch;
+static GLsizeiptr MapScratchSize;
+
+static struct NullObject *object(GLuint name)
+{
+	if (0 == name || name > ObjectCount) return NULL;
+	return &Objects[name - 1];
+}
+
+static GLuint newObject(GLenum type)
+{
+	struct NullObject *objects = realloc(Objects, sizeof(struct NullObject) * (ObjectCount + 1));
+	if (NULL == objects) return 0;
+	Objects = objects;
+	memset(&Objects[ObjectCount], 0, sizeof(struct NullObject));
+	Objects[ObjectCount].type = type;
+	return ++ObjectCount;
+}
+
+static void genNames(GLuint *counter, GLsizei n, GLuint *names)
+{
+	for (GLsizei i = 0; i < n; i++) names[i] = ++*counter;
+}
+
+// Declaration scanning ///////////////////////////////////////////////////////
+
+struct NullDefine {
+	char name[MAX_VARIABLE_NAME];
+	long value;
+};
+
+struct NullScanner {
+	const char *p;
+	struct NullDefine defines[MAX_DEFINES];
+	int defineCount;
+};
+
+static void skipSpaceAndComments(struct NullScanner *s)
+{
+	for (;;)
+	{
+		while (isspace((unsigned char)*s->p)) s->p++;
+		if ('/' == s->p[0] && '/' == s->p[1])
+		{
+			while ('\0' != *s->p && '\n' != *s->p) s->p++;
+		}
+		else if ('/' == s->p[0] && '*' == s->p[1])
+		{
+			const char *end = strstr(s->p + 2, "*/");
+			s->p = NULL != end ? end + 2 : s->p + strlen(s->p);
+		}
+		else return;
+	}
+}
+
+/**
+ * Reads an identifier, a number, or a single punctuation character.
+ * Returns 0 at the end of the source.
+ */
+static int nextToken(struct NullScanner *s, char *token, size_t size)
+{
+	skipSpaceAndComments(s);
+	if ('\0' == *s->p) return 0;
+
+	size_t length = 0;
+	if (isalnum((unsigned char)*s->p) || '_' == *s->p)
+	{
+		while (isalnum((unsigned char)*s->p) || '_' == *s->p)
+		{
+			if (length + 1 < size) token[length++] = *s->p;
+			s->p++;
+		}
+	}
+	else
+	{
+		token[length++] = *s->p++;
+	}
+	token[length] = '\0';
+	return 1;
+}
+
+static void readDirective(struct NullScanner *s)
+{
+	const char *end = strchr(s->p, '\n');
+	if (NULL == end) end = s->p + strlen(s->p);
+
+	char name[MAX_VARIABLE_NAME];
+	long value;
+	if (2 == sscanf(s->p, "#define %63s %ld", name, &value) && s->defineCount < MAX_DEFINES)
+	{
+		struct NullDefine *d = &s->defines[s->defineCount++];
+		strcpy(d->name, name);
+		d->value = value;
+	}
+	s->p = end;
+}
+
+static long termValue(const struct NullScanner *s, const char *token)
+{
+	if (isdigit((unsigned char)token[0])) return strtol(token, NULL, 0);
+	for (int i = 0; i < s->defineCount; i++)
+	{
+		if (0 == strcmp(s->defines[i].name, token)) return s->defines[i].value;
+	}
+	return 1;
+}
+
+/**
+ * Evaluates a sum of products of numbers and #defined names, up to `]`.
+ */
+static GLint arraySize(struct NullScanner *s)
+{
+	char token[MAX_VARIABLE_NAME];
+	long sum = 0, product = 1;
+	while (nextToken(s, token, sizeof(token)) && ']' != token[0])
+	{
+		if ('+' == token[0])
+		{
+			sum += product;
+			product = 1;
+		}
+		else if ('*' != token[0])
+		{
+			product *= termValue(s, token);
+		}
+	}
+	return (GLint)(sum + product);
+}
+
+static GLenum typeFromName(const char *name)
+{
+	static const struct { const char *name; GLenum type; } Types[] = {
+		{ "float", GL_FLOAT },
+		{ "vec2", GL_FLOAT_VEC2 },
+		{ "vec3", GL_FLOAT_VEC3 },
+		{ "vec4", GL_FLOAT_VEC4 },
+		{ "mat2", GL_FLOAT_MAT2 },
+		{ "mat3", GL_FLOAT_MAT3 },
+		{ "mat4", GL_FLOAT_MAT4 },
+		{ "int", GL_INT },
+		{ "bool", GL_BOOL },
+		{ "sampler2D", GL_SAMPLER_2D },
+		{ "samplerCube", GL_SAMPLER_CUBE },
+	};
+	for (size_t i = 0; i < sizeof(Types) / sizeof(Types[0]); i++)
+	{
+		if (0 == strcmp(Types[i].name, name)) return Types[i].type;
+	}
+	return GL_FLOAT_VEC4;
+}
+
+static void addVariable(struct NullVariable *variables, GLint *count, const char *name, GLenum type, GLint size)
+{
+	for (GLint i = 0; i < *count; i++)
+	{
+		// Uniforms declared in both stages are one variable
+		if (0 == strcmp(variables[i].name, name)) return;
+	}
+	if (*count >= MAX_VARIABLES) return;
+
+	struct NullVariable *v = &variables[(*count)++];
+	strncpy(v->name, name, MAX_VARIABLE_NAME - 1);
+	v->type = type;
+	v->size = size;
+}
+
+/**
+ * Finds `attribute` and `uniform` declarations. The variable's name is the
+ * last identifier before `;` or `[`, and its type the one before that, so
+ * precision qualifiers and macros in front are skipped.
+ */
+static void scanDeclarations(const char *source, struct NullObject *program)
+{
+	struct NullScanner s;
+	memset(&s, 0, sizeof(s));
+	s.p = source;
+
+	char token[MAX_VARIABLE_NAME];
+	int statementStart = 1;
+	for (;;)
+	{
+		skipSpaceAndComments(&s);
+		if ('#' == *s.p)
+		{
+			readDirective(&s);
+			continue;
+		}
+		if (!nextToken(&s, token, sizeof(token))) break;
+
+		int isAttribute = 0 == strcmp(token, "attribute");
+		int isUniform = 0 == strcmp(token, "uniform");
+		if (!statementStart || (!isAttribute && !isUniform))
+		{
+			statementStart = (';' == token[0] || '}' == token[0] || '{' == token[0]);
+			continue;
+		}
+
+		char type[MAX_VARIABLE_NAME] = "", name[MAX_VARIABLE_NAME] = "";
+		GLint size = 1;
+		while (nextToken(&s, token, sizeof(token)) && ';' != token[0])
+		{
+			if ('[' == token[0])
+			{
+				size = arraySize(&s);
+			}
+			else if (isalpha((unsigned char)token[0]) || '_' == token[0])
+			{
+				strcpy(type, name);
+				strcpy(name, token);
+			}
+		}
+
+		if ('\0' == name[0]) continue;
+		if (isAttribute)
+		{
+			addVariable(program->attribs, &program->attribCount, name, typeFromName(type), 1);
+		}
+		else
+		{
+			// Arrays are reported as name[0], as most drivers do
+			if (size > 1) strncat(name, "[0]", sizeof(name) - strlen(name) - 1);
+			addVariable(program->uniforms, &program->uniformCount, name, typeFromName(type), size);
+		}
+	}
+}
+
+static void assignLocations(struct NullVariable *variables, GLint count)
+{
+	GLint location = 0;
+	for (GLint i = 0; i < count; i++)
+	{
+		variables[i].location = location;
+		location += variables[i].size;
+	}
+}
+
+static GLint findLocation(const struct NullVariable *variables, GLint count, const GLchar *name)
+{
+	for (GLint i = 0; i < count; i++)
+	{
+		const char *v = variables[i].name;
+		size_t length = strlen(name);
+		if (0 == strcmp(v, name)) return variables[i].location;
+		// Arrays answer to their name without [0] too
+		if (0 == strncmp(v, name, length) && 0 == strcmp(v + length, "[0]")) return variables[i].location;
+	}
+	return -1;
+}
+
+// State ///////////////////////////////////////////////////////////////////
+
+const GLubyte *glGetString(GLenum name)
+{
+	switch (name)
+	{
+		case GL_VENDOR: return (const GLubyte *)"Noise & Heat";
+		case GL_RENDERER: return (const GLubyte *)"PGNullGL";
+		case GL_VERSION: return (const GLubyte *)"OpenGL ES 3.0 PGNullGL";
+		case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte *)"OpenGL ES GLSL ES 3.00";
+		case GL_EXTENSIONS: return (const GLubyte *)"GL_EXT_instanced_arrays GL_OES_rgb8_rgba8";
+		default: return NULL;
+	}
+}
+
+GLenum glGetError(void) { return GL_NO_ERROR; }
+
+void glGetIntegerv(GLenum pname, GLint *params)
+{
+	// GL_VIEWPORT is the only query with more than one value, and nothing
+	// asks for GL_COMPRESSED_TEXTURE_FORMATS once there are none
+	memset(params, 0, sizeof(GLint) * (GL_VIEWPORT == pname ? 4 : 1));
+}
+
+void glPixelStorei(GLenum pname, GLint param) { }
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { }
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height) { }
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) { }
+void glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) { }
+void glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) { }
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) { }
+void glCullFace(GLenum mode) { }
+void glDepthFunc(GLenum func) { }
+void glDepthMask(GLboolean flag) { }
+void glDisable(GLenum cap) { }
+void glEnable(GLenum cap) { }
+void glFrontFace(GLenum mode) { }
+void glPolygonOffset(GLfloat factor, GLfloat units) { }
+void glStencilFunc(GLenum func, GLint ref, GLuint mask) { }
+void glStencilMask(GLuint mask) { }
+void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) { }
+void glClearDepthf(GLclampf depth) { }
+void glClearStencil(GLint s) { }
+void glClear(GLbitfield mask) { }
+void glFlush(void) { }
+void glFinish(void) { }
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels) { }
+
+// Buffers, framebuffers and textures //////////////////////////////////////
+
+void glGenBuffers(GLsizei n, GLuint *buffers) { genNames(&NextBuffer, n, buffers); }
+void glDeleteBuffers(GLsizei n, const GLuint *buffers) { }
+void glBindBuffer(GLenum target, GLuint buffer) { }
+void glBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage) { }
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data) { }
+
+void *glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	if (length > MapScratchSize)
+	{
+		void *scratch = realloc(MapScratch, length);
+		if (NULL == scratch) return NULL;
+		MapScratch = scratch;
+		MapScratchSize = length;
+	}
+	return MapScratch;
+}
+
+GLboolean glUnmapBuffer(GLenum target) { return GL_TRUE; }
+
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers) { genNames(&NextFramebuffer, n, framebuffers); }
+void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) { }
+void glBindFramebuffer(GLenum target, GLuint framebuffer) { }
+void glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) { }
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) { }
+void glInvalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments) { }
+GLenum glCheckFramebufferStatus(GLenum target) { return GL_FRAMEBUFFER_COMPLETE; }
+
+void glGenRenderbuffers(GLsizei n, GLuint *renderbuffers) { genNames(&NextRenderbuffer, n, renderbuffers); }
+void glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers) { }
+void glBindRenderbuffer(GLenum target, GLuint renderbuffer) { }
+void glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) { }
+void glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height) { }
+void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) { }
+
+void glGenTextures(GLsizei n, GLuint *textures) { genNames(&NextTexture, n, textures); }
+void glDeleteTextures(GLsizei n, const GLuint *textures) { }
+void glBindTexture(GLenum target, GLuint texture) { }
+void glTexParameteri(GLenum target, GLenum pname, GLint param) { }
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels) { }
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels) { }
+void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data) { }
+
+// Sync objects are never pending
+GLsync glFenceSync(GLenum condition, GLbitfield flags) { return (GLsync)(uintptr_t)++NextSync; }
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) { return GL_ALREADY_SIGNALED; }
+void glDeleteSync(GLsync sync) { }
+
+// Shaders and programs ////////////////////////////////////////////////////
+
+GLuint glCreateShader(GLenum type) { return newObject(type); }
+GLuint glCreateProgram(void) { return newObject(0); }
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+	struct NullObject *s = object(shader);
+	if (NULL == s) return;
+
+	size_t total = 0;
+	for (GLsizei i = 0; i < count; i++)
+	{
+		total += (NULL != length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+	}
+	char *source = realloc(s->source, total + 1);
+	if (NULL == source) return;
+
+	size_t offset = 0;
+	for (GLsizei i = 0; i < count; i++)
+	{
+		size_t bytes = (NULL != length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+		memcpy(source + offset, string[i], bytes);
+		offset += bytes;
+	}
+	source[total] = '\0';
+	s->source = source;
+}
+
+void glCompileShader(GLuint shader) { }
+
+void glDeleteShader(GLuint shader)
+{
+	struct NullObject *s = object(shader);
+	if (NULL == s) return;
+
+	free(s->source);
+	s->source = NULL;
+}
+
+void glAttachShader(GLuint program, GLuint shader)
+{
+	struct NullObject *p = object(program);
+	struct NullObject *s = object(shader);
+	if (NULL == p || NULL == s) return;
+
+	p->shaders[GL_VERTEX_SHADER == s->type ? 0 : 1] = shader;
+}
+
+void glDetachShader(GLuint program, GLuint shader) { }
+
+void glLinkProgram(GLuint program)
+{
+	struct NullObject *p = object(program);
+	if (NULL == p) return;
+
+	p->attribCount = 0;
+	p->uniformCount = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		struct NullObject *s = object(p->shaders[i]);
+		if (NULL != s && NULL != s->source) scanDeclarations(s->source, p);
+	}
+	assignLocations(p->attribs, p->attribCount);
+	assignLocations(p->uniforms, p->uniformCount);
+}
+
+void glUseProgram(GLuint program) { }
+void glDeleteProgram(GLuint program) { }
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params)
+{
+	*params = (GL_COMPILE_STATUS == pname) ? GL_TRUE : 0;
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufsize, GLsizei *length, GLchar *infolog)
+{
+	if (NULL != length) *length = 0;
+	if (bufsize > 0) infolog[0] = '\0';
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params)
+{
+	const struct NullObject *p = object(program);
+	*params = 0;
+	switch (pname)
+	{
+		case GL_LINK_STATUS:
+		case GL_VALIDATE_STATUS:
+			*params = GL_TRUE;
+			break;
+		case GL_ACTIVE_ATTRIBUTES:
+			if (NULL != p) *params = p->attribCount;
+			break;
+		case GL_ACTIVE_UNIFORMS:
+			if (NULL != p) *params = p->uniformCount;
+			break;
+		case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH:
+		case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+			*params = MAX_VARIABLE_NAME;
+			break;
+	}
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei bufsize, GLsizei *length, GLchar *infolog)
+{
+	if (NULL != length) *length = 0;
+	if (bufsize > 0) infolog[0] = '\0';
+}
+
+static void getActive(const struct NullVariable *variables, GLint count, GLuint index, GLsizei bufsize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	if (index >= (GLuint)count || bufsize <= 0)
+	{
+		if (NULL != length) *length = 0;
+		return;
+	}
+	const struct NullVariable *v = &variables[index];
+	strncpy(name, v->name, bufsize - 1);
+	name[bufsize - 1] = '\0';
+	if (NULL != length) *length = (GLsizei)strlen(name);
+	*size = v->size;
+	*type = v->type;
+}
+
+void glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufsize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	const struct NullObject *p = object(program);
+	if (NULL == p) return;
+	getActive(p->attribs, p->attribCount, index, bufsize, length, size, type, name);
+}
+
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei bufsize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	const struct NullObject *p = object(program);
+	if (NULL == p) return;
+	getActive(p->uniforms, p->uniformCount, index, bufsize, length, size, type, name);
+}
+
+GLint glGetAttribLocation(GLuint program, const GLchar *name)
+{
+	const struct NullObject *p = object(program);
+	return NULL != p ? findLocation(p->attribs, p->attribCount, name) : -1;
+}
+
+GLint glGetUniformLocation(GLuint program, const GLchar *name)
+{
+	const struct NullObject *p = object(program);
+	return NULL != p ? findLocation(p->uniforms, p->uniformCount, name) : -1;
+}
+
+void glUniform1fv(GLint location, GLsizei count, const GLfloat *v) { }
+void glUniform2fv(GLint location, GLsizei count, const GLfloat *v) { }
+void glUniform3fv(GLint location, GLsizei count, const GLfloat *v) { }
+void glUniform4fv(GLint location, GLsizei count, const GLfloat *v) { }
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) { }
+
+// Programs have no uniform blocks, so everything takes the per uniform path
+GLuint glGetUniformBlockIndex(GLuint program, const GLchar *name) { return GL_INVALID_INDEX; }
+void glGetActiveUniformBlockName(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLchar *name) { if (NULL != length) *length = 0; }
+void glGetActiveUniformBlockiv(GLuint program, GLuint index, GLenum pname, GLint *params) { *params = 0; }
+void glGetActiveUniformsiv(GLuint program, GLsizei count, const GLuint *indices, GLenum pname, GLint *params)
+{
+	for (GLsizei i = 0; i < count; i++) params[i] = -1;
+}
+void glUniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) { }
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) { }
+
+// Vertex attributes and drawing ///////////////////////////////////////////
+
+void glEnableVertexAttribArray(GLuint index) { }
+void glDisableVertexAttribArray(GLuint index) { }
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer) { }
+void glVertexAttrib4fv(GLuint index, const GLfloat *values) { }
+void glVertexAttribDivisor(GLuint index, GLuint divisor) { }
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) { }
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) { }
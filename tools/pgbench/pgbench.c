@@ -0,0 +1,511 @@
+//
+//  pgbench.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Times the core's hot paths and writes the results as JSON. Against Mesa,
+//  in a headless context:
+//
+//      cc -std=gnu99 -O2 -Icore/src -Ilinux/src -o pgbench tools/pgbench/pgbench.c
+//          core/src/*.c linux/src/*.c -lEGL -lGLESv2 -lm -lpthread
+//
+//  Against the null driver, which leaves only the core's own cost:
+//
+//      cc -std=gnu99 -O2 -DPG_BENCH_NULL_GL -Icore/src -o pgbench-null tools/pgbench/pgbench.c
+//          core/src/*.c tools/nullgl/PGNullGL.c -lm -lpthread
+//
+//  Adding -DPG_GL_TRACE to either measures the cost of the trace wrappers
+//  while not recording.
+//
+//  Usage: pgbench [--out file] [--baseline file] [--threshold 0.1]
+//                 [--samples n] [--filter text] [--shaders dir]
+//
+//  Each case is run in samples of enough iterations to take at least
+//  SAMPLE_SECONDS, and reports percentiles of the time per iteration over
+//  the samples. With --baseline, each case's median is compared against
+//  the same case in an earlier run's output. Cases slower by more than
+//  the threshold are marked as regressions, and the exit status is 2.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "Pictogram.h"
+#include "Ludogram.h"
+#ifndef PG_BENCH_NULL_GL
+#	include "PGHeadless.h"
+#endif
+
+#define SAMPLE_SECONDS 0.002
+#define DEFAULT_SAMPLES 30
+#define MAX_SAMPLES 1000
+#define INSTANCES 100
+
+typedef struct
+{
+	float position[3];
+	float color[4];
+}
+BenchVertex;
+
+// Everything the cases share, made once up front
+static struct {
+	const char *shaders;
+	char files[3][64];
+	char path[3][256];
+
+	PGRenderer renderer;
+	PGProgram program;
+	PGProgram instancedProgram;
+	PGProgram batchedProgram;
+	LGPrg *prg;
+	PGMesh mesh;
+	PGInstance instances[INSTANCES];
+} Bench;
+
+static const GLfloat Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static const char *shaderPath(int which, const char *name)
+{
+	snprintf(Bench.path[which], sizeof(Bench.path[which]), "%s/%s", Bench.shaders, name);
+	return Bench.path[which];
+}
+
+// Cases /////////////////////////////////////////////////////////////////////
+
+static void fileToString(int which, unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		free(LGFileToString(Bench.files[which], NULL));
+	}
+}
+
+static void fileToString1K(unsigned long iterations) { fileToString(0, iterations); }
+static void fileToString64K(unsigned long iterations) { fileToString(1, iterations); }
+static void fileToString1M(unsigned long iterations) { fileToString(2, iterations); }
+
+static void lgPrgNew(unsigned long iterations)
+{
+	const char *vertex = shaderPath(0, "mvp_col.vsh");
+	const char *fragment = shaderPath(1, "mvp_col.fsh");
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		LGPrg *prg = LGPrgNewFromFiles(vertex, fragment);
+		LGPrgDelete(&prg);
+		pgDeleteQueueFlush();
+	}
+}
+
+static void programCreateAndBuild(unsigned long iterations)
+{
+	const char *vertex = shaderPath(0, "mvp_col_instanced.vsh");
+	const char *fragment = shaderPath(1, "mvp_col.fsh");
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		PGProgram program;
+		pgProgramCreateAndBuild(&program, vertex, fragment);
+		pgProgramDestroy(&program);
+		pgDeleteQueueFlush();
+	}
+}
+
+// Lookups go through a volatile sink so they can't be optimised away
+static volatile GLint Sink;
+
+static void programUniformLocation(unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		Sink = pgProgramUniformLocation(Bench.program, "modelViewMatrix");
+	}
+}
+
+static void programAttribLocation(unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		Sink = pgProgramAttribLocation(Bench.program, "color");
+	}
+}
+
+static void lgPrgUniformLocation(unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		Sink = LGPrgUniformLocation(Bench.prg, "modelViewMatrix");
+	}
+}
+
+static void rendererUseProgramSame(unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererUseProgram(Bench.renderer, Bench.program);
+	}
+}
+
+static void rendererUseProgramSwitch(unsigned long iterations)
+{
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererUseProgram(Bench.renderer, (i & 1) ? Bench.instancedProgram : Bench.program);
+	}
+}
+
+static void rendererSetUniformMatrix(unsigned long iterations)
+{
+	pgRendererUseProgram(Bench.renderer, Bench.program);
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererSetUniformMatrix4(Bench.renderer, "modelViewMatrix", Identity);
+	}
+}
+
+static void rendererDrawMesh(unsigned long iterations)
+{
+	pgRendererUseProgram(Bench.renderer, Bench.program);
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererDrawMesh(Bench.renderer, Bench.mesh, GL_TRIANGLES);
+	}
+}
+
+static void rendererDrawInstanced(unsigned long iterations)
+{
+	pgRendererUseProgram(Bench.renderer, Bench.instancedProgram);
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererDrawInstanced(Bench.renderer, Bench.mesh, GL_TRIANGLES, Bench.instances, INSTANCES);
+	}
+}
+
+static void rendererDrawBatched(unsigned long iterations)
+{
+	pgRendererUseProgram(Bench.renderer, Bench.batchedProgram);
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		pgRendererDrawInstanced(Bench.renderer, Bench.mesh, GL_TRIANGLES, Bench.instances, INSTANCES);
+	}
+}
+
+struct BenchCase {
+	const char *name;
+	void (*run)(unsigned long iterations);
+};
+
+static const struct BenchCase Cases[] = {
+	{ "file_to_string_1k", fileToString1K },
+	{ "file_to_string_64k", fileToString64K },
+	{ "file_to_string_1m", fileToString1M },
+	{ "lgprg_new_from_files", lgPrgNew },
+	{ "program_create_and_build", programCreateAndBuild },
+	{ "program_uniform_location", programUniformLocation },
+	{ "program_attrib_location", programAttribLocation },
+	{ "lgprg_uniform_location", lgPrgUniformLocation },
+	{ "renderer_use_program_same", rendererUseProgramSame },
+	{ "renderer_use_program_switch", rendererUseProgramSwitch },
+	{ "renderer_set_uniform_matrix", rendererSetUniformMatrix },
+	{ "renderer_draw_mesh", rendererDrawMesh },
+	{ "renderer_draw_instanced_100", rendererDrawInstanced },
+	{ "renderer_draw_batched_100", rendererDrawBatched },
+};
+#define NUM_CASES (sizeof(Cases) / sizeof(Cases[0]))
+
+// Setup /////////////////////////////////////////////////////////////////////
+
+static int writeTempFile(char *path, size_t size)
+{
+	strcpy(path, "/tmp/pgbench-XXXXXX");
+	int fd = mkstemp(path);
+	if (fd < 0) return 0;
+
+	char block[4096];
+	for (size_t i = 0; i < sizeof(block); i++) block[i] = 'a' + i % 26;
+	for (size_t written = 0; written < size; )
+	{
+		size_t bytes = size - written < sizeof(block) ? size - written : sizeof(block);
+		if (write(fd, block, bytes) != (ssize_t)bytes) break;
+		written += bytes;
+	}
+	close(fd);
+	return 1;
+}
+
+static int setup(void)
+{
+	if (!writeTempFile(Bench.files[0], 1024) || !writeTempFile(Bench.files[1], 64 * 1024) || !writeTempFile(Bench.files[2], 1024 * 1024))
+	{
+		fprintf(stderr, "Could not write temporary files.\n");
+		return 0;
+	}
+
+	PGResult result = pgProgramCreateAndBuild(&Bench.program, shaderPath(0, "mvp_col.vsh"), shaderPath(1, "mvp_col.fsh"));
+	if (PGR_OK == result) result = pgProgramCreateAndBuild(&Bench.instancedProgram, shaderPath(0, "mvp_col_instanced.vsh"), shaderPath(1, "mvp_col.fsh"));
+	if (PGR_OK == result) result = pgProgramCreateAndBuild(&Bench.batchedProgram, shaderPath(0, "mvp_col_batched.vsh"), shaderPath(1, "mvp_col.fsh"));
+	Bench.prg = LGPrgNewFromFiles(shaderPath(0, "mvp_col.vsh"), shaderPath(1, "mvp_col.fsh"));
+	if (PGR_OK != result || NULL == Bench.prg)
+	{
+		fprintf(stderr, "Could not build the shaders in %s.\n", Bench.shaders);
+		return 0;
+	}
+
+	static const BenchVertex Vertices[] = {
+		{ { -1, -1, 0 }, { 1, 0, 0, 1 } },
+		{ { 1, -1, 0 }, { 0, 1, 0, 1 } },
+		{ { 0, 1, 0 }, { 0, 0, 1, 1 } },
+	};
+	static const PGVertexAttrib Attribs[] = {
+		{ "position", 3, GL_FLOAT, GL_FALSE, 0 },
+		{ "color", 4, GL_FLOAT, GL_FALSE, 3 * sizeof(float) },
+	};
+	if (PGR_OK != pgMeshCreate(&Bench.mesh, Vertices, sizeof(BenchVertex), 3, Attribs, 2)) return 0;
+
+	for (int i = 0; i < INSTANCES; i++)
+	{
+		PGInstance *instance = &Bench.instances[i];
+		memset(instance, 0, sizeof(PGInstance));
+		instance->transform[0][0] = instance->transform[1][1] = 0.05f;
+		instance->transform[0][3] = (i % 10) * 0.2f - 0.9f;
+		instance->transform[1][3] = (i / 10) * 0.2f - 0.9f;
+		for (int c = 0; c < 4; c++) instance->color[c] = 1;
+	}
+
+	pgRendererUseProgram(Bench.renderer, Bench.program);
+	pgRendererSetUniformMatrix4(Bench.renderer, "projectionMatrix", Identity);
+	return 1;
+}
+
+static void teardown(void)
+{
+	for (int i = 0; i < 3; i++) unlink(Bench.files[i]);
+	pgMeshDestroy(&Bench.mesh);
+	pgProgramDestroy(&Bench.program);
+	pgProgramDestroy(&Bench.instancedProgram);
+	pgProgramDestroy(&Bench.batchedProgram);
+	LGPrgDelete(&Bench.prg);
+}
+
+// Measuring /////////////////////////////////////////////////////////////////
+
+struct BenchResult {
+	unsigned long iterations;
+	int samples;
+	double min, p50, p90, p99, max, mean;	// Nanoseconds per iteration
+	double baseline;						// Baseline p50, or < 0
+};
+
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, int count, double p)
+{
+	return sorted[(int)(p * (count - 1) + 0.5)];
+}
+
+static double timeSample(const struct BenchCase *c, unsigned long iterations)
+{
+	double start = now();
+	c->run(iterations);
+	double seconds = now() - start;
+
+	// Let the driver catch up outside the timed region, so queued work
+	// from one sample doesn't land in the next
+	glFinish();
+	pgRendererBeginFrame(Bench.renderer);
+	return seconds;
+}
+
+static void measure(const struct BenchCase *c, int samples, struct BenchResult *result)
+{
+	// Grow the batch until one sample is long enough to time reliably
+	unsigned long iterations = 1;
+	while (timeSample(c, iterations) < SAMPLE_SECONDS && iterations < (1ul << 30)) iterations *= 2;
+
+	double times[MAX_SAMPLES];
+	double sum = 0;
+	for (int i = 0; i < samples; i++)
+	{
+		times[i] = timeSample(c, iterations) * 1e9 / iterations;
+		sum += times[i];
+	}
+	qsort(times, samples, sizeof(double), compareDoubles);
+
+	result->iterations = iterations;
+	result->samples = samples;
+	result->min = times[0];
+	result->p50 = percentile(times, samples, 0.5);
+	result->p90 = percentile(times, samples, 0.9);
+	result->p99 = percentile(times, samples, 0.99);
+	result->max = times[samples - 1];
+	result->mean = sum / samples;
+}
+
+// Baselines /////////////////////////////////////////////////////////////////
+
+/**
+ * Finds a case's p50 in an earlier run's output. Only needs to understand
+ * what writeJSON writes.
+ */
+static double baselineP50(const char *json, const char *name)
+{
+	if (NULL == json) return -1;
+
+	char key[128];
+	snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+	const char *found = strstr(json, key);
+	if (NULL == found) return -1;
+
+	const char *p50 = strstr(found, "\"p50\":");
+	const char *next = strstr(found + 1, "\"name\":");
+	if (NULL == p50 || (NULL != next && p50 > next)) return -1;
+
+	return strtod(p50 + 6, NULL);
+}
+
+static char *readFile(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (NULL == file) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char *data = length >= 0 ? malloc(length + 1) : NULL;
+	if (NULL != data)
+	{
+		if (1 != fread(data, length, 1, file) && length > 0)
+		{
+			free(data);
+			data = NULL;
+		}
+		else data[length] = '\0';
+	}
+	fclose(file);
+	return data;
+}
+
+static void writeJSON(FILE *out, const struct BenchCase *cases, const struct BenchResult *results, size_t count, double threshold)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "  \"renderer\": \"%s\",\n", (const char *)glGetString(GL_RENDERER));
+	fprintf(out, "  \"version\": \"%s\",\n", (const char *)glGetString(GL_VERSION));
+	fprintf(out, "  \"unit\": \"ns\",\n");
+	fprintf(out, "  \"cases\": [\n");
+	for (size_t i = 0; i < count; i++)
+	{
+		const struct BenchResult *r = &results[i];
+		fprintf(out, "    { \"name\": \"%s\", \"iterations\": %lu, \"samples\": %d, ", cases[i].name, r->iterations, r->samples);
+		fprintf(out, "\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f",
+				r->min, r->p50, r->p90, r->p99, r->max, r->mean);
+		if (r->baseline > 0)
+		{
+			double change = r->p50 / r->baseline - 1;
+			fprintf(out, ", \"baseline_p50\": %.3f, \"change\": %.4f, \"regression\": %s",
+					r->baseline, change, change > threshold ? "true" : "false");
+		}
+		fprintf(out, " }%s\n", i + 1 < count ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+// Main //////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+	const char *outPath = NULL;
+	const char *baselinePath = NULL;
+	const char *filter = NULL;
+	double threshold = 0.1;
+	int samples = DEFAULT_SAMPLES;
+	Bench.shaders = "core/shaders";
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (NULL == value) break;
+		if (0 == strcmp(argv[i], "--out")) outPath = value;
+		else if (0 == strcmp(argv[i], "--baseline")) baselinePath = value;
+		else if (0 == strcmp(argv[i], "--threshold")) threshold = atof(value);
+		else if (0 == strcmp(argv[i], "--samples")) samples = atoi(value);
+		else if (0 == strcmp(argv[i], "--filter")) filter = value;
+		else if (0 == strcmp(argv[i], "--shaders")) Bench.shaders = value;
+		else continue;
+		i++;
+	}
+	if (samples < 1) samples = 1;
+	if (samples > MAX_SAMPLES) samples = MAX_SAMPLES;
+
+	char *baseline = NULL;
+	if (NULL != baselinePath && NULL == (baseline = readFile(baselinePath)))
+	{
+		fprintf(stderr, "Could not read baseline %s.\n", baselinePath);
+		return 1;
+	}
+
+#ifdef PG_BENCH_NULL_GL
+	if (PGR_OK != pgRendererCreate(&Bench.renderer)) return 1;
+	pgRendererSetupOffscreen(Bench.renderer, 256, 256);
+#else
+	PGHeadless headless;
+	if (PGR_OK != pgHeadlessCreate(&headless, 256, 256)) return 1;
+	Bench.renderer = pgHeadlessRenderer(headless);
+#endif
+	if (!setup()) return 1;
+
+	struct BenchCase cases[NUM_CASES];
+	struct BenchResult results[NUM_CASES];
+	size_t count = 0;
+	int regressions = 0;
+	for (size_t i = 0; i < NUM_CASES; i++)
+	{
+		if (NULL != filter && NULL == strstr(Cases[i].name, filter)) continue;
+
+		struct BenchResult *r = &results[count];
+		cases[count++] = Cases[i];
+		measure(&Cases[i], samples, r);
+		r->baseline = baselineP50(baseline, Cases[i].name);
+
+		fprintf(stderr, "%-30s %12.1f ns", Cases[i].name, r->p50);
+		if (r->baseline > 0)
+		{
+			double change = r->p50 / r->baseline - 1;
+			fprintf(stderr, "  %+6.1f%%%s", change * 100, change > threshold ? "  REGRESSION" : "");
+			if (change > threshold) regressions++;
+		}
+		fprintf(stderr, "\n");
+	}
+
+	FILE *out = NULL != outPath ? fopen(outPath, "w") : stdout;
+	if (NULL == out)
+	{
+		fprintf(stderr, "Could not write %s.\n", outPath);
+		return 1;
+	}
+	writeJSON(out, cases, results, count, threshold);
+	if (stdout != out) fclose(out);
+
+	teardown();
+#ifdef PG_BENCH_NULL_GL
+	pgRendererDestroy(&Bench.renderer);
+#else
+	pgHeadlessDestroy(&headless);
+#endif
+	free(baseline);
+
+	return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,1147 @@
+//
+//  pgreplay.c
+//
+//  Created by David Wagner on 16/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Replays a GL trace recorded by a PG_GL_TRACE build (see PGTrace.h) and
+//  reports how long each kind of call and each frame took. Against Mesa,
+//  in a headless context:
+//
+//      cc -std=gnu99 -O2 -Icore/src -Ilinux/src -o pgreplay tools/pgreplay/pgreplay.c
+//          core/src/*.c linux/src/*.c -lEGL -lGLESv2 -lm -lpthread
+//
+//  Against the null driver, to measure submission overhead alone:
+//
+//      cc -std=gnu99 -O2 -DPG_REPLAY_NULL_GL -Icore/src -o pgreplay-null tools/pgreplay/pgreplay.c
+//          core/src/*.c tools/nullgl/PGNullGL.c -lm -lpthread
+//
+//  Usage: pgreplay [--finish] trace
+//
+//  --finish calls glFinish at every frame marker, so frame times include
+//  the GPU's work rather than just the time taken to submit it.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "Pictogram.h"
+#ifndef PG_REPLAY_NULL_GL
+#	include "PGHeadless.h"
+#endif
+
+#define MAX_LOCATIONS 64
+
+static const char * const CallNames[PGTC_Count] = {
+	[PGTC_Frame] = "Frame",
+	[PGTC_AttachShader] = "glAttachShader",
+	[PGTC_BindBuffer] = "glBindBuffer",
+	[PGTC_BindFramebuffer] = "glBindFramebuffer",
+	[PGTC_BindRenderbuffer] = "glBindRenderbuffer",
+	[PGTC_BufferData] = "glBufferData",
+	[PGTC_BufferSubData] = "glBufferSubData",
+	[PGTC_Clear] = "glClear",
+	[PGTC_ClearColor] = "glClearColor",
+	[PGTC_ClientArray] = "client array",
+	[PGTC_CompileShader] = "glCompileShader",
+	[PGTC_CreateProgram] = "glCreateProgram",
+	[PGTC_CreateShader] = "glCreateShader",
+	[PGTC_DeleteBuffers] = "glDeleteBuffers",
+	[PGTC_DeleteFramebuffers] = "glDeleteFramebuffers",
+	[PGTC_DeleteProgram] = "glDeleteProgram",
+	[PGTC_DeleteRenderbuffers] = "glDeleteRenderbuffers",
+	[PGTC_DeleteShader] = "glDeleteShader",
+	[PGTC_DeleteTextures] = "glDeleteTextures",
+	[PGTC_DetachShader] = "glDetachShader",
+	[PGTC_DisableVertexAttribArray] = "glDisableVertexAttribArray",
+	[PGTC_DrawArrays] = "glDrawArrays",
+	[PGTC_DrawArraysInstanced] = "glDrawArraysInstanced",
+	[PGTC_EnableVertexAttribArray] = "glEnableVertexAttribArray",
+	[PGTC_Flush] = "glFlush",
+	[PGTC_FramebufferRenderbuffer] = "glFramebufferRenderbuffer",
+	[PGTC_GenBuffers] = "glGenBuffers",
+	[PGTC_GenFramebuffers] = "glGenFramebuffers",
+	[PGTC_GenRenderbuffers] = "glGenRenderbuffers",
+	[PGTC_GetAttribLocation] = "glGetAttribLocation",
+	[PGTC_GetUniformLocation] = "glGetUniformLocation",
+	[PGTC_LinkProgram] = "glLinkProgram",
+	[PGTC_PixelStorei] = "glPixelStorei",
+	[PGTC_ReadPixels] = "glReadPixels",
+	[PGTC_RenderbufferStorage] = "glRenderbufferStorage",
+	[PGTC_ShaderSource] = "glShaderSource",
+	[PGTC_Uniform4fv] = "glUniform4fv",
+	[PGTC_UniformMatrix4fv] = "glUniformMatrix4fv",
+	[PGTC_UseProgram] = "glUseProgram",
+	[PGTC_VertexAttrib4fv] = "glVertexAttrib4fv",
+	[PGTC_VertexAttribDivisor] = "glVertexAttribDivisor",
+	[PGTC_VertexAttribPointer] = "glVertexAttribPointer",
+	[PGTC_Viewport] = "glViewport",
+	[PGTC_MapBufferRange] = "glMapBufferRange",
+	[PGTC_UnmapBuffer] = "glUnmapBuffer",
+	[PGTC_FenceSync] = "glFenceSync",
+	[PGTC_ClientWaitSync] = "glClientWaitSync",
+	[PGTC_DeleteSync] = "glDeleteSync",
+	[PGTC_GenTextures] = "glGenTextures",
+	[PGTC_BindTexture] = "glBindTexture",
+	[PGTC_TexParameteri] = "glTexParameteri",
+	[PGTC_TexImage2D] = "glTexImage2D",
+	[PGTC_TexSubImage2D] = "glTexSubImage2D",
+	[PGTC_CompressedTexImage2D] = "glCompressedTexImage2D",
+	[PGTC_FramebufferTexture2D] = "glFramebufferTexture2D",
+	[PGTC_RenderbufferStorageMultisample] = "glRenderbufferStorageMultisample",
+	[PGTC_BlitFramebuffer] = "glBlitFramebuffer",
+	[PGTC_InvalidateFramebuffer] = "glInvalidateFramebuffer",
+	[PGTC_BlendEquationSeparate] = "glBlendEquationSeparate",
+	[PGTC_BlendFuncSeparate] = "glBlendFuncSeparate",
+	[PGTC_ColorMask] = "glColorMask",
+	[PGTC_CullFace] = "glCullFace",
+	[PGTC_DepthFunc] = "glDepthFunc",
+	[PGTC_DepthMask] = "glDepthMask",
+	[PGTC_Disable] = "glDisable",
+	[PGTC_Enable] = "glEnable",
+	[PGTC_FrontFace] = "glFrontFace",
+	[PGTC_PolygonOffset] = "glPolygonOffset",
+	[PGTC_StencilFunc] = "glStencilFunc",
+	[PGTC_StencilMask] = "glStencilMask",
+	[PGTC_StencilOp] = "glStencilOp",
+	[PGTC_Uniform1fv] = "glUniform1fv",
+	[PGTC_Uniform2fv] = "glUniform2fv",
+	[PGTC_Uniform3fv] = "glUniform3fv",
+	[PGTC_GetUniformBlockIndex] = "glGetUniformBlockIndex",
+	[PGTC_UniformBlockBinding] = "glUniformBlockBinding",
+	[PGTC_BindBufferRange] = "glBindBufferRange",
+	[PGTC_Scissor] = "glScissor",
+	[PGTC_ClearDepthf] = "glClearDepthf",
+	[PGTC_ClearStencil] = "glClearStencil",
+};
+
+// Reading ///////////////////////////////////////////////////////////////////
+
+struct Reader {
+	const unsigned char *p;
+	const unsigned char *end;
+	int overrun;
+};
+
+static const void *getBytes(struct Reader *r, size_t bytes)
+{
+	if ((size_t)(r->end - r->p) < bytes)
+	{
+		r->overrun = 1;
+		r->p = r->end;
+		return NULL;
+	}
+	const void *data = r->p;
+	r->p += bytes;
+	return data;
+}
+
+static uint32_t getU32(struct Reader *r)
+{
+	const unsigned char *b = getBytes(r, 4);
+	if (NULL == b) return 0;
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static int32_t getI32(struct Reader *r)
+{
+	return (int32_t)getU32(r);
+}
+
+static uint64_t getU64(struct Reader *r)
+{
+	uint64_t low = getU32(r);
+	return low | ((uint64_t)getU32(r) << 32);
+}
+
+static GLfloat getF32(struct Reader *r)
+{
+	uint32_t bits = getU32(r);
+	GLfloat value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static const void *getBlob(struct Reader *r, uint32_t *bytes)
+{
+	*bytes = getU32(r);
+	return getBytes(r, *bytes);
+}
+
+// Name and location mapping /////////////////////////////////////////////////
+
+struct NameMap {
+	GLuint *names;
+	uint32_t capacity;
+};
+
+static void mapSet(struct NameMap *map, uint32_t from, GLuint to)
+{
+	if (from >= map->capacity)
+	{
+		uint32_t capacity = map->capacity > 0 ? map->capacity : 64;
+		while (capacity <= from) capacity *= 2;
+		GLuint *names = realloc(map->names, sizeof(GLuint) * capacity);
+		if (NULL == names) return;
+		memset(names + map->capacity, 0, sizeof(GLuint) * (capacity - map->capacity));
+		map->names = names;
+		map->capacity = capacity;
+	}
+	map->names[from] = to;
+}
+
+static GLuint mapGet(const struct NameMap *map, uint32_t from)
+{
+	return from < map->capacity ? map->names[from] : 0;
+}
+
+// A driver may pick different locations than the recording one did
+struct Locations {
+	GLint from[MAX_LOCATIONS];
+	GLint to[MAX_LOCATIONS];
+	int count;
+};
+
+struct ProgramLocations {
+	struct Locations attribs;
+	struct Locations uniforms;
+	struct Locations blocks;
+};
+
+static void locationSet(struct Locations *l, GLint from, GLint to)
+{
+	for (int i = 0; i < l->count; i++)
+	{
+		if (from == l->from[i])
+		{
+			l->to[i] = to;
+			return;
+		}
+	}
+	if (l->count < MAX_LOCATIONS)
+	{
+		l->from[l->count] = from;
+		l->to[l->count] = to;
+		l->count++;
+	}
+}
+
+static GLint locationGet(const struct Locations *l, GLint from)
+{
+	if (NULL == l || from < 0) return from;
+	for (int i = 0; i < l->count; i++)
+	{
+		if (from == l->from[i]) return l->to[i];
+	}
+	return from;
+}
+
+// Replay state //////////////////////////////////////////////////////////////
+
+struct Replay {
+	struct NameMap buffers;
+	struct NameMap objects;			// Shaders and programs
+	struct NameMap framebuffers;
+	struct NameMap renderbuffers;
+	struct NameMap textures;
+
+	GLsync *syncs;
+	uint32_t syncCapacity;
+
+	struct ProgramLocations *programs;
+	uint32_t programCapacity;
+	uint32_t currentProgram;		// Trace name
+
+	GLuint arrayBuffer;				// Replay names
+	GLuint renderbuffer;
+
+	void *scratch;
+	size_t scratchSize;
+
+	int es3;
+};
+
+static struct ProgramLocations *programLocations(struct Replay *replay, uint32_t program, int create)
+{
+	if (program >= replay->programCapacity)
+	{
+		if (!create) return NULL;
+		uint32_t capacity = replay->programCapacity > 0 ? replay->programCapacity : 16;
+		while (capacity <= program) capacity *= 2;
+		struct ProgramLocations *programs = realloc(replay->programs, sizeof(struct ProgramLocations) * capacity);
+		if (NULL == programs) return NULL;
+		memset(programs + replay->programCapacity, 0, sizeof(struct ProgramLocations) * (capacity - replay->programCapacity));
+		replay->programs = programs;
+		replay->programCapacity = capacity;
+	}
+	return &replay->programs[program];
+}
+
+static GLint attribLocation(struct Replay *replay, GLint index)
+{
+	struct ProgramLocations *p = programLocations(replay, replay->currentProgram, 0);
+	return locationGet(NULL != p ? &p->attribs : NULL, index);
+}
+
+static GLint uniformLocation(struct Replay *replay, GLint location)
+{
+	struct ProgramLocations *p = programLocations(replay, replay->currentProgram, 0);
+	return locationGet(NULL != p ? &p->uniforms : NULL, location);
+}
+
+static void setSync(struct Replay *replay, uint32_t id, GLsync sync)
+{
+	if (id >= replay->syncCapacity)
+	{
+		uint32_t capacity = replay->syncCapacity > 0 ? replay->syncCapacity : 64;
+		while (capacity <= id) capacity *= 2;
+		GLsync *syncs = realloc(replay->syncs, sizeof(GLsync) * capacity);
+		if (NULL == syncs) return;
+		memset(syncs + replay->syncCapacity, 0, sizeof(GLsync) * (capacity - replay->syncCapacity));
+		replay->syncs = syncs;
+		replay->syncCapacity = capacity;
+	}
+	replay->syncs[id] = sync;
+}
+
+static GLsync getSync(const struct Replay *replay, uint32_t id)
+{
+	return id < replay->syncCapacity ? replay->syncs[id] : NULL;
+}
+
+static void *scratch(struct Replay *replay, size_t bytes)
+{
+	if (bytes > replay->scratchSize)
+	{
+		void *memory = realloc(replay->scratch, bytes);
+		if (NULL == memory) return NULL;
+		replay->scratch = memory;
+		replay->scratchSize = bytes;
+	}
+	return replay->scratch;
+}
+
+/**
+ * Blobs sit at any offset in the trace, so copy values out before handing
+ * them to GL as floats.
+ */
+static const GLfloat *floats(struct Replay *replay, const void *data, uint32_t bytes)
+{
+	void *copy = scratch(replay, bytes);
+	if (NULL == copy) return NULL;
+	return memcpy(copy, data, bytes);
+}
+
+/**
+ * The same for pixels, which GL may read as 16 bit values.
+ */
+static const void *pixels(struct Replay *replay, const void *data, uint32_t bytes)
+{
+	void *copy = scratch(replay, bytes);
+	if (NULL == copy) return NULL;
+	return memcpy(copy, data, bytes);
+}
+
+static void genNames(struct Reader *r, struct NameMap *map, void (*gen)(GLsizei, GLuint *))
+{
+	uint32_t n = getU32(r);
+	for (uint32_t i = 0; i < n && !r->overrun; i++)
+	{
+		GLuint name = 0;
+		gen(1, &name);
+		mapSet(map, getU32(r), name);
+	}
+}
+
+static void deleteNames(struct Reader *r, struct NameMap *map, void (*del)(GLsizei, const GLuint *))
+{
+	uint32_t n = getU32(r);
+	for (uint32_t i = 0; i < n && !r->overrun; i++)
+	{
+		uint32_t from = getU32(r);
+		GLuint name = mapGet(map, from);
+		if (0 != name) del(1, &name);
+		mapSet(map, from, 0);
+	}
+}
+
+static void vertexAttribDivisor(struct Replay *replay, GLuint index, GLuint divisor)
+{
+#ifdef GL_ES_VERSION_3_0
+	if (replay->es3)
+	{
+		glVertexAttribDivisor(index, divisor);
+		return;
+	}
+#endif
+#ifdef GL_EXT_instanced_arrays
+	glVertexAttribDivisorEXT(index, divisor);
+#endif
+}
+
+static void drawArraysInstanced(struct Replay *replay, GLenum mode, GLint first, GLsizei count, GLsizei instances)
+{
+#ifdef GL_ES_VERSION_3_0
+	if (replay->es3)
+	{
+		glDrawArraysInstanced(mode, first, count, instances);
+		return;
+	}
+#endif
+#ifdef GL_EXT_instanced_arrays
+	glDrawArraysInstancedEXT(mode, first, count, instances);
+#endif
+}
+
+/**
+ * Traces from iOS size their colour buffer through EAGL, which isn't
+ * recorded. Give an unsized colour buffer storage to match the viewport.
+ */
+static void completeFramebuffer(struct Replay *replay, GLsizei width, GLsizei height)
+{
+	if (GL_FRAMEBUFFER_COMPLETE == glCheckFramebufferStatus(GL_FRAMEBUFFER) || 0 == replay->renderbuffer) return;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, replay->renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8_OES, width, height);
+}
+
+static void execute(struct Replay *replay, struct Reader *r, PGTraceCall call)
+{
+	uint32_t bytes;
+	const void *data;
+
+	switch (call)
+	{
+		case PGTC_Frame:
+			break;
+
+		case PGTC_AttachShader:
+		{
+			GLuint program = mapGet(&replay->objects, getU32(r));
+			glAttachShader(program, mapGet(&replay->objects, getU32(r)));
+			break;
+		}
+		case PGTC_BindBuffer:
+		{
+			GLenum target = getU32(r);
+			GLuint buffer = mapGet(&replay->buffers, getU32(r));
+			if (GL_ARRAY_BUFFER == target) replay->arrayBuffer = buffer;
+			glBindBuffer(target, buffer);
+			break;
+		}
+		case PGTC_BindFramebuffer:
+		{
+			GLenum target = getU32(r);
+			glBindFramebuffer(target, mapGet(&replay->framebuffers, getU32(r)));
+			break;
+		}
+		case PGTC_BindRenderbuffer:
+		{
+			GLenum target = getU32(r);
+			replay->renderbuffer = mapGet(&replay->renderbuffers, getU32(r));
+			glBindRenderbuffer(target, replay->renderbuffer);
+			break;
+		}
+		case PGTC_BufferData:
+		{
+			GLenum target = getU32(r);
+			GLsizeiptr size = getU32(r);
+			GLenum usage = getU32(r);
+			data = getU32(r) ? getBytes(r, size) : NULL;
+			glBufferData(target, size, data, usage);
+			break;
+		}
+		case PGTC_BufferSubData:
+		{
+			GLenum target = getU32(r);
+			GLintptr offset = getU32(r);
+			data = getBlob(r, &bytes);
+			if (NULL != data) glBufferSubData(target, offset, bytes, data);
+			break;
+		}
+		case PGTC_Clear:
+			glClear(getU32(r));
+			break;
+		case PGTC_ClearColor:
+		{
+			GLfloat red = getF32(r), green = getF32(r), blue = getF32(r), alpha = getF32(r);
+			glClearColor(red, green, blue, alpha);
+			break;
+		}
+		case PGTC_ClearDepthf:
+			glClearDepthf(getF32(r));
+			break;
+		case PGTC_ClearStencil:
+			glClearStencil(getI32(r));
+			break;
+		case PGTC_ClientArray:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			GLint size = getI32(r);
+			GLenum type = getU32(r);
+			GLboolean normalized = (GLboolean)getU32(r);
+			GLsizei stride = getI32(r);
+			data = getBlob(r, &bytes);
+			if (NULL == data || index < 0) break;
+
+			// Client pointers only mean anything with no buffer bound
+			if (0 != replay->arrayBuffer) glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glVertexAttribPointer(index, size, type, normalized, stride, data);
+			if (0 != replay->arrayBuffer) glBindBuffer(GL_ARRAY_BUFFER, replay->arrayBuffer);
+			break;
+		}
+		case PGTC_CompileShader:
+			glCompileShader(mapGet(&replay->objects, getU32(r)));
+			break;
+		case PGTC_CreateProgram:
+			mapSet(&replay->objects, getU32(r), glCreateProgram());
+			break;
+		case PGTC_CreateShader:
+		{
+			GLenum type = getU32(r);
+			mapSet(&replay->objects, getU32(r), glCreateShader(type));
+			break;
+		}
+		case PGTC_DeleteBuffers:
+			deleteNames(r, &replay->buffers, glDeleteBuffers);
+			break;
+		case PGTC_DeleteFramebuffers:
+			deleteNames(r, &replay->framebuffers, glDeleteFramebuffers);
+			break;
+		case PGTC_DeleteProgram:
+		{
+			uint32_t program = getU32(r);
+			glDeleteProgram(mapGet(&replay->objects, program));
+			struct ProgramLocations *p = programLocations(replay, program, 0);
+			if (NULL != p) memset(p, 0, sizeof(struct ProgramLocations));
+			break;
+		}
+		case PGTC_DeleteRenderbuffers:
+			deleteNames(r, &replay->renderbuffers, glDeleteRenderbuffers);
+			break;
+		case PGTC_DeleteShader:
+			glDeleteShader(mapGet(&replay->objects, getU32(r)));
+			break;
+		case PGTC_DeleteTextures:
+			deleteNames(r, &replay->textures, glDeleteTextures);
+			break;
+		case PGTC_DetachShader:
+		{
+			GLuint program = mapGet(&replay->objects, getU32(r));
+			glDetachShader(program, mapGet(&replay->objects, getU32(r)));
+			break;
+		}
+		case PGTC_DisableVertexAttribArray:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			if (index >= 0) glDisableVertexAttribArray(index);
+			break;
+		}
+		case PGTC_DrawArrays:
+		{
+			GLenum mode = getU32(r);
+			GLint first = getI32(r);
+			glDrawArrays(mode, first, getI32(r));
+			break;
+		}
+		case PGTC_DrawArraysInstanced:
+		{
+			GLenum mode = getU32(r);
+			GLint first = getI32(r);
+			GLsizei count = getI32(r);
+			drawArraysInstanced(replay, mode, first, count, getI32(r));
+			break;
+		}
+		case PGTC_EnableVertexAttribArray:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			if (index >= 0) glEnableVertexAttribArray(index);
+			break;
+		}
+		case PGTC_Flush:
+			glFlush();
+			break;
+		case PGTC_FramebufferRenderbuffer:
+		{
+			GLenum target = getU32(r);
+			GLenum attachment = getU32(r);
+			GLenum renderbufferTarget = getU32(r);
+			glFramebufferRenderbuffer(target, attachment, renderbufferTarget, mapGet(&replay->renderbuffers, getU32(r)));
+			break;
+		}
+		case PGTC_GenBuffers:
+			genNames(r, &replay->buffers, glGenBuffers);
+			break;
+		case PGTC_GenFramebuffers:
+			genNames(r, &replay->framebuffers, glGenFramebuffers);
+			break;
+		case PGTC_GenRenderbuffers:
+			genNames(r, &replay->renderbuffers, glGenRenderbuffers);
+			break;
+		case PGTC_GetAttribLocation:
+		case PGTC_GetUniformLocation:
+		{
+			uint32_t program = getU32(r);
+			data = getBlob(r, &bytes);
+			GLint recorded = getI32(r);
+			if (NULL == data || recorded < 0) break;
+
+			char *name = scratch(replay, bytes + 1);
+			if (NULL == name) break;
+			memcpy(name, data, bytes);
+			name[bytes] = '\0';
+
+			struct ProgramLocations *p = programLocations(replay, program, 1);
+			if (NULL == p) break;
+			if (PGTC_GetAttribLocation == call)
+			{
+				locationSet(&p->attribs, recorded, glGetAttribLocation(mapGet(&replay->objects, program), name));
+			}
+			else
+			{
+				locationSet(&p->uniforms, recorded, glGetUniformLocation(mapGet(&replay->objects, program), name));
+			}
+			break;
+		}
+		case PGTC_LinkProgram:
+			glLinkProgram(mapGet(&replay->objects, getU32(r)));
+			break;
+		case PGTC_PixelStorei:
+		{
+			GLenum name = getU32(r);
+			glPixelStorei(name, getI32(r));
+			break;
+		}
+		case PGTC_ReadPixels:
+		{
+			GLint x = getI32(r), y = getI32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			GLenum format = getU32(r), type = getU32(r);
+			uint32_t offset = getU32(r);
+			// Every format the core reads is at most four bytes a pixel
+			void *pixels = ~0u == offset ? scratch(replay, (size_t)width * height * 4) : (void *)(uintptr_t)offset;
+			glReadPixels(x, y, width, height, format, type, pixels);
+			break;
+		}
+		case PGTC_RenderbufferStorage:
+		{
+			GLenum target = getU32(r), format = getU32(r);
+			GLsizei width = getI32(r);
+			glRenderbufferStorage(target, format, width, getI32(r));
+			break;
+		}
+		case PGTC_ShaderSource:
+		{
+			GLuint shader = mapGet(&replay->objects, getU32(r));
+			data = getBlob(r, &bytes);
+			if (NULL == data) break;
+			const GLchar *source = data;
+			GLint length = (GLint)bytes;
+			glShaderSource(shader, 1, &source, &length);
+			break;
+		}
+		case PGTC_Uniform1fv:
+		case PGTC_Uniform2fv:
+		case PGTC_Uniform3fv:
+		{
+			GLint location = uniformLocation(replay, getI32(r));
+			GLsizei count = getI32(r);
+			data = getBlob(r, &bytes);
+			if (NULL == data) break;
+			
+			const GLfloat *values = floats(replay, data, bytes);
+			if (PGTC_Uniform1fv == call) glUniform1fv(location, count, values);
+			else if (PGTC_Uniform2fv == call) glUniform2fv(location, count, values);
+			else glUniform3fv(location, count, values);
+			break;
+		}
+		case PGTC_Uniform4fv:
+		{
+			GLint location = uniformLocation(replay, getI32(r));
+			GLsizei count = getI32(r);
+			data = getBlob(r, &bytes);
+			if (NULL != data) glUniform4fv(location, count, floats(replay, data, bytes));
+			break;
+		}
+		case PGTC_UniformMatrix4fv:
+		{
+			GLint location = uniformLocation(replay, getI32(r));
+			GLsizei count = getI32(r);
+			GLboolean transpose = (GLboolean)getU32(r);
+			data = getBlob(r, &bytes);
+			if (NULL != data) glUniformMatrix4fv(location, count, transpose, floats(replay, data, bytes));
+			break;
+		}
+		case PGTC_UseProgram:
+			replay->currentProgram = getU32(r);
+			glUseProgram(mapGet(&replay->objects, replay->currentProgram));
+			break;
+		case PGTC_VertexAttrib4fv:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			GLfloat values[4];
+			for (int i = 0; i < 4; i++) values[i] = getF32(r);
+			if (index >= 0) glVertexAttrib4fv(index, values);
+			break;
+		}
+		case PGTC_VertexAttribDivisor:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			GLuint divisor = getU32(r);
+			if (index >= 0) vertexAttribDivisor(replay, index, divisor);
+			break;
+		}
+		case PGTC_VertexAttribPointer:
+		{
+			GLint index = attribLocation(replay, getI32(r));
+			GLint size = getI32(r);
+			GLenum type = getU32(r);
+			GLboolean normalized = (GLboolean)getU32(r);
+			GLsizei stride = getI32(r);
+			uint32_t offset = getU32(r);
+			// Client memory is set up by the PGTC_ClientArray before each draw
+			if (~0u != offset && index >= 0)
+			{
+				glVertexAttribPointer(index, size, type, normalized, stride, (const GLvoid *)(uintptr_t)offset);
+			}
+			break;
+		}
+		case PGTC_Viewport:
+		{
+			GLint x = getI32(r), y = getI32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			completeFramebuffer(replay, width, height);
+			glViewport(x, y, width, height);
+			break;
+		}
+		case PGTC_Scissor:
+		{
+			GLint x = getI32(r), y = getI32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			glScissor(x, y, width, height);
+			break;
+		}
+#ifdef GL_ES_VERSION_3_0
+		case PGTC_MapBufferRange:
+		{
+			GLenum target = getU32(r);
+			GLintptr offset = getU32(r);
+			GLsizeiptr length = getU32(r);
+			glMapBufferRange(target, offset, length, getU32(r));
+			break;
+		}
+		case PGTC_UnmapBuffer:
+			glUnmapBuffer(getU32(r));
+			break;
+		case PGTC_FenceSync:
+			setSync(replay, getU32(r), glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+			break;
+		case PGTC_ClientWaitSync:
+		{
+			GLsync sync = getSync(replay, getU32(r));
+			GLbitfield flags = getU32(r);
+			GLuint64 timeout = getU64(r);
+			if (NULL != sync) glClientWaitSync(sync, flags, timeout);
+			break;
+		}
+		case PGTC_DeleteSync:
+		{
+			uint32_t id = getU32(r);
+			GLsync sync = getSync(replay, id);
+			if (NULL != sync) glDeleteSync(sync);
+			setSync(replay, id, NULL);
+			break;
+		}
+		case PGTC_RenderbufferStorageMultisample:
+		{
+			GLenum target = getU32(r);
+			GLsizei samples = getI32(r);
+			GLenum format = getU32(r);
+			GLsizei width = getI32(r);
+			glRenderbufferStorageMultisample(target, samples, format, width, getI32(r));
+			break;
+		}
+		case PGTC_BlitFramebuffer:
+		{
+			GLint srcX0 = getI32(r), srcY0 = getI32(r), srcX1 = getI32(r), srcY1 = getI32(r);
+			GLint dstX0 = getI32(r), dstY0 = getI32(r), dstX1 = getI32(r), dstY1 = getI32(r);
+			GLbitfield mask = getU32(r);
+			glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, getU32(r));
+			break;
+		}
+		case PGTC_InvalidateFramebuffer:
+		{
+			GLenum target = getU32(r);
+			GLsizei count = getI32(r);
+			GLenum attachments[4];
+			if (count < 0 || count > 4)
+			{
+				r->overrun = 1;
+				break;
+			}
+			for (GLsizei i = 0; i < count; i++)
+			{
+				attachments[i] = getU32(r);
+			}
+			glInvalidateFramebuffer(target, count, attachments);
+			break;
+		}
+		case PGTC_GetUniformBlockIndex:
+		{
+			uint32_t program = getU32(r);
+			data = getBlob(r, &bytes);
+			GLint recorded = getI32(r);
+			if (NULL == data || recorded < 0) break;
+
+			char *name = scratch(replay, bytes + 1);
+			if (NULL == name) break;
+			memcpy(name, data, bytes);
+			name[bytes] = '\0';
+
+			struct ProgramLocations *p = programLocations(replay, program, 1);
+			if (NULL != p) locationSet(&p->blocks, recorded, glGetUniformBlockIndex(mapGet(&replay->objects, program), name));
+			break;
+		}
+		case PGTC_UniformBlockBinding:
+		{
+			uint32_t program = getU32(r);
+			GLint index = getI32(r);
+			GLuint binding = getU32(r);
+			struct ProgramLocations *p = programLocations(replay, program, 0);
+			glUniformBlockBinding(mapGet(&replay->objects, program), locationGet(NULL != p ? &p->blocks : NULL, index), binding);
+			break;
+		}
+		case PGTC_BindBufferRange:
+		{
+			GLenum target = getU32(r);
+			GLuint index = getU32(r);
+			GLuint buffer = mapGet(&replay->buffers, getU32(r));
+			GLintptr offset = getU32(r);
+			glBindBufferRange(target, index, buffer, offset, getU32(r));
+			break;
+		}
+#endif
+		case PGTC_GenTextures:
+			genNames(r, &replay->textures, glGenTextures);
+			break;
+		case PGTC_BindTexture:
+		{
+			GLenum target = getU32(r);
+			glBindTexture(target, mapGet(&replay->textures, getU32(r)));
+			break;
+		}
+		case PGTC_TexParameteri:
+		{
+			GLenum target = getU32(r), name = getU32(r);
+			glTexParameteri(target, name, getI32(r));
+			break;
+		}
+		case PGTC_TexImage2D:
+		{
+			GLenum target = getU32(r);
+			GLint level = getI32(r), internalFormat = getI32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			GLint border = getI32(r);
+			GLenum format = getU32(r), type = getU32(r);
+			data = getBlob(r, &bytes);
+			glTexImage2D(target, level, internalFormat, width, height, border, format, type, bytes > 0 && NULL != data ? pixels(replay, data, bytes) : NULL);
+			break;
+		}
+		case PGTC_TexSubImage2D:
+		{
+			GLenum target = getU32(r);
+			GLint level = getI32(r), x = getI32(r), y = getI32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			GLenum format = getU32(r), type = getU32(r);
+			data = getBlob(r, &bytes);
+			if (NULL != data) glTexSubImage2D(target, level, x, y, width, height, format, type, pixels(replay, data, bytes));
+			break;
+		}
+		case PGTC_CompressedTexImage2D:
+		{
+			GLenum target = getU32(r);
+			GLint level = getI32(r);
+			GLenum internalFormat = getU32(r);
+			GLsizei width = getI32(r), height = getI32(r);
+			GLint border = getI32(r);
+			data = getBlob(r, &bytes);
+			if (NULL != data) glCompressedTexImage2D(target, level, internalFormat, width, height, border, (GLsizei)bytes, pixels(replay, data, bytes));
+			break;
+		}
+		case PGTC_BlendEquationSeparate:
+		{
+			GLenum modeRGB = getU32(r);
+			glBlendEquationSeparate(modeRGB, getU32(r));
+			break;
+		}
+		case PGTC_BlendFuncSeparate:
+		{
+			GLenum srcRGB = getU32(r);
+			GLenum dstRGB = getU32(r);
+			GLenum srcAlpha = getU32(r);
+			glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, getU32(r));
+			break;
+		}
+		case PGTC_ColorMask:
+		{
+			GLboolean red = getU32(r);
+			GLboolean green = getU32(r);
+			GLboolean blue = getU32(r);
+			glColorMask(red, green, blue, getU32(r));
+			break;
+		}
+		case PGTC_CullFace:
+			glCullFace(getU32(r));
+			break;
+		case PGTC_DepthFunc:
+			glDepthFunc(getU32(r));
+			break;
+		case PGTC_DepthMask:
+			glDepthMask(getU32(r));
+			break;
+		case PGTC_Disable:
+			glDisable(getU32(r));
+			break;
+		case PGTC_Enable:
+			glEnable(getU32(r));
+			break;
+		case PGTC_FrontFace:
+			glFrontFace(getU32(r));
+			break;
+		case PGTC_PolygonOffset:
+		{
+			GLfloat factor = getF32(r);
+			glPolygonOffset(factor, getF32(r));
+			break;
+		}
+		case PGTC_StencilFunc:
+		{
+			GLenum func = getU32(r);
+			GLint ref = getI32(r);
+			glStencilFunc(func, ref, getU32(r));
+			break;
+		}
+		case PGTC_StencilMask:
+			glStencilMask(getU32(r));
+			break;
+		case PGTC_StencilOp:
+		{
+			GLenum fail = getU32(r);
+			GLenum zfail = getU32(r);
+			glStencilOp(fail, zfail, getU32(r));
+			break;
+		}
+		case PGTC_FramebufferTexture2D:
+		{
+			GLenum target = getU32(r);
+			GLenum attachment = getU32(r);
+			GLenum textureTarget = getU32(r);
+			GLuint texture = mapGet(&replay->textures, getU32(r));
+			glFramebufferTexture2D(target, attachment, textureTarget, texture, getI32(r));
+			break;
+		}
+		default:
+			fprintf(stderr, "Can't replay call %d.\n", call);
+			r->overrun = 1;
+			break;
+	}
+}
+
+// Reporting /////////////////////////////////////////////////////////////////
+
+struct CallStats {
+	PGTraceCall call;
+	unsigned long count;
+	double seconds;
+};
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static int compareStats(const void *a, const void *b)
+{
+	const struct CallStats *x = a, *y = b;
+	return x->seconds < y->seconds ? 1 : x->seconds > y->seconds ? -1 : 0;
+}
+
+static double percentile(const double *sorted, size_t count, double p)
+{
+	size_t index = (size_t)(p * (count - 1) + 0.5);
+	return sorted[index];
+}
+
+static void report(struct CallStats *stats, double *frames, size_t frameCount, double total)
+{
+	unsigned long calls = 0;
+	for (int i = 0; i < PGTC_Count; i++) calls += stats[i].count;
+
+	printf("\n%-28s %10s %12s %10s\n", "call", "count", "total ms", "mean us");
+	qsort(stats, PGTC_Count, sizeof(struct CallStats), compareStats);
+	for (int i = 0; i < PGTC_Count; i++)
+	{
+		if (0 == stats[i].count || PGTC_Frame == stats[i].call) continue;
+		printf("%-28s %10lu %12.3f %10.3f\n", CallNames[stats[i].call], stats[i].count, stats[i].seconds * 1e3, stats[i].seconds * 1e6 / stats[i].count);
+	}
+
+	printf("\n%lu calls in %.3f ms\n", calls, total * 1e3);
+	if (frameCount > 0)
+	{
+		qsort(frames, frameCount, sizeof(double), compareDoubles);
+		double sum = 0;
+		for (size_t i = 0; i < frameCount; i++) sum += frames[i];
+		printf("%zu frames, %.1f calls a frame\n", frameCount, (double)calls / frameCount);
+		printf("frame ms: mean %.3f  median %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+			   sum * 1e3 / frameCount,
+			   percentile(frames, frameCount, 0.5) * 1e3,
+			   percentile(frames, frameCount, 0.95) * 1e3,
+			   percentile(frames, frameCount, 0.99) * 1e3,
+			   frames[frameCount - 1] * 1e3);
+	}
+}
+
+// Main //////////////////////////////////////////////////////////////////////
+
+static unsigned char *readFile(const char *path, size_t *size)
+{
+	FILE *file = fopen(path, "rb");
+	if (NULL == file) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	unsigned char *data = length > 0 ? malloc(length) : NULL;
+	if (NULL != data && 1 != fread(data, length, 1, file))
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+
+	*size = NULL != data ? (size_t)length : 0;
+	return data;
+}
+
+static void printBlob(const char *label, struct Reader *r)
+{
+	uint32_t bytes;
+	const char *text = getBlob(r, &bytes);
+	printf("%s%.*s\n", label, (int)bytes, NULL != text ? text : "");
+}
+
+int main(int argc, char **argv)
+{
+	int finish = 0;
+	const char *path = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--finish")) finish = 1;
+		else path = argv[i];
+	}
+	if (NULL == path)
+	{
+		fprintf(stderr, "Usage: %s [--finish] trace\n", argv[0]);
+		return 1;
+	}
+
+	size_t size;
+	unsigned char *trace = readFile(path, &size);
+	if (NULL == trace)
+	{
+		fprintf(stderr, "Could not read %s.\n", path);
+		return 1;
+	}
+
+	struct Reader r = { trace, trace + size, 0 };
+	const void *magic = getBytes(&r, 4);
+	if (NULL == magic || 0 != memcmp(magic, "PGTR", 4) || PG_TRACE_VERSION != getU32(&r))
+	{
+		fprintf(stderr, "%s is not a version %d trace.\n", path, PG_TRACE_VERSION);
+		return 1;
+	}
+	printBlob("recorded on: ", &r);
+	printBlob("recorded with: ", &r);
+	int width = (int)getU32(&r);
+	int height = (int)getU32(&r);
+
+#ifndef PG_REPLAY_NULL_GL
+	// Stands in for the framebuffer the trace started with
+	PGHeadless headless;
+	if (PGR_OK != pgHeadlessCreate(&headless, width > 0 ? width : 1, height > 0 ? height : 1)) return 1;
+#else
+	(void)width;
+	(void)height;
+#endif
+	printf("replaying on: %s\n", (const char *)glGetString(GL_RENDERER));
+
+	struct Replay replay;
+	memset(&replay, 0, sizeof(replay));
+	const char *version = (const char *)glGetString(GL_VERSION);
+	replay.es3 = NULL != version && 0 == strncmp(version, "OpenGL ES 3", 11);
+
+	struct CallStats stats[PGTC_Count];
+	memset(stats, 0, sizeof(stats));
+	for (int i = 0; i < PGTC_Count; i++) stats[i].call = (PGTraceCall)i;
+
+	double *frames = NULL;
+	size_t frameCount = 0, frameCapacity = 0;
+
+	double start = now();
+	double frameStart = -1;
+	while (r.p < r.end && !r.overrun)
+	{
+		PGTraceCall call = (PGTraceCall)*r.p++;
+		if (call >= PGTC_Count)
+		{
+			fprintf(stderr, "Unknown call %d at offset %ld.\n", call, (long)(r.p - trace - 1));
+			break;
+		}
+
+		double before = now();
+		execute(&replay, &r, call);
+		double after = now();
+		stats[call].count++;
+		stats[call].seconds += after - before;
+
+		if (PGTC_Frame == call)
+		{
+			if (finish) glFinish();
+			double t = now();
+			// Time before the first marker is setup, not a frame
+			if (frameStart >= 0)
+			{
+				if (frameCount == frameCapacity)
+				{
+					frameCapacity = frameCapacity > 0 ? frameCapacity * 2 : 256;
+					frames = realloc(frames, sizeof(double) * frameCapacity);
+					if (NULL == frames) return 1;
+				}
+				frames[frameCount++] = t - frameStart;
+			}
+			frameStart = t;
+		}
+	}
+	double total = now() - start;
+
+	if (r.overrun) fprintf(stderr, "Trace ends part way through a call.\n");
+	report(stats, frames, frameCount, total);
+
+#ifndef PG_REPLAY_NULL_GL
+	pgHeadlessDestroy(&headless);
+#endif
+	free(frames);
+	free(trace);
+	return r.overrun ? 1 : 0;
+}
@@ -0,0 +1,229 @@
+//
+//  schedcheck.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Checks PGFrameScheduler against a simulated clock: which ticks render
+//  after invalidations, while idle, for deadlines, while animating, with
+//  work pending and in continuous mode, and when `wake` is called. Then
+//  races near deadlines against far ones, both set from other threads
+//  while ticking, to check the near ones are never lost. Needs no GL:
+//
+//      cc -std=gnu99 -O2 -Icore/src -o schedcheck tools/schedcheck/schedcheck.c
+//          core/src/*.c tools/nullgl/PGNullGL.c -lm -lpthread
+//
+//  Usage: schedcheck
+//
+//  Exits with 1 if any check fails.
+//
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Pictogram.h"
+
+// A 60Hz display
+#define TICK_MICROSECONDS 16667
+
+// Near deadlines raced against far ones and ticks, and how many ticks past
+// one it is lost
+#define RACE_DEADLINES 20000
+#define RACE_LOST_TICKS 1000
+#define RACE_FAR_TICKS (RACE_LOST_TICKS * 10)
+
+static uint64_t Clock;
+static unsigned long Wakes;
+static GLboolean Work;
+static int Failures;
+
+static uint64_t simulatedNow(void *userData)
+{
+	(void)userData;
+	return __atomic_load_n(&Clock, __ATOMIC_ACQUIRE);
+}
+
+static GLboolean workPending(void *userData)
+{
+	(void)userData;
+	return Work;
+}
+
+static void wake(void *userData)
+{
+	(void)userData;
+	__atomic_add_fetch(&Wakes, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Ticks `count` times and returns how many rendered.
+ */
+static int tick(PGFrameScheduler scheduler, int count)
+{
+	int rendered = 0;
+	for (int i = 0; i < count; i++)
+	{
+		Clock += TICK_MICROSECONDS;
+		if (pgFrameSchedulerShouldRender(scheduler)) rendered++;
+	}
+	return rendered;
+}
+
+static void check(GLboolean passed, const char *what)
+{
+	printf("%-4s %s\n", passed ? "ok" : "FAIL", what);
+	if (!passed) Failures++;
+}
+
+static void checkOnDemand(void)
+{
+	PGFrameSchedulerCallbacks callbacks = { simulatedNow, workPending, wake, NULL };
+	PGFrameScheduler scheduler;
+	pgFrameSchedulerCreate(&scheduler, &callbacks);
+
+	check(1 == tick(scheduler, 10), "the first frame renders");
+	check(0 == tick(scheduler, 10), "idle ticks skip");
+	check(PG_FRAME_SCHEDULER_IDLE == pgFrameSchedulerNextFrameTime(scheduler), "idle with nothing waiting");
+
+	unsigned long wakes = Wakes;
+	pgFrameSchedulerInvalidate(scheduler);
+	pgFrameSchedulerInvalidate(scheduler);
+	check(wakes + 1 == Wakes, "invalidating twice wakes once");
+	check(0 == pgFrameSchedulerNextFrameTime(scheduler), "invalidated wants the next tick");
+	check(1 == tick(scheduler, 10), "invalidating twice renders once");
+
+	wakes = Wakes;
+	pgFrameSchedulerBeginAnimation(scheduler);
+	pgFrameSchedulerBeginAnimation(scheduler);
+	check(wakes + 1 == Wakes, "nested animations wake once");
+	check(10 == tick(scheduler, 10), "animating renders every tick");
+	pgFrameSchedulerEndAnimation(scheduler);
+	check(10 == tick(scheduler, 10), "an inner animation ending keeps rendering");
+	pgFrameSchedulerEndAnimation(scheduler);
+	check(1 == tick(scheduler, 10), "the last animation ending renders where it stopped");
+
+	wakes = Wakes;
+	uint64_t deadline = Clock + 3 * TICK_MICROSECONDS + 1;
+	pgFrameSchedulerInvalidateAt(scheduler, deadline + TICK_MICROSECONDS);
+	pgFrameSchedulerInvalidateAt(scheduler, deadline);
+	pgFrameSchedulerInvalidateAt(scheduler, deadline + 2 * TICK_MICROSECONDS);
+	check(wakes + 1 == Wakes, "a deadline wakes an idle scheduler once");
+	check(deadline == pgFrameSchedulerNextFrameTime(scheduler), "the earliest deadline wins");
+	check(0 == tick(scheduler, 3), "ticks before the deadline skip");
+	check(1 == tick(scheduler, 1), "the tick reaching the deadline renders");
+	check(0 == tick(scheduler, 10), "a deadline renders once");
+	check(PG_FRAME_SCHEDULER_IDLE == pgFrameSchedulerNextFrameTime(scheduler), "idle after the deadline");
+
+	Work = GL_TRUE;
+	check(0 == pgFrameSchedulerNextFrameTime(scheduler), "pending work wants the next tick");
+	check(10 == tick(scheduler, 10), "pending work renders every tick");
+	Work = GL_FALSE;
+	check(0 == tick(scheduler, 10), "finished work goes idle");
+
+	wakes = Wakes;
+	pgFrameSchedulerSetMode(scheduler, PGFS_Continuous);
+	check(wakes + 1 == Wakes, "going continuous wakes");
+	check(10 == tick(scheduler, 10), "continuous renders every tick");
+	pgFrameSchedulerSetMode(scheduler, PGFS_OnDemand);
+	check(0 == tick(scheduler, 10), "back on demand goes idle");
+
+	PGFrameSchedulerStats stats;
+	pgFrameSchedulerStats(scheduler, &stats);
+	check(stats.ticks == stats.framesRendered + stats.framesSkipped, "stats add up");
+	check(stats.wakes == Wakes, "stats count wakes");
+
+	pgFrameSchedulerDestroy(&scheduler);
+}
+
+typedef struct
+{
+	PGFrameScheduler scheduler;
+	uint64_t lastRender;	// Clock of the last tick which rendered
+	GLboolean done;
+	unsigned long lost;
+}
+Race;
+
+/**
+ * Sets a deadline a tick or two ahead and waits until a tick at or after
+ * it renders, over and over.
+ */
+static void *setNearDeadlines(void *data)
+{
+	Race *race = data;
+	for (int i = 0; i < RACE_DEADLINES; i++)
+	{
+		uint64_t deadline = simulatedNow(NULL) + 1 + (i & 1);
+		pgFrameSchedulerInvalidateAt(race->scheduler, deadline);
+
+		// Ticks store lastRender before the clock moves on, so once the
+		// clock is well past a deadline which hasn't rendered it never will
+		for (;;)
+		{
+			uint64_t now = simulatedNow(NULL);
+			if (__atomic_load_n(&race->lastRender, __ATOMIC_ACQUIRE) >= deadline) break;
+			if (now > deadline + RACE_LOST_TICKS)
+			{
+				race->lost++;
+				break;
+			}
+			sched_yield();
+		}
+	}
+	__atomic_store_n(&race->done, GL_TRUE, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/**
+ * Keeps asking for frames long after the near ones, which must not
+ * replace them.
+ */
+static void *setFarDeadlines(void *data)
+{
+	Race *race = data;
+	while (!__atomic_load_n(&race->done, __ATOMIC_ACQUIRE))
+	{
+		pgFrameSchedulerInvalidateAt(race->scheduler, simulatedNow(NULL) + RACE_FAR_TICKS);
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void checkDeadlineRace(void)
+{
+	PGFrameSchedulerCallbacks callbacks = { simulatedNow, NULL, NULL, NULL };
+	Race race = { NULL, 0, GL_FALSE, 0 };
+	pgFrameSchedulerCreate(&race.scheduler, &callbacks);
+	__atomic_store_n(&Clock, 0, __ATOMIC_RELEASE);
+	pgFrameSchedulerShouldRender(race.scheduler);
+
+	pthread_t near, far;
+	if (0 != pthread_create(&near, NULL, setNearDeadlines, &race))
+	{
+		check(GL_FALSE, "deadlines set from other threads");
+		pgFrameSchedulerDestroy(&race.scheduler);
+		return;
+	}
+	GLboolean farStarted = 0 == pthread_create(&far, NULL, setFarDeadlines, &race);
+	while (!__atomic_load_n(&race.done, __ATOMIC_ACQUIRE))
+	{
+		uint64_t now = __atomic_add_fetch(&Clock, 1, __ATOMIC_ACQ_REL);
+		if (pgFrameSchedulerShouldRender(race.scheduler)) __atomic_store_n(&race.lastRender, now, __ATOMIC_RELEASE);
+		sched_yield();
+	}
+	pthread_join(near, NULL);
+	if (farStarted) pthread_join(far, NULL);
+
+	if (0 != race.lost) printf("     %lu of %d deadlines lost\n", race.lost, RACE_DEADLINES);
+	check(farStarted && 0 == race.lost, "no deadline set from other threads is lost");
+	pgFrameSchedulerDestroy(&race.scheduler);
+}
+
+int main(void)
+{
+	checkOnDemand();
+	checkDeadlineRace();
+
+	printf("%d failed\n", Failures);
+	return 0 == Failures ? 0 : 1;
+}
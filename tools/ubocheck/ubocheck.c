@@ -0,0 +1,145 @@
+//
+//  ubocheck.c
+//
+//  Created by David Wagner on 17/10/2012.
+//  Copyright (c) 2012 Noise & Heat. All rights reserved.
+//
+//  Checks that programs declaring a shared uniform block with different
+//  members agree on it: a program with fewer members and one with more
+//  both draw with the right values, whichever the uniform buffer sees
+//  first, and a program with a member moved is refused. Needs OpenGL ES 3
+//  in a headless context:
+//
+//      cc -std=gnu99 -O2 -Icore/src -Ilinux/src -o ubocheck
+//          tools/ubocheck/ubocheck.c core/src/*.c linux/src/*.c
+//          -lEGL -lGLESv2 -lm -lpthread
+//
+//  Usage: ubocheck [shader directory]
+//
+//  The shaders are in tools/ubocheck, the default. Exits with 1 if any
+//  check fails.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Pictogram.h"
+#include "PGHeadless.h"
+
+#define SIZE 8
+
+static const GLfloat Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+static const GLfloat Tint[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+
+static const char *Directory = "tools/ubocheck";
+static int Failures;
+
+static void check(GLboolean passed, const char *what)
+{
+	printf("%-4s %s\n", passed ? "ok" : "FAIL", what);
+	if (!passed) Failures++;
+}
+
+static GLboolean near(GLubyte value, GLfloat expected)
+{
+	int difference = (int)value - (int)(expected * 255.0f + 0.5f);
+	return difference >= -1 && difference <= 1;
+}
+
+static PGResult build(PGProgram *program, const char *vertex)
+{
+	char vertexPath[1024], fragmentPath[1024];
+	snprintf(vertexPath, sizeof(vertexPath), "%s/%s", Directory, vertex);
+	snprintf(fragmentPath, sizeof(fragmentPath), "%s/colour.fsh", Directory);
+	return pgProgramCreateAndBuild(program, vertexPath, fragmentPath);
+}
+
+/**
+ * Clears, draws a full screen triangle with the program and reads the
+ * middle pixel back.
+ */
+static PGResult draw(PGRenderer renderer, PGMesh mesh, PGProgram program, GLubyte pixel[4])
+{
+	pgRendererClear(renderer, 0, 0, 0, 0);
+	pgRendererUseProgram(renderer, program);
+	PGResult result = pgRendererDrawMesh(renderer, mesh, GL_TRIANGLES);
+	pgRendererReadPixels(renderer, SIZE / 2, SIZE / 2, 1, 1, pixel);
+	return result;
+}
+
+static void checkOrder(const char *first, const char *second)
+{
+	PGHeadless headless;
+	if (PGR_OK != pgHeadlessCreate(&headless, SIZE, SIZE))
+	{
+		check(GL_FALSE, "a GL context");
+		return;
+	}
+	PGRenderer renderer = pgHeadlessRenderer(headless);
+	pgRendererSetupOffscreen(renderer, SIZE, SIZE);
+	PGUniformBuffer uniforms = pgRendererUniforms(renderer);
+	if (!pgUniformBufferIsSupported(uniforms))
+	{
+		printf("skip uniform buffers aren't supported\n");
+		pgHeadlessDestroy(&headless);
+		return;
+	}
+
+	PGProgram shortProgram = PG_NULL_HANDLE, longProgram = PG_NULL_HANDLE, movedProgram = PG_NULL_HANDLE;
+	PGMesh mesh = PG_NULL_HANDLE;
+	if (PGR_OK != build(&shortProgram, "short.vsh") || PGR_OK != build(&longProgram, "long.vsh") || PGR_OK != build(&movedProgram, "moved.vsh"))
+	{
+		check(GL_FALSE, "the shaders build");
+	}
+	else
+	{
+		PGUniformMember members[] = { { "viewMatrix", GL_FLOAT_MAT4, 1 }, { "tint", GL_FLOAT_VEC4, 1 } };
+		pgUniformBufferDeclare(uniforms, PGUB_View, members, 2);
+
+		PGVertexAttrib attribs[] = { { "position", 2, GL_FLOAT, GL_FALSE, 0 } };
+		static const GLfloat triangle[] = { -1, -1, 3, -1, -1, 3 };
+		pgMeshCreate(&mesh, triangle, 2 * sizeof(GLfloat), 3, attribs, 1);
+
+		pgRendererBeginFrame(renderer);
+		pgUniformBufferSet(uniforms, PGUB_View, "viewMatrix", Identity);
+		pgUniformBufferSet(uniforms, PGUB_View, "tint", Tint);
+
+		char what[128];
+		GLubyte pixel[4];
+		PGProgram order[2] = { 0 == strcmp(first, "short") ? shortProgram : longProgram, 0 == strcmp(second, "short") ? shortProgram : longProgram };
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				PGResult result = draw(renderer, mesh, order[i], pixel);
+				GLboolean isShort = order[i] == shortProgram;
+				GLboolean right = isShort
+					? 255 == pixel[0] && 0 == pixel[1] && 0 == pixel[2]
+					: near(pixel[0], Tint[0]) && near(pixel[1], Tint[1]) && near(pixel[2], Tint[2]);
+				snprintf(what, sizeof(what), "%s then %s: the %s program draws%s", first, second, isShort ? "short" : "long", pass > 0 ? " again" : "");
+				check(PGR_OK == result && right, what);
+			}
+		}
+
+		snprintf(what, sizeof(what), "%s then %s: a program with a member moved is refused", first, second);
+		check(PGR_InvalidProgram == draw(renderer, mesh, movedProgram, pixel), what);
+		pgRendererEndFrame(renderer);
+	}
+
+	pgMeshDestroy(&mesh);
+	pgProgramDestroy(&shortProgram);
+	pgProgramDestroy(&longProgram);
+	pgProgramDestroy(&movedProgram);
+	pgHeadlessDestroy(&headless);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) Directory = argv[1];
+
+	checkOrder("short", "long");
+	checkOrder("long", "short");
+
+	printf("%d failed\n", Failures);
+	return 0 == Failures ? 0 : 1;
+}